@@ -37,11 +37,7 @@ class LayerNorm:
     self.eps = eps
 
   def __call__(self, f, x):
-    mean = f.mean(x, axis=-1, keepdims=True)
-    variance = f.mean(f.square(f.sub(x, mean)), axis=-1, keepdims=True)
-    norm = f.mul(f.sub(x, mean),
-                 f.div(1.0, f.sqrt(f.add(variance, self.eps))))
-    return f.add(f.mul(norm, self.scale), self.bias)
+    return f.layer_norm(x, self.scale, self.bias, self.eps)
 
 class Linear:
   def __init__(self, f, num_inputs, num_outputs, bias=True, name=None):
@@ -655,9 +655,26 @@ class Builder:
       v.producer.add_attr("axis", axis)
     return v
 
+  def log_softmax(self, x, axis=None, name=None):
+    v = self.op("LogSoftMax", [x], name)
+    if axis:
+      if axis < 0: axis = len(x.shape) + axis
+      v.producer.add_attr("axis", axis)
+    return v
+
   def logsumexp(self, x, axis=None, keepdims=None, name=None):
     return self.reduce("LogSumExp", x, axis, keepdims, name)
 
+  def layer_norm(self, x, gamma=None, beta=None, epsilon=1e-6, name=None):
+    if (gamma is None) != (beta is None):
+      raise TypeError("layer norm needs both scale and bias")
+    args = [x]
+    if gamma is not None: args += [gamma, beta]
+    v = self.op("LayerNorm", args, name)
+    v.shape = x.shape.copy()
+    v.producer.add_attr("epsilon", epsilon)
+    return v
+
   def ref(self, instance, var, name=None):
     r = self.op("Reference", [instance], name)
     r.producer.add_attr("var", var.name)
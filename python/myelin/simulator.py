@@ -60,6 +60,21 @@ def softmax(x, axis=None):
     e = np.exp(x - np.max(x, axis=axis, keepdims=True))
     return e / e.sum(axis=axis, keepdims=True)
 
+def log_softmax(x, axis=None):
+  if axis is None:
+    m = np.max(x)
+    return x - m - np.log(np.exp(x - m).sum())
+  else:
+    m = np.max(x, axis=axis, keepdims=True)
+    return x - m - np.log(np.exp(x - m).sum(axis=axis, keepdims=True))
+
+def layer_norm(x, gamma=None, beta=None, epsilon=1e-6):
+  mean = np.mean(x, axis=-1, keepdims=True)
+  variance = np.mean(np.square(x - mean), axis=-1, keepdims=True)
+  y = (x - mean) / np.sqrt(variance + epsilon)
+  if gamma is not None: y = y * gamma + beta
+  return y
+
 def logsumexp(x, axis=None, keepdims=False):
   m = np.amax(x, axis=axis, keepdims=True)
   y = np.log(np.sum(np.exp(x - m), axis=axis, keepdims=keepdims))
@@ -211,7 +226,18 @@ def compute(flow, f, data):
         v[o[0]] = softmax(v[i[0]])
       else:
         v[o[0]] = softmax(v[i[0]], axis=int(axis))
-
+    elif op.type == "LogSoftMax":
+      axis = op.attrs.get("axis")
+      if axis is None:
+        v[o[0]] = log_softmax(v[i[0]])
+      else:
+        v[o[0]] = log_softmax(v[i[0]], axis=int(axis))
+    elif op.type == "LayerNorm":
+      epsilon = float(op.attrs.get("epsilon", 1e-6))
+      if len(i) == 3:
+        v[o[0]] = layer_norm(v[i[0]], v[i[1]], v[i[2]], epsilon)
+      else:
+        v[o[0]] = layer_norm(v[i[0]], epsilon=epsilon)
     elif op.type == "LogSumExp":
       axis = op.attrs.get("axis")
       if axis is None:
@@ -35,6 +35,12 @@ flags.define("--custom_search_config",
              metavar="CONFIG",
              help="search configuration for custom index")
 
+flags.define("--search_index_version",
+             default=2,
+             type=int,
+             metavar="NUM",
+             help="search index format (1=plain, 2=compressed posting lists)")
+
 class SearchWorkflow:
   def __init__(self, name=None):
     self.wf = Workflow(name)
@@ -120,7 +126,9 @@ class SearchWorkflow:
       postings = self.wf.shuffle(terms, bufsize=512 * 1024 * 1024)
 
       # Collect entities and terms and build search index.
-      builder = self.wf.task("search-index-builder")
+      builder = self.wf.task("search-index-builder", params={
+        "version": flags.arg.search_index_version,
+      })
       builder.attach_input("config", config)
       self.wf.connect(documents, builder, name="documents")
       self.wf.connect(postings, builder, name="terms")
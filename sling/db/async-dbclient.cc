@@ -0,0 +1,387 @@
+// Copyright 2025 Ringgaard Research ApS
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "sling/db/async-dbclient.h"
+
+#include <sys/socket.h>
+
+#include "sling/base/logging.h"
+
+namespace sling {
+
+// Client whose completion callbacks are run by the current thread.
+static thread_local const AsyncDBClient *callback_client = nullptr;
+
+// Return truncation error.
+static Status Truncated() {
+  return Status(EBADMSG, "packet truncated");
+}
+
+// Return error for waiting in completion callback.
+static Status Deadlock() {
+  return Status(EDEADLK, "Cannot wait for completion in callback");
+}
+
+// Read record from DBGET reply.
+static Status ReadRecord(IOBuffer *buffer, DBRecord *record) {
+  uint32 ksize;
+  if (!buffer->Read(&ksize, 4)) return Truncated();
+  bool has_version = ksize & 1;
+  ksize >>= 1;
+  if (buffer->available() < ksize) return Truncated();
+  record->key = Slice(buffer->Consume(ksize), ksize);
+
+  record->version = 0;
+  if (has_version) {
+    if (!buffer->Read(&record->version, 8)) return Truncated();
+  }
+
+  uint32 vsize;
+  if (!buffer->Read(&vsize, 4)) return Truncated();
+  if (buffer->available() < vsize) return Truncated();
+  record->value = Slice(buffer->Consume(vsize), vsize);
+  return Status::OK;
+}
+
+AsyncDBClient::~AsyncDBClient() {
+  Close();
+}
+
+Status AsyncDBClient::Connect(const string &database, const string &agent) {
+  CHECK(!running_) << "Already connected";
+
+  // Connect to database server.
+  string hostname;
+  string portname;
+  string dbname;
+  DBClient::ParseDatabaseName(database, &hostname, &portname, &dbname);
+  Status st = Client::Connect(hostname, portname, "slingdb", agent);
+  if (!st.ok()) return st;
+
+  // Switch to database.
+  if (!dbname.empty()) {
+    IOBuffer request;
+    IOBuffer response;
+    uint32 reply;
+    request.Write(dbname);
+    st = Perform(DBUSE, &request, &reply, &response);
+    if (!st.ok()) return st;
+    if (reply == DBERROR) return Status(EINVAL, response.data());
+  }
+
+  // Start sender and receiver threads.
+  sender_.SetJoinable(true);
+  receiver_.SetJoinable(true);
+  sender_.Start();
+  receiver_.Start();
+  running_ = true;
+
+  return Status::OK;
+}
+
+Status AsyncDBClient::Close() {
+  if (InCallback()) return Deadlock();
+  Status st;
+  if (running_) {
+    // Wait for outstanding operations.
+    st = Wait();
+
+    // Stop sender and receiver threads.
+    {
+      std::unique_lock<std::mutex> lock(mu_);
+      stop_ = true;
+      queued_.notify_all();
+      sent_.notify_all();
+    }
+    sender_.Join();
+    receiver_.Join();
+    running_ = false;
+  }
+
+  Status cst = Client::Close();
+  return st.ok() ? cst : st;
+}
+
+void AsyncDBClient::Get(const Slice &key, Completion done) {
+  DBRecord record;
+  record.key = key;
+  Enqueue(DBGET, DBOVERWRITE, record, std::move(done));
+}
+
+void AsyncDBClient::Put(const DBRecord &record, Completion done, DBMode mode) {
+  Enqueue(DBPUT, mode, record, std::move(done));
+}
+
+Status AsyncDBClient::Get(const Slice &key, string *value) {
+  std::vector<Slice> keys = {key};
+  std::vector<string> values;
+  Status st = Get(keys, &values);
+  if (st.ok()) value->swap(values[0]);
+  return st;
+}
+
+Status AsyncDBClient::Get(const std::vector<Slice> &keys,
+                          std::vector<string> *values) {
+  values->clear();
+  values->resize(keys.size());
+  if (keys.empty()) return Status::OK;
+  if (InCallback()) return Deadlock();
+
+  std::mutex mu;
+  std::condition_variable done;
+  int remaining = keys.size();
+  Status result;
+  for (int i = 0; i < keys.size(); ++i) {
+    Get(keys[i], [&, i](const Status &st, const DBRecord &record) {
+      std::unique_lock<std::mutex> lock(mu);
+      if (st.ok()) {
+        (*values)[i].assign(record.value.data(), record.value.size());
+      } else if (result.ok()) {
+        result = st;
+      }
+      if (--remaining == 0) done.notify_all();
+    });
+  }
+
+  std::unique_lock<std::mutex> lock(mu);
+  while (remaining > 0) done.wait(lock);
+  return result;
+}
+
+Status AsyncDBClient::Put(std::vector<DBRecord> *records, DBMode mode) {
+  if (records->empty()) return Status::OK;
+  if (InCallback()) return Deadlock();
+
+  std::mutex mu;
+  std::condition_variable done;
+  int remaining = records->size();
+  Status result;
+  for (int i = 0; i < records->size(); ++i) {
+    Put((*records)[i], [&, i](const Status &st, const DBRecord &record) {
+      std::unique_lock<std::mutex> lock(mu);
+      if (st.ok()) {
+        (*records)[i].result = record.result;
+      } else if (result.ok()) {
+        result = st;
+      }
+      if (--remaining == 0) done.notify_all();
+    }, mode);
+  }
+
+  std::unique_lock<std::mutex> lock(mu);
+  while (remaining > 0) done.wait(lock);
+  return result;
+}
+
+Status AsyncDBClient::Wait() {
+  if (InCallback()) return Deadlock();
+  std::unique_lock<std::mutex> lock(mu_);
+  while (pending_ > 0) idle_.wait(lock);
+  return status_;
+}
+
+AsyncDBClient::Batch *AsyncDBClient::Open(DBVerb verb, DBMode mode) {
+  // Add operation to the last batch in the queue if it is compatible.
+  if (!queue_.empty()) {
+    Batch *last = queue_.back();
+    if (last->verb == verb &&
+        last->mode == mode &&
+        last->completions.size() < max_batch_) {
+      return last;
+    }
+  }
+
+  // Start new batch.
+  Batch *batch = new Batch(verb, mode);
+  if (verb == DBPUT) batch->request.Write(&mode, 4);
+  queue_.push_back(batch);
+  return batch;
+}
+
+void AsyncDBClient::Enqueue(DBVerb verb, DBMode mode, const DBRecord &record,
+                            Completion done) {
+  std::unique_lock<std::mutex> lock(mu_);
+  if (!running_ || !status_.ok()) {
+    Status st = running_ ? status_ : Status(ENOTCONN, "Not connected");
+    lock.unlock();
+    done(st, record);
+    return;
+  }
+
+  // Add operation to batch.
+  Batch *batch = Open(verb, mode);
+  IOBuffer *request = &batch->request;
+  if (verb == DBPUT) {
+    uint32 ksize = record.key.size() << 1;
+    if (record.version != 0) ksize |= 1;
+    request->Write(&ksize, 4);
+    request->Write(record.key);
+    if (record.version != 0) request->Write(&record.version, 8);
+    uint32 vsize = record.value.size();
+    request->Write(&vsize, 4);
+    request->Write(record.value);
+  } else {
+    uint32 ksize = record.key.size();
+    request->Write(&ksize, 4);
+    request->Write(record.key);
+  }
+  batch->completions.push_back(std::move(done));
+  pending_++;
+  queued_.notify_one();
+}
+
+void AsyncDBClient::Sender() {
+  for (;;) {
+    // Wait until there is a batch to send and room in the pipeline. Operations
+    // from concurrent callers are accumulated in the queued batches while the
+    // pipeline is full.
+    Batch *batch;
+    bool ok;
+    {
+      std::unique_lock<std::mutex> lock(mu_);
+      while (!stop_ &&
+             (queue_.empty() || inflight_.size() >= max_outstanding_)) {
+        queued_.wait(lock);
+      }
+      if (queue_.empty()) return;
+      batch = queue_.front();
+      queue_.pop_front();
+      ok = status_.ok();
+    }
+
+    // Send request to server. Batches queued after a connection error are
+    // failed by the receiver.
+    if (ok) {
+      Status st = Send(batch->verb, &batch->request);
+      if (!st.ok()) SetError(st);
+    }
+
+    // Hand over batch to receiver. This is done after the request has been
+    // sent, since the receiver deletes the batch when the reply arrives.
+    {
+      std::unique_lock<std::mutex> lock(mu_);
+      inflight_.push_back(batch);
+      sent_.notify_one();
+    }
+  }
+}
+
+bool AsyncDBClient::InCallback() const {
+  return callback_client == this;
+}
+
+void AsyncDBClient::Receiver() {
+  // Completion callbacks are run by the receiver thread.
+  callback_client = this;
+  IOBuffer response;
+  for (;;) {
+    // Wait for next request.
+    Batch *batch;
+    Status st;
+    {
+      std::unique_lock<std::mutex> lock(mu_);
+      while (!stop_ && inflight_.empty()) sent_.wait(lock);
+      if (inflight_.empty()) return;
+      batch = inflight_.front();
+      st = status_;
+    }
+
+    // Receive reply and complete operations.
+    if (st.ok()) {
+      uint32 reply;
+      st = Receive(&reply, &response);
+      if (st.ok()) {
+        st = Dispatch(batch, reply, &response);
+      } else {
+        Abort(batch, 0, st);
+      }
+      if (!st.ok()) SetError(st);
+    } else {
+      Abort(batch, 0, st);
+    }
+
+    // Remove completed batch.
+    {
+      std::unique_lock<std::mutex> lock(mu_);
+      inflight_.pop_front();
+      pending_ -= batch->completions.size();
+      if (pending_ == 0) idle_.notify_all();
+      queued_.notify_one();
+    }
+    delete batch;
+  }
+}
+
+Status AsyncDBClient::Dispatch(Batch *batch, uint32 reply,
+                               IOBuffer *response) {
+  // Server errors fail all operations in the batch.
+  if (reply == DBERROR) {
+    Abort(batch, 0, Status(EINVAL, response->data()));
+    return Status::OK;
+  }
+
+  int num_ops = batch->completions.size();
+  DBRecord record;
+  if (batch->verb == DBGET) {
+    if (reply != DBRECORD) {
+      Status st(EBADMSG, "Unexpected reply to DBGET");
+      Abort(batch, 0, st);
+      return st;
+    }
+    for (int i = 0; i < num_ops; ++i) {
+      Status st = ReadRecord(response, &record);
+      if (!st.ok()) {
+        Abort(batch, i, st);
+        return st;
+      }
+      batch->completions[i](Status::OK, record);
+    }
+  } else {
+    if (reply != DBRESULT) {
+      Status st(EBADMSG, "Unexpected reply to DBPUT");
+      Abort(batch, 0, st);
+      return st;
+    }
+    for (int i = 0; i < num_ops; ++i) {
+      if (!response->Read(&record.result, 4)) {
+        Status st = Truncated();
+        Abort(batch, i, st);
+        return st;
+      }
+      batch->completions[i](Status::OK, record);
+    }
+  }
+
+  return Status::OK;
+}
+
+void AsyncDBClient::Abort(Batch *batch, int first, const Status &st) {
+  DBRecord empty;
+  for (int i = first; i < batch->completions.size(); ++i) {
+    batch->completions[i](st, empty);
+  }
+}
+
+void AsyncDBClient::SetError(const Status &st) {
+  std::unique_lock<std::mutex> lock(mu_);
+  if (status_.ok()) {
+    LOG(ERROR) << "Database connection error: " << st;
+    status_ = st;
+
+    // Shut down connection to unblock the receiver.
+    shutdown(sock_, SHUT_RDWR);
+  }
+}
+
+}  // namespace sling
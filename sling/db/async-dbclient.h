@@ -0,0 +1,162 @@
+// Copyright 2025 Ringgaard Research ApS
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SLING_DB_ASYNC_DBCLIENT_H_
+#define SLING_DB_ASYNC_DBCLIENT_H_
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "sling/base/status.h"
+#include "sling/base/types.h"
+#include "sling/db/dbclient.h"
+#include "sling/db/dbprotocol.h"
+#include "sling/net/client.h"
+#include "sling/util/iobuffer.h"
+#include "sling/util/thread.h"
+
+namespace sling {
+
+// Asynchronous database client. Requests are pipelined over a single
+// connection to the database server, i.e. new requests are sent without
+// waiting for the replies to previous requests. Operations from concurrent
+// callers are batched into multi-record DBGET and DBPUT requests. Replies are
+// received by a separate thread, which calls the completion callbacks for the
+// operations in the order they were issued.
+//
+// Since the receiver thread is blocked while a completion callback runs,
+// callbacks can issue new asynchronous operations, but they cannot wait for
+// operations to complete. The synchronous Get() and Put() methods, Wait(), and
+// Close() fail with EDEADLK when called from a completion callback.
+class AsyncDBClient : public Client {
+ public:
+  // Completion callback for asynchronous operations. For DBGET, the record
+  // contains the key, version, and value of the record. For DBPUT, the record
+  // contains the outcome of the update. The key and value are only valid
+  // during the callback.
+  typedef std::function<void(const Status &st, const DBRecord &record)>
+      Completion;
+
+  ~AsyncDBClient();
+
+  // Connect to database server. See DBClient::Connect() for the format of the
+  // database name.
+  Status Connect(const string &database, const string &agent);
+
+  // Wait for all outstanding operations to complete and close connection.
+  Status Close();
+
+  // Read record from database asynchronously.
+  void Get(const Slice &key, Completion done);
+
+  // Add or update record in database asynchronously.
+  void Put(const DBRecord &record, Completion done, DBMode mode = DBOVERWRITE);
+
+  // Read record(s) from database and wait for the result. The values are
+  // empty for missing records.
+  Status Get(const Slice &key, string *value);
+  Status Get(const std::vector<Slice> &keys, std::vector<string> *values);
+
+  // Add or update records in database and wait for the result. The records
+  // are updated with the outcome.
+  Status Put(std::vector<DBRecord> *records, DBMode mode = DBOVERWRITE);
+
+  // Wait until all outstanding operations have completed. Returns the first
+  // connection error, if any.
+  Status Wait();
+
+  // Check if the current thread is running a completion callback for this
+  // client.
+  bool InCallback() const;
+
+  // Maximum number of records in each request.
+  void set_max_batch(int max_batch) { max_batch_ = max_batch; }
+
+  // Maximum number of requests sent to the server without a reply.
+  void set_max_outstanding(int max_outstanding) {
+    max_outstanding_ = max_outstanding;
+  }
+
+ private:
+  // Batch of operations sent in one request.
+  struct Batch {
+    Batch(DBVerb verb, DBMode mode) : verb(verb), mode(mode) {}
+
+    DBVerb verb;                          // request verb
+    DBMode mode;                          // update mode for DBPUT
+    IOBuffer request;                     // request body
+    std::vector<Completion> completions;  // completion callbacks
+  };
+
+  // Return batch for adding operation. The mutex must be locked.
+  Batch *Open(DBVerb verb, DBMode mode);
+
+  // Enqueue operation in batch.
+  void Enqueue(DBVerb verb, DBMode mode, const DBRecord &record,
+               Completion done);
+
+  // Send queued requests to server.
+  void Sender();
+
+  // Receive replies from server and complete operations.
+  void Receiver();
+
+  // Complete operations in batch from reply. Returns an error if the
+  // connection is no longer usable.
+  Status Dispatch(Batch *batch, uint32 reply, IOBuffer *response);
+
+  // Complete remaining operations in batch with error.
+  static void Abort(Batch *batch, int first, const Status &st);
+
+  // Record connection error.
+  void SetError(const Status &st);
+
+  // Queue of batches waiting to be sent.
+  std::deque<Batch *> queue_;
+
+  // Batches that have been sent and are waiting for a reply.
+  std::deque<Batch *> inflight_;
+
+  // Number of operations that have not been completed.
+  int pending_ = 0;
+
+  // First connection error.
+  Status status_;
+
+  // Batching parameters.
+  int max_batch_ = DBMAXBATCH;
+  int max_outstanding_ = 16;
+
+  // Flags for running and stopping the sender and receiver threads.
+  bool running_ = false;
+  bool stop_ = false;
+
+  // Mutex and signals for queues.
+  std::mutex mu_;
+  std::condition_variable queued_;
+  std::condition_variable sent_;
+  std::condition_variable idle_;
+
+  // Threads for sending requests and receiving replies.
+  ClosureThread sender_{[&]() { Sender(); }};
+  ClosureThread receiver_{[&]() { Receiver(); }};
+};
+
+}  // namespace sling
+
+#endif  // SLING_DB_ASYNC_DBCLIENT_H_
@@ -30,11 +30,15 @@ int main(int argc, char *argv[]) {
   DatabaseIndex index;
   CHECK(index.Open(FLAGS_index));
 
+  VLOG(1) << "version: " << index.version();
   VLOG(1) << "epoch: " << index.epoch();
   VLOG(1) << "capacity: " << index.capacity();
   VLOG(1) << "limit: " << index.limit();
   VLOG(1) << "records: " << index.num_records();
   VLOG(1) << "deleted: " << index.num_deleted();
+  if (index.migrating()) {
+    VLOG(1) << "migrated: " << index.migrated();
+  }
 
   // Check index integrity.
   index.Check(FLAGS_fix);
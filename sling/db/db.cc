@@ -14,7 +14,9 @@
 
 #include "sling/db/db.h"
 
+#include <string.h>
 #include <algorithm>
+#include <chrono>
 #include <string>
 #include <vector>
 
@@ -133,6 +135,31 @@ Status Database::Open(const string &dbdir, bool recover) {
     }
   }
 
+  // Read database generation. Databases created before generations were
+  // introduced start a new generation when they are opened.
+  generation_ = 0;
+  if (File::Exists(GenerationFile())) {
+    string generation;
+    Status st = File::ReadContents(GenerationFile(), &generation);
+    if (!st.ok()) return st;
+    while (!generation.empty() && generation.back() == '\n') {
+      generation.pop_back();
+    }
+    if (!safe_strtou64(generation, &generation_)) {
+      return Status(E_CONFIG, "Invalid database generation");
+    }
+  } else if (!config_.read_only) {
+    Status st = NewGeneration();
+    if (!st.ok()) return st;
+  }
+
+  // Read position maps for shards compacted in the current generation.
+  Status st = ReadShardMaps();
+  if (!st.ok()) return st;
+
+  // Allow concurrent readers to read all records in the database.
+  Publish();
+
   return Status::OK;
 }
 
@@ -175,7 +202,8 @@ Status Database::Create(const string &dbdir, const string &config) {
   if (!st.ok()) return st;
   dirty_ = true;
 
-  return Status::OK;
+  // Start first generation of database.
+  return NewGeneration();
 }
 
 Status Database::Flush() {
@@ -198,6 +226,14 @@ Status Database::Flush() {
 }
 
 void Database::Close() {
+  ExclusiveLock lock(&access_);
+  Shutdown();
+}
+
+void Database::Shutdown() {
+  // Abort online compaction.
+  AbortCompaction();
+
   // Close writer.
   delete writer_;
   writer_ = nullptr;
@@ -213,15 +249,22 @@ void Database::Close() {
 
 Status Database::Bulk(bool enable) {
   if (bulk_ == enable) return Status::OK;
+
+  // Complete any ongoing index migration before switching index.
+  Status st = MigrateIndex(DatabaseIndex::NPOS);
+  if (!st.ok()) return st;
   bulk_ = enable;
 
   // Switch index. Use memory-based index in bulk mode.
   DatabaseIndex *newidx = new DatabaseIndex();
-  Status st = newidx->Create(IndexFile(), index_->capacity(), index_->limit());
+  st = newidx->Create(IndexFile(), index_->capacity(), index_->limit());
   if (!st.ok()) return st;
   newidx->CopyFrom(index_);
-  delete index_;
-  index_ = newidx;
+  {
+    ExclusiveLock lock(&access_);
+    delete index_;
+    index_ = newidx;
+  }
 
   // Mark database as dirty when leaving bulk mode to trigger an index flush.
   if (!bulk_) dirty_ = true;
@@ -230,8 +273,11 @@ Status Database::Bulk(bool enable) {
 }
 
 Status Database::Backup() {
-  // First flush database to ensure we have a consistent state.
-  Status st = Flush();
+  // First complete index migration and flush database to ensure we have a
+  // consistent state.
+  Status st = MigrateIndex(DatabaseIndex::NPOS);
+  if (!st.ok()) return st;
+  st = Flush();
   if (!st.ok()) return st;
 
   // Write snapshot of index to backup file.
@@ -253,7 +299,8 @@ Status Database::Clear() {
   }
 
   // Close database.
-  Close();
+  ExclusiveLock lock(&access_);
+  Shutdown();
 
   // Remove data and index files.
   for (const string &fn : datafiles) {
@@ -270,8 +317,15 @@ Status Database::Clear() {
     if (!st.ok()) return st;
   }
 
-  // Re-open empty database.
-  return Open(dbdir_, false);
+  if (File::Exists(IndexPreviousFile())) {
+    Status st = File::Delete(IndexPreviousFile());
+    if (!st.ok()) return st;
+  }
+
+  // Re-open empty database in a new generation.
+  Status st = Open(dbdir_, false);
+  if (!st.ok()) return st;
+  return NewGeneration();
 }
 
 Status Database::Purge() {
@@ -279,8 +333,13 @@ Status Database::Purge() {
     return Status(ENOSYS, "Purging of multi-volume databases not supported");
   }
 
-  // Flush database.
+  // Purging supersedes online compaction.
+  AbortCompaction();
+
+  // Complete index migration and flush database.
   Status st;
+  st = MigrateIndex(DatabaseIndex::NPOS);
+  if (!st.ok()) return st;
   st = Flush();
   if (!st.ok()) return st;
 
@@ -367,13 +426,15 @@ Status Database::Purge() {
           << num_overwrites << " overwrites, "
           << num_records << " records remaining";
 
-  // Update index.
+  // Update index. Concurrent readers are locked out until the purged
+  // database has been re-opened.
+  ExclusiveLock lock(&access_);
   index_->CopyFrom(&idx);
   st = index_->Flush(epoch);
   if (!st.ok()) return st;
 
   // Close database.
-  Close();
+  Shutdown();
 
   // Remove old data shards.
   for (const string &fn : datafiles) {
@@ -387,8 +448,308 @@ Status Database::Purge() {
     if (!st.ok()) return st;
   }
 
-  // Re-open purged database.
-  return Open(dbdir_, false);
+  // Re-open purged database in a new generation, since the record ids have
+  // changed.
+  st = Open(dbdir_, false);
+  if (!st.ok()) return st;
+  return NewGeneration();
+}
+
+Status Database::Compact(int records, bool *done) {
+  *done = false;
+  if (config_.read_only) return Status(EACCES, "Database is read-only");
+
+  // Start new compaction of the sealed data shards.
+  if (compaction_ == nullptr) {
+    if (readers_.size() < 2) {
+      *done = true;
+      return Status::OK;
+    }
+    compaction_ = new Compaction();
+    compaction_->end = CurrentShard();
+    LOG(INFO) << "Start compaction of " << compaction_->end
+              << " shards in db " << dbdir_;
+  }
+  Compaction *c = compaction_;
+
+  Record record;
+  int copied = 0;
+  while (copied < records) {
+    // Open next shard for compaction.
+    if (c->input == nullptr) {
+      if (++c->shard == c->end) {
+        LOG(INFO) << "Compaction completed for db " << dbdir_;
+        delete compaction_;
+        compaction_ = nullptr;
+        *done = true;
+        return Status::OK;
+      }
+      c->input = new RecordReader(DataFile(c->shard), config_.record);
+      RecordFileOptions options = config_.record;
+      options.append = false;
+      c->output = new RecordWriter(CompactDataFile(c->shard), options);
+      c->map.shard = c->shard;
+      c->map.positions.clear();
+      c->map.positions.emplace_back(c->input->Tell(), c->output->Tell());
+      c->copied = 0;
+    }
+
+    // Switch to compacted shard when all records have been copied.
+    if (c->input->Done()) {
+      Status st = SwitchCompactedShard();
+      if (!st.ok()) return st;
+      continue;
+    }
+
+    // Read next record.
+    Status st = c->input->Read(&record);
+    if (!st.ok()) return st;
+    add(COMPACTREAD, record.value.size());
+    copied++;
+
+    // Skip records that are no longer in the index. Deletion records are kept,
+    // so replicas that have not reached them yet still receive the deletions.
+    bool deletion = record.value.empty();
+    uint64 fp = Fingerprint(record.key);
+    uint64 recid = RecordID(c->shard, record.position);
+    if (!deletion && !index_->Exists(fp, recid)) continue;
+
+    // Sample the old and new position of the record for relocating positions
+    // in the shard.
+    if (c->copied++ % SAMPLE_INTERVAL == 0) {
+      c->map.positions.emplace_back(record.position, c->output->Tell());
+    }
+
+    // Copy record to compacted shard. The index entry is switched when the
+    // whole shard has been compacted.
+    uint64 pos;
+    st = c->output->Write(record, &pos);
+    if (!st.ok()) return st;
+    add(COMPACTWRITE, record.value.size());
+    if (!deletion) {
+      c->relocations.push_back({fp, recid, RecordID(c->shard, pos)});
+    }
+  }
+
+  return Status::OK;
+}
+
+Status Database::SwitchCompactedShard() {
+  Compaction *c = compaction_;
+  int shard = c->shard;
+  string datafn = DataFile(shard);
+  string compactfn = CompactDataFile(shard);
+
+  // Close compacted shard and open reader for it.
+  Status st = c->output->Close();
+  if (!st.ok()) return st;
+  delete c->output;
+  c->output = nullptr;
+  uint64 before = c->input->size();
+  delete c->input;
+  c->input = nullptr;
+  RecordReader *reader = new RecordReader(compactfn, config_.record);
+  uint64 after = reader->size();
+
+  // The index on disk is marked as stale until the index entries have been
+  // switched to the compacted shard, so it will be recovered if the database
+  // is not shut down cleanly in the meantime. The index backup is removed
+  // since its record ids are no longer valid.
+  st = index_->Flush(DatabaseIndex::NVAL);
+  if (!st.ok()) return st;
+  if (File::Exists(IndexBackupFile())) {
+    st = File::Delete(IndexBackupFile());
+    if (!st.ok()) return st;
+  }
+
+  // Save the position map for the shard before it is replaced. If the
+  // database is not shut down cleanly before the shard has been replaced, the
+  // compacted file is still present, and the map is dropped when the database
+  // is opened.
+  c->map.positions.emplace_back(before, after);
+  c->map.layout = layout_ + 1;
+  shard_maps_.push_back(c->map);
+  st = WriteShardMaps();
+  if (!st.ok()) {
+    shard_maps_.pop_back();
+    delete reader;
+    return st;
+  }
+
+  // Replace shard and switch index entries. Concurrent readers are locked out
+  // while the shard is being switched.
+  int64 stale = 0;
+  {
+    ExclusiveLock lock(&access_);
+    st = File::Rename(compactfn, datafn);
+    if (!st.ok()) {
+      shard_maps_.pop_back();
+      WriteShardMaps();
+      delete reader;
+      return st;
+    }
+    std::swap(readers_[shard], reader);
+    delete reader;
+    layout_ = c->map.layout;
+
+    // Records that have been updated or deleted after they were copied are
+    // left behind as garbage in the compacted shard.
+    for (const Compaction::Relocation &r : c->relocations) {
+      if (index_->Update(r.fp, r.from, r.to) == DatabaseIndex::NPOS) stale++;
+    }
+  }
+  size_ -= before - after;
+  add(RECLAIMED, before - after);
+
+  LOG(INFO) << "Compacted shard " << shard << " of db " << dbdir_ << " from "
+            << before << " to " << after << " bytes, "
+            << c->relocations.size() << " records, "
+            << stale << " stale";
+  c->relocations.clear();
+
+  // Flush index with the switched entries.
+  dirty_ = true;
+  return Flush();
+}
+
+Status Database::NewGeneration() {
+  // Generations are based on the time in microseconds, so a database that is
+  // deleted and re-created does not reuse a generation.
+  uint64 now = std::chrono::duration_cast<std::chrono::microseconds>(
+      std::chrono::system_clock::now().time_since_epoch()).count();
+  generation_ = std::max(generation_ + 1, now);
+
+  // Record ids from earlier layouts are not relocated across generations.
+  layout_ = 0;
+  shard_maps_.clear();
+  if (File::Exists(ShardMapFile())) {
+    Status st = File::Delete(ShardMapFile());
+    if (!st.ok()) return st;
+  }
+
+  // Write generation to temporary file and replace the current file.
+  string filename = GenerationFile();
+  Status st = File::WriteContents(filename + ".tmp",
+                                  std::to_string(generation_) + "\n");
+  if (!st.ok()) return st;
+  return File::Rename(filename + ".tmp", filename);
+}
+
+Status Database::ReadShardMaps() {
+  layout_ = 0;
+  shard_maps_.clear();
+  if (!File::Exists(ShardMapFile())) return Status::OK;
+  string data;
+  Status st = File::ReadContents(ShardMapFile(), &data);
+  if (!st.ok()) return st;
+
+  // Each map has the layout, the shard, and the number of samples followed by
+  // the (old, new) position samples.
+  const char *p = data.data();
+  const char *end = p + data.size();
+  while (p < end) {
+    if (end - p < 16) return Status(E_CONFIG, "Invalid shard map file");
+    ShardMap map;
+    uint32 shard, samples;
+    memcpy(&map.layout, p, 8);
+    memcpy(&shard, p + 8, 4);
+    memcpy(&samples, p + 12, 4);
+    p += 16;
+    if (end - p < samples * 16) {
+      return Status(E_CONFIG, "Invalid shard map file");
+    }
+    map.shard = shard;
+    map.positions.resize(samples);
+    for (auto &sample : map.positions) {
+      memcpy(&sample.first, p, 8);
+      memcpy(&sample.second, p + 8, 8);
+      p += 16;
+    }
+    shard_maps_.push_back(std::move(map));
+  }
+
+  // Drop the map for the last compacted shard if the shard was never replaced.
+  if (!shard_maps_.empty()) {
+    string compactfn = CompactDataFile(shard_maps_.back().shard);
+    if (File::Exists(compactfn) && !config_.read_only) {
+      LOG(WARNING) << "Discard incomplete compaction of shard "
+                   << shard_maps_.back().shard << " in db " << dbdir_;
+      shard_maps_.pop_back();
+      st = WriteShardMaps();
+      if (!st.ok()) return st;
+      st = File::Delete(compactfn);
+      if (!st.ok()) return st;
+    }
+  }
+  if (!shard_maps_.empty()) layout_ = shard_maps_.back().layout;
+
+  return Status::OK;
+}
+
+Status Database::WriteShardMaps() {
+  string data;
+  for (const ShardMap &map : shard_maps_) {
+    uint32 shard = map.shard;
+    uint32 samples = map.positions.size();
+    data.append(reinterpret_cast<const char *>(&map.layout), 8);
+    data.append(reinterpret_cast<const char *>(&shard), 4);
+    data.append(reinterpret_cast<const char *>(&samples), 4);
+    for (const auto &sample : map.positions) {
+      data.append(reinterpret_cast<const char *>(&sample.first), 8);
+      data.append(reinterpret_cast<const char *>(&sample.second), 8);
+    }
+  }
+
+  // Write maps to temporary file and replace the current file.
+  string filename = ShardMapFile();
+  Status st = File::WriteContents(filename + ".tmp", data);
+  if (!st.ok()) return st;
+  return File::Rename(filename + ".tmp", filename);
+}
+
+bool Database::Relocate(uint64 *position, uint64 layout) const {
+  if (layout == layout_) return true;
+  if (layout > layout_) return false;
+
+  // Find the map for the layout following the position layout.
+  int first = 0;
+  while (first < shard_maps_.size() && shard_maps_[first].layout <= layout) {
+    first++;
+  }
+  if (first == shard_maps_.size()) return false;
+  if (shard_maps_[first].layout != layout + 1) return false;
+
+  // Apply the maps for all later layouts in order. A position maps to the new
+  // position of the last sampled record at or before it. Positions before the
+  // first record in the shard are not changed.
+  for (int i = first; i < shard_maps_.size(); ++i) {
+    const ShardMap &map = shard_maps_[i];
+    if (Shard(*position) != map.shard) continue;
+    uint64 pos = Position(*position);
+    auto it = std::upper_bound(
+        map.positions.begin(), map.positions.end(), pos,
+        [](uint64 pos, const std::pair<uint64, uint64> &sample) {
+          return pos < sample.first;
+        });
+    if (it == map.positions.begin()) continue;
+    --it;
+    *position = RecordID(map.shard, it->second);
+  }
+  return true;
+}
+
+void Database::AbortCompaction() {
+  if (compaction_ == nullptr) return;
+  Compaction *c = compaction_;
+  delete c->input;
+  if (c->output != nullptr) {
+    string compactfn = CompactDataFile(c->shard);
+    c->output->Close();
+    delete c->output;
+    File::Delete(compactfn);
+  }
+  delete c;
+  compaction_ = nullptr;
 }
 
 bool Database::Get(const Slice &key, Record *record, bool novalue) {
@@ -418,6 +779,55 @@ bool Database::Get(const Slice &key, Record *record, bool novalue) {
   return false;
 }
 
+bool Database::Lookup(const Slice &key, Record *record, IOBuffer *buffer,
+                      bool novalue, bool *unsynced) {
+  // Compute record key fingerprint.
+  inc(GET);
+  uint64 fp = Fingerprint(key);
+
+  // Hold shared lock to prevent index and data shards from being swapped out.
+  SharedLock lock(&access_);
+  if (index_ == nullptr) return false;
+  uint64 synced = synced_.load(std::memory_order_acquire);
+
+  // Entries can be moved between the previous and the expanded index while
+  // the index is being migrated, so the lookup is retried if this happens
+  // before the record has been found.
+  for (;;) {
+    uint64 moves = index_->moves();
+
+    // Loop over matching records in index.
+    uint64 pos = DatabaseIndex::NPOS;
+    for (;;) {
+      // Get next match in index.
+      uint64 recid = index_->Get(fp, &pos);
+      if (recid == DatabaseIndex::NVAL) break;
+
+      // Records that have not been flushed yet can only be read by the writer.
+      if (recid >= synced) {
+        *unsynced = true;
+        return false;
+      }
+
+      // Read record from data file using positional reads.
+      RecordReader *reader = readers_[Shard(recid)];
+      Status st = reader->ReadAt(Position(recid), record, buffer, novalue);
+      inc(RECREAD);
+      if (!st) return false;
+      if (!novalue) add(BYTEREAD, record->value.size());
+
+      // Return record if key matches.
+      if (key == record->key) {
+        inc(HIT);
+        return true;
+      }
+      inc(MISS);
+    }
+
+    if (index_->Stable(moves)) return false;
+  }
+}
+
 uint64 Database::Put(const Record &record, DBMode mode, DBResult *result) {
   // Check if database is read-only.
   if (config_.read_only) return DatabaseIndex::NVAL;
@@ -636,6 +1046,18 @@ string Database::IndexBackupFile() const {
   return dbdir_ + "/index.bak";
 }
 
+string Database::GenerationFile() const {
+  return dbdir_ + "/generation";
+}
+
+string Database::ShardMapFile() const {
+  return dbdir_ + "/shardmaps";
+}
+
+string Database::IndexPreviousFile() const {
+  return DatabaseIndex::PreviousFilename(dbdir_ + "/index");
+}
+
 string Database::DataFile(int shard) const {
   if (shard < readers_.size()) {
     return readers_[shard]->file()->filename();
@@ -648,15 +1070,28 @@ string Database::TempDataFile(int shard) const {
   return ShardFile(datadir_ + "/temp-", shard);
 }
 
+string Database::CompactDataFile(int shard) const {
+  // Compacted shards are written to the same directory as the original shard.
+  string datafn = DataFile(shard);
+  return ShardFile(datafn.substr(0, datafn.rfind('/')) + "/compact-", shard);
+}
+
 Status Database::SyncWriter() {
   if (writer_ != nullptr) {
     Status st = writer_->Flush();
     if (!st.ok()) return st;
     writer_->Sync(readers_.back());
+    Publish();
   }
   return Status::OK;
 }
 
+void Database::Publish() {
+  // Without a writer, all records in the data shards can be read.
+  uint64 synced = writer_ != nullptr ? epoch() : -1;
+  synced_.store(synced, std::memory_order_release);
+}
+
 Status Database::ReadRecord(uint64 recid, Record *record, bool novalue) {
   Status st;
   uint64 shard = Shard(recid);
@@ -704,22 +1139,33 @@ Status Database::AddDataShard() {
   if (!st.ok()) return st;
 
   // Create reader for new shard.
+  // Concurrent readers never access the data shards when there is no index,
+  // so the lock is only needed when the database is open.
   RecordReader *reader = new RecordReader(datafn, config_.record);
-  readers_.push_back(reader);
+  if (index_ != nullptr) {
+    ExclusiveLock lock(&access_);
+    readers_.push_back(reader);
+  } else {
+    readers_.push_back(reader);
+  }
+  Publish();
   dirty_ = true;
 
   return Status::OK;
 }
 
 Status Database::ExpandIndex(uint64 capacity) {
-  // Rehash index by copying it to a new larger index.
-  Status st;
+  // Complete any ongoing index migration first.
+  Status st = MigrateIndex(DatabaseIndex::NPOS);
+  if (!st.ok()) return st;
+
+  // Rehash index by migrating it to a new larger index.
   LOG(INFO) << "Expand index to " << capacity << " entries for db " << dbdir_;
   DatabaseIndex *new_index = new DatabaseIndex();
 
-  // Unlink current index.
+  // Keep the current index as the previous index until it has been migrated.
   if (!bulk_) {
-    st = File::Delete(IndexFile());
+    st = File::Rename(IndexFile(), IndexPreviousFile());
     if (!st.ok()) return st;
   }
 
@@ -728,15 +1174,27 @@ Status Database::ExpandIndex(uint64 capacity) {
   st = new_index->Create(IndexFile(), capacity, limit);
   if (!st.ok()) return st;
 
-  // Transfer all entries to the new index.
-  index_->TransferTo(new_index);
+  // Switch to new index and start migrating entries from the current index.
+  ExclusiveLock lock(&access_);
+  new_index->Attach(index_);
+  index_ = new_index;
+  dirty_ = true;
+  return Status::OK;
+}
 
-  // Switch to new index.
-  st = index_->Close();
-  if (!st.ok()) return st;
+Status Database::MigrateIndex(uint64 slots) {
+  if (!index_->migrating()) return Status::OK;
+  if (!index_->Migrate(slots)) return Status::OK;
 
-  delete index_;
-  index_ = new_index;
+  // Remove previous index when all entries have been migrated.
+  VLOG(1) << "Index migration completed for db " << dbdir_;
+  ExclusiveLock lock(&access_);
+  Status st = index_->Detach();
+  if (!st.ok()) return st;
+  if (!bulk_ && File::Exists(IndexPreviousFile())) {
+    st = File::Delete(IndexPreviousFile());
+    if (!st.ok()) return st;
+  }
   dirty_ = true;
   return Status::OK;
 }
@@ -749,9 +1207,18 @@ Status Database::Expand() {
     if (!st.ok()) return st;
   }
 
+  // Migrate a bounded number of entries from the previous index. All the
+  // remaining entries are migrated if the expanded index is already full.
+  if (index_->migrating()) {
+    uint64 slots = config_.index_migration_step;
+    if (index_->full()) slots = DatabaseIndex::NPOS;
+    Status st = MigrateIndex(slots);
+    if (!st.ok()) return st;
+  }
+
   // Check for index overflow.
   if (index_->full()) {
-    // Rehash index by copying it to a new larger index.
+    // Rehash index by migrating it to a new larger index.
     Status st = ExpandIndex(index_->capacity() * 2);
     if (!st.ok()) return st;
   }
@@ -767,6 +1234,12 @@ Status Database::Recover(uint64 capacity) {
   CHECK(index_ == nullptr);
   dirty_ = true;
 
+  // Remove previous index from incomplete index migration.
+  if (File::Exists(IndexPreviousFile())) {
+    st = File::Delete(IndexPreviousFile());
+    if (!st.ok()) return st;
+  }
+
   // Use index backup if available.
   if (File::Exists(IndexBackupFile())) {
     // Copy index backup to memory index.
@@ -953,6 +1426,13 @@ bool Database::ParseConfig(Text config) {
         return false;
       }
       config_.index_load_factor = n;
+    } else if (key == "index_migration_step") {
+      int64 n = ParseNumber(value);
+      if (n <= 0) {
+        LOG(ERROR) << "Invalid index migration step: " << line;
+        return false;
+      }
+      config_.index_migration_step = n;
     } else if (key == "data_shard_size") {
       uint64 n = ParseNumber(value);
       if (n <= 0) {
@@ -987,6 +1467,8 @@ bool Database::ParseConfig(Text config) {
       config_.timestamped = ParseBool(value, false);
     } else if (key == "can_clear") {
       config_.can_clear = ParseBool(value, false);
+    } else if (key == "concurrent") {
+      config_.concurrent = ParseBool(value, false);
     } else {
       LOG(ERROR) << "Unknown configuration parameter: " << line;
       return false;
@@ -15,7 +15,9 @@
 #ifndef SLING_DB_DB_H_
 #define SLING_DB_DB_H_
 
+#include <atomic>
 #include <string>
+#include <utility>
 #include <vector>
 
 #include "sling/base/logging.h"
@@ -26,6 +28,8 @@
 #include "sling/file/file.h"
 #include "sling/file/recordio.h"
 #include "sling/string/text.h"
+#include "sling/util/iobuffer.h"
+#include "sling/util/rwlock.h"
 
 namespace sling {
 
@@ -34,7 +38,9 @@ namespace sling {
 // data shards are recordio files and all new records are written sequentially
 // to the data files. Record deletion is performed by writing a record with the
 // deleted key and an empty value. Please notice that the database methods are
-// not thread-safe and requires synchronized access, e.g. using a mutex.
+// not thread-safe and requires synchronized access, e.g. using a mutex. The
+// only exception is Lookup(), which can be called concurrently from multiple
+// threads while one thread holding the lock is updating the database.
 class Database {
  public:
   // Configuration options for database.
@@ -54,6 +60,9 @@ class Database {
     // Index load factor.
     double index_load_factor = 0.75;
 
+    // Number of index slots migrated per update when the index is expanded.
+    uint64 index_migration_step = 1024;
+
     // Read-only mode.
     bool read_only = false;
 
@@ -62,6 +71,9 @@ class Database {
 
     // Allow clearing all records in database.
     bool can_clear = false;
+
+    // Allow concurrent readers without locking the database.
+    bool concurrent = false;
   };
 
   // Database performance metrics.
@@ -76,9 +88,12 @@ class Database {
     BYTEWRITE, // number of bytes written
     HIT,       // number of hash table hits
     MISS,      // number of hash table misses
+    COMPACTREAD,   // number of bytes read by compaction
+    COMPACTWRITE,  // number of bytes written by compaction
+    RECLAIMED,     // number of bytes reclaimed by compaction
   };
 
-  const static int NUM_DBMETRICS = MISS + 1;
+  const static int NUM_DBMETRICS = RECLAIMED + 1;
 
   // Deallocate database instance.
   ~Database();
@@ -109,9 +124,36 @@ class Database {
   // Compact database by removing all deleted and updated records.
   Status Purge();
 
+  // Compact database online. The sealed data shards, i.e. all shards except
+  // the last one, are compacted one at a time by copying the active records
+  // into a new data file. Each call copies up to the given number of records,
+  // so the caller can release the database lock between calls while updates
+  // continue to the last shard. When all records in a shard have been copied,
+  // the index entries are switched to the compacted shard and the old data
+  // file is replaced. Returns done when all sealed shards have been compacted.
+  // Record ids in compacted shards change, so each replaced shard starts a new
+  // layout. Positions from earlier layouts can be mapped to the current layout
+  // with Relocate().
+  Status Compact(int records, bool *done);
+
+  // Abort online compaction. Shards that have already been compacted are kept.
+  void AbortCompaction();
+
+  // Check if online compaction is in progress.
+  bool compacting() const { return compaction_ != nullptr; }
+
   // Get record from database. Return true if found.
   bool Get(const Slice &key, Record *record, bool novalue = false);
 
+  // Look up record in database without holding the database lock. This can be
+  // called from multiple threads concurrently with a single writer. The record
+  // data is read into the buffer, which must be private to the calling thread.
+  // Returns false if the record is not found. If the record has been written
+  // after the last synchronization of the writer, unsynced is set to true and
+  // the caller must fall back to Get() while holding the database lock.
+  bool Lookup(const Slice &key, Record *record, IOBuffer *buffer,
+              bool novalue, bool *unsynced);
+
   // Add or update record in database. Return record id of new record.
   uint64 Put(const Record &record,
              DBMode mode = DBOVERWRITE,
@@ -150,12 +192,31 @@ class Database {
   // Check if database has unflushed changed.
   bool dirty() const { return dirty_; }
 
+  // Return the generation of the database. A new generation is started when
+  // existing record ids are invalidated, i.e. when the database is created,
+  // cleared, or purged.
+  uint64 generation() const { return generation_; }
+
+  // Return the layout of the database within the current generation. The
+  // layout changes every time online compaction replaces a data shard.
+  uint64 layout() const { return layout_; }
+
+  // Map iterator position from an earlier layout to the current layout. A
+  // position in a compacted shard is mapped to a position at or before the
+  // first record that had not been reached, so iterating from the relocated
+  // position can return some records again, but no records are skipped.
+  // Returns false if the layout is not known in the current generation.
+  bool Relocate(uint64 *position, uint64 layout) const;
+
   // Check if database is read-only.
   bool read_only() const { return config_.read_only; }
 
   // Use timestamps for record version numbers.
   bool timestamped() const { return config_.timestamped; }
 
+  // Check if database allows concurrent readers.
+  bool concurrent() const { return config_.concurrent; }
+
   // Return number of active records.
   uint64 num_records() const { return index_->num_records(); }
 
@@ -168,6 +229,9 @@ class Database {
   // Return index capacity.
   uint64 index_capacity() const { return index_->capacity(); }
 
+  // Check if index entries are being migrated to an expanded index.
+  bool index_migrating() const { return index_->migrating(); }
+
   // Return bulk mode.
   bool bulk() const { return bulk_; }
 
@@ -209,8 +273,12 @@ class Database {
   }
 
   // Increment performance counter.
-  void inc(Metric metric) { ++counter_[metric]; }
-  void add(Metric metric, uint64 value) { counter_[metric] += value; }
+  void inc(Metric metric) {
+    counter_[metric].fetch_add(1, std::memory_order_relaxed);
+  }
+  void add(Metric metric, uint64 value) {
+    counter_[metric].fetch_add(value, std::memory_order_relaxed);
+  }
 
   // Parse configuration.
   bool ParseConfig(Text config);
@@ -224,30 +292,93 @@ class Database {
   // Return filename for index backup.
   string IndexBackupFile() const;
 
+  // Return filename for database generation.
+  string GenerationFile() const;
+
+  // Return filename for position maps for compacted shards.
+  string ShardMapFile() const;
+
+  // Return filename for previous index during index migration.
+  string IndexPreviousFile() const;
+
   // Return filename for (new) data shard.
   string DataFile(int shard) const;
 
   // Return filename for temporary data shard.
   string TempDataFile(int shard) const;
 
+  // Return filename for data shard being compacted online.
+  string CompactDataFile(int shard) const;
+
   // Read data record (key).
   Status ReadRecord(uint64 recid, Record *record, bool novalue);
 
   // Add new empty data shard.
   Status AddDataShard();
 
-  // Expand index to accommodate more entries.
+  // Expand index to accommodate more entries. The entries in the current
+  // index are migrated incrementally to the new index by MigrateIndex().
   Status ExpandIndex(uint64 capacity);
 
+  // Migrate entries in the next slots of the previous index to the expanded
+  // index. The previous index is removed when all entries have been migrated.
+  Status MigrateIndex(uint64 slots);
+
   // Expand database for next record.
   Status Expand();
 
   // Synchronize readers with writer.
   Status SyncWriter();
 
+  // Update the synchronization point for concurrent readers.
+  void Publish();
+
+  // Close data and index files without acquiring the access lock.
+  void Shutdown();
+
   // Recover index from data files.
   Status Recover(uint64 capacity);
 
+  // Replace data shard with compacted shard and switch index entries.
+  Status SwitchCompactedShard();
+
+  // Start new database generation.
+  Status NewGeneration();
+
+  // Read and write position maps for compacted shards.
+  Status ReadShardMaps();
+  Status WriteShardMaps();
+
+  // Number of copied records between samples in shard position maps.
+  const static int SAMPLE_INTERVAL = 1024;
+
+  // Sampled mapping from positions in a data shard to positions in the
+  // compacted shard. The samples are the (old, new) positions of every
+  // SAMPLE_INTERVAL copied record, plus the start and end of the shard.
+  struct ShardMap {
+    uint64 layout;                                     // layout after switch
+    int shard;                                         // compacted shard
+    std::vector<std::pair<uint64, uint64>> positions;  // sampled positions
+  };
+
+  // State for online compaction.
+  struct Compaction {
+    // Index entry for record copied to compacted shard.
+    struct Relocation {
+      uint64 fp;    // fingerprint for record key
+      uint64 from;  // record id in original shard
+      uint64 to;    // record id in compacted shard
+    };
+
+    int shard = -1;                       // shard being compacted
+    int end = 0;                          // end of shards to compact
+    RecordReader *input = nullptr;        // reader for original shard
+    RecordWriter *output = nullptr;       // writer for compacted shard
+    std::vector<Relocation> relocations;  // records copied to compacted shard
+    ShardMap map;                         // position map for compacted shard
+    int64 copied = 0;                     // records copied from shard
+  };
+
   // Database directory.
   string dbdir_;
 
@@ -269,14 +400,33 @@ class Database {
   // Flag for tracking unwritten changes to database.
   bool dirty_ = false;
 
+  // Database generation.
+  uint64 generation_ = 0;
+
+  // Database layout and position maps for the shards compacted in the current
+  // generation.
+  uint64 layout_ = 0;
+  std::vector<ShardMap> shard_maps_;
+
   // Bulk mode is used for initial loading of a database.
   bool bulk_ = false;
 
   // Size of data shards excluding the last one.
   uint64 size_ = 0;
 
+  // All records before the synchronization point have been flushed to disk
+  // and can be read by concurrent readers.
+  std::atomic<uint64> synced_{0};
+
+  // Concurrent readers hold a shared lock, and changes to the set of data
+  // shards or the index table require an exclusive lock.
+  RWLock access_;
+
+  // Online compaction in progress.
+  Compaction *compaction_ = nullptr;
+
   // Database performance counters.
-  uint64 counter_[NUM_DBMETRICS] = {};
+  std::atomic<uint64> counter_[NUM_DBMETRICS] = {};
 };
 
 }  // namespace sling
@@ -32,23 +32,10 @@ Status DBClient::Connect(const string &database, const string &agent) {
   // Parse database specification.
   database_ = database;
   agent_ = agent;
-  string hostname = "localhost";
-  string portname = "7070";
+  string hostname;
+  string portname;
   string dbname;
-  int slash = database.find('/');
-  if (slash == -1) {
-    dbname = database;
-  } else {
-    dbname = database.substr(slash + 1);
-    if (slash > 0) {
-      hostname = database.substr(0, slash);
-      int colon = hostname.find(':');
-      if (colon != -1) {
-        portname = hostname.substr(colon + 1);
-        hostname.resize(colon);
-      }
-    }
-  }
+  ParseDatabaseName(database, &hostname, &portname, &dbname);
 
   // Connect to database server.
   Status st = Client::Connect(hostname, portname, "slingdb", agent);
@@ -62,6 +49,28 @@ Status DBClient::Connect(const string &database, const string &agent) {
   }
 }
 
+void DBClient::ParseDatabaseName(const string &database,
+                                 string *hostname,
+                                 string *portname,
+                                 string *dbname) {
+  *hostname = "localhost";
+  *portname = "7070";
+  int slash = database.find('/');
+  if (slash == -1) {
+    *dbname = database;
+  } else {
+    *dbname = database.substr(slash + 1);
+    if (slash > 0) {
+      *hostname = database.substr(0, slash);
+      int colon = hostname->find(':');
+      if (colon != -1) {
+        *portname = hostname->substr(colon + 1);
+        hostname->resize(colon);
+      }
+    }
+  }
+}
+
 Status DBClient::Use(const string &dbname) {
   request_.Clear();
   request_.Write(dbname);
@@ -274,6 +283,35 @@ Status DBClient::Clear() {
   });
 }
 
+Status DBClient::Changes(uint64 *position, uint64 *layout, int batch,
+                         std::vector<DBRecord> *records,
+                         uint64 *epoch,
+                         uint64 *generation,
+                         IOBuffer *buffer) {
+  if (buffer == nullptr) buffer = &response_;
+  return Transact([&]() -> Status {
+    records->clear();
+    request_.Clear();
+    request_.Write(position, 8);
+    request_.Write(&batch, 4);
+    request_.Write(layout, 8);
+    Status st = Do(DBREPLICATE, buffer);
+    if (!st.ok()) return st;
+    if (reply_ != DBCHANGES) return Status(ENOSYS, "Not supported");
+    if (!buffer->Read(epoch, 8)) return Truncated();
+    if (!buffer->Read(generation, 8)) return Truncated();
+    if (!buffer->Read(layout, 8)) return Truncated();
+    if (!buffer->Read(position, 8)) return Truncated();
+    DBRecord record;
+    while (!buffer->empty()) {
+      st = ReadRecord(&record, buffer, false);
+      if (!st.ok()) return st;
+      records->push_back(record);
+    }
+    return Status::OK;
+  });
+}
+
 void DBClient::WriteKey(const Slice &key) {
   uint32 size = key.size();
   request_.Write(&size, 4);
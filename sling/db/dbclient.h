@@ -63,6 +63,13 @@ class DBClient : public Client {
   // Switch to using another database on server.
   Status Use(const string &dbname);
 
+  // Parse database specification into server hostname, port, and database
+  // name.
+  static void ParseDatabaseName(const string &database,
+                                string *hostname,
+                                string *portname,
+                                string *dbname);
+
   // Enable/disable bulk mode for database to avoid excessive checkpointing
   // activity during bulk load of database.
   Status Bulk(bool enable);
@@ -107,6 +114,18 @@ class DBClient : public Client {
   // Clear all records from database.
   Status Clear();
 
+  // Get the next batch of changes to the database from a position for
+  // replicating the database. Deleted records have empty values. The position
+  // is relative to the database layout, and both are updated to the position
+  // of the following changes in the current layout. The position is set to -1
+  // if it cannot be relocated to the current layout. The current epoch and
+  // generation of the database are also returned.
+  Status Changes(uint64 *position, uint64 *layout, int batch,
+                 std::vector<DBRecord> *records,
+                 uint64 *epoch,
+                 uint64 *generation,
+                 IOBuffer *buffer = nullptr);
+
  private:
   // Database transaction.
   typedef std::function<Status()> Transaction;
@@ -41,9 +41,16 @@ Status DatabaseIndex::Open(const string &filename) {
   if (header_->magic != MAGIC) {
     return Status(E_NOT_INDEX, "Not an index file: ", filename);
   }
-  if (header_->version != VERSION) {
+  if (header_->version != 1 && header_->version != VERSION) {
     return Status(E_NOT_SUPPORTED, "Unsupported index file version");
   }
+  if (header_->version == 1 &&
+      (header_->previous != 0 || header_->migrated != 0)) {
+    // Version 1 indices have no migration state. The header is not upgraded
+    // when the index is opened, so older versions can still open the index.
+    // It is replaced by a version 2 index when it is expanded or recreated.
+    return Status(E_MIGRATION, "Invalid index migration state");
+  }
   if (header_->offset < sizeof(Header) || header_->offset > mapped_size_) {
     return Status(E_POSITION, "Invalid position of index entries");
   }
@@ -65,6 +72,18 @@ Status DatabaseIndex::Open(const string &filename) {
   entries_ = reinterpret_cast<Entry *>(mapped_addr_ + header_->offset);
   mask_ = header_->capacity - 1;
 
+  // Open previous index if migration has not been completed.
+  if (header_->previous != 0) {
+    previous_ = new DatabaseIndex();
+    Status st = previous_->Open(PreviousFilename(filename));
+    if (!st.ok()) return st;
+    if (previous_->capacity() != header_->previous ||
+        header_->migrated > header_->previous ||
+        previous_->migrating()) {
+      return Status(E_MIGRATION, "Invalid index migration state");
+    }
+  }
+
   return Status::OK;
 }
 
@@ -127,6 +146,8 @@ Status DatabaseIndex::Create(const string &filename,
   header_->capacity = capacity;
   header_->limit = limit;
   header_->deletions = 0;
+  header_->previous = 0;
+  header_->migrated = 0;
 
   // Set up index entry table.
   entries_ = reinterpret_cast<Entry *>(mapped_addr_ + offset);
@@ -136,6 +157,12 @@ Status DatabaseIndex::Create(const string &filename,
 }
 
 Status DatabaseIndex::Flush(uint64 epoch) {
+  // Flush previous index before the header of this index is updated.
+  if (previous_ != nullptr) {
+    Status st = previous_->Flush(epoch);
+    if (!st.ok()) return st;
+  }
+
   if (file_ != nullptr) {
     // Flush index table to disk.
     uint64 entry_table_size = header_->capacity * sizeof(Entry);
@@ -154,6 +181,14 @@ Status DatabaseIndex::Flush(uint64 epoch) {
 }
 
 Status DatabaseIndex::Close() {
+  // Close previous index.
+  if (previous_ != nullptr) {
+    Status st = previous_->Close();
+    delete previous_;
+    previous_ = nullptr;
+    if (!st.ok()) return st;
+  }
+
   if (file_ != nullptr) {
     // Remove memory mapping.
     if (mapped_addr_ != nullptr) {
@@ -180,17 +215,30 @@ Status DatabaseIndex::Close() {
 uint64 DatabaseIndex::Get(uint64 key, uint64 *pos) const {
   // Compute position of (first) key.
   if (*pos == NPOS) *pos = key & mask_;
-  for (;;) {
-    Entry &e = entries_[*pos];
-    *pos = (*pos + 1) & mask_;
-    if (e.key == key) {
-      // Return match.
-      return e.value;
-    } else if (e.key == EMPTY) {
-      // Stop when the first empty index slot is found.
-      return NVAL;
+  if (*pos <= mask_) {
+    for (;;) {
+      Entry &e = entries_[*pos];
+      *pos = (*pos + 1) & mask_;
+      uint64 k = __atomic_load_n(&e.key, __ATOMIC_ACQUIRE);
+      if (k == key) {
+        // Return match.
+        return __atomic_load_n(&e.value, __ATOMIC_RELAXED);
+      } else if (k == EMPTY) {
+        // Stop when the first empty index slot is found.
+        break;
+      }
     }
+
+    // Continue search in previous index during migration.
+    if (previous_ == nullptr) return NVAL;
+    *pos = header_->capacity + (key & previous_->mask_);
   }
+
+  // Search for next match in previous index.
+  uint64 prevpos = *pos - header_->capacity;
+  uint64 value = previous_->Get(key, &prevpos);
+  *pos = header_->capacity + prevpos;
+  return value;
 }
 
 bool DatabaseIndex::Exists(uint64 key, uint64 value) {
@@ -202,10 +250,13 @@ bool DatabaseIndex::Exists(uint64 key, uint64 value) {
       return true;
     } else if (e.key == EMPTY) {
       // No match found.
-      return false;
+      break;
     }
     pos = (pos + 1) & mask_;
   }
+
+  // Check previous index during migration.
+  return previous_ != nullptr && previous_->Exists(key, value);
 }
 
 uint64 DatabaseIndex::Add(uint64 key, uint64 value) {
@@ -219,8 +270,10 @@ uint64 DatabaseIndex::Add(uint64 key, uint64 value) {
       } else {
         header_->size++;
       }
-      e.key = key;
-      e.value = value;
+      // The value is stored before the key is published to allow concurrent
+      // readers.
+      __atomic_store_n(&e.value, value, __ATOMIC_RELAXED);
+      __atomic_store_n(&e.key, key, __ATOMIC_RELEASE);
       return pos;
     }
     pos = (pos + 1) & mask_;
@@ -234,14 +287,19 @@ uint64 DatabaseIndex::Update(uint64 key, uint64 oldval, uint64 newval) {
     Entry &e = entries_[pos];
     if (e.key == key && e.value == oldval) {
       // Match found.
-      e.value = newval;
+      __atomic_store_n(&e.value, newval, __ATOMIC_RELEASE);
       return pos;
     } else if (e.key == EMPTY) {
       // No match found.
-      return NPOS;
+      break;
     }
     pos = (pos + 1) & mask_;
   }
+
+  // Update entry in previous index during migration.
+  if (previous_ == nullptr) return NPOS;
+  pos = previous_->Update(key, oldval, newval);
+  return pos == NPOS ? NPOS : header_->capacity + pos;
 }
 
 uint64 DatabaseIndex::Delete(uint64 key, uint64 value) {
@@ -251,15 +309,20 @@ uint64 DatabaseIndex::Delete(uint64 key, uint64 value) {
     Entry &e = entries_[pos];
     if (e.key == key && e.value == value) {
       // Match found.
-      e.key = TOMBSTONE;
+      __atomic_store_n(&e.key, TOMBSTONE, __ATOMIC_RELEASE);
       header_->deletions++;
       return pos;
     } else if (e.value == EMPTY) {
       // No match found.
-      return NVAL;
+      break;
     }
     pos = (pos + 1) & mask_;
   }
+
+  // Delete entry in previous index during migration.
+  if (previous_ == nullptr) return NVAL;
+  pos = previous_->Delete(key, value);
+  return pos == NVAL ? NVAL : header_->capacity + pos;
 }
 
 void DatabaseIndex::TransferTo(DatabaseIndex *index) const {
@@ -274,6 +337,55 @@ void DatabaseIndex::TransferTo(DatabaseIndex *index) const {
   }
 }
 
+void DatabaseIndex::Attach(DatabaseIndex *previous) {
+  CHECK(previous_ == nullptr);
+  CHECK(!previous->migrating());
+  previous_ = previous;
+  header_->previous = previous->capacity();
+  header_->migrated = 0;
+}
+
+bool DatabaseIndex::Migrate(uint64 slots) {
+  if (previous_ == nullptr) return true;
+
+  // Determine range of slots to migrate.
+  uint64 start = header_->migrated;
+  uint64 end = previous_->capacity();
+  if (slots < end - start) end = start + slots;
+
+  // Bump the sequence number to make concurrent readers retry failed lookups
+  // while entries are being moved.
+  __atomic_store_n(&moves_, moves_ + 1, __ATOMIC_RELAXED);
+  __atomic_thread_fence(__ATOMIC_RELEASE);
+
+  // Move entries from the previous index to this index. Migrated entries are
+  // replaced with tombstones to keep the probe sequences in the previous index
+  // intact.
+  for (uint64 pos = start; pos < end; ++pos) {
+    Entry &e = previous_->entries_[pos];
+    if (e.key != EMPTY && e.key != TOMBSTONE) {
+      Add(e.key, e.value);
+      __atomic_store_n(&e.key, TOMBSTONE, __ATOMIC_RELEASE);
+      previous_->header_->deletions++;
+    }
+  }
+  header_->migrated = end;
+  __atomic_store_n(&moves_, moves_ + 1, __ATOMIC_RELEASE);
+
+  return end == previous_->capacity();
+}
+
+Status DatabaseIndex::Detach() {
+  CHECK(previous_ != nullptr);
+  CHECK_EQ(header_->migrated, previous_->capacity());
+  Status st = previous_->Close();
+  delete previous_;
+  previous_ = nullptr;
+  header_->previous = 0;
+  header_->migrated = 0;
+  return st;
+}
+
 void DatabaseIndex::CopyFrom(const DatabaseIndex *index) {
   // Check that index sizes match.
   CHECK_EQ(mapped_size_, index->mapped_size_);
@@ -26,7 +26,16 @@ namespace sling {
 
 // Database index. The index is implemented as a file-backed hash table with
 // linear probing. The index allows multiple keys with the same value. Index
-// keys 0 and 1 are reserved.
+// keys 0 and 1 are reserved. Lookups can run concurrently with a single thread
+// updating the index, since new entries are published by storing the key after
+// the value.
+//
+// The index can be expanded incrementally by attaching the previous (smaller)
+// index to a new index. New entries are always added to the new index, and
+// the entries in the previous index are migrated a few slots at a time. Until
+// the migration has completed, lookups consult both the new and the previous
+// index. The migration state is stored in the index header, and the previous
+// index is kept in a separate file (<index>.old) until it has been migrated.
 class DatabaseIndex {
  public:
   // Invalid index position.
@@ -37,7 +46,8 @@ class DatabaseIndex {
 
   ~DatabaseIndex() { Close(); }
 
-  // Open existing index file.
+  // Open existing index file. If the index is being migrated, the previous
+  // index is opened as well.
   Status Open(const string &filename);
 
   // Create new index file.
@@ -52,6 +62,7 @@ class DatabaseIndex {
   // Look up value in index. Search for first value if pos is not specified.
   // Otherwise, search for the next value after position. Return the (next)
   // value for the key and update position or NVAL if no match is found.
+  // Positions at or above the capacity refer to the previous index.
   uint64 Get(uint64 key, uint64 *pos) const;
   uint64 Get(uint64 key) const {
     uint64 pos = NPOS;
@@ -75,6 +86,37 @@ class DatabaseIndex {
   // Transfer all used index entries to another index.
   void TransferTo(DatabaseIndex *index) const;
 
+  // Start incremental migration of entries from the previous index into this
+  // index. Ownership of the previous index is transferred to this index.
+  void Attach(DatabaseIndex *previous);
+
+  // Migrate entries in the next slots of the previous index to this index.
+  // Returns true when all entries have been migrated.
+  bool Migrate(uint64 slots);
+
+  // Close previous index after all entries have been migrated.
+  Status Detach();
+
+  // Check if entries are being migrated from a previous index.
+  bool migrating() const { return previous_ != nullptr; }
+
+  // Return filename for previous index during migration.
+  static string PreviousFilename(const string &filename) {
+    return filename + ".old";
+  }
+
+  // Sequence number for migration moves. The sequence number is odd while
+  // entries are being moved from the previous index to this index.
+  uint64 moves() const { return __atomic_load_n(&moves_, __ATOMIC_ACQUIRE); }
+
+  // Check that no entries have been moved since sequence number was obtained.
+  // Lookups that fail in a concurrent reader must be retried unless stable.
+  bool Stable(uint64 moves) const {
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    if (moves & 1) return false;
+    return __atomic_load_n(&moves_, __ATOMIC_RELAXED) == moves;
+  }
+
   // Copy index from another index. This requires that the other index has the
   // same capacity as this index.
   void CopyFrom(const DatabaseIndex *index);
@@ -100,11 +142,21 @@ class DatabaseIndex {
   uint64 limit() const { return header_ != nullptr ? header_->limit : 0; }
 
   // Return number of active records.
-  uint64 num_records() const { return header_->size - header_->deletions; }
+  uint64 num_records() const {
+    uint64 n = header_->size - header_->deletions;
+    if (previous_ != nullptr) n += previous_->num_records();
+    return n;
+  }
 
   // Return number of deleted records.
   uint64 num_deleted() const { return header_->deletions; }
 
+  // Return number of slots migrated from the previous index.
+  uint64 migrated() const { return header_->migrated; }
+
+  // Return index file format version.
+  uint32 version() const { return header_->version; }
+
   // Error codes.
   enum Errors {
     E_MEMMAP = 2000,         // unable to map index into memory
@@ -117,12 +169,13 @@ class DatabaseIndex {
     E_LOAD_FACTOR,           // invalid index load factor
     E_ALIGNMENT,             // index capacity not aligned to page size
     E_MISSING,               // index file is missing or empty
+    E_MIGRATION,             // invalid index migration state
   };
 
  private:
   // Magic number and version for identifying database index file.
   static const uint32 MAGIC = 0x46584449;  // IDXF
-  static const uint32 VERSION = 1;
+  static const uint32 VERSION = 2;
 
   // Special keys for empty and deleted entries in the index.
   static const uint64 EMPTY = 0;
@@ -138,6 +191,8 @@ class DatabaseIndex {
     uint64 capacity;  // maximum capacity of index
     uint64 limit;     // index size limit, i.e. capacity * load factor
     uint64 deletions; // number of deleted entries (tombstones) in index
+    uint64 previous;  // capacity of previous index being migrated (v2)
+    uint64 migrated;  // number of slots migrated from previous index (v2)
   };
 
   // Index entry. If key is EMPTY, the entry is unused, and if the key is
@@ -164,6 +219,12 @@ class DatabaseIndex {
 
   // Index position mask, i.e. capacity - 1.
   uint64 mask_;
+
+  // Previous index with entries that are being migrated to this index.
+  DatabaseIndex *previous_ = nullptr;
+
+  // Migration sequence number for concurrent readers.
+  uint64 moves_ = 0;
 };
 
 }  // namespace sling
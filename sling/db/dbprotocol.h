@@ -37,6 +37,7 @@ enum DBVerb : uint32 {
   DBNEXT2     = 8,     // retrieve the next record(s), version 2
   DBSTREAM    = 9,     // retrieve stream of records
   DBCLEAR     = 10,    // delete all records from database
+  DBREPLICATE = 11,    // retrieve changes to database for replication
 
   // Reply verbs.
   DBOK        = 128,   // success reply
@@ -49,6 +50,7 @@ enum DBVerb : uint32 {
   DBKEY       = 135,   // reply with key/record information
   DBDATA      = 136,   // stream reply with key/record information
   DBEND       = 137,   // end of stream
+  DBCHANGES   = 138,   // reply with changed records
 };
 
 // Update mode for DBPUT.
@@ -84,6 +86,9 @@ enum DBNextFlag : uint8 {
   DBNEXT_NOVALUE   = 0x04,     // do not return record value
 };
 
+// Maximum number of records in a multi-record request.
+static const int DBMAXBATCH = 1000;
+
 // Database protocol packet header.
 struct DBHeader {
   DBVerb verb;   // command or reply type
@@ -183,7 +188,29 @@ struct DBHeader {
 //
 // Delete all records from database, if allowed.
 //
+// DBREPLICATE start:uint64 num:uint32 layout:uint64 ->
+//             DBCHANGES epoch:uint64 generation:uint64 layout:uint64
+//                       next:uint64 {record}*
+//
+// Retrieves the next changes to the database from the start position for
+// replicating the database. Both updated and deleted records are returned,
+// where deletions are records with an empty value. The next position is used
+// for retrieving the following changes, and the epoch is the current end of
+// the database. A replica has caught up with the database when the next
+// position reaches the epoch. The generation changes when the record ids in
+// the database are invalidated, e.g. by clearing or purging the database, and
+// the replica must then resynchronize from the start. Online compaction moves
+// records within a generation, which changes the layout of the database. The
+// start position is relocated from the layout in the request to the current
+// layout, and the next position is returned in the current layout. If the
+// start position cannot be relocated, no records are returned, the next
+// position is -1, and the replica must resynchronize from the start.
+//
 // All requests can return a DBERROR message:char[] reply if an error occurs.
+//
+// Requests can be pipelined, i.e. a client can send multiple requests without
+// waiting for the replies. The server processes the requests in order and
+// sends back the replies in the same order as the requests.
 
 }  // namespace sling
 
@@ -17,10 +17,13 @@
 #include <time.h>
 #include <unistd.h>
 #include <string>
+#include <thread>
 #include <unordered_map>
 
 #include "sling/db/db.h"
+#include "sling/db/dbclient.h"
 #include "sling/db/dbprotocol.h"
+#include "sling/file/file.h"
 #include "sling/net/http-server.h"
 #include "sling/string/numbers.h"
 #include "sling/util/fingerprint.h"
@@ -94,6 +97,16 @@ Status DBService::MountDatabase(const string &name,
   // Add database to mount table.
   mounts_[name] = mount;
 
+  // Resume replication if database is a replica.
+  string leader;
+  uint64 position, generation, layout;
+  if (DBReplica::Load(dbdir, &leader, &position, &generation, &layout)) {
+    LOG(INFO) << "Resume replication of " << name << " from " << leader;
+    mount->replica =
+        new DBReplica(mount, leader, position, generation, layout);
+    mount->replica->Start();
+  }
+
   // Database mounted sucessfully.
   LOG(INFO) << "Database mounted: " << name << ", "
             << mount->db.num_records() << " records";
@@ -191,6 +204,10 @@ void DBService::Process(HTTPRequest *request, HTTPResponse *response) {
         Clear(request, response);
       } else if (strcmp(cmd, "purge") == 0) {
         Purge(request, response);
+      } else if (strcmp(cmd, "replicate") == 0) {
+        Replicate(request, response);
+      } else if (strcmp(cmd, "promote") == 0) {
+        Promote(request, response);
       } else {
         response->SendError(501, nullptr, "Unknown DB command");
       }
@@ -223,7 +240,7 @@ void DBService::Upgrade(HTTPRequest *request, HTTPResponse *response) {
 
 void DBService::Get(HTTPRequest *request, HTTPResponse *response) {
   // Get database and resource from request.
-  DBLock l(this, request->path());
+  DBLock l(this, request->path(), true);
   if (l.mount() == nullptr) {
     response->SendError(404, nullptr, "Database not found");
     return;
@@ -233,7 +250,8 @@ void DBService::Get(HTTPRequest *request, HTTPResponse *response) {
   Record record;
   if (!l.resource().empty()) {
     // Fetch record from database.
-    if (!l.db()->Get(l.resource(), &record)) {
+    IOBuffer buffer;
+    if (!l.Get(l.resource(), &record, &buffer)) {
       response->SendError(404, nullptr, "Record not found");
       return;
     }
@@ -242,6 +260,7 @@ void DBService::Get(HTTPRequest *request, HTTPResponse *response) {
     ReturnSingle(response, record, false, timestamped, -1);
   } else {
     // Read first/next record in iterator.
+    l.Lock();
     URLQuery query(request->query());
 
     // Get record position.
@@ -366,7 +385,7 @@ void DBService::ReturnMultiple(HTTPResponse *response, Database *db,
 
 void DBService::Head(HTTPRequest *request, HTTPResponse *response) {
   // Get database and resource from request.
-  DBLock l(this, request->path());
+  DBLock l(this, request->path(), true);
   if (l.mount() == nullptr) {
     response->set_status(404);
     return;
@@ -374,7 +393,8 @@ void DBService::Head(HTTPRequest *request, HTTPResponse *response) {
 
   // Fetch record information from database.
   Record record;
-  if (!l.db()->Get(l.resource(), &record, false)) {
+  IOBuffer buffer;
+  if (!l.Get(l.resource(), &record, &buffer, true)) {
     response->set_status(404);
     return;
   }
@@ -410,6 +430,10 @@ void DBService::Put(HTTPRequest *request, HTTPResponse *response) {
     response->SendError(405, nullptr, "Database is read-only");
     return;
   }
+  if (l.mount()->replica != nullptr) {
+    response->SendError(405, nullptr, "Database is a replica");
+    return;
+  }
 
   // Get record from request.
   Slice value(request->content(), request->content_size());
@@ -489,6 +513,10 @@ void DBService::Delete(HTTPRequest *request, HTTPResponse *response) {
     response->SendError(405, nullptr, "Database is read-only");
     return;
   }
+  if (l.mount()->replica != nullptr) {
+    response->SendError(405, nullptr, "Database is a replica");
+    return;
+  }
 
   // Delete record.
   if (!l.db()->Delete(l.resource())) {
@@ -529,8 +557,13 @@ void DBService::Options(HTTPRequest *request, HTTPResponse *response) {
     dbinfo->Add("bulk", mount->db.bulk());
     dbinfo->Add("read_only", mount->db.read_only());
     dbinfo->Add("timestamped", mount->db.timestamped());
+    dbinfo->Add("concurrent", mount->db.concurrent());
     dbinfo->Add("deletions", mount->db.num_deleted());
     dbinfo->Add("index_capacity", mount->db.index_capacity());
+    dbinfo->Add("index_migrating", mount->db.index_migrating());
+    if (mount->replica != nullptr) {
+      dbinfo->Add("leader", mount->replica->leader());
+    }
   }
 
   json.Write(response->buffer());
@@ -612,8 +645,11 @@ void DBService::Unmount(HTTPRequest *request, HTTPResponse *response) {
     return;
   }
 
-  // Acquire database lock to ensure exclusive access.
+  // Stop replication and online compaction and acquire database lock to
+  // ensure exclusive access.
   DBMount *mount = f->second;
+  if (mount->replica != nullptr) mount->replica->Stop();
+  if (mount->compaction != nullptr) mount->compaction->Stop();
   mount->Acquire();
 
   // Release database from active clients.
@@ -674,6 +710,12 @@ void DBService::Clear(HTTPRequest *request, HTTPResponse *response) {
     return;
   }
 
+  // Replicas can only be cleared by the leader.
+  if (l.mount()->replica != nullptr) {
+    response->SendError(405, nullptr, "Database is a replica");
+    return;
+  }
+
   // Clear database.
   LOG(INFO) << "Clear database: " << name;
   Status st = l.db()->Clear();
@@ -692,6 +734,7 @@ void DBService::Purge(HTTPRequest *request, HTTPResponse *response) {
   // Get parameters.
   URLQuery query(request->query());
   string name = query.Get("name").str();
+  bool online = query.Get("online", false);
 
   // Lock database.
   DBLock l(this, name);
@@ -700,6 +743,23 @@ void DBService::Purge(HTTPRequest *request, HTTPResponse *response) {
     return;
   }
 
+  // Only one compaction can run at a time.
+  DBMount *mount = l.mount();
+  if (mount->compaction != nullptr && mount->compaction->running()) {
+    response->SendError(500, nullptr, "Database compaction in progress");
+    return;
+  }
+
+  // Start online compaction in the background.
+  if (online) {
+    LOG(INFO) << "Start online compaction of database: " << name;
+    delete mount->compaction;
+    mount->compaction = new DBCompaction(mount);
+    mount->compaction->Start();
+    response->SendError(200, nullptr, "Database compaction started");
+    return;
+  }
+
   // Purge database.
   LOG(INFO) << "Purge database: " << name;
   Status st = l.db()->Purge();
@@ -714,6 +774,85 @@ void DBService::Purge(HTTPRequest *request, HTTPResponse *response) {
   response->SendError(200, nullptr, "Database purged");
 }
 
+void DBService::Replicate(HTTPRequest *request, HTTPResponse *response) {
+  // Get parameters.
+  URLQuery query(request->query());
+  string name = query.Get("name").str();
+  string leader = query.Get("leader").str();
+  if (leader.empty()) {
+    response->SendError(400, nullptr, "Leader missing");
+    return;
+  }
+  uint64 position = 0;
+  Text pos = query.Get("position");
+  if (!pos.empty() && !safe_strtou64(pos.data(), pos.size(), &position)) {
+    response->SendError(400, nullptr, "Invalid position");
+    return;
+  }
+
+  // Find mounted database.
+  MutexLock lock(&mu_);
+  auto f = mounts_.find(name);
+  if (f == mounts_.end()) {
+    response->SendError(404, nullptr, "Database not found");
+    return;
+  }
+  DBMount *mount = f->second;
+  if (mount->replica != nullptr) {
+    response->SendError(500, nullptr, "Database is already a replica");
+    return;
+  }
+
+  // Save replication state and start replication.
+  DBLock l(mount);
+  DBReplica *replica = new DBReplica(mount, leader, position);
+  Status st = replica->Save();
+  if (!st.ok()) {
+    delete replica;
+    response->SendError(500, nullptr, HTMLEscape(st.ToString()).c_str());
+    return;
+  }
+  mount->replica = replica;
+  replica->Start();
+
+  LOG(INFO) << "Replicating " << name << " from " << leader;
+  response->SendError(200, nullptr, "Database replication started");
+}
+
+void DBService::Promote(HTTPRequest *request, HTTPResponse *response) {
+  // Get parameters.
+  URLQuery query(request->query());
+  string name = query.Get("name").str();
+
+  // Find mounted database.
+  MutexLock lock(&mu_);
+  auto f = mounts_.find(name);
+  if (f == mounts_.end()) {
+    response->SendError(404, nullptr, "Database not found");
+    return;
+  }
+  DBMount *mount = f->second;
+  if (mount->replica == nullptr) {
+    response->SendError(500, nullptr, "Database is not a replica");
+    return;
+  }
+
+  // Stop replication and remove replication state.
+  DBReplica *replica = mount->replica;
+  replica->Stop();
+  DBLock l(mount);
+  mount->replica = nullptr;
+  delete replica;
+  Status st = DBReplica::Remove(mount->db.dbdir());
+  if (!st.ok()) {
+    response->SendError(500, nullptr, HTMLEscape(st.ToString()).c_str());
+    return;
+  }
+
+  LOG(INFO) << "Database promoted: " << name;
+  response->SendError(200, nullptr, "Database promoted");
+}
+
 void DBService::Statusz(HTTPRequest *request, HTTPResponse *response) {
   // General server information.
   JSON::Object json;
@@ -738,6 +877,25 @@ void DBService::Statusz(HTTPRequest *request, HTTPResponse *response) {
     dbstats->Add("BYTEWRITE", mount->db.counter(Database::BYTEWRITE));
     dbstats->Add("HIT", mount->db.counter(Database::HIT));
     dbstats->Add("MISS", mount->db.counter(Database::MISS));
+    dbstats->Add("COMPACTREAD", mount->db.counter(Database::COMPACTREAD));
+    dbstats->Add("COMPACTWRITE", mount->db.counter(Database::COMPACTWRITE));
+    dbstats->Add("RECLAIMED", mount->db.counter(Database::RECLAIMED));
+
+    // Write amplification is the ratio between the bytes written to the data
+    // shards, including records copied by compaction, and the bytes written by
+    // clients.
+    uint64 written = mount->db.counter(Database::BYTEWRITE);
+    uint64 copied = mount->db.counter(Database::COMPACTWRITE);
+    if (written > 0) {
+      dbstats->Add("write_amplification",
+                   static_cast<double>(written + copied) / written);
+    }
+    if (mount->compaction != nullptr) {
+      mount->compaction->GetStatus(dbstats->AddObject("compaction"));
+    }
+    if (mount->replica != nullptr) {
+      mount->replica->GetStatus(dbstats->AddObject("replication"));
+    }
   }
 
   json.Write(response->buffer());
@@ -761,12 +919,17 @@ DBMount::DBMount(const string &name) : name(name) {
   last_update = last_flush = time(0);
 }
 
+DBMount::~DBMount() {
+  delete replica;
+  delete compaction;
+}
+
 void DBMount::Acquire() {
   mu.Lock();
   mu.Unlock();
 }
 
-DBLock::DBLock(DBService *dbs, const char *path) {
+DBLock::DBLock(DBService *dbs, const char *path, bool shared) {
   if (path == nullptr) return;
 
   // Get database name from path.
@@ -781,9 +944,10 @@ DBLock::DBLock(DBService *dbs, const char *path) {
   auto f = dbs->mounts_.find(dbname);
   if (f == dbs->mounts_.end()) return;
 
-  // Lock database.
+  // Lock database unless it supports concurrent readers.
   mount_ = f->second;
-  mount_->mu.Lock();
+  shared_ = shared && mount_->db.concurrent();
+  if (!shared_) Lock();
 
   // Get resource name from path.
   if (*p == '/') p++;
@@ -799,25 +963,397 @@ DBLock::DBLock(DBService *dbs, const string &dbname) {
 
   // Lock database.
   mount_ = f->second;
-  mount_->mu.Lock();
+  Lock();
 }
 
-DBLock::DBLock(DBMount *mount) {
+DBLock::DBLock(DBMount *mount, bool shared) {
   mount_ = mount;
-  if (mount_ != nullptr) mount_->mu.Lock();
+  if (mount_ != nullptr) {
+    shared_ = shared && mount_->db.concurrent();
+    if (!shared_) Lock();
+  }
 }
 
 DBLock::~DBLock() {
-  if (mount_ != nullptr) mount_->mu.Unlock();
+  if (locked_) mount_->mu.Unlock();
+}
+
+void DBLock::Lock() {
+  if (mount_ != nullptr && !locked_) {
+    mount_->mu.Lock();
+    locked_ = true;
+  }
 }
 
 void DBLock::Yield() {
-  if (mount_ != nullptr) {
+  if (locked_) {
     mount_->mu.Unlock();
-    mount_->mu.Lock();
+    if (shared_) {
+      locked_ = false;
+    } else {
+      mount_->mu.Lock();
+    }
+  }
+}
+
+bool DBLock::Get(const Slice &key, Record *record, IOBuffer *buffer,
+                 bool novalue) {
+  if (!locked_) {
+    // Try to read record without locking the database.
+    bool unsynced = false;
+    if (db()->Lookup(key, record, buffer, novalue, &unsynced)) return true;
+    if (!unsynced) return false;
+
+    // Fall back to reading record under the database lock.
+    Lock();
+  }
+  return db()->Get(key, record, novalue);
+}
+
+DBReplica::DBReplica(DBMount *mount, const string &leader, uint64 position,
+                     uint64 generation, uint64 layout)
+    : mount_(mount), leader_(leader), position_(position),
+      generation_(generation), layout_(layout), saved_(position) {
+}
+
+DBReplica::~DBReplica() {
+  Stop();
+}
+
+void DBReplica::Start() {
+  thread_.SetJoinable(true);
+  thread_.Start();
+  running_ = true;
+}
+
+void DBReplica::Stop() {
+  if (!running_) return;
+
+  // Stop replication thread.
+  {
+    std::unique_lock<std::mutex> lock(mu_);
+    stop_ = true;
+    stopped_.notify_all();
+  }
+  thread_.Join();
+  running_ = false;
+
+  // Save final replication position.
+  DBLock l(mount_);
+  Status st = Save();
+  if (!st.ok()) {
+    LOG(ERROR) << "Error saving replication state for " << mount_->name
+               << ": " << st;
   }
 }
 
+string DBReplica::StateFile(const string &dbdir) {
+  return dbdir + "/replica";
+}
+
+bool DBReplica::Load(const string &dbdir, string *leader, uint64 *position,
+                     uint64 *generation, uint64 *layout) {
+  // The replication state file contains the leader, the position, and the
+  // leader generation and layout on separate lines.
+  string state;
+  if (!File::ReadContents(StateFile(dbdir), &state).ok()) return false;
+  std::vector<string> lines;
+  int start = 0;
+  for (;;) {
+    int nl = state.find('\n', start);
+    if (nl == -1) nl = state.size();
+    if (nl > start) lines.push_back(state.substr(start, nl - start));
+    if (nl >= state.size()) break;
+    start = nl + 1;
+  }
+  if (lines.size() < 2) return false;
+  *leader = lines[0];
+  if (!safe_strtou64(lines[1], position)) return false;
+  *generation = 0;
+  if (lines.size() > 2 && !safe_strtou64(lines[2], generation)) return false;
+  *layout = 0;
+  if (lines.size() > 3 && !safe_strtou64(lines[3], layout)) return false;
+  return true;
+}
+
+Status DBReplica::Remove(const string &dbdir) {
+  return File::Delete(StateFile(dbdir));
+}
+
+Status DBReplica::Save() {
+  // Flush database before saving position, so the saved position never runs
+  // ahead of the changes on disk.
+  Status st = mount_->db.Flush();
+  if (!st.ok()) return st;
+  mount_->last_flush = time(0);
+
+  // Write state to temporary file and replace the current state file.
+  string state = leader_ + "\n" +
+                 std::to_string(position_) + "\n" +
+                 std::to_string(generation_) + "\n" +
+                 std::to_string(layout_) + "\n";
+  string filename = StateFile(mount_->db.dbdir());
+  st = File::WriteContents(filename + ".tmp", state);
+  if (!st.ok()) return st;
+  st = File::Rename(filename + ".tmp", filename);
+  if (!st.ok()) return st;
+  saved_ = position_;
+  return Status::OK;
+}
+
+void DBReplica::GetStatus(JSON::Object *json) {
+  std::unique_lock<std::mutex> lock(mu_);
+  time_t now = time(0);
+  json->Add("leader", leader_);
+  json->Add("connected", connected_);
+  json->Add("position", position_);
+  json->Add("epoch", epoch_);
+  json->Add("generation", generation_);
+  json->Add("layout", layout_);
+  json->Add("applied", applied_);
+
+  // The lag in bytes is only known when the replica is in the same data
+  // shard as the leader, i.e. the upper 16 bits of the record ids match.
+  if (position_ >= epoch_) {
+    json->Add("lag_bytes", 0);
+  } else if ((position_ >> 48) == (epoch_ >> 48)) {
+    json->Add("lag_bytes", epoch_ - position_);
+  }
+  json->Add("lag_seconds", caught_up_ == 0 ? -1 : now - caught_up_);
+  if (!error_.empty()) json->Add("error", error_);
+}
+
+bool DBReplica::Wait(int ms) {
+  std::unique_lock<std::mutex> lock(mu_);
+  if (!stop_) stopped_.wait_for(lock, std::chrono::milliseconds(ms));
+  return !stop_;
+}
+
+void DBReplica::Resync(DBLock *l, uint64 generation, uint64 layout) {
+  LOG(WARNING) << "Resynchronize replica " << mount_->name
+               << " from " << leader_ << ", generation " << generation_
+               << " -> " << generation;
+
+  // Clear replica, so records that have been deleted in the leader database
+  // are removed. Otherwise, the changes are applied on top of the existing
+  // records.
+  if (l->db()->config().can_clear) {
+    Status st = l->db()->Clear();
+    if (!st.ok()) {
+      LOG(ERROR) << "Error clearing replica " << mount_->name << ": " << st;
+    }
+  } else {
+    LOG(WARNING) << "Replica " << mount_->name << " cannot be cleared, "
+                 << "records deleted in the leader might remain";
+  }
+
+  // Restart replication from the beginning of the new generation.
+  {
+    std::unique_lock<std::mutex> lock(mu_);
+    position_ = 0;
+    generation_ = generation;
+    layout_ = layout;
+    caught_up_ = 0;
+  }
+  Status st = Save();
+  if (!st.ok()) {
+    LOG(ERROR) << "Error saving replication state for " << mount_->name
+               << ": " << st;
+  }
+}
+
+void DBReplica::Run() {
+  DBClient leader;
+  std::vector<DBRecord> records;
+  IOBuffer buffer;
+  time_t last_save = time(0);
+  for (;;) {
+    {
+      std::unique_lock<std::mutex> lock(mu_);
+      if (stop_) break;
+    }
+
+    // Connect to leader.
+    if (!leader.connected()) {
+      Status st = leader.Connect(leader_, "replica");
+      std::unique_lock<std::mutex> lock(mu_);
+      connected_ = st.ok();
+      if (!st.ok()) {
+        LOG(WARNING) << "Error connecting to leader " << leader_ << ": " << st;
+        error_ = st.ToString();
+        lock.unlock();
+        if (!Wait(RETRY_INTERVAL)) break;
+        continue;
+      }
+    }
+
+    // Fetch next batch of changes from leader.
+    uint64 next = position_;
+    uint64 layout = layout_;
+    uint64 epoch, generation;
+    Status st = leader.Changes(&next, &layout, BATCH_SIZE, &records, &epoch,
+                               &generation, &buffer);
+    if (!st.ok()) {
+      LOG(WARNING) << "Error replicating " << mount_->name
+                   << " from " << leader_ << ": " << st;
+      leader.Close();
+      {
+        std::unique_lock<std::mutex> lock(mu_);
+        connected_ = false;
+        error_ = st.ToString();
+      }
+      if (!Wait(RETRY_INTERVAL)) break;
+      continue;
+    }
+
+    // The record ids in the leader database are no longer valid for the
+    // position if the leader has started a new generation, if the leader
+    // cannot relocate the position to its current layout, or if the leader
+    // database is behind the replica, e.g. if it has been restored from an
+    // older copy. Replication must then start over from the beginning.
+    if ((generation_ != 0 && generation != generation_) || next == -1 ||
+        position_ > epoch) {
+      DBLock l(mount_);
+      Resync(&l, generation, layout);
+      continue;
+    }
+
+    // Apply changes to replica. Changes are idempotent, so a batch can safely
+    // be applied again if it fails halfway.
+    bool failed = false;
+    {
+      DBLock l(mount_);
+      Record record;
+      for (const DBRecord &rec : records) {
+        record.key = rec.key;
+        record.value = rec.value;
+        record.version = rec.version;
+        if (record.value.empty()) {
+          l.db()->Delete(record.key);
+        } else if (l.db()->Put(record) == -1) {
+          failed = true;
+          break;
+        }
+      }
+      if (!records.empty()) mount_->last_update = time(0);
+
+      // Update replication state. The leader generation is saved right away
+      // when it was not known before.
+      std::unique_lock<std::mutex> lock(mu_);
+      bool adopted = generation_ != generation;
+      generation_ = generation;
+      epoch_ = epoch;
+      if (failed) {
+        error_ = "Error applying changes";
+      } else {
+        position_ = next;
+        layout_ = layout;
+        applied_ += records.size();
+        if (position_ >= epoch_) caught_up_ = time(0);
+        error_.clear();
+      }
+      lock.unlock();
+
+      // Periodically save replication position.
+      time_t now = time(0);
+      if ((position_ != saved_ && now - last_save >= SAVE_INTERVAL) ||
+          adopted) {
+        Status st = Save();
+        if (!st.ok()) {
+          LOG(ERROR) << "Error saving replication state for " << mount_->name
+                     << ": " << st;
+        }
+        last_save = now;
+      }
+    }
+
+    // Wait for more changes when caught up with leader.
+    if (failed) {
+      LOG(ERROR) << "Error applying changes to replica " << mount_->name;
+      if (!Wait(RETRY_INTERVAL)) break;
+    } else if (records.empty()) {
+      if (!Wait(POLL_INTERVAL)) break;
+    }
+  }
+}
+
+DBCompaction::~DBCompaction() {
+  Stop();
+}
+
+void DBCompaction::Start() {
+  started_ = time(0);
+  thread_.SetJoinable(true);
+  thread_.Start();
+  running_ = true;
+}
+
+void DBCompaction::Stop() {
+  if (!running_) return;
+  {
+    std::unique_lock<std::mutex> lock(mu_);
+    stop_ = true;
+  }
+  thread_.Join();
+  running_ = false;
+}
+
+bool DBCompaction::running() {
+  std::unique_lock<std::mutex> lock(mu_);
+  return !done_;
+}
+
+void DBCompaction::GetStatus(JSON::Object *json) {
+  std::unique_lock<std::mutex> lock(mu_);
+  json->Add("running", !done_);
+  json->Add("started", static_cast<int64>(started_));
+  if (done_) {
+    json->Add("finished", static_cast<int64>(finished_));
+    json->Add("elapsed", static_cast<int64>(finished_ - started_));
+  } else {
+    json->Add("elapsed", static_cast<int64>(time(0) - started_));
+  }
+  if (!error_.empty()) json->Add("error", error_);
+}
+
+void DBCompaction::Run() {
+  Status st;
+  for (;;) {
+    // Compact the next batch of records while holding the database lock. The
+    // lock is released between batches to let clients access the database.
+    bool done = false;
+    {
+      DBLock l(mount_);
+      bool stop;
+      {
+        std::unique_lock<std::mutex> lock(mu_);
+        stop = stop_;
+      }
+      if (stop) {
+        LOG(INFO) << "Compaction of " << mount_->name << " stopped";
+        l.db()->AbortCompaction();
+        break;
+      }
+      st = l.db()->Compact(STEP_SIZE, &done);
+      if (!st.ok()) {
+        LOG(ERROR) << "Error compacting " << mount_->name << ": " << st;
+        l.db()->AbortCompaction();
+        break;
+      }
+    }
+    if (done) {
+      LOG(INFO) << "Database compacted: " << mount_->name;
+      break;
+    }
+    std::this_thread::yield();
+  }
+
+  std::unique_lock<std::mutex> lock(mu_);
+  if (!st.ok()) error_ = st.ToString();
+  finished_ = time(0);
+  done_ = true;
+}
+
 DBSession::DBSession(DBService *dbs, SocketConnection *conn, const char *ua)
     : dbs_(dbs), conn_(conn) {
   // Add client to client list.
@@ -861,9 +1397,13 @@ DBSession::Continuation DBSession::Process(SocketConnection *conn) {
   auto *hdr = DBHeader::from(req->begin());
   if (req->available() < hdr->size + sizeof(DBHeader)) return CONTINUE;
 
-  // Dispatch request.
+  // Hide any pipelined requests following the current request while it is
+  // being processed.
+  size_t pipelined = req->available() - sizeof(DBHeader) - hdr->size;
   req->Consume(sizeof(DBHeader));
-  if (req->available() != hdr->size) return TERMINATE;
+  req->Unwrite(pipelined);
+
+  // Dispatch request.
   Continuation cont = TERMINATE;
   switch (hdr->verb) {
     case DBUSE: cont = Use(); break;
@@ -877,12 +1417,17 @@ DBSession::Continuation DBSession::Process(SocketConnection *conn) {
     case DBNEXT2: cont = Next(2); break;
     case DBSTREAM: cont = Stream(); break;
     case DBCLEAR: cont = Clear(); break;
-    default: return Error("command verb not supported");
+    case DBREPLICATE: cont = Replicate(); break;
+    default: cont = Error("command verb not supported");
   }
 
   // Make sure the whole request has been consumed.
   if (req->available() > 0) req->Consume(req->available());
 
+  // Restore pipelined requests. These are processed after the response for
+  // the current request has been sent.
+  req->Append(pipelined);
+
   return cont;
 }
 
@@ -918,7 +1463,7 @@ DBSession::Continuation DBSession::Bulk() {
 
 DBSession::Continuation DBSession::Get() {
   if (mount_ == nullptr) return Error("no database");
-  DBLock l(mount_);
+  DBLock l(mount_, true);
   auto *req = conn_->request();
   auto *rsp = conn_->response_body();
   while (!req->empty()) {
@@ -928,7 +1473,7 @@ DBSession::Continuation DBSession::Get() {
 
     // Read record from database.
     Record record;
-    if (!l.db()->Get(key, &record)) {
+    if (!l.Get(key, &record, &buffer_)) {
       // Return empty value if record is not found.
       record.key = key;
       record.value.clear();
@@ -944,7 +1489,7 @@ DBSession::Continuation DBSession::Get() {
 
 DBSession::Continuation DBSession::Head() {
   if (mount_ == nullptr) return Error("no database");
-  DBLock l(mount_);
+  DBLock l(mount_, true);
   auto *req = conn_->request();
   auto *rsp = conn_->response_body();
   while (!req->empty()) {
@@ -955,7 +1500,7 @@ DBSession::Continuation DBSession::Head() {
     // Get record information from database.
     Record record;
     uint32 vsize = 0;
-    if (l.db()->Get(key, &record, false)) {
+    if (l.Get(key, &record, &buffer_, true)) {
       vsize = record.value.size();
     }
 
@@ -971,6 +1516,7 @@ DBSession::Continuation DBSession::Head() {
 DBSession::Continuation DBSession::Put() {
   if (mount_ == nullptr) return Error("no database");
   DBLock l(mount_);
+  if (l.mount()->replica != nullptr) return Error("database is a replica");
   auto *req = conn_->request();
   auto *rsp = conn_->response_body();
 
@@ -1005,6 +1551,7 @@ DBSession::Continuation DBSession::Put() {
 DBSession::Continuation DBSession::Delete() {
   if (mount_ == nullptr) return Error("no database");
   DBLock l(mount_);
+  if (l.mount()->replica != nullptr) return Error("database is a replica");
   auto *req = conn_->request();
   while (!req->empty()) {
     // Read next key.
@@ -1108,11 +1655,58 @@ DBSession::Continuation DBSession::Epoch() {
 DBSession::Continuation DBSession::Clear() {
   if (mount_ == nullptr) return Error("no database");
   DBLock l(mount_);
+  if (l.mount()->replica != nullptr) return Error("database is a replica");
   Status st = l.db()->Clear();
   if (!st.ok()) return Error(st.message());
   return Response(DBOK);
 }
 
+DBSession::Continuation DBSession::Replicate() {
+  if (mount_ == nullptr) return Error("no database");
+  DBLock l(mount_);
+  auto *req = conn_->request();
+  auto *rsp = conn_->response_body();
+
+  uint64 iterator;
+  if (!req->Read(&iterator, 8)) return TERMINATE;
+  uint32 num;
+  if (!req->Read(&num, 4)) return TERMINATE;
+  if (num > DBMAXBATCH) num = DBMAXBATCH;
+  uint64 layout;
+  if (!req->Read(&layout, 8)) return TERMINATE;
+
+  // Relocate the position to the current layout of the database. If this is
+  // not possible, no changes are returned and the next position is -1.
+  if (!l.db()->Relocate(&iterator, layout)) {
+    iterator = -1;
+    num = 0;
+  }
+
+  // Write current epoch, generation, and layout and reserve room for next
+  // position.
+  uint64 epoch = l.db()->epoch();
+  uint64 generation = l.db()->generation();
+  layout = l.db()->layout();
+  rsp->Write(&epoch, 8);
+  rsp->Write(&generation, 8);
+  rsp->Write(&layout, 8);
+  rsp->Append(8);
+
+  // Return updated and deleted records after the current position.
+  Record record;
+  for (int n = 0; n < num; ++n) {
+    uint64 next = iterator;
+    if (!l.db()->Next(&record, &next, true)) break;
+    WriteRecord(record, rsp);
+    iterator = next;
+    if (rsp->available() > MAX_CHANGES_SIZE) break;
+    l.Yield();
+  }
+  memcpy(rsp->begin() + 24, &iterator, 8);
+
+  return Response(DBCHANGES);
+}
+
 DBSession::Continuation DBSession::Error(const char *msg) {
   // Clear existing (partial) response.
   conn_->response_header()->Clear();
@@ -15,13 +15,18 @@
 #ifndef SLING_DB_DBSERVER_H_
 #define SLING_DB_DBSERVER_H_
 
+#include <condition_variable>
+#include <mutex>
 #include <string>
 #include <unordered_map>
 
 #include "sling/base/types.h"
 #include "sling/db/db.h"
+#include "sling/db/dbclient.h"
+#include "sling/db/dbprotocol.h"
 #include "sling/net/http-server.h"
 #include "sling/net/static-content.h"
+#include "sling/util/json.h"
 #include "sling/util/thread.h"
 
 namespace sling {
@@ -29,6 +34,8 @@ namespace sling {
 class DBSession;
 class DBMount;
 class DBLock;
+class DBReplica;
+class DBCompaction;
 
 // HTTP/SLINGDB interface for database engine.
 class DBService {
@@ -100,6 +107,12 @@ class DBService {
   // Compact database by removing all deleted and updated records.
   void Purge(HTTPRequest *request, HTTPResponse *response);
 
+  // Start replicating database from leader.
+  void Replicate(HTTPRequest *request, HTTPResponse *response);
+
+  // Stop replication and make replica database writable.
+  void Promote(HTTPRequest *request, HTTPResponse *response);
+
   // Return database statistics.
   void Statusz(HTTPRequest *request, HTTPResponse *response);
 
@@ -126,7 +139,7 @@ class DBService {
   StaticContent app_{"/adminz", "sling/db/app"};
 
   // Maximum batch size.
-  static const int MAX_BATCH = 1000;
+  static const int MAX_BATCH = DBMAXBATCH;
 
   // Maximum database name size.
   static const int MAX_DBNAME_SIZE = 128;
@@ -143,6 +156,9 @@ struct DBMount {
   // Initialize database mount.
   DBMount(const string &name);
 
+  // Stop replication and compaction for database.
+  ~DBMount();
+
   // Get exclusive access to mounted database to acquiring the database lock
   // and releasing it again. If the caller is holding the global lock, this
   // will ensure exclusive access.
@@ -153,26 +169,191 @@ struct DBMount {
   Mutex mu;             // mutex for serializing access to database
   time_t last_update;   // time of last database update
   time_t last_flush;    // time of last database flush
+  DBReplica *replica = nullptr;  // replication from leader, if any
+  DBCompaction *compaction = nullptr;  // online compaction, if any
 };
 
-// Lock on database.
+// Replication of a mounted database from a database on a leader server. The
+// replica pulls the changes to the leader database from the current position
+// and applies them to the local database. The position and the generation and
+// layout of the leader database are saved in the database directory, so
+// replication resumes from the saved position when the database is mounted
+// again. When online compaction on the leader changes the layout, the leader
+// relocates the position to the new layout. If the leader starts a new
+// generation, the replica resynchronizes from the start. Clients cannot update
+// replicated databases.
+class DBReplica {
+ public:
+  // Initialize replication of database from leader. The leader is specified as
+  // [<hostname>[:<port>]/]<database name>.
+  // The generation is zero if the leader generation is not known yet.
+  DBReplica(DBMount *mount, const string &leader, uint64 position,
+            uint64 generation = 0, uint64 layout = 0);
+
+  // Stop replication.
+  ~DBReplica();
+
+  // Start replication thread.
+  void Start();
+
+  // Stop replication thread and save replication position.
+  void Stop();
+
+  // Load replication state for database. Returns false if the database is not
+  // a replica.
+  static bool Load(const string &dbdir, string *leader, uint64 *position,
+                   uint64 *generation, uint64 *layout);
+
+  // Remove replication state for database.
+  static Status Remove(const string &dbdir);
+
+  // Flush database and save replication position. The database must be locked.
+  Status Save();
+
+  // Output replication status.
+  void GetStatus(JSON::Object *json);
+
+  // Leader database.
+  const string &leader() const { return leader_; }
+
+ private:
+  // Replicate changes from leader until stopped.
+  void Run();
+
+  // Wait for interval. Returns false if replication has been stopped.
+  bool Wait(int ms);
+
+  // Restart replication from the start of a new leader generation. The replica
+  // database is cleared if allowed. The database must be locked.
+  void Resync(DBLock *l, uint64 generation, uint64 layout);
+
+  // Return file name for replication state.
+  static string StateFile(const string &dbdir);
+
+  // Replicated database.
+  DBMount *mount_;
+
+  // Leader database.
+  string leader_;
+
+  // Position in leader database for the next changes.
+  uint64 position_;
+
+  // Last known epoch for leader database.
+  uint64 epoch_ = 0;
+
+  // Generation and layout of leader database for the position.
+  uint64 generation_;
+  uint64 layout_;
+
+  // Position saved in replication state.
+  uint64 saved_ = 0;
+
+  // Replication statistics.
+  bool connected_ = false;   // connected to leader
+  uint64 applied_ = 0;       // number of changes applied
+  time_t caught_up_ = 0;     // last time replica caught up with leader
+  string error_;             // last replication error
+
+  // Replication thread.
+  ClosureThread thread_{[&]() { Run(); }};
+  bool running_ = false;
+  bool stop_ = false;
+
+  // Mutex and signal for replication state.
+  std::mutex mu_;
+  std::condition_variable stopped_;
+
+  // Maximum number of changes fetched per request.
+  static const int BATCH_SIZE = 1000;
+
+  // Interval for polling leader for new changes when caught up (ms).
+  static const int POLL_INTERVAL = 200;
+
+  // Interval for reconnecting after errors (ms).
+  static const int RETRY_INTERVAL = 5000;
+
+  // Interval for saving replication position (seconds).
+  static const int SAVE_INTERVAL = 10;
+};
+
+// Online compaction of a mounted database. The compaction runs in a background
+// thread, which compacts the database in small steps and releases the database
+// lock between steps, so clients can keep using the database while it is being
+// compacted.
+class DBCompaction {
+ public:
+  DBCompaction(DBMount *mount) : mount_(mount) {}
+
+  // Stop compaction.
+  ~DBCompaction();
+
+  // Start compaction thread.
+  void Start();
+
+  // Stop compaction thread. The compaction of the current shard is aborted.
+  void Stop();
+
+  // Check if compaction is still running.
+  bool running();
+
+  // Output compaction status.
+  void GetStatus(JSON::Object *json);
+
+ private:
+  // Compact database until done or stopped.
+  void Run();
+
+  // Database being compacted.
+  DBMount *mount_;
+
+  // Compaction statistics.
+  time_t started_ = 0;       // start time for compaction
+  time_t finished_ = 0;      // completion time for compaction
+  string error_;             // compaction error
+
+  // Compaction thread.
+  ClosureThread thread_{[&]() { Run(); }};
+  bool running_ = false;
+  bool done_ = false;
+  bool stop_ = false;
+
+  // Mutex for compaction state.
+  std::mutex mu_;
+
+  // Number of records copied in each compaction step.
+  static const int STEP_SIZE = 1000;
+};
+
+// Lock on database. In shared mode, the database is only locked if it does not
+// support concurrent readers.
 class DBLock {
  public:
   // Look up database from URL path and lock it.
-  DBLock(DBService *dbs, const char *path);
+  DBLock(DBService *dbs, const char *path, bool shared = false);
 
   // Look up database and lock it.
   DBLock(DBService *dbs, const string &dbname);
 
   // Lock database.
-  DBLock(DBMount *mount);
+  DBLock(DBMount *mount, bool shared = false);
 
   // Unlock database.
   ~DBLock();
 
-  // Yield database lock for long-running transactions.
+  // Acquire database lock if it is not already locked.
+  void Lock();
+
+  // Yield database lock for long-running transactions. In shared mode, the
+  // lock is released until it is needed again.
   void Yield();
 
+  // Get record from database. Concurrent readers only acquire the database
+  // lock if the record has not been synchronized yet. The buffer is used for
+  // holding the record data for concurrent readers.
+  bool Get(const Slice &key, Record *record, IOBuffer *buffer,
+           bool novalue = false);
+
   DBMount *mount() { return mount_; }
   Database *db() { return &mount_->db; }
   const string &resource() { return resource_; }
@@ -180,6 +361,8 @@ class DBLock {
  private:
   DBMount *mount_ = nullptr;       // database for resource
   string resource_;                // resource name
+  bool shared_ = false;            // allow concurrent readers
+  bool locked_ = false;            // database lock is held
 };
 
 // Database client connection that uses the binary SLINGDB protocol.
@@ -231,6 +414,9 @@ class DBSession : public SocketSession {
   // Clear all records in database.
   Continuation Clear();
 
+  // Return changes to database for replication.
+  Continuation Replicate();
+
   // Return error message to client.
   Continuation Error(const char *msg);
 
@@ -252,6 +438,10 @@ class DBSession : public SocketSession {
   SocketConnection *conn_;        // client connection
   DBMount *mount_ = nullptr;      // active database for client
   char *agent_ = nullptr;         // user agent
+  IOBuffer buffer_;               // buffer for concurrent record reads
+
+  // Maximum size of replication reply.
+  static const int MAX_CHANGES_SIZE = 16 << 20;
 
   // Client list.
   DBSession *next_;
@@ -0,0 +1,166 @@
+// Copyright 2025 Ringgaard Research ApS
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include "sling/base/flags.h"
+#include "sling/base/init.h"
+#include "sling/base/logging.h"
+#include "sling/db/async-dbclient.h"
+#include "sling/db/db.h"
+#include "sling/db/dbserver.h"
+#include "sling/file/file.h"
+#include "sling/net/http-server.h"
+#include "sling/string/strcat.h"
+
+DEFINE_int32(port, 17071, "Port for test database server");
+DEFINE_int32(records, 10000, "Number of records written in tests");
+
+using namespace sling;
+
+// Key and value for record.
+static string Key(int i) { return StrCat("key", i); }
+static string Value(int i) { return StrCat("value ", i, string(i % 50, '.')); }
+
+// Write records with synchronous batch put and read them back.
+static void TestSync(AsyncDBClient *client) {
+  std::vector<string> keys;
+  std::vector<string> values;
+  std::vector<DBRecord> records(FLAGS_records);
+  for (int i = 0; i < FLAGS_records; ++i) {
+    keys.push_back(Key(i));
+    values.push_back(Value(i));
+  }
+  for (int i = 0; i < FLAGS_records; ++i) {
+    records[i].key = keys[i];
+    records[i].value = values[i];
+  }
+  CHECK(client->Put(&records));
+  for (const DBRecord &record : records) CHECK_EQ(record.result, DBNEW);
+
+  std::vector<Slice> slices(keys.begin(), keys.end());
+  std::vector<string> results;
+  CHECK(client->Get(slices, &results));
+  for (int i = 0; i < FLAGS_records; ++i) CHECK_EQ(results[i], values[i]);
+}
+
+// Issue new asynchronous operations from completion callbacks. Each callback
+// looks up the next record until the end of the chain is reached.
+static void TestChained(AsyncDBClient *client) {
+  static const int kChains = 10;
+  std::atomic<int> completed(0);
+  std::vector<string> keys;
+  for (int i = 0; i < FLAGS_records; ++i) keys.push_back(Key(i));
+
+  std::function<void(int)> lookup = [&](int i) {
+    client->Get(keys[i], [&, i](const Status &st, const DBRecord &record) {
+      CHECK(st) << st;
+      CHECK(client->InCallback());
+      CHECK_EQ(record.value.str(), Value(i));
+      completed++;
+      if (i + kChains < FLAGS_records) lookup(i + kChains);
+    });
+  };
+  for (int i = 0; i < kChains; ++i) lookup(i);
+
+  // Operations issued by callbacks are pending before the callback returns,
+  // so waiting covers the whole chain.
+  CHECK(client->Wait());
+  CHECK_EQ(completed, FLAGS_records);
+  CHECK(!client->InCallback());
+}
+
+// Waiting for completion in a completion callback fails instead of
+// deadlocking the receiver thread.
+static void TestWaitInCallback(AsyncDBClient *client) {
+  std::atomic<int> checked(0);
+  client->Get(Key(0), [&](const Status &st, const DBRecord &record) {
+    CHECK(st) << st;
+    string value;
+    Status gst = client->Get(Key(1), &value);
+    CHECK_EQ(gst.code(), EDEADLK) << gst;
+
+    std::vector<DBRecord> records(1);
+    records[0].key = "key";
+    records[0].value = "value";
+    Status pst = client->Put(&records);
+    CHECK_EQ(pst.code(), EDEADLK) << pst;
+
+    Status wst = client->Wait();
+    CHECK_EQ(wst.code(), EDEADLK) << wst;
+
+    Status cst = client->Close();
+    CHECK_EQ(cst.code(), EDEADLK) << cst;
+    checked++;
+  });
+  CHECK(client->Wait());
+  CHECK_EQ(checked, 1);
+
+  // The client must still be usable.
+  string value;
+  CHECK(client->Get(Key(1), &value));
+  CHECK_EQ(value, Value(1));
+}
+
+int main(int argc, char *argv[]) {
+  InitProgram(&argc, &argv);
+
+  // Create test database.
+  string dir;
+  CHECK(File::CreateTempDir(&dir));
+  string dbdir = dir + "/test";
+  {
+    Database db;
+    CHECK(db.Create(dbdir, ""));
+    CHECK(db.Flush());
+  }
+
+  // Start database server.
+  DBService *dbservice = new DBService(dir);
+  CHECK(dbservice->MountDatabase("test", dbdir, false));
+  SocketServerOptions sockopts;
+  HTTPServer *httpd = new HTTPServer(sockopts, "127.0.0.1", FLAGS_port);
+  dbservice->Register(httpd);
+  CHECK(httpd->Start());
+
+  // Connect to database server.
+  AsyncDBClient client;
+  CHECK(client.Connect(StrCat("localhost:", FLAGS_port, "/test"), "test"));
+
+  TestSync(&client);
+  LOG(INFO) << "Synchronous operations passed";
+  TestChained(&client);
+  LOG(INFO) << "Chained callbacks passed";
+  TestWaitInCallback(&client);
+  LOG(INFO) << "Waiting in callback passed";
+
+  CHECK(client.Close());
+
+  // Shut down server.
+  httpd->Shutdown();
+  httpd->Wait();
+  delete httpd;
+  delete dbservice;
+
+  for (const string &filename : File::Match(dbdir + "/*")) {
+    CHECK(File::Delete(filename));
+  }
+  CHECK(File::Rmdir(dbdir));
+  CHECK(File::Rmdir(dir));
+
+  LOG(INFO) << "Async database client test passed";
+  return 0;
+}
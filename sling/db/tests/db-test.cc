@@ -0,0 +1,375 @@
+// Copyright 2025 Ringgaard Research ApS
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "sling/base/flags.h"
+#include "sling/base/init.h"
+#include "sling/base/logging.h"
+#include "sling/db/db.h"
+#include "sling/db/dbindex.h"
+#include "sling/file/file.h"
+#include "sling/string/strcat.h"
+#include "sling/util/iobuffer.h"
+#include "sling/util/thread.h"
+
+DEFINE_int32(records, 20000, "Number of records written in tests");
+DEFINE_int32(readers, 4, "Number of concurrent readers");
+
+using namespace sling;
+
+// Key and value for record with version.
+static string Key(int i) { return StrCat("key", i); }
+static string Value(int i, int version) {
+  return StrCat("value ", i, " version ", version, string(i % 100, '.'));
+}
+
+// Check that the value is a version of the value for record.
+static bool ValueFor(const Slice &value, int i) {
+  string prefix = StrCat("value ", i, " version ");
+  return value.size() > prefix.size() &&
+         memcmp(value.data(), prefix.data(), prefix.size()) == 0;
+}
+
+// Remove database directory.
+static void RemoveDatabase(const string &dbdir) {
+  for (const string &filename : File::Match(dbdir + "/*")) {
+    CHECK(File::Delete(filename));
+  }
+  CHECK(File::Rmdir(dbdir));
+}
+
+// Look up records without locking while a single writer adds and updates
+// records. The index is small, so it is expanded and migrated several times,
+// and the shards are small, so new shards are added while the readers are
+// running.
+static void TestConcurrentLookup(const string &dir) {
+  string dbdir = dir + "/concurrent";
+  Database db;
+  CHECK(db.Create(dbdir,
+                  "concurrent: true\n"
+                  "initial_index_capacity: 1024\n"
+                  "index_migration_step: 64\n"
+                  "data_shard_size: 256K\n"));
+  CHECK(db.concurrent());
+
+  std::mutex mu;
+  std::atomic<int> written(0);
+  std::atomic<bool> done(false);
+  std::atomic<int64> lookups(0);
+  std::atomic<int64> unsynced_lookups(0);
+
+  WorkerPool readers;
+  readers.Start(FLAGS_readers, [&](int index) {
+    std::mt19937 prng(index);
+    IOBuffer buffer;
+    Record record;
+    while (!done) {
+      int n = written;
+      if (n == 0) continue;
+      int i = std::uniform_int_distribution<int>(0, n - 1)(prng);
+      string key = Key(i);
+      bool unsynced = false;
+      if (db.Lookup(key, &record, &buffer, false, &unsynced)) {
+        CHECK(record.key == Slice(key));
+        CHECK(ValueFor(record.value, i)) << key;
+      } else {
+        // Records that have not been synced yet must be read by the writer.
+        CHECK(unsynced) << "Record not found: " << key;
+        std::lock_guard<std::mutex> lock(mu);
+        CHECK(db.Get(key, &record)) << key;
+        CHECK(ValueFor(record.value, i)) << key;
+        unsynced_lookups++;
+      }
+      lookups++;
+    }
+  });
+
+  // Add records and update earlier records.
+  Record record;
+  for (int i = 0; i < FLAGS_records; ++i) {
+    std::lock_guard<std::mutex> lock(mu);
+    string key = Key(i);
+    string value = Value(i, 0);
+    record.key = key;
+    record.value = value;
+    CHECK(db.Put(record) != -1);
+    if (i % 3 == 0) {
+      string key = Key(i / 2);
+      string value = Value(i / 2, i);
+      record.key = key;
+      record.value = value;
+      CHECK(db.Put(record) != -1);
+    }
+    if (i % 500 == 0) CHECK(db.Flush());
+    written = i + 1;
+  }
+  done = true;
+  readers.Join();
+
+  LOG(INFO) << "Concurrent lookups: " << lookups << " lookups, "
+            << unsynced_lookups << " unsynced, index capacity "
+            << db.index_capacity() << ", " << db.num_shards() << " shards";
+  CHECK_EQ(db.num_records(), FLAGS_records);
+  CHECK_GT(db.index_capacity(), 1024);
+  CHECK_GT(db.num_shards(), 1);
+
+  // Check that all records can be looked up after the database is reopened.
+  CHECK(db.Flush());
+  db.Close();
+  Database reopened;
+  CHECK(reopened.Open(dbdir));
+  IOBuffer buffer;
+  for (int i = 0; i < FLAGS_records; ++i) {
+    string key = Key(i);
+    bool unsynced = false;
+    CHECK(reopened.Lookup(key, &record, &buffer, false, &unsynced)) << key;
+    CHECK(ValueFor(record.value, i)) << key;
+  }
+  reopened.Close();
+  RemoveDatabase(dbdir);
+}
+
+// Return the format version of a database index file.
+static int IndexVersion(const string &dbdir) {
+  DatabaseIndex index;
+  CHECK(index.Open(dbdir + "/index"));
+  int version = index.version();
+  CHECK(index.Close());
+  return version;
+}
+
+// Set the format version in the header of a database index file.
+static void SetIndexVersion(const string &dbdir, uint32 version) {
+  File *file = File::OpenOrDie(dbdir + "/index", "r+");
+  CHECK(file->Seek(4));
+  CHECK(file->Write(&version, sizeof(uint32)));
+  CHECK(file->Close());
+}
+
+// Add records to database and check that all records can be read.
+static void AddRecords(Database *db, int begin, int end) {
+  Record record;
+  for (int i = begin; i < end; ++i) {
+    string key = Key(i);
+    string value = Value(i, 0);
+    record.key = key;
+    record.value = value;
+    CHECK(db->Put(record) != -1);
+  }
+  CHECK(db->Flush());
+  for (int i = 0; i < end; ++i) {
+    CHECK(db->Get(Key(i), &record)) << Key(i);
+    CHECK(ValueFor(record.value, i)) << Key(i);
+  }
+}
+
+// Open database with a version 1 index. The index is not upgraded when the
+// database is opened or updated, so older versions can still open it, but it
+// is replaced by a version 2 index when it is expanded.
+static void TestVersion1Index(const string &dir) {
+  string dbdir = dir + "/v1";
+  {
+    Database db;
+    CHECK(db.Create(dbdir, "initial_index_capacity: 1024\n"));
+    AddRecords(&db, 0, 100);
+  }
+  CHECK_EQ(IndexVersion(dbdir), 2);
+  SetIndexVersion(dbdir, 1);
+
+  {
+    Database db;
+    CHECK(db.Open(dbdir));
+    CHECK_EQ(IndexVersion(dbdir), 1);
+    AddRecords(&db, 100, 200);
+    CHECK_EQ(IndexVersion(dbdir), 1);
+  }
+  CHECK_EQ(IndexVersion(dbdir), 1);
+
+  {
+    Database db;
+    CHECK(db.Open(dbdir));
+    AddRecords(&db, 200, 1000);
+    CHECK_GT(db.index_capacity(), 1024);
+  }
+  CHECK_EQ(IndexVersion(dbdir), 2);
+
+  // Versions from the future cannot be opened.
+  SetIndexVersion(dbdir, 3);
+  Database db;
+  CHECK(!db.Open(dbdir));
+  db.Close();
+  RemoveDatabase(dbdir);
+}
+
+// Apply changes from iterator position to the end of the database to a copy
+// of the database contents, like a replica would.
+static void ApplyChanges(Database *db, uint64 *iterator,
+                         std::map<string, string> *contents) {
+  Record record;
+  while (db->Next(&record, iterator, true)) {
+    if (record.value.empty()) {
+      contents->erase(record.key.str());
+    } else {
+      (*contents)[record.key.str()] = record.value.str();
+    }
+  }
+}
+
+// Return the active records in the database.
+static std::map<string, string> Contents(Database *db) {
+  std::map<string, string> contents;
+  uint64 iterator = 0;
+  Record record;
+  while (db->Next(&record, &iterator)) {
+    contents[record.key.str()] = record.value.str();
+  }
+  return contents;
+}
+
+// Compact the sealed shards of a database online while records are updated
+// and deleted. Positions taken before the compaction are relocated to the new
+// layout, and replaying the changes from the relocated positions must produce
+// the same records as the database.
+static void TestCompaction(const string &dir) {
+  string dbdir = dir + "/compact";
+  Database db;
+  CHECK(db.Create(dbdir, "data_shard_size: 256K\n"));
+
+  // Add records, and update and delete some of them.
+  Record record;
+  for (int i = 0; i < FLAGS_records; ++i) {
+    string key = Key(i);
+    string value = Value(i, 0);
+    record.key = key;
+    record.value = value;
+    CHECK(db.Put(record) != -1);
+    if (i % 3 == 0) {
+      string key = Key(i / 2);
+      string value = Value(i / 2, i);
+      record.key = key;
+      record.value = value;
+      CHECK(db.Put(record) != -1);
+    }
+    if (i % 7 == 0) db.Delete(Key(i / 3));
+  }
+  CHECK(db.Flush());
+  CHECK_GT(db.num_shards(), 2);
+
+  // Take positions at the start, inside and at the end of the shards,
+  // together with the records a replica at each position has received.
+  struct Checkpoint {
+    uint64 position;
+    std::map<string, string> contents;
+  };
+  std::vector<Checkpoint> checkpoints;
+  std::map<string, string> contents;
+  uint64 iterator = 0;
+  int n = 0;
+  checkpoints.push_back({iterator, contents});
+  while (db.Next(&record, &iterator, true)) {
+    if (record.value.empty()) {
+      contents.erase(record.key.str());
+    } else {
+      contents[record.key.str()] = record.value.str();
+    }
+    if (++n % 997 == 0) checkpoints.push_back({iterator, contents});
+  }
+  checkpoints.push_back({iterator, contents});
+  CHECK(contents == Contents(&db));
+
+  // Compact database while records are being updated and deleted.
+  uint64 generation = db.generation();
+  uint64 layout = db.layout();
+  int sealed = db.num_shards() - 1;
+  uint64 size = db.size();
+  bool done = false;
+  int steps = 0;
+  while (!done) {
+    CHECK(db.Compact(500, &done));
+    int i = steps++ * 13;
+    string key = Key(i);
+    string value = Value(i, -1);
+    record.key = key;
+    record.value = value;
+    CHECK(db.Put(record) != -1);
+    db.Delete(Key(i + 1));
+  }
+  CHECK(db.Flush());
+  LOG(INFO) << "Compacted " << sealed << " shards in " << steps << " steps, "
+            << size << " -> " << db.size() << " bytes";
+
+  // Compaction keeps the generation and changes the layout.
+  CHECK_EQ(db.generation(), generation);
+  CHECK_EQ(db.layout(), layout + sealed);
+  CHECK_LT(db.size(), size);
+  std::map<string, string> expected = Contents(&db);
+
+  // Replay changes from the relocated positions.
+  int moved = 0;
+  for (const Checkpoint &checkpoint : checkpoints) {
+    uint64 position = checkpoint.position;
+    CHECK(db.Relocate(&position, layout));
+    if (position != checkpoint.position) moved++;
+    std::map<string, string> replica = checkpoint.contents;
+    ApplyChanges(&db, &position, &replica);
+    CHECK(replica == expected) << "position " << checkpoint.position;
+  }
+  CHECK_GT(moved, 0);
+
+  // Positions from unknown layouts cannot be relocated.
+  uint64 position = checkpoints[1].position;
+  CHECK(!db.Relocate(&position, db.layout() + 1));
+
+  // The layout and position maps are kept when the database is reopened.
+  db.Close();
+  Database reopened;
+  CHECK(reopened.Open(dbdir));
+  CHECK_EQ(reopened.generation(), generation);
+  CHECK_EQ(reopened.layout(), layout + sealed);
+  const Checkpoint &checkpoint = checkpoints[checkpoints.size() / 2];
+  position = checkpoint.position;
+  CHECK(reopened.Relocate(&position, layout));
+  std::map<string, string> replica = checkpoint.contents;
+  ApplyChanges(&reopened, &position, &replica);
+  CHECK(replica == expected);
+  CHECK(Contents(&reopened) == expected);
+
+  // Purging starts a new generation.
+  CHECK(reopened.Purge());
+  CHECK_NE(reopened.generation(), generation);
+  CHECK_EQ(reopened.layout(), 0);
+  CHECK(Contents(&reopened) == expected);
+  reopened.Close();
+  RemoveDatabase(dbdir);
+}
+
+int main(int argc, char *argv[]) {
+  InitProgram(&argc, &argv);
+
+  string dir;
+  CHECK(File::CreateTempDir(&dir));
+  TestConcurrentLookup(dir);
+  TestVersion1Index(dir);
+  TestCompaction(dir);
+  CHECK(File::Rmdir(dir));
+
+  LOG(INFO) << "Database test passed";
+  return 0;
+}
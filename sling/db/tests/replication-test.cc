@@ -0,0 +1,203 @@
+// Copyright 2025 Ringgaard Research ApS
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <unistd.h>
+#include <map>
+#include <string>
+
+#include "sling/base/flags.h"
+#include "sling/base/init.h"
+#include "sling/base/logging.h"
+#include "sling/db/db.h"
+#include "sling/db/dbclient.h"
+#include "sling/db/dbserver.h"
+#include "sling/file/file.h"
+#include "sling/net/http-server.h"
+#include "sling/string/strcat.h"
+
+DEFINE_int32(port, 17072, "Port for test database server");
+DEFINE_int32(records, 20000, "Number of records written in tests");
+DEFINE_int32(timeout, 60, "Seconds to wait for replica to catch up");
+
+using namespace sling;
+
+// Key and value for record with version.
+static string Key(int i) { return StrCat("key", i); }
+static string Value(int i, int version) {
+  return StrCat("value ", i, " version ", version, string(i % 100, '.'));
+}
+
+// Put record into database.
+static void Put(Database *db, const string &key, const string &value) {
+  Record record;
+  record.key = key;
+  record.value = value;
+  CHECK(db->Put(record) != -1);
+}
+
+// Return the active records in the database.
+static std::map<string, string> Contents(const string &dbdir) {
+  Database db;
+  CHECK(db.Open(dbdir));
+  std::map<string, string> contents;
+  uint64 iterator = 0;
+  Record record;
+  while (db.Next(&record, &iterator)) {
+    contents[record.key.str()] = record.value.str();
+  }
+  return contents;
+}
+
+// Remove database directory.
+static void RemoveDatabase(const string &dbdir) {
+  for (const string &filename : File::Match(dbdir + "/*")) {
+    CHECK(File::Delete(filename));
+  }
+  CHECK(File::Rmdir(dbdir));
+}
+
+int main(int argc, char *argv[]) {
+  InitProgram(&argc, &argv);
+
+  string dir;
+  CHECK(File::CreateTempDir(&dir));
+  string leaderdir = dir + "/leader";
+  string replicadir = dir + "/replica";
+  string leader = StrCat("localhost:", FLAGS_port, "/leader");
+
+  // Create leader database with several shards and with updated and deleted
+  // records.
+  uint64 generation;
+  {
+    Database db;
+    CHECK(db.Create(leaderdir, "data_shard_size: 256K\n"));
+    for (int i = 0; i < FLAGS_records; ++i) {
+      Put(&db, Key(i), Value(i, 0));
+      if (i % 3 == 0) Put(&db, Key(i / 2), Value(i / 2, i));
+      if (i % 7 == 0) db.Delete(Key(i / 3));
+    }
+    CHECK(db.Flush());
+    CHECK_GT(db.num_shards(), 2);
+    generation = db.generation();
+  }
+
+  // Create replica that has received the changes up to a position in the
+  // middle of the first shard of the leader. A record only in the replica
+  // checks that the replica is not resynchronized from the start, since
+  // resynchronization clears the replica.
+  uint64 position = 0;
+  {
+    Database db;
+    CHECK(db.Open(leaderdir));
+    Database replica;
+    CHECK(replica.Create(replicadir, "can_clear: true\n"));
+    Put(&replica, "marker", "replica only");
+    Record record;
+    for (int n = 0; n < FLAGS_records / 10; ++n) {
+      CHECK(db.Next(&record, &position, true));
+      if (record.value.empty()) {
+        replica.Delete(record.key);
+      } else {
+        CHECK(replica.Put(record) != -1);
+      }
+    }
+    CHECK(replica.Flush());
+    CHECK_EQ(position >> 48, 0);
+    CHECK(File::WriteContents(replicadir + "/replica",
+                              StrCat(leader, "\n", position, "\n",
+                                     generation, "\n0\n")));
+  }
+
+  // Compact the leader, which moves the records in the first shard.
+  uint64 layout;
+  {
+    Database db;
+    CHECK(db.Open(leaderdir));
+    bool done = false;
+    while (!done) CHECK(db.Compact(1000, &done));
+    CHECK(db.Flush());
+    CHECK_EQ(db.generation(), generation);
+    layout = db.layout();
+    CHECK_GT(layout, 0);
+    uint64 relocated = position;
+    CHECK(db.Relocate(&relocated, 0));
+    CHECK_LT(relocated, position);
+    LOG(INFO) << "Compacted leader, layout " << layout << ", replica position "
+              << position << " -> " << relocated;
+  }
+
+  // Start server with leader and replica. The replica resumes replication
+  // from the saved position in the old layout.
+  DBService *dbservice = new DBService(dir);
+  CHECK(dbservice->MountDatabase("leader", leaderdir, false));
+  SocketServerOptions sockopts;
+  HTTPServer *httpd = new HTTPServer(sockopts, "127.0.0.1", FLAGS_port);
+  dbservice->Register(httpd);
+  CHECK(httpd->Start());
+  CHECK(dbservice->MountDatabase("replica", replicadir, false));
+
+  // Update leader while it is being replicated. The last record marks the end
+  // of the changes.
+  DBClient client;
+  CHECK(client.Connect(leader, "test"));
+  for (int i = 0; i < FLAGS_records; i += 11) {
+    string key = Key(i);
+    string value = Value(i, -1);
+    DBRecord record(key, value);
+    CHECK(client.Put(&record));
+    client.Delete(Key(i + 1));
+  }
+  DBRecord end("end", "end");
+  CHECK(client.Put(&end));
+  CHECK(client.Close());
+
+  // Wait for replica to receive all changes.
+  DBClient replica;
+  string name = StrCat("localhost:", FLAGS_port, "/replica");
+  CHECK(replica.Connect(name, "test"));
+  DBRecord record;
+  for (int wait = 0; wait < FLAGS_timeout * 10; ++wait) {
+    CHECK(replica.Get("end", &record));
+    if (!record.value.empty()) break;
+    usleep(100000);
+  }
+  CHECK(!record.value.empty()) << "Replica did not catch up";
+  CHECK(replica.Close());
+
+  // Shut down server. This stops replication and saves the replica state.
+  httpd->Shutdown();
+  httpd->Wait();
+  delete httpd;
+  delete dbservice;
+
+  // The replica has the same records as the leader and was never cleared.
+  std::map<string, string> expected = Contents(leaderdir);
+  std::map<string, string> actual = Contents(replicadir);
+  CHECK_EQ(actual["marker"], "replica only");
+  actual.erase("marker");
+  CHECK(actual == expected);
+
+  // The replica state has the current layout of the leader.
+  string state;
+  CHECK(File::ReadContents(replicadir + "/replica", &state));
+  CHECK(state.find(StrCat("\n", generation, "\n", layout, "\n")) != -1)
+      << state;
+
+  RemoveDatabase(leaderdir);
+  RemoveDatabase(replicadir);
+  CHECK(File::Rmdir(dir));
+
+  LOG(INFO) << "Replication test passed";
+  return 0;
+}
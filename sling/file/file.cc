@@ -335,6 +335,10 @@ void *File::MapMemory(uint64 pos, size_t size, bool writable, bool preload) {
   return nullptr;
 }
 
+void *File::MapPrivateMemory(uint64 pos, size_t size, bool preload) {
+  return nullptr;
+}
+
 Status File::FlushMappedMemory(void *data, size_t size) {
   if (default_file_system == nullptr) return NoFileSystem("mmunmap");
   return default_file_system->FlushMappedMemory(data, size);
@@ -345,6 +349,11 @@ Status File::FreeMappedMemory(void *data, size_t size) {
   return default_file_system->FreeMappedMemory(data, size);
 }
 
+Status File::UnprotectMappedMemory(void *data, size_t size) {
+  if (default_file_system == nullptr) return NoFileSystem("mprotect");
+  return default_file_system->UnprotectMappedMemory(data, size);
+}
+
 Status FileSystem::FlushMappedMemory(void *data, size_t size) {
   return Status(ENOSYS, "Memory-mapped files not supported");
 }
@@ -353,6 +362,10 @@ Status FileSystem::FreeMappedMemory(void *data, size_t size) {
   return Status(ENOSYS, "Memory-mapped files not supported");
 }
 
+Status FileSystem::UnprotectMappedMemory(void *data, size_t size) {
+  return Status(ENOSYS, "Memory-mapped files not supported");
+}
+
 REGISTER_INITIALIZER(filesystem, {
   File::Init();
 });
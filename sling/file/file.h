@@ -77,6 +77,12 @@ class File {
                           bool writable = false,
                           bool preload = true);
 
+  // Map file region into memory as a private copy-on-write mapping. The pages
+  // are shared with other processes mapping the same file until they are
+  // modified. Return null on error or if not supported.
+  virtual void *MapPrivateMemory(uint64 pos, size_t size,
+                                 bool preload = false);
+
   // Resize file.
   virtual Status Resize(uint64 size) = 0;
 
@@ -176,6 +182,10 @@ class File {
 
   // Free memory mapping.
   static Status FreeMappedMemory(void *data, size_t size);
+
+  // Make read-only private memory mapping writable. Modified pages are copied
+  // on write.
+  static Status UnprotectMappedMemory(void *data, size_t size);
 };
 
 // Abstract file system interface.
@@ -228,6 +238,9 @@ class FileSystem : public Singleton<FileSystem> {
 
   // Release mapped memory.
   virtual Status FreeMappedMemory(void *data, size_t size);
+
+  // Make private mapped memory writable.
+  virtual Status UnprotectMappedMemory(void *data, size_t size);
 };
 
 }  // namespace sling
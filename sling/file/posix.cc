@@ -134,6 +134,13 @@ class PosixFile : public File {
     return mapping == MAP_FAILED ? nullptr : mapping;
   }
 
+  void *MapPrivateMemory(uint64 pos, size_t size, bool preload) override {
+    void *mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                         MAP_PRIVATE | (preload ? MAP_POPULATE : 0),
+                         fd_, pos);
+    return mapping == MAP_FAILED ? nullptr : mapping;
+  }
+
   Status Resize(uint64 size) override {
     if (ftruncate(fd_, size) == -1) return IOError(filename_, errno);
     return Status::OK;
@@ -311,6 +318,13 @@ class PosixFileSystem : public FileSystem {
     if (munmap(data, size) != 0) return IOError("munmap", errno);
     return Status::OK;
   }
+
+  Status UnprotectMappedMemory(void *data, size_t size) override {
+    if (mprotect(data, size, PROT_READ | PROT_WRITE) != 0) {
+      return IOError("mprotect", errno);
+    }
+    return Status::OK;
+  }
 };
 
 File *NewFileFromDescriptor(const string &name, int fd) {
@@ -15,11 +15,16 @@
 #include "sling/file/recordio.h"
 
 #include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
 #include <vector>
 
 #include "sling/base/logging.h"
 #include "sling/base/types.h"
 #include "sling/util/fingerprint.h"
+#include "sling/util/thread.h"
 #include "sling/util/snappy.h"
 #include "sling/util/varint.h"
 
@@ -165,6 +170,159 @@ size_t RecordFile::WriteHeader(const Header &header, char *data) {
   return p - data;
 }
 
+// Background reader that reads blocks from a file sequentially in a separate
+// I/O thread, so reading from disk overlaps with decoding the records.
+class RecordReader::Prefetcher {
+ public:
+  Prefetcher(File *file, uint64 start, uint64 end, size_t block_size,
+             int depth, PrefetchStats *stats)
+      : file_(file), position_(start), end_(end), block_size_(block_size),
+        depth_(depth), stats_(stats), thread_([this]() { Run(); }) {
+    thread_.SetJoinable(true);
+    thread_.Start();
+  }
+
+  ~Prefetcher() {
+    // Stop I/O thread.
+    {
+      std::unique_lock<std::mutex> lock(mu_);
+      stop_ = true;
+      space_.notify_all();
+    }
+    thread_.Join();
+
+    // Free blocks.
+    delete current_;
+    for (IOBuffer *b : ready_) delete b;
+    for (IOBuffer *b : free_) delete b;
+  }
+
+  // Copy prefetched data into buffer. Only returns fewer bytes than requested
+  // at the end of the file.
+  Status Read(char *data, uint64 size, uint64 *read) {
+    *read = 0;
+    while (size > 0) {
+      // Get next block from read-ahead queue.
+      if (current_ == nullptr) {
+        std::unique_lock<std::mutex> lock(mu_);
+        if (ready_.empty() && !eof_) {
+          auto start = std::chrono::steady_clock::now();
+          while (ready_.empty() && !eof_) ready_signal_.wait(lock);
+          auto end = std::chrono::steady_clock::now();
+          stats_->stalls++;
+          stats_->stall_time +=
+              std::chrono::duration_cast<std::chrono::microseconds>(
+                  end - start).count();
+        }
+        if (ready_.empty()) return status_;
+        stats_->queued += ready_.size();
+        if (ready_.size() > stats_->max_queued) {
+          stats_->max_queued = ready_.size();
+        }
+        current_ = ready_.front();
+        ready_.pop_front();
+        space_.notify_one();
+      }
+
+      // Copy data from current block.
+      uint64 n = std::min<uint64>(size, current_->available());
+      memcpy(data, current_->Consume(n), n);
+      data += n;
+      size -= n;
+      *read += n;
+
+      // Recycle block when it has been consumed.
+      if (current_->empty()) {
+        std::unique_lock<std::mutex> lock(mu_);
+        free_.push_back(current_);
+        current_ = nullptr;
+      }
+    }
+    return Status::OK;
+  }
+
+ private:
+  // Read blocks from file until the end of the file or until stopped.
+  void Run() {
+    for (;;) {
+      // Wait for room in the read-ahead queue.
+      IOBuffer *block;
+      {
+        std::unique_lock<std::mutex> lock(mu_);
+        while (!stop_ && ready_.size() >= depth_) space_.wait(lock);
+        if (stop_) return;
+        if (free_.empty()) {
+          block = new IOBuffer();
+          block->Reset(block_size_);
+        } else {
+          block = free_.back();
+          free_.pop_back();
+          block->Clear();
+        }
+      }
+
+      // Read next block from file.
+      uint64 size = std::min<uint64>(block_size_, end_ - position_);
+      uint64 read = 0;
+      Status s;
+      if (size > 0) s = file_->PRead(position_, block->end(), size, &read);
+      block->Append(read);
+      position_ += read;
+
+      // Add block to queue.
+      std::unique_lock<std::mutex> lock(mu_);
+      if (read > 0) {
+        ready_.push_back(block);
+        stats_->blocks++;
+      } else {
+        free_.push_back(block);
+      }
+      if (!s.ok() || read == 0) {
+        status_ = s;
+        eof_ = true;
+      }
+      ready_signal_.notify_one();
+      if (eof_) return;
+    }
+  }
+
+  // File and range of file to read.
+  File *file_;
+  uint64 position_;
+  uint64 end_;
+
+  // Block size and maximum number of blocks in read-ahead queue.
+  size_t block_size_;
+  size_t depth_;
+
+  // Read-ahead queue with blocks that have been read from file.
+  std::deque<IOBuffer *> ready_;
+
+  // Free blocks for reuse.
+  std::vector<IOBuffer *> free_;
+
+  // Current block being consumed by reader.
+  IOBuffer *current_ = nullptr;
+
+  // End of file has been reached or a read error has occurred.
+  bool eof_ = false;
+  Status status_;
+
+  // Flag to stop I/O thread.
+  bool stop_ = false;
+
+  // Prefetching statistics.
+  PrefetchStats *stats_;
+
+  // Mutex and signals for read-ahead queue.
+  std::mutex mu_;
+  std::condition_variable ready_signal_;
+  std::condition_variable space_;
+
+  // I/O thread.
+  ClosureThread thread_;
+};
+
 RecordReader::RecordReader(File *file,
                            const RecordFileOptions &options,
                            bool owned)
@@ -196,6 +354,23 @@ RecordReader::RecordReader(File *file,
   } else {
     CHECK(file_->GetSize(&size_));
   }
+
+  // Map the whole file, including the index, into memory in mmap mode.
+  if (options.mmap) {
+    uint64 file_size;
+    CHECK(file_->GetSize(&file_size));
+    void *mapping = file_->MapMemory(0, file_size, false, false);
+    if (mapping != nullptr) {
+      mapping_ = static_cast<const char *>(mapping);
+      mapped_size_ = file_size;
+      input_.Reset(0);
+    } else {
+      VLOG(1) << "Unable to map " << file_->filename() << " into memory";
+    }
+  }
+
+  // Prefetching is started on demand when filling the input buffer.
+  if (mapping_ == nullptr) prefetch_ = options.prefetch;
 }
 
 RecordReader::RecordReader(const string &filename,
@@ -213,6 +388,16 @@ RecordReader::~RecordReader() {
 }
 
 Status RecordReader::Close() {
+  delete prefetcher_;
+  prefetcher_ = nullptr;
+  prefetch_ = 0;
+  if (mapping_ != nullptr) {
+    Status s = File::FreeMappedMemory(const_cast<char *>(mapping_),
+                                      mapped_size_);
+    mapping_ = nullptr;
+    mapped_size_ = 0;
+    if (!s.ok()) return s;
+  }
   if (owned_ && file_) {
     Status s = file_->Close();
     file_ = nullptr;
@@ -237,12 +422,30 @@ Status RecordReader::Fill(uint64 needed) {
 
   // Fill buffer from file.
   uint64 read;
-  Status s = file_->Read(input_.end(), requested, &read);
+  Status s = ReadInput(input_.end(), requested, &read);
   if (!s.ok()) return s;
   input_.Append(read);
   return Status::OK;
 }
 
+Status RecordReader::ReadInput(char *data, uint64 size, uint64 *read) {
+  if (prefetch_ == 0) return file_->Read(data, size, read);
+
+  // Start prefetching from the end of the data in the input buffer. The
+  // prefetcher reads the whole file including the index, so it can also be
+  // used for reading index pages.
+  if (prefetcher_ == nullptr) {
+    uint64 file_size;
+    Status s = file_->GetSize(&file_size);
+    if (!s.ok()) return s;
+    uint64 start = position_ + input_.available();
+    prefetcher_ = new Prefetcher(file_, start, file_size,
+                                 input_.capacity(), prefetch_,
+                                 &prefetch_stats_);
+  }
+  return prefetcher_->Read(data, size, read);
+}
+
 Status RecordReader::Ensure(uint64 size) {
   if (input_.available() < size) {
     // Expand input buffer if needed.
@@ -263,10 +466,10 @@ Status RecordReader::Ensure(uint64 size) {
   return Status::OK;
 }
 
-Status RecordReader::Validate(const Header &hdr) const {
+Status RecordReader::Validate(const Header &hdr, uint64 pos) const {
   if (hdr.record_type == DATA_RECORD || hdr.record_type == VDATA_RECORD) {
     uint64 size = hdr.record_size;
-    if (size + position_ > size_) {
+    if (size + pos > size_) {
       return Status(1, "Invalid record");
     }
     int chunk_size = info_.chunk_size;
@@ -276,7 +479,7 @@ Status RecordReader::Validate(const Header &hdr) const {
         return Status(1, "Invalid record size");
       }
       // Record cannot cross chunk boundary.
-      if (position_ / chunk_size != (position_ + size - 1) / chunk_size) {
+      if (pos / chunk_size != (pos + size - 1) / chunk_size) {
         return Status(1, "Invalid record alignment");
       }
     }
@@ -285,6 +488,9 @@ Status RecordReader::Validate(const Header &hdr) const {
 }
 
 Status RecordReader::Read(Record *record) {
+  if (mapping_ != nullptr) {
+    return ReadMapped(position_, record, &buffer_, false, &position_);
+  }
   for (;;) {
     // Fill input buffer if it is nearly empty.
     if (input_.available() < MAX_HEADER_LEN) {
@@ -297,7 +503,7 @@ Status RecordReader::Read(Record *record) {
     ssize_t hdrsize = ReadHeader(input_.begin(), &hdr);
     if (hdrsize < 0) return Status(1, "Corrupt record header");
     if (validate_) {
-      Status s = Validate(hdr);
+      Status s = Validate(hdr, position_);
       if (!s.ok()) return s;
     }
 
@@ -350,6 +556,9 @@ Status RecordReader::Read(Record *record) {
 }
 
 Status RecordReader::ReadKey(Record *record) {
+  if (mapping_ != nullptr) {
+    return ReadMapped(position_, record, &buffer_, true, &position_);
+  }
   for (;;) {
     // Fill input buffer if it is nearly empty.
     if (input_.available() < MAX_HEADER_LEN) {
@@ -362,7 +571,7 @@ Status RecordReader::ReadKey(Record *record) {
     ssize_t hdrsize = ReadHeader(input_.begin(), &hdr);
     if (hdrsize < 0) return Status(1, "Corrupt record header");
     if (validate_) {
-      Status s = Validate(hdr);
+      Status s = Validate(hdr, position_);
       if (!s.ok()) return s;
     }
 
@@ -431,9 +640,189 @@ Status RecordReader::ReadKey(Record *record) {
   }
 }
 
+Status RecordReader::ReadAt(uint64 pos, Record *record, IOBuffer *buffer,
+                            bool novalue) const {
+  if (mapping_ != nullptr) {
+    return ReadMapped(pos, record, buffer, novalue, nullptr);
+  }
+  for (;;) {
+    // Read record header.
+    char header[MAX_HEADER_LEN];
+    uint64 bytes;
+    Status s = file_->PRead(pos, header, MAX_HEADER_LEN, &bytes);
+    if (!s.ok()) return s;
+    if (bytes < MAX_HEADER_LEN) {
+      memset(header + bytes, 0, MAX_HEADER_LEN - bytes);
+    }
+    Header hdr;
+    ssize_t hdrsize = ReadHeader(header, &hdr);
+    if (hdrsize < 0 || hdrsize > bytes) {
+      return Status(1, "Corrupt record header");
+    }
+
+    // Skip filler records.
+    if (hdr.record_type == FILLER_RECORD) {
+      pos += hdr.record_size;
+      continue;
+    }
+    record->position = pos;
+    record->type = hdr.record_type;
+    record->version = hdr.version;
+
+    // Determine how much of the record needs to be read. Without the value,
+    // only the varint with the decompressed length is needed for compressed
+    // records.
+    size_t value_size = hdr.record_size - hdr.key_size;
+    size_t size = hdr.record_size;
+    if (novalue) {
+      size = hdr.key_size;
+      if (info_.compression == SNAPPY) {
+        size += std::min<size_t>(value_size, Varint::kMax32);
+      }
+    }
+
+    // Read record data into buffer.
+    buffer->Clear();
+    buffer->Ensure(size);
+    s = file_->PRead(pos + hdrsize, buffer->end(), size, &bytes);
+    if (!s.ok()) return s;
+    if (bytes != size) return Status(1, "Record truncated");
+    buffer->Append(size);
+
+    // Get uncompressed value size.
+    size_t vsize;
+    const char *value = buffer->begin() + hdr.key_size;
+    if (info_.compression == SNAPPY) {
+      if (value_size == 0) {
+        vsize = 0;
+      } else if (!snappy::GetUncompressedLength(value, size - hdr.key_size,
+                                                &vsize)) {
+        return Status(EINVAL, "Corrupt compressed record");
+      }
+    } else if (info_.compression == UNCOMPRESSED) {
+      vsize = value_size;
+    } else {
+      return Status(1, "Unknown compression type");
+    }
+
+    if (novalue) {
+      // Set value to the real length but with an invalid pointer that will
+      // crash if it is accessed.
+      char *bad = reinterpret_cast<char *>(0xDECADE0FABBABABE);
+      record->value = Slice(vsize > 0 ? bad : nullptr, vsize);
+    } else if (info_.compression == SNAPPY && value_size > 0) {
+      // Decompress record value after the raw record in the buffer.
+      buffer->Ensure(vsize);
+      value = buffer->begin() + hdr.key_size;
+      char *uncompressed = buffer->Append(vsize);
+      if (!snappy::RawUncompress(value, value_size, uncompressed)) {
+        return Status(EINVAL, "Uncompress failed");
+      }
+      record->value = Slice(uncompressed, vsize);
+    } else {
+      record->value = Slice(value, vsize);
+    }
+
+    // Get record key.
+    if (hdr.key_size > 0) {
+      record->key = Slice(buffer->begin(), hdr.key_size);
+    } else {
+      record->key = Slice();
+    }
+
+    return Status::OK;
+  }
+}
+
+Status RecordReader::ReadMapped(uint64 pos, Record *record, IOBuffer *buffer,
+                                bool novalue, uint64 *next) const {
+  for (;;) {
+    // Read record header. The header is copied if it is at the very end of
+    // the file to avoid reading past the end of the mapping.
+    if (pos >= mapped_size_) return Status(1, "Record truncated");
+    uint64 left = mapped_size_ - pos;
+    const char *data = mapping_ + pos;
+    char header[MAX_HEADER_LEN];
+    if (left < MAX_HEADER_LEN) {
+      memcpy(header, data, left);
+      memset(header + left, 0, MAX_HEADER_LEN - left);
+      data = header;
+    }
+    Header hdr;
+    ssize_t hdrsize = ReadHeader(data, &hdr);
+    if (hdrsize < 0 || hdrsize > left) {
+      return Status(1, "Corrupt record header");
+    }
+    if (validate_) {
+      Status s = Validate(hdr, pos);
+      if (!s.ok()) return s;
+    }
+
+    // Skip filler records.
+    if (hdr.record_type == FILLER_RECORD) {
+      pos += hdr.record_size;
+      continue;
+    }
+    if (hdr.record_size > left - hdrsize || hdr.key_size > hdr.record_size) {
+      return Status(1, "Record truncated");
+    }
+    record->position = pos;
+    record->type = hdr.record_type;
+    record->version = hdr.version;
+
+    // Get record key directly from the mapping.
+    const char *key = mapping_ + pos + hdrsize;
+    if (hdr.key_size > 0) {
+      record->key = Slice(key, hdr.key_size);
+    } else {
+      record->key = Slice();
+    }
+
+    // Get record value. Only compressed values need to be copied.
+    const char *value = key + hdr.key_size;
+    size_t value_size = hdr.record_size - hdr.key_size;
+    size_t vsize = value_size;
+    if (info_.compression == SNAPPY) {
+      if (value_size > 0 &&
+          !snappy::GetUncompressedLength(value, value_size, &vsize)) {
+        return Status(EINVAL, "Corrupt compressed record");
+      }
+    } else if (info_.compression != UNCOMPRESSED) {
+      return Status(1, "Unknown compression type");
+    }
+
+    if (novalue) {
+      // Set value to the real length but with an invalid pointer that will
+      // crash if it is accessed.
+      char *bad = reinterpret_cast<char *>(0xDECADE0FABBABABE);
+      record->value = Slice(vsize > 0 ? bad : nullptr, vsize);
+    } else if (info_.compression == SNAPPY && value_size > 0) {
+      // Decompress record value into buffer.
+      buffer->Clear();
+      buffer->Ensure(vsize);
+      char *uncompressed = buffer->Append(vsize);
+      if (!snappy::RawUncompress(value, value_size, uncompressed)) {
+        return Status(EINVAL, "Uncompress failed");
+      }
+      record->value = Slice(uncompressed, vsize);
+    } else {
+      record->value = Slice(value, value_size);
+    }
+
+    if (next != nullptr) *next = pos + hdrsize + hdr.record_size;
+    return Status::OK;
+  }
+}
+
 Status RecordReader::Seek(uint64 pos) {
-  // Check if we can skip to position in input buffer.
+  // Memory-mapped files only need to update the position.
   if (pos == 0) pos = info_.hdrlen;
+  if (mapping_ != nullptr) {
+    position_ = pos;
+    return Status::OK;
+  }
+
+  // Check if we can skip to position in input buffer.
   if (pos == position_) return Status::OK;
   int64 offset = pos - position_;
   position_ = pos;
@@ -442,9 +831,14 @@ Status RecordReader::Seek(uint64 pos) {
     return Status::OK;
   }
 
-  // Clear input buffer and seek to new position.
+  // Clear input buffer and seek to new position. The prefetcher is restarted
+  // from the new position on the next read.
   input_.Clear();
   readahead_ = false;
+  if (prefetcher_ != nullptr) {
+    delete prefetcher_;
+    prefetcher_ = nullptr;
+  }
   return file_->Seek(pos);
 }
 
@@ -651,6 +1045,8 @@ RecordWriter::RecordWriter(const string &filename)
 
 RecordWriter::RecordWriter(RecordReader *reader,
                            const RecordFileOptions &options) {
+  CHECK(!reader->mapped()) << "Memory-mapped record files are read-only";
+  CHECK(reader->prefetch_ == 0) << "Prefetching record files are read-only";
   reader_ = reader;
   output_.Reset(options.buffer_size);
   file_ = reader->file();
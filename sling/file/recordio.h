@@ -148,11 +148,30 @@ struct RecordFileOptions {
 
   // Validate record headers on read.
   bool validate = false;
+
+  // Memory-map record file for reading. Records in uncompressed record files
+  // are then returned without copying, and only compressed record values are
+  // decompressed into a buffer. Falls back to buffered reading if the file
+  // cannot be mapped.
+  bool mmap = false;
+
+  // Number of input buffers read ahead by a background I/O thread when
+  // reading sequentially. Zero disables prefetching.
+  int prefetch = 0;
 };
 
 // Reader for reading records from a record file.
 class RecordReader : public RecordFile {
  public:
+  // Statistics for prefetching.
+  struct PrefetchStats {
+    uint64 blocks = 0;      // number of blocks read by the I/O thread
+    uint64 queued = 0;      // sum of read-ahead queue depth when reading block
+    uint64 max_queued = 0;  // maximum read-ahead queue depth
+    uint64 stalls = 0;      // number of reads that had to wait for I/O
+    uint64 stall_time = 0;  // total time waiting for I/O in microseconds
+  };
+
   // Open record file for reading.
   RecordReader(File *file, const RecordFileOptions &options, bool owned = true);
   RecordReader(const string &filename, const RecordFileOptions &options);
@@ -172,6 +191,14 @@ class RecordReader : public RecordFile {
   // Read key from next record and skip value.
   Status ReadKey(Record *record);
 
+  // Read record at position using positional reads. The record data is
+  // stored in the buffer. This does not change the state of the reader, so
+  // it can be called concurrently from multiple threads with separate
+  // buffers. If novalue is set, only the key is read and the value is set to
+  // an invalid pointer with the size of the (uncompressed) value.
+  Status ReadAt(uint64 pos, Record *record, IOBuffer *buffer,
+                bool novalue = false) const;
+
   // Return current position in record file.
   uint64 Tell() { return position_; }
 
@@ -196,15 +223,31 @@ class RecordReader : public RecordFile {
   // File size.
   uint64 size() const { return size_; }
 
+  // Check if record file is memory-mapped.
+  bool mapped() const { return mapping_ != nullptr; }
+
+  // Prefetching statistics.
+  const PrefetchStats &prefetch_stats() const { return prefetch_stats_; }
+
  private:
+  class Prefetcher;
+
+  // Read data from file or prefetcher into the input buffer.
+  Status ReadInput(char *data, uint64 size, uint64 *read);
+
+  // Read record at position from memory-mapped file. If next is not null, it
+  // is set to the position of the following record.
+  Status ReadMapped(uint64 pos, Record *record, IOBuffer *buffer,
+                    bool novalue, uint64 *next) const;
+
   // Fill input buffer.
   Status Fill(uint64 needed);
 
   // Ensure that at least 'size' bytes are available in input buffer.
   Status Ensure(uint64 size);
 
-  // Validate record header.
-  Status Validate(const Header &hdr) const;
+  // Validate header for record at position.
+  Status Validate(const Header &hdr, uint64 pos) const;
 
   // Input file.
   File *file_;
@@ -234,6 +277,16 @@ class RecordReader : public RecordFile {
   // Buffer for decompressed record data.
   IOBuffer buffer_;
 
+  // Memory mapping of the whole record file in mmap mode.
+  const char *mapping_ = nullptr;
+  uint64 mapped_size_ = 0;
+
+  // Number of blocks to read ahead and the background prefetcher. The
+  // prefetcher is started on demand and restarted after seeking.
+  int prefetch_ = 0;
+  Prefetcher *prefetcher_ = nullptr;
+  PrefetchStats prefetch_stats_;
+
   friend class RecordWriter;
 };
 
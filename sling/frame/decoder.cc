@@ -115,6 +115,14 @@ Handle Decoder::DecodeObject() {
         case WIRE_QSTRING:
           handle = DecodeQString();
           break;
+        case WIRE_SEGMENT: {
+          // Start new segment with fresh references.
+          uint64 size;
+          if (!input_->ReadVarint64(&size)) return Handle::error();
+          references_.reset();
+          handle = DecodeObject();
+          break;
+        }
         default:
           handle = Handle::error();
       }
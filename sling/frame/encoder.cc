@@ -20,6 +20,7 @@
 #include "sling/frame/object.h"
 #include "sling/frame/store.h"
 #include "sling/frame/wire.h"
+#include "sling/stream/memory.h"
 #include "sling/stream/output.h"
 
 namespace sling {
@@ -28,16 +29,30 @@ Encoder::Encoder(const Store *store, Output *output, bool marker)
     : store_(store), output_(output),
       global_(store != nullptr && store->globals() == nullptr) {
   // Insert special values in reference mapping.
+  ResetReferences();
+
+  // Output binary encoding mark.
+  if (marker) output_->WriteChar(WIRE_BINARY_MARKER);
+}
+
+void Encoder::ResetReferences() {
+  references_.clear();
   references_[Handle::id()] = Reference(WIRE_ID);
   references_[Handle::isa()] = Reference(WIRE_ISA);
   references_[Handle::is()] = Reference(WIRE_IS);
   references_[Handle::name()] = Reference(WIRE_NAME);
-
-  // Output binary encoding mark.
-  if (marker) output_->WriteChar(WIRE_BINARY_MARKER);
+  next_index_ = 0;
 }
 
 void Encoder::EncodeAll() {
+  // In segmented mode, the frames are encoded into a segment buffer which is
+  // written to the output when it is full.
+  Output *output = output_;
+  string segment;
+  StringOutputStream stream(&segment);
+  Output buffer(&stream);
+  if (segment_size_ > 0) output_ = &buffer;
+
   const MapDatum *map = store_->GetMap(store_->symbols());
   for (Handle *bucket = map->begin(); bucket < map->end(); ++bucket) {
     Handle h = *bucket;
@@ -45,10 +60,29 @@ void Encoder::EncodeAll() {
       const SymbolDatum *symbol = store_->GetSymbol(h);
       if (symbol->bound() && !store_->IsProxy(symbol->value)) {
         EncodeObject(symbol->value);
+        if (segment_size_ > 0) {
+          buffer.Flush();
+          if (segment.size() >= segment_size_) WriteSegment(output, &segment);
+        }
       }
       h = symbol->next;
     }
   }
+
+  // Write last segment.
+  if (segment_size_ > 0) {
+    buffer.Flush();
+    if (!segment.empty()) WriteSegment(output, &segment);
+    output_ = output;
+  }
+}
+
+void Encoder::WriteSegment(Output *output, string *segment) {
+  output->WriteVarint64(WIRE_SPECIAL | (WIRE_SEGMENT << 3));
+  output->WriteVarint64(segment->size());
+  output->Write(segment->data(), segment->size());
+  segment->clear();
+  ResetReferences();
 }
 
 void Encoder::EncodeObject(Handle handle) {
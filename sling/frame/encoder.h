@@ -34,12 +34,18 @@ class Encoder {
   void Encode(const Object &object) { EncodeObject(object.handle()); }
   void Encode(Handle handle) { EncodeObject(handle); }
 
-  // Encodes all frames in the symbol table of the store.
+  // Encodes all frames in the symbol table of the store. If a segment size
+  // is set, the output is split into independent segments. Each segment has
+  // its own object references, so objects without ids that are shared by
+  // frames in different segments, e.g. anonymous frames, are encoded in each
+  // of these segments and are decoded into separate objects. Frames with ids
+  // are encoded as symbol links, so these keep their identity.
   void EncodeAll();
 
   // Configuration parameters.
   void set_shallow(bool shallow) { shallow_ = shallow; }
   void set_global(bool global) { global_ = global; }
+  void set_segment_size(int size) { segment_size_ = size; }
 
  private:
   // Object encoding states.
@@ -62,6 +68,12 @@ class Encoder {
     uint32 index: 30;  // reference number
   };
 
+  // Clears reference mapping, leaving only the pre-defined values.
+  void ResetReferences();
+
+  // Writes segment to output and starts a new segment.
+  void WriteSegment(Output *output, string *segment);
+
   // Encodes object for handle.
   void EncodeObject(Handle handle);
 
@@ -98,6 +110,10 @@ class Encoder {
   // Output frames in the global store by value.
   bool global_;
 
+  // Approximate segment size in bytes for segmented encoding of all frames.
+  // Segmentation is disabled if this is zero.
+  int segment_size_ = 0;
+
   DISALLOW_IMPLICIT_CONSTRUCTORS(Encoder);
 };
 
@@ -0,0 +1,468 @@
+// Copyright 2025 Ringgaard Research ApS
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "sling/frame/json-reader.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#include <string.h>
+
+#include "sling/frame/reader.h"
+#include "sling/stream/input.h"
+#include "sling/stream/memory.h"
+#include "sling/string/ctype.h"
+#include "sling/string/numbers.h"
+
+namespace sling {
+
+// Bit masks for characters in a 64-byte block of input.
+struct CharMasks {
+  uint64 quote;      // quote characters
+  uint64 backslash;  // backslash characters
+  uint64 op;         // brackets, colons, and commas
+  uint64 newline;    // newline characters
+};
+
+// Classifies the characters in a block of 64 bytes.
+static void ClassifyBlock(const char *block, CharMasks *masks) {
+#ifdef __SSE2__
+  const __m128i quote = _mm_set1_epi8('"');
+  const __m128i backslash = _mm_set1_epi8('\\');
+  const __m128i newline = _mm_set1_epi8('\n');
+  const __m128i colon = _mm_set1_epi8(':');
+  const __m128i comma = _mm_set1_epi8(',');
+  const __m128i lower = _mm_set1_epi8(0x20);
+  const __m128i open = _mm_set1_epi8('{');
+  const __m128i close = _mm_set1_epi8('}');
+  masks->quote = masks->backslash = masks->op = masks->newline = 0;
+  for (int i = 0; i < 4; ++i) {
+    __m128i v = _mm_loadu_si128(
+        reinterpret_cast<const __m128i *>(block + i * 16));
+    int shift = i * 16;
+    masks->quote |= static_cast<uint64>(static_cast<uint16>(
+        _mm_movemask_epi8(_mm_cmpeq_epi8(v, quote)))) << shift;
+    masks->backslash |= static_cast<uint64>(static_cast<uint16>(
+        _mm_movemask_epi8(_mm_cmpeq_epi8(v, backslash)))) << shift;
+    masks->newline |= static_cast<uint64>(static_cast<uint16>(
+        _mm_movemask_epi8(_mm_cmpeq_epi8(v, newline)))) << shift;
+
+    // Square brackets become curly brackets when bit 5 is set, so all
+    // brackets can be found with two comparisons.
+    __m128i folded = _mm_or_si128(v, lower);
+    __m128i op = _mm_or_si128(_mm_cmpeq_epi8(folded, open),
+                              _mm_cmpeq_epi8(folded, close));
+    op = _mm_or_si128(op, _mm_cmpeq_epi8(v, colon));
+    op = _mm_or_si128(op, _mm_cmpeq_epi8(v, comma));
+    masks->op |= static_cast<uint64>(static_cast<uint16>(
+        _mm_movemask_epi8(op))) << shift;
+  }
+#else
+  masks->quote = masks->backslash = masks->op = masks->newline = 0;
+  for (int i = 0; i < 64; ++i) {
+    uint64 bit = 1ULL << i;
+    switch (block[i]) {
+      case '"': masks->quote |= bit; break;
+      case '\\': masks->backslash |= bit; break;
+      case '\n': masks->newline |= bit; break;
+      case '{': case '}': case '[': case ']': case ':': case ',':
+        masks->op |= bit;
+        break;
+    }
+  }
+#endif
+}
+
+// Returns mask with all characters escaped by a backslash. The carry flag is
+// set if the last character in the block is an unescaped backslash. Escapes
+// are rare in most JSON, so the backslashes are processed one at a time.
+static uint64 FindEscaped(uint64 backslash, bool *carry) {
+  uint64 escaped = 0;
+  if (*carry) {
+    escaped = 1;
+    backslash &= ~1ULL;
+  }
+  *carry = false;
+  while (backslash != 0) {
+    int i = __builtin_ctzll(backslash);
+    if (i == 63) {
+      *carry = true;
+      break;
+    }
+    uint64 next = 1ULL << (i + 1);
+    escaped |= next;
+    backslash &= ~((1ULL << i) | next);
+  }
+  return escaped;
+}
+
+// Returns mask where each bit is the xor of all the lower bits in the mask
+// including the bit itself. For a mask of quotes, this marks the characters
+// inside strings including the opening quote.
+static uint64 PrefixXor(uint64 mask) {
+  mask ^= mask << 1;
+  mask ^= mask << 2;
+  mask ^= mask << 4;
+  mask ^= mask << 8;
+  mask ^= mask << 16;
+  mask ^= mask << 32;
+  return mask;
+}
+
+Object JSONReader::Read(Text json) {
+  data_ = json.data();
+  size_ = json.size();
+  index_.clear();
+  next_ = 0;
+  pos_ = 0;
+
+  // Parse input using the structural index.
+  Handle result;
+  if (Index() && Parse(&result)) {
+    stack_.reset();
+    return Object(store_, result);
+  }
+  stack_.reset();
+
+  // Fall back to the standard reader.
+  ArrayInputStream stream(json.data(), json.size());
+  Input input(&stream);
+  Reader reader(store_, &input);
+  reader.set_json(true);
+  return reader.Read();
+}
+
+bool JSONReader::Index() {
+  if (size_ >= 1ULL << 32) return false;
+
+  bool carry = false;
+  uint64 in_string = 0;
+  CharMasks masks;
+  char tail[64];
+  for (size_t base = 0; base < size_; base += 64) {
+    // Classify characters in next block. The last block is padded with
+    // spaces.
+    const char *block = data_ + base;
+    if (size_ - base < 64) {
+      memset(tail, ' ', sizeof(tail));
+      memcpy(tail, block, size_ - base);
+      block = tail;
+    }
+    ClassifyBlock(block, &masks);
+
+    // Find quotes that are not escaped and mark the characters inside
+    // strings. The string state is carried over from the previous block.
+    uint64 escaped = FindEscaped(masks.backslash, &carry);
+    uint64 quotes = masks.quote & ~escaped;
+    uint64 inside = PrefixXor(quotes) ^ in_string;
+    in_string = static_cast<uint64>(static_cast<int64>(inside) >> 63);
+
+    // Unescaped newlines are not allowed in strings.
+    if (masks.newline & inside & ~escaped) return false;
+
+    // Add quotes and the structural characters outside strings to the index.
+    uint64 structurals = (masks.op & ~inside) | quotes;
+    while (structurals != 0) {
+      index_.push_back(base + __builtin_ctzll(structurals));
+      structurals &= structurals - 1;
+    }
+  }
+
+  // Check for unterminated string.
+  return in_string == 0;
+}
+
+bool JSONReader::Parse(Handle *result) {
+  // Only objects and arrays are parsed at the top level.
+  int c = Peek();
+  if (c != '{' && c != '[') return false;
+  return ParseValue(result);
+}
+
+int JSONReader::Peek() {
+  size_t end = next_ < index_.size() ? index_[next_] : size_;
+  while (pos_ < end && ascii_isspace(data_[pos_])) pos_++;
+  if (pos_ < end) return 0;
+  return next_ < index_.size() ? data_[end] : -1;
+}
+
+bool JSONReader::ParseValue(Handle *value) {
+  switch (Peek()) {
+    case '{':
+      return ParseObject(value);
+
+    case '[':
+      return ParseArray(value);
+
+    case '"': {
+      Text str;
+      if (!ParseString(&str)) return false;
+      *value = store_->AllocateString(str);
+      return true;
+    }
+
+    case 0:
+      return ParseScalar(value);
+
+    default:
+      return false;
+  }
+}
+
+bool JSONReader::ParseObject(Handle *frame) {
+  // Skip open bracket.
+  Advance();
+
+  // Put frame slots on the stack while parsing.
+  Word mark = stack_.offset(stack_.end());
+
+  int c = Peek();
+  if (c == '}') {
+    Advance();
+  } else {
+    for (;;) {
+      // Parse slot name. The id: slot is reserved for frame ids, so this key
+      // is renamed to _id.
+      if (c != '"') return false;
+      Text key;
+      if (!ParseString(&key)) return false;
+      Handle name = store_->Lookup(key);
+      if (name.IsId()) name = store_->Lookup("_id");
+      *stack_.push() = name;
+
+      // Skip colon between slot name and value.
+      if (Peek() != ':') return false;
+      Advance();
+
+      // Parse slot value.
+      Handle value;
+      if (!ParseValue(&value)) return false;
+      *stack_.push() = value;
+
+      // Continue with next slot after comma.
+      c = Peek();
+      if (c == '}') {
+        Advance();
+        break;
+      }
+      if (c != ',') return false;
+      Advance();
+      c = Peek();
+    }
+  }
+
+  // Create new frame from slots.
+  Slot *begin = reinterpret_cast<Slot *>(stack_.address(mark));
+  Slot *end = reinterpret_cast<Slot *>(stack_.end());
+  *frame = store_->AllocateFrame(begin, end, Handle::nil());
+
+  // Remove slots from stack.
+  stack_.set_end(stack_.address(mark));
+  return true;
+}
+
+bool JSONReader::ParseArray(Handle *array) {
+  // Skip open bracket.
+  Advance();
+
+  // Put elements on the stack while parsing.
+  Word mark = stack_.offset(stack_.end());
+
+  if (Peek() == ']') {
+    Advance();
+  } else {
+    for (;;) {
+      // Parse next element and push it on the stack.
+      Handle value;
+      if (!ParseValue(&value)) return false;
+      *stack_.push() = value;
+
+      // Continue with next element after comma.
+      int c = Peek();
+      if (c == ']') {
+        Advance();
+        break;
+      }
+      if (c != ',') return false;
+      Advance();
+    }
+  }
+
+  // Create new array from elements.
+  *array = store_->AllocateArray(stack_.address(mark), stack_.end());
+
+  // Remove elements from stack.
+  stack_.set_end(stack_.address(mark));
+  return true;
+}
+
+bool JSONReader::ParseString(Text *text) {
+  // The opening quote is followed by the closing quote in the index, since
+  // structural characters inside strings are not indexed.
+  size_t begin = index_[next_] + 1;
+  size_t end = index_[next_ + 1];
+  next_ += 2;
+  pos_ = end + 1;
+
+  // Strings without escapes are used directly from the input.
+  const char *str = data_ + begin;
+  size_t len = end - begin;
+  if (memchr(str, '\\', len) == nullptr) {
+    *text = Text(str, len);
+    return true;
+  }
+
+  if (!Unescape(str, str + len)) return false;
+  *text = Text(buffer_);
+  return true;
+}
+
+bool JSONReader::Unescape(const char *begin, const char *end) {
+  // Decode escapes in the same way as the tokenizer. Malformed escapes are
+  // left to the standard reader.
+  buffer_.clear();
+  const char *p = begin;
+  while (p < end) {
+    char ch = *p++;
+    if (ch != '\\') {
+      buffer_.push_back(ch);
+      continue;
+    }
+
+    ch = *p++;
+    switch (ch) {
+      case 'a': buffer_.push_back('\a'); break;
+      case 'b': buffer_.push_back('\b'); break;
+      case 'f': buffer_.push_back('\f'); break;
+      case 'n': buffer_.push_back('\n'); break;
+      case 'r': buffer_.push_back('\r'); break;
+      case 't': buffer_.push_back('\t'); break;
+      case 'v': buffer_.push_back('\v'); break;
+      case 'x': case 'u': case 'U': {
+        // Parse hex escape (\x00) or unicode escape (\u0000 or \U00000000).
+        int digits = ch == 'x' ? 2 : ch == 'u' ? 4 : 8;
+        if (end - p < digits) return false;
+        uint32 code = 0;
+        for (int i = 0; i < digits; ++i) {
+          int digit = ascii_isxdigit(p[i]) ? (p[i] <= '9' ? p[i] - '0' :
+                                              (p[i] | 0x20) - 'a' + 10) : -1;
+          if (digit < 0) return false;
+          code = (code << 4) + digit;
+          if (code > 0x10ffff) return false;
+        }
+        p += digits;
+
+        // Unicode code points are converted to UTF-8. Surrogates are encoded
+        // individually.
+        if (ch == 'x' || code <= 0x7f) {
+          buffer_.push_back(code);
+        } else if (code <= 0x7ff) {
+          buffer_.push_back(0xc0 | (code >> 6));
+          buffer_.push_back(0x80 | (code & 0x3f));
+        } else if (code <= 0xffff) {
+          buffer_.push_back(0xe0 | (code >> 12));
+          buffer_.push_back(0x80 | ((code >> 6) & 0x3f));
+          buffer_.push_back(0x80 | (code & 0x3f));
+        } else {
+          buffer_.push_back(0xf0 | (code >> 18));
+          buffer_.push_back(0x80 | ((code >> 12) & 0x3f));
+          buffer_.push_back(0x80 | ((code >> 6) & 0x3f));
+          buffer_.push_back(0x80 | (code & 0x3f));
+        }
+        break;
+      }
+      default:
+        // Just escape the next character.
+        buffer_.push_back(ch);
+    }
+  }
+  return true;
+}
+
+bool JSONReader::ParseScalar(Handle *value) {
+  // Get token text up to the next structural character.
+  size_t end = next_ < index_.size() ? index_[next_] : size_;
+  while (end > pos_ && ascii_isspace(data_[end - 1])) end--;
+  Text token(data_ + pos_, end - pos_);
+  pos_ = end;
+
+  // Parse literals.
+  switch (token.size()) {
+    case 3:
+      if (token == "nil") {
+        *value = Handle::nil();
+        return true;
+      }
+      break;
+    case 4:
+      if (token == "null") {
+        *value = Handle::nil();
+        return true;
+      }
+      if (token == "true") {
+        *value = Handle::Bool(true);
+        return true;
+      }
+      break;
+    case 5:
+      if (token == "false") {
+        *value = Handle::Bool(false);
+        return true;
+      }
+      break;
+  }
+
+  // Check number syntax, i.e. -?[0-9]+(.[0-9]+)?([eE][-+]?[0-9]+)?
+  const char *p = token.data();
+  const char *limit = p + token.size();
+  if (p < limit && *p == '-') p++;
+  const char *digits = p;
+  while (p < limit && ascii_isdigit(*p)) p++;
+  if (p == digits) return false;
+  bool integer = true;
+  if (p < limit && *p == '.') {
+    integer = false;
+    digits = ++p;
+    while (p < limit && ascii_isdigit(*p)) p++;
+    if (p == digits) return false;
+  }
+  if (p < limit && (*p == 'e' || *p == 'E')) {
+    integer = false;
+    p++;
+    if (p < limit && (*p == '-' || *p == '+')) p++;
+    digits = p;
+    while (p < limit && ascii_isdigit(*p)) p++;
+    if (p == digits) return false;
+  }
+  if (p != limit) return false;
+
+  // Convert number. Integers that do not fit in a handle are kept as strings.
+  if (integer) {
+    int64 n;
+    if (safe_strto64(token.data(), token.size(), &n)) {
+      if (n >= Handle::kMinInt && n <= Handle::kMaxInt) {
+        *value = Handle::Integer(n);
+      } else {
+        *value = store_->AllocateString(token);
+      }
+      return true;
+    }
+  }
+  float f;
+  if (!safe_strtof(token.str(), &f)) return false;
+  *value = Handle::Float(f);
+  return true;
+}
+
+}  // namespace sling
@@ -0,0 +1,110 @@
+// Copyright 2025 Ringgaard Research ApS
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SLING_FRAME_JSON_READER_H_
+#define SLING_FRAME_JSON_READER_H_
+
+#include <string>
+#include <vector>
+
+#include "sling/base/macros.h"
+#include "sling/base/types.h"
+#include "sling/frame/object.h"
+#include "sling/frame/store.h"
+#include "sling/string/text.h"
+
+namespace sling {
+
+// The JSON reader converts JSON text in memory to objects in a store. It
+// produces the same objects as Reader in JSON mode, i.e. objects are converted
+// to frames with the keys as slot names, but parses the input in two passes.
+// The first pass finds the structural characters, i.e. brackets, colons,
+// commas, and quotes outside strings, in blocks of 64 bytes using SIMD
+// instructions. The second pass builds the objects directly in the store from
+// the structural index. Input that the fast path does not handle, e.g. invalid
+// JSON or SLING-specific syntax, is parsed with Reader instead, so the result
+// is always the same as for Reader.
+class JSONReader {
+ public:
+  // Initializes JSON reader for reading objects into store.
+  explicit JSONReader(Store *store) : store_(store), stack_(store) {}
+
+  // Reads the first object from JSON text.
+  Object Read(Text json);
+
+ private:
+  // Builds structural index for input. Returns false if the input contains
+  // strings that the fast path does not handle.
+  bool Index();
+
+  // Parses object from structural index. Returns false if the input could not
+  // be parsed.
+  bool Parse(Handle *result);
+
+  // Parses value at the current position.
+  bool ParseValue(Handle *value);
+
+  // Parses JSON object into frame.
+  bool ParseObject(Handle *frame);
+
+  // Parses JSON array.
+  bool ParseArray(Handle *array);
+
+  // Parses string at the current structural. The string content is returned
+  // in text, which points either into the input or to the escape buffer.
+  bool ParseString(Text *text);
+
+  // Decodes escape sequences in string.
+  bool Unescape(const char *begin, const char *end);
+
+  // Parses number or literal between the current position and the next
+  // structural.
+  bool ParseScalar(Handle *value);
+
+  // Returns the next structural character or -1 at the end of the input. Only
+  // whitespace is allowed before the structural character, otherwise zero is
+  // returned.
+  int Peek();
+
+  // Moves past the current structural character.
+  void Advance() { pos_ = index_[next_++] + 1; }
+
+  // Object store for parsed objects.
+  Store *store_;
+
+  // Stack for storing intermediate objects while parsing.
+  HandleSpace stack_;
+
+  // Input text.
+  const char *data_ = nullptr;
+  size_t size_ = 0;
+
+  // Positions of structural characters in input.
+  std::vector<uint32> index_;
+
+  // Next structural character in index.
+  size_t next_ = 0;
+
+  // Current position in input.
+  size_t pos_ = 0;
+
+  // Buffer for strings with escape sequences.
+  string buffer_;
+
+  DISALLOW_COPY_AND_ASSIGN(JSONReader);
+};
+
+}  // namespace sling
+
+#endif  // SLING_FRAME_JSON_READER_H_
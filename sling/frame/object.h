@@ -15,6 +15,7 @@
 #ifndef SLING_FRAME_OBJECT_H_
 #define SLING_FRAME_OBJECT_H_
 
+#include <algorithm>
 #include <atomic>
 #include <functional>
 #include <string>
@@ -176,6 +177,12 @@ template<typename T> class handle_map {
   // Return size of hash table.
   size_t size() const { return size_; }
 
+  // Remove all elements from handle map.
+  void clear() {
+    std::fill(nodes_, end_, node{});
+    size_ = 0;
+  }
+
   // Check if handle map is empty.
   bool empty() const { return size_ == 0; }
 
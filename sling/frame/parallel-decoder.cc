@@ -0,0 +1,273 @@
+// Copyright 2025 Ringgaard Research ApS
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "sling/frame/parallel-decoder.h"
+
+#include <string.h>
+#include <condition_variable>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "sling/base/logging.h"
+#include "sling/file/file.h"
+#include "sling/frame/decoder.h"
+#include "sling/frame/object.h"
+#include "sling/frame/store.h"
+#include "sling/frame/wire.h"
+#include "sling/stream/input.h"
+#include "sling/stream/memory.h"
+#include "sling/util/threadpool.h"
+#include "sling/util/varint.h"
+
+namespace sling {
+
+// Tag for segment header.
+static const uint64 kSegmentTag = WIRE_SPECIAL | (WIRE_SEGMENT << 3);
+
+ParallelDecoder::ParallelDecoder(Store *store, int num_threads)
+    : store_(store), num_threads_(num_threads) {
+  if (num_threads_ <= 0) num_threads_ = std::thread::hardware_concurrency();
+  if (num_threads_ <= 0) num_threads_ = 1;
+}
+
+bool ParallelDecoder::Segmented(const string &filename) {
+  // Segmented files start with a binary marker followed by a segment tag.
+  File *file;
+  if (!File::Open(filename, "r", &file).ok()) return false;
+  char header[2];
+  uint64 read;
+  bool segmented = file->Read(header, sizeof(header), &read).ok() &&
+                   read == sizeof(header) &&
+                   header[0] == WIRE_BINARY_MARKER &&
+                   header[1] == kSegmentTag;
+  file->Close();
+  return segmented;
+}
+
+Status ParallelDecoder::ReadSegments(File *file,
+                                     std::vector<Segment> *segments) {
+  uint64 size;
+  Status st = file->GetSize(&size);
+  if (!st.ok()) return st;
+
+  // Each segment starts with a segment tag and the segment size. The segment
+  // headers are read by skipping over the segment data.
+  uint64 pos = 1;
+  while (pos < size) {
+    char header[2 * Varint::kMax64];
+    uint64 read;
+    st = file->PRead(pos, header, sizeof(header), &read);
+    if (!st.ok()) return st;
+
+    const char *limit = header + read;
+    uint64 tag;
+    uint64 length;
+    const char *p = Varint::Parse64WithLimit(header, limit, &tag);
+    if (p == nullptr || tag != kSegmentTag) {
+      return Status(1, "Invalid segment header", file->filename());
+    }
+    p = Varint::Parse64WithLimit(p, limit, &length);
+    if (p == nullptr) return Status(1, "Invalid segment size");
+
+    Segment segment;
+    segment.position = pos + (p - header);
+    segment.size = length;
+    if (segment.position + segment.size > size) {
+      return Status(1, "Truncated segment", file->filename());
+    }
+    segments->push_back(segment);
+    pos = segment.position + segment.size;
+  }
+
+  return Status::OK;
+}
+
+Status ParallelDecoder::DecodeSegment(File *file, const Segment &segment,
+                                      Store **result) {
+  // Read segment data.
+  string data;
+  data.resize(segment.size);
+  uint64 read;
+  Status st = file->PRead(segment.position, &data[0], segment.size, &read);
+  if (!st.ok()) return st;
+  if (read != segment.size) return Status(1, "Short segment read");
+
+  // Decode segment into worker store.
+  Store *store = new Store();
+  store->LockGC();
+  ArrayInputStream stream(data.data(), data.size());
+  Input input(&stream);
+  Decoder decoder(store, &input, false);
+  while (!decoder.done()) {
+    if (decoder.DecodeObject().IsError()) {
+      delete store;
+      return Status(1, "Error decoding segment", file->filename());
+    }
+  }
+
+  // Remove garbage, e.g. replaced proxies and old symbol tables, from the
+  // worker store before merging.
+  store->UnlockGC();
+  store->GC();
+
+  *result = store;
+  return Status::OK;
+}
+
+Status ParallelDecoder::DecodeFile(const string &filename) {
+  // Open file and read segment directory.
+  File *file;
+  Status st = File::Open(filename, "r", &file);
+  if (!st.ok()) return st;
+  std::vector<Segment> segments;
+  st = ReadSegments(file, &segments);
+  if (!st.ok()) {
+    file->Close();
+    return st;
+  }
+
+  // Worker stores for decoded segments.
+  int num_segments = segments.size();
+  std::vector<Store *> results(num_segments);
+  std::vector<Status> status(num_segments);
+  std::vector<bool> ready(num_segments);
+  std::mutex mu;
+  std::condition_variable done;
+  {
+    // Decode segments in parallel. The number of segments in progress is
+    // limited to bound the memory used by the worker stores.
+    int window = 2 * num_threads_;
+    ThreadPool pool(num_threads_, window);
+    pool.StartWorkers();
+    auto schedule = [&](int index) {
+      pool.Schedule([&, index]() {
+        Store *result = nullptr;
+        Status st = DecodeSegment(file, segments[index], &result);
+        std::unique_lock<std::mutex> lock(mu);
+        results[index] = result;
+        status[index] = st;
+        ready[index] = true;
+        done.notify_all();
+      });
+    };
+    for (int i = 0; i < window && i < num_segments; ++i) schedule(i);
+
+    // Merge worker stores into target store in segment order. The GC is
+    // locked since the handle mapping holds unrooted handles to objects in the
+    // store.
+    GCLock gclock(store_);
+    for (int i = 0; i < num_segments; ++i) {
+      // Wait until segment has been decoded.
+      {
+        std::unique_lock<std::mutex> lock(mu);
+        while (!ready[i]) done.wait(lock);
+      }
+      if (i + window < num_segments) schedule(i + window);
+
+      // Merge worker store into target store.
+      if (!status[i].ok() && st.ok()) st = status[i];
+      if (st.ok()) Merge(results[i]);
+      delete results[i];
+    }
+  }
+
+  Status cst = file->Close();
+  return st.ok() ? cst : st;
+}
+
+void ParallelDecoder::Merge(const Store *source) {
+  // Allocate objects in target store for all the objects in the worker store.
+  // Symbols and proxies are resolved in the target store, and frames with ids
+  // use the existing frame or proxy for the id in the target store.
+  mapping_.clear();
+  Handle symtab = source->symbols();
+  Store::Iterator it(source);
+  const Datum *object;
+  while ((object = it.next()) != nullptr) {
+    if (object->invalid()) continue;
+    Handle self = object->self;
+    if (self.idx() < Store::kPristineHandles || self == symtab) continue;
+    if (self.idx() >= mapping_.size()) {
+      mapping_.resize(self.idx() + 1, Handle::nil());
+    }
+
+    Handle handle;
+    if (object->IsSymbol()) {
+      handle = store_->Symbol(object->AsSymbol()->name());
+    } else if (object->IsString()) {
+      const StringDatum *str = object->AsString();
+      if (str->qualified()) {
+        handle = store_->AllocateString(str->length(), Handle::nil());
+        memcpy(store_->GetString(handle)->data(), str->data(), str->length());
+      } else {
+        handle = store_->AllocateString(str->str());
+      }
+    } else if (object->IsArray()) {
+      handle = store_->AllocateArray(object->AsArray()->length());
+    } else if (object->IsProxy()) {
+      const ProxyDatum *proxy = object->AsProxy();
+      handle = store_->Lookup(source->SymbolName(proxy->symbol));
+    } else if (object->IsFrame()) {
+      const FrameDatum *frame = object->AsFrame();
+      Handle id = frame->get(Handle::id());
+      if (id.IsNil()) {
+        handle = store_->AllocateFrame(frame->slots());
+      } else {
+        handle = store_->Lookup(source->SymbolName(id));
+      }
+    }
+    mapping_[self.idx()] = handle;
+  }
+
+  // Fill in the contents of the new objects with mapped handles.
+  Store::Iterator contents(source);
+  while ((object = contents.next()) != nullptr) {
+    if (object->invalid()) continue;
+    Handle self = object->self;
+    if (self.idx() < Store::kPristineHandles || self == symtab) continue;
+    Handle handle = mapping_[self.idx()];
+
+    if (object->IsString()) {
+      const StringDatum *str = object->AsString();
+      if (str->qualified()) {
+        store_->GetString(handle)->set_qualifier(Map(str->qualifier()));
+      }
+    } else if (object->IsArray()) {
+      const ArrayDatum *array = object->AsArray();
+      Handle *dest = store_->GetArray(handle)->begin();
+      for (const Handle *h = array->begin(); h < array->end(); ++h) {
+        *dest++ = Map(*h);
+      }
+    } else if (object->IsFrame() && !object->IsProxy()) {
+      const FrameDatum *frame = object->AsFrame();
+      slots_.clear();
+      bool anonymous = true;
+      for (const Slot *s = frame->begin(); s < frame->end(); ++s) {
+        slots_.emplace_back(Map(s->name), Map(s->value));
+        if (s->name.IsId()) anonymous = false;
+      }
+      Slot *begin = slots_.data();
+      Slot *end = begin + slots_.size();
+      if (anonymous) {
+        store_->UpdateFrame(handle, begin, end);
+      } else {
+        store_->AllocateFrame(begin, end, handle);
+      }
+    }
+  }
+}
+
+}  // namespace sling
@@ -0,0 +1,87 @@
+// Copyright 2025 Ringgaard Research ApS
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SLING_FRAME_PARALLEL_DECODER_H_
+#define SLING_FRAME_PARALLEL_DECODER_H_
+
+#include <string>
+#include <vector>
+
+#include "sling/base/status.h"
+#include "sling/base/types.h"
+#include "sling/file/file.h"
+#include "sling/frame/store.h"
+
+namespace sling {
+
+// The parallel decoder loads files with segmented binary encoding into a global
+// store. Each segment is decoded into a separate worker store by a pool of
+// threads, and the objects in the worker stores are then merged into the
+// target store in segment order. Object references do not cross segments, so
+// anonymous objects shared between segments are decoded into one copy per
+// segment.
+class ParallelDecoder {
+ public:
+  // Initializes parallel decoder for loading objects into global store. If the
+  // number of threads is zero, one thread per CPU core is used.
+  ParallelDecoder(Store *store, int num_threads = 0);
+
+  // Decodes all objects in segmented file into the store.
+  Status DecodeFile(const string &filename);
+
+  // Checks if file has segmented binary encoding.
+  static bool Segmented(const string &filename);
+
+ private:
+  // Segment in segmented encoding.
+  struct Segment {
+    uint64 position;  // file position of segment data
+    uint64 size;      // size of segment data in bytes
+  };
+
+  // Reads segment directory by following the chain of segment headers.
+  static Status ReadSegments(File *file, std::vector<Segment> *segments);
+
+  // Decodes segment into a new worker store.
+  static Status DecodeSegment(File *file, const Segment &segment,
+                              Store **result);
+
+  // Merges objects from worker store into target store.
+  void Merge(const Store *source);
+
+  // Maps handle in worker store to handle in target store.
+  Handle Map(Handle handle) const {
+    if (!handle.IsRef() || handle.idx() < Store::kPristineHandles) {
+      return handle;
+    }
+    DCHECK_LT(handle.idx(), mapping_.size());
+    return mapping_[handle.idx()];
+  }
+
+  // Target store.
+  Store *store_;
+
+  // Number of decoder threads.
+  int num_threads_;
+
+  // Mapping from handle index in worker store to handle in target store.
+  std::vector<Handle> mapping_;
+
+  // Slot buffer for merging frames.
+  std::vector<Slot> slots_;
+};
+
+}  // namespace sling
+
+#endif  // SLING_FRAME_PARALLEL_DECODER_H_
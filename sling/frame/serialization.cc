@@ -15,6 +15,7 @@
 #include "sling/frame/serialization.h"
 
 #include "sling/base/logging.h"
+#include "sling/frame/parallel-decoder.h"
 #include "sling/frame/snapshot.h"
 #include "sling/frame/wire.h"
 
@@ -95,7 +96,8 @@ string Encode(const Object &object) {
 
 void LoadStore(const string &filename, Store *store) {
   if (store->Pristine() && Snapshot::Valid(filename)) {
-    Status st = Snapshot::Read(store, filename);
+    Status st = Snapshot::Map(store, filename);
+    if (!st.ok()) st = Snapshot::Read(store, filename);
     if (st.ok()) {
       VLOG(1) << "Loaded " << filename << " from snapshot";
       return;
@@ -104,6 +106,13 @@ void LoadStore(const string &filename, Store *store) {
     }
   }
 
+  if (store->globals() == nullptr && ParallelDecoder::Segmented(filename)) {
+    ParallelDecoder decoder(store);
+    Status st = decoder.DecodeFile(filename);
+    CHECK(st) << filename;
+    return;
+  }
+
   store->LockGC();
   FileInputStream stream(filename);
   Input input(&stream);
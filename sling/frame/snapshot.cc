@@ -14,6 +14,9 @@
 
 #include "sling/frame/snapshot.h"
 
+#include <string.h>
+#include <vector>
+
 #include "sling/base/logging.h"
 #include "sling/base/status.h"
 #include "sling/base/types.h"
@@ -42,7 +45,13 @@ bool Snapshot::Valid(const string &filename) {
   // Check snapshot version.
   Header hdr;
   if (ok) ok = file->Read(&hdr, sizeof(Header)).ok();
-  if (ok) ok = hdr.magic == MAGIC && hdr.version == VERSION;
+  if (ok) ok = hdr.magic == MAGIC;
+  if (ok && hdr.version != VERSION) {
+    LOG(WARNING) << "Ignoring snapshot " << Filename(filename)
+                 << " with version " << hdr.version
+                 << ", expected version " << VERSION;
+    ok = false;
+  }
   file->Close();
   return ok;
 }
@@ -76,12 +85,19 @@ Status Snapshot::Read(Store *store, const string &filename) {
 
   // Read heaps from snapshot.
   Heap *symheap = nullptr;
+  uint64 pos = sizeof(Header);
   for (int i = 0; i < hdr.heaps; ++i) {
     // Read heap size.
     uint64 heapsize;
     st = file->Read(&heapsize, sizeof(uint64));
     if (!st.ok()) return st;
 
+    // Skip padding before heap.
+    uint64 start = Align(pos + sizeof(uint64));
+    st = file->Skip(start - pos - sizeof(uint64));
+    if (!st.ok()) return st;
+    pos = start + heapsize;
+
     // Allocate new heap.
     Heap *heap = new Heap();
     heap->reserve(heapsize);
@@ -112,10 +128,10 @@ Status Snapshot::Read(Store *store, const string &filename) {
   memset(handles.base() + 1, 0, (hdr.handles - 1) * sizeof(Store::Reference));
 
   // Restore handle table from self handles in objects. If snapshot has a
-  // separate heap for the symbol table, all the other heaps are frozen.
+  // separate heap for the symbol table, all the other heaps are frozen. The
+  // objects in frozen heaps have already been marked in the snapshot.
   store->free_handle_ = nullptr;
   for (Heap *heap = store->first_heap_; heap != nullptr; heap = heap->next()) {
-    bool freeze = (symheap != nullptr && heap != symheap);
     Datum *object = heap->base();
     Datum *end = heap->end();
     while (object < end) {
@@ -123,14 +139,10 @@ Status Snapshot::Read(Store *store, const string &filename) {
         // Update handle table from self handle.
         store->Assign(object->self, object);
         DCHECK(store->IsValidReference(object->self));
-
-        // Set mark bit for objects in frozen heaps to prevent the GC from
-        // traversing these objects.
-        if (freeze) object->mark();
       }
       object = object->next();
     }
-    if (freeze) heap->set_frozen(true);
+    if (symheap != nullptr && heap != symheap) heap->set_frozen(true);
   }
 
   // Set up symbol table.
@@ -143,6 +155,174 @@ Status Snapshot::Read(Store *store, const string &filename) {
   return file->Close();
 }
 
+Status Snapshot::Map(Store *store, const string &filename) {
+  // Only global stores can be restored from snapshot.
+  if (store->globals() != nullptr) {
+    return Status(1, "local store cannot be loaded from snapshot");
+  }
+
+  // Read snapshot header.
+  File *file;
+  Status st = File::Open(Filename(filename), "r", &file);
+  if (!st.ok()) return st;
+
+  Header hdr;
+  uint64 size;
+  st = file->Read(&hdr, sizeof(Header));
+  if (st.ok()) st = file->GetSize(&size);
+  if (!st.ok()) {
+    file->Close();
+    return st;
+  }
+
+  if (hdr.magic != MAGIC || hdr.version != VERSION || hdr.symheap == -1) {
+    file->Close();
+    return Status(1, "snapshot cannot be mapped", filename);
+  }
+  if (hdr.symheap < 0 || hdr.symheap >= hdr.heaps || hdr.handles < 1 ||
+      store->symbols_.bits != hdr.symtab) {
+    file->Close();
+    return Status(1, "invalid snapshot header", filename);
+  }
+
+  // Map snapshot file read-only into memory, so the pages are shared through
+  // the page cache. The store makes the mapping writable copy-on-write if it
+  // needs to modify objects in the mapped heaps. The mapping stays valid after
+  // the file has been closed.
+  char *mapping = static_cast<char *>(file->MapMemory(0, size, false, false));
+  st = file->Close();
+  if (mapping == nullptr) return Status(1, "cannot map snapshot", filename);
+  if (!st.ok()) {
+    File::FreeMappedMemory(mapping, size);
+    return st;
+  }
+
+  // Check snapshot layout before changing the store.
+  uint64 pos = sizeof(Header);
+  uint64 symstart = 0;
+  uint64 symend = 0;
+  bool valid = hdr.offsets % sizeof(uint64) == 0 &&
+               hdr.offsets <= size &&
+               hdr.handles <= (size - hdr.offsets) / sizeof(uint64);
+  for (int i = 0; valid && i < hdr.heaps; ++i) {
+    if (pos + sizeof(uint64) > size) {
+      valid = false;
+    } else {
+      uint64 heapsize = *reinterpret_cast<uint64 *>(mapping + pos);
+      pos = Align(pos + sizeof(uint64));
+      valid = pos <= size && heapsize <= size - pos;
+      if (i == hdr.symheap) {
+        symstart = pos;
+        symend = pos + heapsize;
+      }
+      pos += heapsize;
+    }
+  }
+
+  // Check that all handles point to objects inside the heaps.
+  const uint64 *offsets =
+      reinterpret_cast<const uint64 *>(mapping + hdr.offsets);
+  for (int i = 1; valid && i < hdr.handles; ++i) {
+    uint64 offset = offsets[i];
+    if (offset == 0) continue;
+    valid = offset >= sizeof(Header) && offset < hdr.offsets &&
+            offset % kObjectAlign == 0;
+  }
+  if (!valid) {
+    File::FreeMappedMemory(mapping, size);
+    return Status(1, "invalid snapshot", filename);
+  }
+
+  // Delete existing heaps.
+  Heap *heap = store->first_heap_;
+  while (heap != nullptr) {
+    Heap *next = heap->next();
+    delete heap;
+    heap = next;
+  }
+  store->first_heap_ = store->last_heap_ = store->current_heap_ = heap;
+
+  // Set up heaps. The frozen heaps point directly into the mapped snapshot,
+  // whereas the symbol heap is copied since new symbols can be added to the
+  // symbol table.
+  Address symbase = nullptr;
+  pos = sizeof(Header);
+  for (int i = 0; i < hdr.heaps; ++i) {
+    uint64 heapsize = *reinterpret_cast<uint64 *>(mapping + pos);
+    pos = Align(pos + sizeof(uint64));
+
+    Heap *heap = new Heap();
+    if (i == hdr.symheap) {
+      heap->reserve(heapsize);
+      memcpy(heap->base(), mapping + pos, heapsize);
+      heap->set_end(heap->address(heapsize));
+      symbase = reinterpret_cast<Address>(heap->base());
+    } else {
+      heap->Map(reinterpret_cast<Address>(mapping + pos), heapsize);
+    }
+    pos += heapsize;
+
+    store->current_heap_ = heap;
+    if (store->first_heap_ == nullptr) store->first_heap_ = heap;
+    if (store->last_heap_ != nullptr) store->last_heap_->set_next(heap);
+    store->last_heap_ = heap;
+  }
+  store->mapping_ = mapping;
+  store->mapped_size_ = size;
+
+  // Allocate handle table.
+  size_t handle_table_size = hdr.handles * sizeof(Store::Reference);
+  auto &handles = store->handles_;
+  handles.reserve(handle_table_size);
+  handles.set_end(handles.base() + hdr.handles);
+  store->pools_[Handle::kGlobal] = handles.base();
+
+  // Restore handle table from object offsets, leaving the nil entry intact.
+  Store::Reference *ref = handles.base();
+  for (int i = 1; i < hdr.handles; ++i) {
+    uint64 offset = offsets[i];
+    Address object = nullptr;
+    if (offset >= symstart && offset < symend) {
+      object = symbase + (offset - symstart);
+    } else if (offset != 0) {
+      object = reinterpret_cast<Address>(mapping + offset);
+    }
+    ref[i].object = reinterpret_cast<Datum *>(object);
+  }
+  store->free_handle_ = nullptr;
+
+  // Set up symbol table.
+  store->num_symbols_ = hdr.symbols;
+  store->num_buckets_ = hdr.buckets;
+
+  return Status::OK;
+}
+
+// Write heap to snapshot with all objects marked.
+static Status WriteMarked(File *file, Heap *heap) {
+  static const size_t kBufferSize = 1 << 20;
+  string buffer;
+  Datum *object = heap->base();
+  Datum *end = heap->end();
+  while (object < end) {
+    // Copy object to buffer and mark it.
+    Datum *next = object->next();
+    size_t offset = buffer.size();
+    buffer.append(reinterpret_cast<char *>(object), Region::size(object, next));
+    Datum *copy = reinterpret_cast<Datum *>(&buffer[offset]);
+    if (!copy->invalid()) copy->mark();
+    object = next;
+
+    // Flush buffer when it is full.
+    if (buffer.size() >= kBufferSize || object == end) {
+      Status st = file->Write(buffer.data(), buffer.size());
+      if (!st.ok()) return st;
+      buffer.clear();
+    }
+  }
+  return Status::OK;
+}
+
 Status Snapshot::Write(Store *store, const string &filename) {
   // Only global stores can be snapshot.
   if (store->globals() != nullptr) {
@@ -165,25 +345,66 @@ Status Snapshot::Write(Store *store, const string &filename) {
   hdr.heaps = 0;
   hdr.symheap = -1;
   Heap *symheap = store->GetSymbolHeap();
+  uint64 pos = sizeof(Header);
   for (Heap *heap = store->first_heap_; heap != nullptr; heap = heap->next()) {
     if (heap == symheap) hdr.symheap = hdr.heaps;
     hdr.heaps++;
+    pos = Align(pos + sizeof(uint64)) + heap->size();
   }
+  hdr.offsets = Align(pos);
   st = file->Write(&hdr, sizeof(Header));
   if (!st.ok()) {
     file->Close();
     return st;
   }
 
-  // Write heaps.
+  // Write heaps. If the store has a separate symbol heap, all the other heaps
+  // are frozen when the snapshot is loaded. The objects in these heaps are
+  // marked in the snapshot to prevent the GC from traversing them, so the
+  // heaps can be used without modification. The file offsets of all objects
+  // are collected for the handle table.
+  std::vector<uint64> offsets(hdr.handles);
+  string padding;
+  pos = sizeof(Header);
   for (Heap *heap = store->first_heap_; heap != nullptr; heap = heap->next()) {
     uint64 heapsize = heap->size();
+    uint64 start = Align(pos + sizeof(uint64));
+    padding.assign(start - pos - sizeof(uint64), 0);
     st = file->Write(&heapsize, sizeof(uint64));
-    if (st.ok()) st = file->Write(heap->base(), heapsize);
+    if (st.ok()) st = file->Write(padding.data(), padding.size());
+    if (st.ok()) {
+      if (symheap != nullptr && heap != symheap) {
+        st = WriteMarked(file, heap);
+      } else {
+        st = file->Write(heap->base(), heapsize);
+      }
+    }
     if (!st) {
       file->Close();
       return st;
     }
+
+    Datum *object = heap->base();
+    Datum *end = heap->end();
+    while (object < end) {
+      if (!object->invalid()) {
+        uint64 offset = Region::size(heap->base(), object);
+        offsets[object->self.idx()] = start + offset;
+      }
+      object = object->next();
+    }
+    pos = start + heapsize;
+  }
+
+  // Write object offsets for handle table.
+  padding.assign(hdr.offsets - pos, 0);
+  st = file->Write(padding.data(), padding.size());
+  if (st.ok()) {
+    st = file->Write(offsets.data(), offsets.size() * sizeof(uint64));
+  }
+  if (!st) {
+    file->Close();
+    return st;
   }
 
   return file->Close();
@@ -26,6 +26,11 @@ namespace sling {
 // Global frame stores can be snapshot and saved to .snap files. These can then
 // be loaded into a new empty global store. For large stores, this is faster
 // than reading the frame store in encoded format.
+//
+// The heaps are stored page-aligned in the snapshot file together with a
+// table of file offsets for the objects in the handle table. This allows the
+// snapshot to be memory-mapped directly into a store, so the frozen heaps can
+// be shared between processes using the same snapshot.
 class Snapshot {
  public:
   // Filename for snapshot.
@@ -37,13 +42,22 @@ class Snapshot {
   // Read snapshot into empty global store.
   static Status Read(Store *store, const string &filename);
 
+  // Map snapshot into empty global store. The frozen heaps are memory-mapped
+  // read-only from the snapshot file, and only the symbol heap and the handle
+  // table are allocated in private memory. Fails without changing the
+  // store if the snapshot does not have a separate symbol heap.
+  static Status Map(Store *store, const string &filename);
+
   // Write store to snapshot file.
   static Status Write(Store *store, const string &filename);
 
  private:
   // Current magic and version for snapshots.
   static const int MAGIC = 0x50414e53;
-  static const int VERSION = 5;
+  static const int VERSION = 6;
+
+  // Alignment of heaps and handle table in snapshot file.
+  static const int ALIGNMENT = 4096;
 
   // Snapshot file header.
   struct Header {
@@ -55,7 +69,13 @@ class Snapshot {
     int symbols;    // number of symbols in symbol table
     int buckets;    // number of hash buckets in the symbol table
     int symheap;    // heap for symbol table (-1 means no separate heap)
+    int64 offsets;  // file position of object offsets for handle table
   };
+
+  // Align file position.
+  static uint64 Align(uint64 pos) {
+    return (pos + ALIGNMENT - 1) & ~static_cast<uint64>(ALIGNMENT - 1);
+  }
 };
 
 }  // namespace sling
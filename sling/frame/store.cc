@@ -18,6 +18,7 @@
 
 #include "sling/base/clock.h"
 #include "sling/base/logging.h"
+#include "sling/file/file.h"
 #include "sling/string/strcat.h"
 #include "sling/string/text.h"
 #include "sling/util/city.h"
@@ -53,10 +54,6 @@ static const Word kInitialHeap[] = {
 
 #undef CHARS
 
-// Size of pristine store.
-static const int kPristineSymbols = 4;
-static const int kPristineHandles = 10;
-
 // Default store options.
 const Store::Options Store::kDefaultOptions;
 
@@ -215,10 +212,19 @@ Store::~Store() {
     heap = next;
   }
 
+  // Release memory mapping for mapped heaps.
+  if (mapping_ != nullptr) File::FreeMappedMemory(mapping_, mapped_size_);
+
   // Release reference to shared global store.
   if (globals_ != nullptr && globals_->shared()) globals_->Release();
 }
 
+void Store::UnprotectMapping() {
+  VLOG(1) << "Make mapped snapshot writable";
+  CHECK(File::UnprotectMappedMemory(mapping_, mapped_size_));
+  mapping_writable_ = true;
+}
+
 void Store::Share() {
   CHECK(!shared()) << "Store is already shared";
   refs_ = 1;
@@ -359,6 +365,7 @@ Handle Store::AllocateFrame(Slot *begin, Slot *end, Handle original) {
         CHECK_EQ(handle.tag(), symbol->self.tag());
 
         // Bind symbol to frame.
+        Unprotect();
         symbol->value = handle;
         frame->AddFlags(PUBLIC);
       } else if (id->IsProxy()) {
@@ -398,6 +405,7 @@ void Store::UpdateFrame(Handle handle, Slot *begin, Slot *end) {
 
   // Make sure the existing frame is anonymous.
   CHECK(frame->IsAnonymous());
+  Unprotect();
 
   // Copy new slots to the frame.
   Slot *t = frame->begin();
@@ -483,6 +491,7 @@ void Store::ResizeArray(Handle array, Word length) {
 void Store::Unbind(Handle handle) {
   FrameDatum *frame = GetFrame(handle);
   CHECK(frame->IsFrame());
+  Unprotect();
   for (Slot *slot = frame->begin(); slot < frame->end(); ++slot) {
     if (slot->name.IsId()) {
       // Unbind symbol from the frame.
@@ -514,6 +523,7 @@ void Store::Set(Handle frame, Handle name, Handle value) {
   for (Slot *s = datum->begin(); s < datum->end(); ++s) {
     if (s->name == name) {
       // Update slot and return.
+      Unprotect();
       s->value = value;
       return;
     }
@@ -637,6 +647,7 @@ void Store::Delete(Handle frame, Handle name) {
   Slot *end = datum->end();
   while (slot < end && slot->name != name) slot++;
   if (slot == end) return;
+  Unprotect();
   Slot *current = slot;
   while (slot < end) {
     if (slot->name == name) {
@@ -722,7 +733,9 @@ void Store::ResizeSymbolTable() {
   MapDatum *map = AllocateDatum(ARRAY, size)->AsMap();
   for (Handle *h = map->begin(); h < map->end(); ++h) *h = Handle::nil();
 
-  // Move all the symbols to the new symbol map.
+  // Move all the symbols to the new symbol map. This relinks the bucket chains
+  // of symbols in the mapped heaps.
+  Unprotect();
   MapDatum *symbols = GetMap(symbols_);
   for (Handle *bucket = symbols->begin(); bucket < symbols->end(); ++bucket) {
     // Move all symbols in bucket to new map. If we encounter a symbol with
@@ -852,6 +865,7 @@ Handle Store::Lookup(Text name) {
 
   // Symbol is unbound. Bind it to a new proxy.
   Handle proxy = AllocateProxy(sym);
+  Unprotect();
   GetSymbol(sym)->value = proxy;
   return proxy;
 }
@@ -1038,6 +1052,7 @@ void Store::ReplaceProxy(ProxyDatum *proxy, FrameDatum *frame) {
   // Check that both the proxy and the frame are owned by the store.
   CHECK(Owned(proxy->self));
   CHECK(Owned(frame->self));
+  Unprotect();
 
   // Swap the handles for the proxy and the frame.
   Assign(proxy->self, frame);
@@ -1451,6 +1466,7 @@ bool Store::IsValidReference(Handle handle) const {
 
 void Store::ReplaceHandle(Handle handle, Handle replacement) {
   // Scan the heaps and replace all instances of handle.
+  Unprotect();
   for (Heap *heap = first_heap_; heap != nullptr; heap = heap->next()) {
     Datum *object = heap->base();
     Datum *end = heap->end();
@@ -1492,6 +1508,82 @@ void Store::ReplaceHandle(Handle handle, Handle replacement) {
   } while (ext != &externals_);
 }
 
+void Store::Reset(int64 retain) {
+  // Only local stores can be reset, since the standard objects in global
+  // stores must be preserved.
+  CHECK(globals_ != nullptr) << "Only local stores can be reset";
+  CHECK(refs_ <= 0) << "Reset with live references to store";
+  CHECK(roots_.next_ == &roots_) << "Reset with live roots in store";
+  CHECK(externals_.next_ == &externals_) << "Reset with live externals";
+  CHECK_EQ(gc_locks_, 0) << "Reset with GC lock on store";
+
+  // Rewind heaps. The memory is kept for new objects, except for the heaps
+  // beyond the retained size. The first heap is always kept.
+  int64 kept = first_heap_->capacity();
+  Heap *last = first_heap_;
+  while (last->next() != nullptr) {
+    Heap *heap = last->next();
+    if (retain >= 0 && kept + heap->capacity() > retain) break;
+    kept += heap->capacity();
+    last = heap;
+  }
+  Heap *heap = last->next();
+  while (heap != nullptr) {
+    Heap *next = heap->next();
+    delete heap;
+    heap = next;
+  }
+  last->set_next(nullptr);
+  last_heap_ = last;
+  for (heap = first_heap_; heap != nullptr; heap = heap->next()) {
+    heap->reset();
+  }
+  current_heap_ = first_heap_;
+
+  // Rewind handle table and shrink it if it has grown beyond the retained
+  // size.
+  handles_.reset();
+  if (retain >= 0 && handles_.capacity() > retain) {
+    handles_.reserve(options_->initial_handles);
+    pools_[store_tag_] = handles_.base();
+  }
+  free_handle_ = nullptr;
+  num_dead_handles_ = 0;
+
+  // Allocate new empty symbol table.
+  num_symbols_ = 0;
+  num_buckets_ = 1;
+  symbols_ = AllocateArray(num_buckets_);
+  roots_.handle_ = symbols_;
+
+  // Reset statistics.
+  gc_pending_ = false;
+  num_gcs_ = 0;
+  gc_time_ = 0;
+}
+
+StorePool::~StorePool() {
+  for (Store *store : free_) delete store;
+}
+
+Store *StorePool::Acquire() {
+  {
+    std::lock_guard<std::mutex> lock(mu_);
+    if (!free_.empty()) {
+      Store *store = free_.back();
+      free_.pop_back();
+      return store;
+    }
+  }
+  return new Store(globals_);
+}
+
+void StorePool::Release(Store *store) {
+  store->Reset(retain_);
+  std::lock_guard<std::mutex> lock(mu_);
+  free_.push_back(store);
+}
+
 void Store::Freeze() {
   // Just return if store is already frozen.
   if (frozen_) return;
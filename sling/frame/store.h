@@ -18,8 +18,10 @@
 #include <stdlib.h>
 #include <atomic>
 #include <functional>
+#include <mutex>
 #include <string>
 #include <utility>
+#include <vector>
 
 #include "sling/base/bitcast.h"
 #include "sling/base/logging.h"
@@ -988,7 +990,10 @@ struct MemoryUsage {
 // leaving a contiguous area at the end of the heap for allocating new objects.
 class Heap : public Space<Datum> {
  public:
-  Heap() : next_(nullptr), frozen_(false) {}
+  Heap() : next_(nullptr), frozen_(false), mapped_(false) {}
+
+  // Mapped heaps do not own their memory.
+  ~Heap() { if (mapped_) base_ = end_ = limit_ = nullptr; }
 
   // Next heap in store.
   Heap *next() const { return next_; }
@@ -998,6 +1003,18 @@ class Heap : public Space<Datum> {
   bool frozen() const { return frozen_; }
   void set_frozen(bool frozen) { frozen_ = frozen; }
 
+  // Use external memory region, e.g. a memory-mapped snapshot, for the heap.
+  // The heap is full and frozen, and the memory is not owned by the heap.
+  void Map(Address base, size_t size) {
+    DCHECK(base_ == nullptr);
+    base_ = base;
+    end_ = limit_ = base + size;
+    frozen_ = mapped_ = true;
+  }
+
+  // Check if heap is memory-mapped.
+  bool mapped() const { return mapped_; }
+
  private:
   // Next heap for store. All the heaps for a store are linked together in a
   // linked list.
@@ -1006,6 +1023,9 @@ class Heap : public Space<Datum> {
   // A heap can be frozen making the objects in the heap read-only.
   bool frozen_;
 
+  // Memory-mapped heaps point into memory owned by the store.
+  bool mapped_;
+
   DISALLOW_COPY_AND_ASSIGN(Heap);
 };
 
@@ -1331,11 +1351,25 @@ class Store {
   // Performs garbage collection.
   void GC();
 
+  // Deletes all objects in a local store and rewinds it to its initial state.
+  // The heaps and the handle table are kept for reuse, so resetting a store is
+  // much cheaper than deleting it and allocating a new one. At most retain
+  // bytes of heap memory are kept, and the handle table is shrunk to its
+  // initial size if it is larger than that. A negative value keeps all the
+  // memory. There must be no live roots or external references to objects in
+  // the store.
+  void Reset(int64 retain = -1);
+
   // Checks if store is pristine, i.e. the store only contains the standard
   // frames. This can be used for checking if a snapshot can be used for
   // restoring the store without overwriting any existing content.
   bool Pristine() const;
 
+  // Size of pristine store. The standard objects have the same handles in all
+  // global stores.
+  static const int kPristineSymbols = 4;
+  static const int kPristineHandles = 10;
+
   // Resize symbol table.
   void ResizeSymbolTable();
 
@@ -1425,6 +1459,7 @@ class Store {
   // Replaces heap object for a handle with a new object.
   void Replace(Handle handle, Datum *object) {
     // Mark old object as invalid.
+    Unprotect();
     Deref(handle)->invalidate();
 
     // Update handle to point to new object.
@@ -1434,6 +1469,14 @@ class Store {
     object->self = handle;
   }
 
+  // Make the mapped heaps writable before modifying existing objects. The
+  // pages in the mapping are copied on write, so only modified pages use
+  // private memory.
+  void Unprotect() {
+    if (mapping_ != nullptr && !mapping_writable_) UnprotectMapping();
+  }
+  void UnprotectMapping();
+
   // Unbind frame by unbinding it from the symbol table.
   void Unbind(Handle handle);
 
@@ -1500,6 +1543,13 @@ class Store {
   Reference *free_handle_;
   Space<Reference> handles_;
 
+  // Memory mapping for snapshot with mapped heaps. This is released when the
+  // store is deleted. The mapping is read-only until objects in the mapped
+  // heaps are modified.
+  void *mapping_ = nullptr;
+  size_t mapped_size_ = 0;
+  bool mapping_writable_ = false;
+
   // Root and external lists are used for locking objects that are referenced
   // externally.
   Root roots_;
@@ -1557,6 +1607,65 @@ class GCLock {
   Store *store_;
 };
 
+// Pool of local stores for a global store. Local stores are reset and returned
+// to the pool after use instead of being deleted, so the memory for the heaps
+// and handle tables is reused, e.g. for processing a stream of messages. Memory
+// beyond the retained size for each store is released when the store is
+// returned, so a store that has grown for an unusually large message does not
+// keep the memory. The pool can be used from multiple threads concurrently.
+class StorePool {
+ public:
+  // Initializes pool of local stores for global store.
+  explicit StorePool(const Store *globals, int64 retain = kDefaultRetain)
+      : globals_(globals), retain_(retain) {}
+
+  // Deletes all the stores in the pool.
+  ~StorePool();
+
+  // Gets empty local store from the pool or allocates a new one.
+  Store *Acquire();
+
+  // Resets local store and returns it to the pool.
+  void Release(Store *store);
+
+  // Default number of bytes of heap memory retained for each store (16 MB).
+  static const int64 kDefaultRetain = 16 << 20;
+
+ private:
+  // Global store for local stores.
+  const Store *globals_;
+
+  // Maximum heap size retained for each pooled store.
+  int64 retain_;
+
+  // Local stores available for reuse.
+  std::vector<Store *> free_;
+
+  // Mutex for serializing access to pool.
+  std::mutex mu_;
+
+  DISALLOW_COPY_AND_ASSIGN(StorePool);
+};
+
+// Local store from a store pool, which is returned to the pool when it goes out
+// of scope. Objects referencing the store must be destructed before, i.e. they
+// must be declared after the pooled store.
+class PooledStore {
+ public:
+  explicit PooledStore(StorePool *pool)
+      : pool_(pool), store_(pool->Acquire()) {}
+  ~PooledStore() { pool_->Release(store_); }
+
+  // Returns local store.
+  Store *store() const { return store_; }
+
+ private:
+  StorePool *pool_;
+  Store *store_;
+
+  DISALLOW_COPY_AND_ASSIGN(PooledStore);
+};
+
 // Adds root to store.
 inline Root::Root(Store *store, Handle handle) {
   handle_ = handle;
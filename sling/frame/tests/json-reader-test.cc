@@ -0,0 +1,190 @@
+// Copyright 2025 Ringgaard Research ApS
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include "sling/base/flags.h"
+#include "sling/base/init.h"
+#include "sling/base/logging.h"
+#include "sling/frame/json-reader.h"
+#include "sling/frame/object.h"
+#include "sling/frame/reader.h"
+#include "sling/frame/serialization.h"
+#include "sling/frame/store.h"
+#include "sling/stream/input.h"
+#include "sling/stream/memory.h"
+#include "sling/string/strcat.h"
+
+DEFINE_int32(documents, 2000, "Number of random documents");
+
+using namespace sling;
+
+// Parse JSON with both the JSON reader and the standard reader and check that
+// the results are the same.
+static void Compare(Store *store, const string &json) {
+  JSONReader fast(store);
+  Object actual = fast.Read(json);
+
+  ArrayInputStream stream(json.data(), json.size());
+  Input input(&stream);
+  Reader reader(store, &input);
+  reader.set_json(true);
+  Object expected = reader.Read();
+  CHECK(!reader.error()) << reader.GetErrorMessage("json") << "\n" << json;
+
+  CHECK(store->Equal(expected.handle(), actual.handle()))
+      << "JSON: " << json << "\n"
+      << "expected: " << ToText(expected) << "\n"
+      << "actual: " << ToText(actual);
+}
+
+// Documents covering the syntax handled by the fast path.
+static const char *kFastCases[] = {
+  "{}",
+  "[]",
+  "{\"a\": 1}",
+  "[1, 2, 3]",
+  " \n\t{ \"a\" :\n 1 , \"b\":[ ] ,\"c\" : { } }\n ",
+  "{\"a\": [1, [2, [3, [4]]]], \"b\": {\"c\": {\"d\": {}}}}",
+  "{\"a\": true, \"b\": false, \"c\": null}",
+  "{\"a\": \"{[:,]}\", \"b\": \"a \\\"quoted\\\" string\"}",
+
+  // Escapes.
+  "{\"s\": \"line\\nbreak\\ttab\\rcr\\bbs\\fff\"}",
+  "{\"s\": \"back\\\\slash \\/ slash\"}",
+  "{\"s\": \"\\u00e6\\u00f8\\u00e5 \\u20ac \\u0041\"}",
+  "{\"s\": \"\\\\\", \"t\": \"\\\\\\\"\"}",
+  "{\"\\u0069d\": \"escaped key\"}",
+
+  // The id key is renamed to _id.
+  "{\"id\": \"Q42\", \"labels\": {\"en\": {\"id\": \"x\"}}}",
+  "[{\"id\": 1}, {\"id\": 2, \"_id\": 3}]",
+
+  // Numbers.
+  "[0, -0, 1, -1, 42, 3.5, -2.25, 1e3, 1E-3, 2.5e+2, 0.1]",
+  "[268435455, -268435456, 268435456, -268435457]",
+  "[536870911, -536870912, 536870912, 2147483648, -2147483649]",
+  "[9223372036854775807, -9223372036854775808, 12345678901234567890]",
+  "{\"amount\": \"+10\", \"unit\": \"1\", \"big\": 100000000000000000000}",
+};
+
+// Documents that are parsed by the standard reader as a fallback.
+static const char *kFallbackCases[] = {
+  // Qualified strings.
+  "{\"label\": \"hello\"@/lang/en}",
+  "[\"a\"@/lang/da, \"b\"]",
+
+  // Trailing comma.
+  "{\"a\": 1, \"b\": [1, 2,],}",
+
+  // Symbols and SLING literals.
+  "{\"a\": /lang/en, \"b\": nil}",
+
+  // Hex number.
+  "[0x1f, 1]",
+
+  // Top-level scalar.
+  "\"string\"",
+  "42",
+};
+
+// Random string with characters that need escaping.
+static string RandomString(std::mt19937 *prng, bool escapes) {
+  static const char *kPieces[] = {
+    "a", "b", "Q", "1", " ", "{", "}", "[", "]", ":", ",", "@", "/",
+    "\\\"", "\\\\", "\\n", "\\t", "\\u00e9", "\\u4e2d", "\\/",
+    "\xc3\xa6", "\xe2\x82\xac",
+  };
+  int limit = escapes ? sizeof(kPieces) / sizeof(kPieces[0]) : 13;
+  std::uniform_int_distribution<int> pieces(0, limit - 1);
+  std::uniform_int_distribution<int> length(0, 40);
+  string str = "\"";
+  int n = length(*prng);
+  for (int i = 0; i < n; ++i) str.append(kPieces[pieces(*prng)]);
+  str.push_back('"');
+  return str;
+}
+
+// Random value with nested objects and arrays.
+static string RandomValue(std::mt19937 *prng, int depth) {
+  std::uniform_int_distribution<int> kind(0, depth > 3 ? 4 : 6);
+  std::uniform_int_distribution<int> size(0, 6);
+  std::uniform_int_distribution<int64> number(-(1LL << 40), 1LL << 40);
+  std::uniform_int_distribution<int> small(-1000, 1000);
+  switch (kind(*prng)) {
+    case 0: return RandomString(prng, true);
+    case 1: return RandomString(prng, false);
+    case 2: return std::to_string(small(*prng));
+    case 3: return std::to_string(number(*prng));
+    case 4: return StrCat(small(*prng), ".", std::abs(small(*prng)));
+    case 5: {
+      string str = "[";
+      int n = size(*prng);
+      for (int i = 0; i < n; ++i) {
+        if (i > 0) str.append(i % 2 ? "," : ",\n  ");
+        str.append(RandomValue(prng, depth + 1));
+      }
+      str.append("]");
+      return str;
+    }
+    default: {
+      static const char *kKeys[] = {
+        "\"id\"", "\"type\"", "\"labels\"", "\"value\"", "\"en\"",
+        "\"mainsnak\"", "\"datavalue\"", "\"P31\"", "\"a\\nb\"",
+      };
+      std::uniform_int_distribution<int> keys(0, 8);
+      string str = "{";
+      int n = size(*prng);
+      for (int i = 0; i < n; ++i) {
+        if (i > 0) str.append(", ");
+        str.append(kKeys[keys(*prng)]);
+        str.append(i % 3 ? ":" : " : ");
+        str.append(RandomValue(prng, depth + 1));
+      }
+      str.append("}");
+      return str;
+    }
+  }
+}
+
+int main(int argc, char *argv[]) {
+  InitProgram(&argc, &argv);
+  Store store;
+
+  // Fixed test cases.
+  for (const char *json : kFastCases) Compare(&store, json);
+  for (const char *json : kFallbackCases) Compare(&store, json);
+
+  // Escapes and quotes at the boundaries of 64-byte blocks.
+  for (int pad = 0; pad < 130; ++pad) {
+    string filler(pad, 'x');
+    Compare(&store, "{\"s\": \"" + filler + "\\\"\", \"t\": [1]}");
+    Compare(&store, "{\"s\": \"" + filler + "\\\\\", \"t\": [1]}");
+    Compare(&store, "{\"s\": \"" + filler + "\\\\\\\"\", \"t\": 2}");
+    Compare(&store, "{\"" + filler + "\": \"{,}\", \"id\": 3}");
+  }
+
+  // Random documents.
+  std::mt19937 prng(27182);
+  for (int i = 0; i < FLAGS_documents; ++i) {
+    string json = RandomValue(&prng, 0);
+    if (json[0] != '{' && json[0] != '[') json = "[" + json + "]";
+    Compare(&store, json);
+  }
+
+  LOG(INFO) << "JSON reader test passed";
+  return 0;
+}
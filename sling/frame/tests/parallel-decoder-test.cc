@@ -0,0 +1,196 @@
+// Copyright 2025 Ringgaard Research ApS
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <string>
+#include <vector>
+
+#include "sling/base/flags.h"
+#include "sling/base/init.h"
+#include "sling/base/logging.h"
+#include "sling/file/file.h"
+#include "sling/frame/decoder.h"
+#include "sling/frame/encoder.h"
+#include "sling/frame/object.h"
+#include "sling/frame/parallel-decoder.h"
+#include "sling/frame/serialization.h"
+#include "sling/frame/store.h"
+#include "sling/stream/file.h"
+#include "sling/string/strcat.h"
+
+DEFINE_int32(frames, 20000, "Number of frames in test store");
+DEFINE_int32(threads, 4, "Number of decoder threads");
+
+using namespace sling;
+
+// Build store with frames that have strings, numbers, arrays, anonymous
+// sub-frames, and references to other frames. The references to the next
+// frame are forward references across segments, and the references to the
+// X frames are never defined, so these are proxies. All the frames share an
+// anonymous frame.
+static void BuildStore(Store *store) {
+  Handle en = store->Lookup("/lang/en");
+  Builder common(store);
+  common.Add("name", "shared");
+  Handle shared = common.Create().handle();
+  for (int i = 0; i < FLAGS_frames; ++i) {
+    Builder sub(store);
+    sub.Add("value", i);
+
+    std::vector<Handle> elements = {
+      Handle::Integer(i),
+      store->Lookup(StrCat("Q", (i + 7) % FLAGS_frames)),
+    };
+    Array list(store, elements);
+
+    Builder b(store);
+    b.AddId(StrCat("Q", i));
+    b.Add("name", StrCat("item ", i));
+    b.Add("label", StrCat("label ", i), en);
+    b.Add("count", i);
+    b.Add("weight", i * 0.5f);
+    b.Add("next", store->Lookup(StrCat("Q", (i + 1) % FLAGS_frames)));
+    b.Add("ref", store->Lookup(StrCat("X", i % 10)));
+    b.Add("list", list);
+    b.Add("sub", sub.Create());
+    b.Add("shared", shared);
+    b.Create();
+  }
+}
+
+// Write all frames in store to file.
+static void WriteStore(const Store *store, const string &filename,
+                       int segment_size) {
+  FileOutputStream stream(filename);
+  Output output(&stream);
+  Encoder encoder(store, &output);
+  encoder.set_shallow(true);
+  encoder.set_segment_size(segment_size);
+  encoder.EncodeAll();
+  output.Flush();
+  CHECK(stream.Close());
+}
+
+// Add frame for one of the X frames before decoding.
+static void AddExisting(Store *store) {
+  Builder b(store);
+  b.AddId("X3");
+  b.Add("name", "existing");
+  b.Create();
+}
+
+// Decode file with the sequential decoder.
+static void DecodeSequential(Store *store, const string &filename) {
+  FileInputStream stream(filename);
+  Input input(&stream);
+  Decoder decoder(store, &input);
+  decoder.DecodeAll();
+}
+
+// Check that frames are the same in both stores.
+static void Compare(Store *expected, Store *actual) {
+  for (int i = 0; i < FLAGS_frames; ++i) {
+    string id = StrCat("Q", i);
+    Frame e(expected, id);
+    Frame a(actual, id);
+    CHECK(e.valid()) << id;
+    CHECK(a.valid()) << id;
+    CHECK(!a.IsProxy()) << id;
+    CHECK_EQ(ToText(e), ToText(a)) << id;
+
+    // References must point to the frames in the target store.
+    string next = StrCat("Q", (i + 1) % FLAGS_frames);
+    string ref = StrCat("X", i % 10);
+    CHECK(a.GetHandle("next") == actual->Lookup(next)) << id;
+    CHECK(a.GetHandle("ref") == actual->Lookup(ref)) << id;
+  }
+
+  // The shared anonymous frame must have the same contents everywhere.
+  Handle shared = actual->Lookup("shared");
+  for (int i = 0; i < FLAGS_frames; ++i) {
+    Frame a(actual, StrCat("Q", i));
+    CHECK_EQ(a.GetFrame(shared).GetString("name"), "shared");
+  }
+
+  // The existing frame must not be replaced by a proxy.
+  Frame x3(actual, "X3");
+  CHECK(!x3.IsProxy());
+  CHECK_EQ(x3.GetString("name"), "existing");
+}
+
+// Return number of distinct copies of the shared anonymous frame.
+static int SharedCopies(Store *store) {
+  Handle shared = store->Lookup("shared");
+  HandleSet copies;
+  for (int i = 0; i < FLAGS_frames; ++i) {
+    copies.insert(Frame(store, StrCat("Q", i)).GetHandle(shared));
+  }
+  return copies.size();
+}
+
+int main(int argc, char *argv[]) {
+  InitProgram(&argc, &argv);
+
+  string dir;
+  CHECK(File::CreateTempDir(&dir));
+  string plain = dir + "/plain.sling";
+  string segmented = dir + "/segmented.sling";
+
+  {
+    Store store;
+    BuildStore(&store);
+    WriteStore(&store, plain, 0);
+    WriteStore(&store, segmented, 4096);
+  }
+  CHECK(!ParallelDecoder::Segmented(plain));
+  CHECK(ParallelDecoder::Segmented(segmented));
+
+  // Decode plain file with the sequential decoder as the reference.
+  Store expected;
+  AddExisting(&expected);
+  DecodeSequential(&expected, plain);
+
+  // The sequential decoder must still be able to read segmented files.
+  Store sequential;
+  AddExisting(&sequential);
+  DecodeSequential(&sequential, segmented);
+  Compare(&expected, &sequential);
+
+  // Decode segmented file with the parallel decoder.
+  Store parallel;
+  AddExisting(&parallel);
+  ParallelDecoder decoder(&parallel, FLAGS_threads);
+  CHECK(decoder.DecodeFile(segmented));
+  Compare(&expected, &parallel);
+
+  // Anonymous frames shared between frames keep their identity within a
+  // segment, but each segment decodes its own copy.
+  CHECK_EQ(SharedCopies(&expected), 1);
+  int copies = SharedCopies(&parallel);
+  CHECK_GT(copies, 1);
+  CHECK_EQ(SharedCopies(&sequential), copies);
+  CHECK_LT(copies, FLAGS_frames / 10);
+
+  // Load segmented file into a pristine store.
+  Store loaded;
+  LoadStore(segmented, &loaded);
+  CHECK(Frame(&loaded, "X3").IsProxy());
+  CHECK_EQ(ToText(Frame(&expected, "Q42")), ToText(Frame(&loaded, "Q42")));
+
+  File::Delete(plain);
+  File::Delete(segmented);
+  File::Rmdir(dir);
+
+  LOG(INFO) << "Parallel decoder test passed";
+  return 0;
+}
@@ -0,0 +1,172 @@
+// Copyright 2025 Ringgaard Research ApS
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <stdio.h>
+#include <utime.h>
+#include <string>
+
+#include "sling/base/flags.h"
+#include "sling/base/init.h"
+#include "sling/base/logging.h"
+#include "sling/file/file.h"
+#include "sling/frame/object.h"
+#include "sling/frame/serialization.h"
+#include "sling/frame/snapshot.h"
+#include "sling/frame/store.h"
+#include "sling/string/strcat.h"
+
+DEFINE_int32(frames, 20000, "Number of frames in test store");
+
+using namespace sling;
+
+// Build store with frames that have strings, numbers, and references to other
+// frames. The references to the X frames are never defined, so these are
+// proxies.
+static void BuildStore(Store *store) {
+  for (int i = 0; i < FLAGS_frames; ++i) {
+    Builder b(store);
+    b.AddId(StrCat("Q", i));
+    b.Add("name", StrCat("item ", i));
+    b.Add("count", i);
+    b.Add("next", store->Lookup(StrCat("Q", (i + 1) % FLAGS_frames)));
+    b.Add("ref", store->Lookup(StrCat("X", i % 10)));
+    b.Create();
+  }
+}
+
+// Check frames in store.
+static void CheckStore(Store *store) {
+  for (int i = 0; i < FLAGS_frames; ++i) {
+    Frame f(store, StrCat("Q", i));
+    CHECK(f.valid()) << i;
+    CHECK_EQ(f.GetString("name"), StrCat("item ", i));
+    CHECK_EQ(f.GetInt("count"), i);
+    CHECK_EQ(f.GetFrame("next").Id(), StrCat("Q", (i + 1) % FLAGS_frames));
+    CHECK(f.GetFrame("ref").IsProxy());
+  }
+}
+
+// Return the access permissions for the memory mapping with the address.
+static string MappingPermissions(const void *address) {
+  uint64 addr = reinterpret_cast<uint64>(address);
+  FILE *maps = fopen("/proc/self/maps", "r");
+  CHECK(maps != nullptr);
+  char line[1024];
+  string perms;
+  while (fgets(line, sizeof(line), maps) != nullptr) {
+    unsigned long long start, end;
+    char mode[8];
+    if (sscanf(line, "%llx-%llx %7s", &start, &end, mode) != 3) continue;
+    if (addr >= start && addr < end) {
+      perms = mode;
+      break;
+    }
+  }
+  fclose(maps);
+  return perms;
+}
+
+// Return access permissions for the memory holding a frame.
+static string FramePermissions(Store *store, const string &id) {
+  Handle handle = store->LookupExisting(id);
+  CHECK(!handle.IsNil());
+  return MappingPermissions(store->Deref(handle));
+}
+
+// Set snapshot version in header.
+static void SetVersion(const string &filename, int version) {
+  File *file;
+  CHECK(File::Open(Snapshot::Filename(filename), "r+", &file));
+  CHECK(file->Seek(sizeof(int)));
+  CHECK(file->Write(&version, sizeof(int)));
+  CHECK(file->Close());
+}
+
+int main(int argc, char *argv[]) {
+  InitProgram(&argc, &argv);
+
+  string dir;
+  CHECK(File::CreateTempDir(&dir));
+  string filename = dir + "/store.sling";
+
+  // Write store and snapshot. The store file must be older than the snapshot.
+  {
+    Store store;
+    BuildStore(&store);
+    store.AllocateSymbolHeap();
+    store.GC();
+    FileEncoder encoder(&store, filename);
+    encoder.EncodeAll();
+    CHECK(encoder.Close());
+    struct utimbuf past;
+    past.actime = past.modtime = time(nullptr) - 60;
+    CHECK_EQ(utime(filename.c_str(), &past), 0);
+    CHECK(Snapshot::Write(&store, filename));
+  }
+  CHECK(Snapshot::Valid(filename));
+
+  // Load store from snapshot. The frozen heaps are mapped read-only.
+  {
+    Store store;
+    LoadStore(filename, &store);
+    CheckStore(&store);
+    CHECK_EQ(FramePermissions(&store, "Q0"), "r--p");
+    CHECK_EQ(FramePermissions(&store, StrCat("Q", FLAGS_frames - 1)), "r--p");
+    LOG(INFO) << "Mapped snapshot is read-only";
+
+    // Add new frames to the store. This resizes the symbol table, which
+    // relinks symbols in the mapped heaps, so the mapping must be made
+    // writable.
+    for (int i = 0; i < FLAGS_frames; ++i) {
+      Builder b(&store);
+      b.AddId(StrCat("P", i));
+      b.Add("item", store.Lookup(StrCat("Q", i)));
+      b.Create();
+    }
+    CHECK_EQ(FramePermissions(&store, "Q0"), "rw-p");
+
+    // Modify mapped frames.
+    for (int i = 0; i < FLAGS_frames; i += 100) {
+      Frame f(&store, StrCat("Q", i));
+      f.Set("count", i);
+      f.Add("extra", true);
+    }
+    CheckStore(&store);
+    for (int i = 0; i < FLAGS_frames; ++i) {
+      Frame f(&store, StrCat("P", i));
+      CHECK_EQ(f.GetFrame("item").Id(), StrCat("Q", i));
+    }
+    LOG(INFO) << "Mapped snapshot is writable after modification";
+  }
+
+  // Snapshots with other versions are rejected, and the store is decoded
+  // from the store file instead.
+  SetVersion(filename, 5);
+  CHECK(!Snapshot::Valid(filename));
+  {
+    Store store;
+    CHECK(!Snapshot::Map(&store, filename).ok());
+    CHECK(store.Pristine());
+    LoadStore(filename, &store);
+    CheckStore(&store);
+  }
+  LOG(INFO) << "Snapshot version check passed";
+
+  File::Delete(Snapshot::Filename(filename));
+  File::Delete(filename);
+  File::Rmdir(dir);
+
+  LOG(INFO) << "Snapshot test passed";
+  return 0;
+}
@@ -0,0 +1,168 @@
+// Copyright 2025 Ringgaard Research ApS
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <string>
+#include <vector>
+
+#include "sling/base/flags.h"
+#include "sling/base/init.h"
+#include "sling/base/logging.h"
+#include "sling/frame/object.h"
+#include "sling/frame/serialization.h"
+#include "sling/frame/store.h"
+#include "sling/string/strcat.h"
+#include "sling/util/thread.h"
+
+DEFINE_int32(threads, 4, "Number of threads using the pool");
+DEFINE_int32(messages, 200, "Number of messages per thread");
+
+using namespace sling;
+
+// Build frames in local store and check their contents.
+static void BuildFrames(Store *store, int n, const string &prefix) {
+  Handle name = store->Lookup("name");
+  for (int i = 0; i < n; ++i) {
+    Builder b(store);
+    b.AddId(StrCat(prefix, i));
+    b.Add(name, StrCat("item ", i));
+    b.Add("count", i);
+    b.Add("parent", store->Lookup(StrCat(prefix, i / 2)));
+    b.Create();
+  }
+  for (int i = 0; i < n; ++i) {
+    Frame f(store, StrCat(prefix, i));
+    CHECK(f.valid());
+    CHECK_EQ(f.GetString("name"), StrCat("item ", i));
+    CHECK_EQ(f.GetInt("count"), i);
+  }
+}
+
+// Return the total memory allocated by store.
+static int64 Allocated(Store *store) {
+  MemoryUsage usage;
+  store->GetMemoryUsage(&usage, true);
+  return usage.memory_allocated();
+}
+
+// Check that a store is empty after it has been reset.
+static void CheckEmpty(Store *store, const string &prefix) {
+  MemoryUsage usage;
+  store->GetMemoryUsage(&usage);
+  CHECK_EQ(usage.num_symbols(), 0);
+  CHECK_LT(usage.used_heap_bytes(), 1024);
+  CHECK_LE(usage.used_handles(), 1);
+  CHECK(store->Lookup(prefix + "0").IsLocalRef());
+  CHECK(Frame(store, prefix + "0").IsProxy());
+}
+
+// Reuse store from pool and check that it is rewound.
+static void TestReuse(const Store *commons) {
+  StorePool pool(commons);
+  Store *store = pool.Acquire();
+  BuildFrames(store, 1000, "Q");
+  store->GC();
+  BuildFrames(store, 1000, "P");
+  pool.Release(store);
+
+  Store *reused = pool.Acquire();
+  CHECK(reused == store);
+  CheckEmpty(reused, "Q");
+  BuildFrames(reused, 1000, "Q");
+  pool.Release(reused);
+
+  // A new store is allocated when the pool is empty.
+  Store *first = pool.Acquire();
+  Store *second = pool.Acquire();
+  CHECK(first != second);
+  pool.Release(first);
+  pool.Release(second);
+  LOG(INFO) << "Store reuse test passed";
+}
+
+// Check that the memory for a store that has grown for a large message is
+// released when the store is returned to the pool.
+static void TestTrim(const Store *commons) {
+  const int64 retain = 1 << 20;
+  StorePool pool(commons, retain);
+  Store *store = pool.Acquire();
+  int64 initial = Allocated(store);
+
+  // Build large message.
+  BuildFrames(store, 200000, "Q");
+  int64 grown = Allocated(store);
+  CHECK_GT(grown, 4 * retain);
+  pool.Release(store);
+
+  // Memory beyond the retained size must be released.
+  store = pool.Acquire();
+  int64 trimmed = Allocated(store);
+  LOG(INFO) << "Store memory initial " << initial << ", grown " << grown
+            << ", trimmed " << trimmed;
+  CHECK_LE(trimmed, retain + initial);
+  CheckEmpty(store, "Q");
+
+  // Store must still be usable after it has been trimmed.
+  BuildFrames(store, 10000, "Q");
+  pool.Release(store);
+
+  // Without a retain limit, all memory is kept.
+  StorePool unbounded(commons, -1);
+  store = unbounded.Acquire();
+  BuildFrames(store, 200000, "Q");
+  grown = Allocated(store);
+  unbounded.Release(store);
+  store = unbounded.Acquire();
+  CHECK_EQ(Allocated(store), grown);
+  unbounded.Release(store);
+  LOG(INFO) << "Store trim test passed";
+}
+
+// Use pool from multiple threads.
+static void TestThreads(const Store *commons) {
+  StorePool pool(commons);
+  std::vector<ClosureThread *> threads;
+  for (int t = 0; t < FLAGS_threads; ++t) {
+    threads.push_back(new ClosureThread([&pool, t]() {
+      for (int m = 0; m < FLAGS_messages; ++m) {
+        PooledStore local(&pool);
+        CheckEmpty(local.store(), "Q");
+        BuildFrames(local.store(), 100 + (m * 37 + t) % 500, "Q");
+      }
+    }));
+  }
+  for (ClosureThread *thread : threads) thread->SetJoinable(true);
+  for (ClosureThread *thread : threads) thread->Start();
+  for (ClosureThread *thread : threads) {
+    thread->Join();
+    delete thread;
+  }
+  LOG(INFO) << "Store pool thread test passed";
+}
+
+int main(int argc, char *argv[]) {
+  InitProgram(&argc, &argv);
+
+  Store commons;
+  commons.Lookup("name");
+  commons.Lookup("count");
+  commons.Lookup("parent");
+  commons.Freeze();
+
+  TestReuse(&commons);
+  TestTrim(&commons);
+  TestThreads(&commons);
+
+  LOG(INFO) << "Store pool test passed";
+  return 0;
+}
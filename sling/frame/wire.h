@@ -40,8 +40,14 @@ enum WireSpecial {
   WIRE_RESOLVE  = 7,  // resolve link, followed by slots and replacement index
   WIRE_QSTRING  = 8,  // qstring, followed by length, data, and qualifier
   WIRE_NAME     = 9,  // "name" value
+  WIRE_SEGMENT  = 10, // segment, followed by segment size in bytes
 };
 
+// Segmented encodings consist of a sequence of segments, each prefixed with a
+// WIRE_SEGMENT tag and the size of the segment. The reference numbers are
+// reset at the start of each segment, so segments can be decoded
+// independently of each other.
+
 // The binary marker (i.e. a nul character) is used for prefixing serialized
 // SLING objects to indicate that they are binary encoded. The textual encoding
 // will never contain a nul character. In binary encoding, a nul character is
@@ -0,0 +1,320 @@
+// Copyright 2025 Ringgaard Research ApS
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "sling/myelin/autotuner.h"
+
+#include <stdio.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include "sling/base/clock.h"
+#include "sling/base/logging.h"
+#include "sling/file/file.h"
+#include "sling/myelin/builder.h"
+#include "sling/string/printf.h"
+#include "third_party/jit/cpu.h"
+
+namespace sling {
+namespace myelin {
+
+// Tuning database format version. Version 2 changed the format of the CPU
+// features in the signature.
+static const int kVersion = 2;
+
+// Candidate unroll factors, where 0 is the default, i.e. the maximum number of
+// unrolls supported by the SIMD strategy.
+static const int kUnrolls[] = {0, 1, 2};
+
+// Minimum relative speedup for selecting a non-default configuration.
+static const double kMinGain = 1.02;
+
+// Minimum measurement time in milliseconds.
+static const double kMinTime = 1.0;
+
+// Number of repeated measurements.
+static const int kTrials = 5;
+
+// Return name of configuration.
+static string ConfigName(const AutoTuner::Config &config) {
+  string name = config.unroll > 0 ? StringPrintf("U%d", config.unroll) : "";
+  if (!config.loop_order.empty()) {
+    if (!name.empty()) name.push_back('/');
+    name.append(config.loop_order);
+  }
+  return name.empty() ? "default" : name;
+}
+
+// Measure time in microseconds for computing cell instance.
+static double Measure(Instance *data) {
+  // Warm up.
+  for (int i = 0; i < 10; ++i) data->Compute();
+
+  // Determine the number of iterations needed for a reliable measurement.
+  Clock clock;
+  int64 iterations = 1;
+  for (;;) {
+    clock.start();
+    for (int64 i = 0; i < iterations; ++i) data->Compute();
+    clock.stop();
+    if (clock.ms() >= kMinTime || iterations >= (1 << 20)) break;
+    iterations *= 2;
+  }
+
+  // Return the best of repeated measurements.
+  double best = clock.us() / iterations;
+  for (int trial = 0; trial < kTrials; ++trial) {
+    clock.start();
+    for (int64 i = 0; i < iterations; ++i) data->Compute();
+    clock.stop();
+    best = std::min(best, clock.us() / iterations);
+  }
+  return best;
+}
+
+bool AutoTuner::Load(const string &filename) {
+  string contents;
+  if (!File::ReadContents(filename, &contents).ok()) return false;
+
+  // Each line has signature, unroll, loop order, baseline and best time. The
+  // first line has the format version. Entries from older versions are
+  // ignored since the signatures are not compatible.
+  int version = 1;
+  int pos = 0;
+  while (pos < contents.size()) {
+    int end = contents.find('\n', pos);
+    if (end == string::npos) end = contents.size();
+    string line = contents.substr(pos, end - pos);
+    pos = end + 1;
+    if (sscanf(line.c_str(), "# tuning database version %d", &version) == 1) {
+      continue;
+    }
+    if (line.empty() || line[0] == '#') continue;
+    if (version != kVersion) {
+      LOG(WARNING) << "Ignoring tuning database " << filename
+                   << " with version " << version;
+      return false;
+    }
+
+    char signature[256];
+    char order[32];
+    Result result;
+    if (sscanf(line.c_str(), "%255s %d %31s %lf %lf",
+               signature, &result.config.unroll, order,
+               &result.baseline, &result.best) != 5) {
+      LOG(WARNING) << "Invalid tuning database entry: " << line;
+      continue;
+    }
+    if (strcmp(order, "-") != 0) result.config.loop_order = order;
+    db_[signature] = result;
+  }
+
+  return true;
+}
+
+bool AutoTuner::Save(const string &filename) const {
+  // Output entries in sorted order.
+  std::vector<string> signatures;
+  for (auto &it : db_) signatures.push_back(it.first);
+  std::sort(signatures.begin(), signatures.end());
+
+  string contents = StringPrintf("# tuning database version %d\n", kVersion);
+  contents.append("# signature unroll loop_order baseline_us best_us\n");
+  for (const string &signature : signatures) {
+    const Result &result = db_.at(signature);
+    const string &order = result.config.loop_order;
+    StringAppendF(&contents, "%s %d %s %.4f %.4f\n",
+                  signature.c_str(),
+                  result.config.unroll,
+                  order.empty() ? "-" : order.c_str(),
+                  result.baseline,
+                  result.best);
+  }
+
+  return File::WriteContents(filename, contents).ok();
+}
+
+int AutoTuner::Tune(Flow *flow, bool benchmark) {
+  int tuned = 0;
+  for (Flow::Operation *op : flow->ops()) {
+    // Look up op in tuning database.
+    string signature = Signature(op);
+    if (signature.empty()) continue;
+    auto f = db_.find(signature);
+    if (f == db_.end()) {
+      if (!benchmark) continue;
+
+      // Benchmark candidate configurations.
+      Result result = Search(op);
+      if (result.baseline < 0) continue;
+      f = db_.emplace(signature, result).first;
+      LOG(INFO) << "Tuned " << op->name << " " << signature << ": "
+                << ConfigName(result.config) << ", "
+                << result.baseline << " us -> " << result.best << " us";
+    }
+
+    // Set tuning parameters for op.
+    const Result &result = f->second;
+    if (result.config.unroll > 0) {
+      op->SetAttr("unroll", result.config.unroll);
+    }
+    if (!result.config.loop_order.empty()) {
+      op->SetAttr("loop_order", result.config.loop_order);
+    }
+    if (result.best > 0 && result.best < result.baseline) {
+      op->SetAttr("tuned", StringPrintf("%s %.2fx",
+                                        ConfigName(result.config).c_str(),
+                                        result.baseline / result.best));
+    }
+    tuned++;
+  }
+
+  return tuned;
+}
+
+string AutoTuner::Signature(const Flow::Operation *op) {
+  // Only plain matrix multiplications on fully specified shapes are tuned.
+  if (op->type != "MatMul") return "";
+  if (op->indegree() != 2 || op->outdegree() != 1) return "";
+  Flow::Variable *a = op->inputs[0];
+  Flow::Variable *b = op->inputs[1];
+  Flow::Variable *c = op->outputs[0];
+  Type type = c->type;
+  if (type != DT_FLOAT && type != DT_DOUBLE) return "";
+  if (a->type != type || b->type != type) return "";
+  for (auto *var : {a, b, c}) {
+    if (var->rank() < 2 || !var->shape.defined()) return "";
+  }
+
+  // The signature covers the operation, the argument layout and the CPU.
+  auto order = [](const Flow::Variable *var) {
+    if (var->is(Flow::Variable::ROW)) return "r";
+    if (var->is(Flow::Variable::COL)) return "c";
+    return "";
+  };
+  return StringPrintf("%s:%s:%s%s%s:%s%s%s%s:%s%s:%d%d%d:%08x",
+                      op->type.c_str(),
+                      TypeTraits::of(type).name().c_str(),
+                      a->shape.ToString().c_str(), order(a),
+                      a->constant() ? "k" : "",
+                      b->shape.ToString().c_str(), order(b),
+                      b->constant() ? "k" : "",
+                      b->learnable() ? "l" : "",
+                      c->shape.ToString().c_str(), order(c),
+                      op->GetAttr("transpose_a", false),
+                      op->GetAttr("transpose_b", false),
+                      op->GetAttr("transpose_c", false),
+                      jit::CPU::SupportedFeatures());
+}
+
+double AutoTuner::Benchmark(const Flow::Operation *op,
+                            const Config &config) const {
+  // Build flow with the matmul op in isolation.
+  Flow flow;
+  FlowBuilder f(&flow, "tune");
+  std::vector<Flow::Variable *> args;
+  for (int i = 0; i < op->indegree(); ++i) {
+    Flow::Variable *input = op->inputs[i];
+    string name = i == 0 ? "a" : "b";
+    Flow::Variable *arg;
+    if (input->constant()) {
+      arg = f.Const(input->data, input->type, input->shape);
+    } else if (input->learnable()) {
+      arg = f.Parameter(name, input->type, input->shape);
+    } else {
+      arg = f.Placeholder(name, input->type, input->shape);
+    }
+    arg->flags |= input->flags & (Flow::Variable::ROW | Flow::Variable::COL);
+    args.push_back(arg);
+  }
+  Flow::Variable *output = op->outputs[0];
+  auto *c = f.Op(op->type, args, output->type, output->shape);
+  c->flags |= output->flags & (Flow::Variable::ROW | Flow::Variable::COL);
+  f.Name(c, "c")->set_out();
+
+  // Set tuning parameters.
+  Flow::Operation *matmul = c->producer;
+  matmul->CopyAttrsFrom(*op);
+  matmul->RemoveAttr("unroll");
+  matmul->RemoveAttr("loop_order");
+  matmul->RemoveAttr("tuned");
+  if (config.unroll > 0) matmul->SetAttr("unroll", config.unroll);
+  if (!config.loop_order.empty()) {
+    matmul->SetAttr("loop_order", config.loop_order);
+  }
+
+  // Compile flow.
+  flow.Analyze(*library_);
+  Network network;
+  if (!network.Compile(flow, *library_)) return -1;
+
+  // Check that the op is computed by the SIMD matmul kernel.
+  Cell *cell = network.GetCell("tune");
+  bool simd = false;
+  for (const Step *step : cell->steps()) {
+    if (step->type() == "MatMul" && step->kernel()->Name() == "SIMDMatMul") {
+      simd = true;
+    }
+  }
+  if (!simd) return -1;
+
+  // Measure computation time.
+  Instance data(cell);
+  return Measure(&data);
+}
+
+AutoTuner::Result AutoTuner::Search(const Flow::Operation *op) const {
+  // Benchmark default configuration.
+  Result result;
+  result.baseline = Benchmark(op, result.config);
+  result.best = result.baseline;
+  if (result.baseline < 0) return result;
+
+  // Loop order can only be selected for constant weight matrices.
+  std::vector<string> orders;
+  if (op->inputs[1]->constant()) {
+    orders = {"vertical", "horizontal"};
+  } else {
+    orders = {""};
+  }
+
+  // Benchmark candidate configurations.
+  Config best;
+  double best_time = result.baseline;
+  for (int unroll : kUnrolls) {
+    for (const string &order : orders) {
+      Config config;
+      config.unroll = unroll;
+      config.loop_order = order;
+      if (config.unroll == 0 && config.loop_order.empty()) continue;
+      double time = Benchmark(op, config);
+      VLOG(3) << op->name << " " << ConfigName(config) << ": " << time << " us";
+      if (time >= 0 && time < best_time) {
+        best = config;
+        best_time = time;
+      }
+    }
+  }
+
+  // Only use a non-default configuration if it is significantly faster.
+  if (best_time * kMinGain < result.baseline) {
+    result.config = best;
+    result.best = best_time;
+  }
+
+  return result;
+}
+
+}  // namespace myelin
+}  // namespace sling
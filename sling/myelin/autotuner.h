@@ -0,0 +1,94 @@
+// Copyright 2025 Ringgaard Research ApS
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SLING_MYELIN_AUTOTUNER_H_
+#define SLING_MYELIN_AUTOTUNER_H_
+
+#include <string>
+#include <unordered_map>
+
+#include "sling/base/types.h"
+#include "sling/myelin/compute.h"
+#include "sling/myelin/flow.h"
+
+namespace sling {
+namespace myelin {
+
+// The autotuner selects code generation parameters for the SIMD matrix
+// multiplication kernel by benchmarking candidate configurations for each
+// MatMul op on the target CPU. The candidates vary the unroll factor, i.e. the
+// number of accumulator registers in the register block, and the loop order,
+// i.e. vertical or horizontal summation over a constant weight matrix. The
+// fastest configuration is recorded in a tuning database keyed by the matmul
+// signature and the CPU features, so later compilations can reuse it without
+// benchmarking.
+//
+// The selected configuration is stored in the unroll and loop_order
+// attributes of the op. The speedup over the default configuration is stored
+// in the tuned attribute, which is shown in the profile report.
+class AutoTuner {
+ public:
+  // Tuning parameters for matmul.
+  struct Config {
+    int unroll = 0;      // maximum number of unrolls (0 for default)
+    string loop_order;   // vertical or horizontal summation (empty for default)
+  };
+
+  // Tuning result.
+  struct Result {
+    Config config;       // fastest configuration
+    double baseline;     // time in microseconds for default configuration
+    double best;         // time in microseconds for fastest configuration
+  };
+
+  AutoTuner(const Library *library) : library_(library) {}
+
+  // Load tuning database. Returns false if the database could not be read.
+  bool Load(const string &filename);
+
+  // Save tuning database.
+  bool Save(const string &filename) const;
+
+  // Set tuning parameters for the MatMul ops in flow. If benchmark is true,
+  // ops not in the tuning database are benchmarked and added to the database.
+  // The flow must have been analyzed. Returns the number of tuned ops.
+  int Tune(Flow *flow, bool benchmark);
+
+  // Tuning database.
+  const std::unordered_map<string, Result> &results() const { return db_; }
+
+ private:
+  // Return signature for matmul op or an empty string if the op cannot be
+  // tuned.
+  static string Signature(const Flow::Operation *op);
+
+  // Benchmark matmul op in isolation with configuration. Returns time in
+  // microseconds per computation, or -1 if the op is not compiled with the
+  // SIMD matmul kernel.
+  double Benchmark(const Flow::Operation *op, const Config &config) const;
+
+  // Benchmark candidate configurations for op.
+  Result Search(const Flow::Operation *op) const;
+
+  // Library with kernels for benchmarking.
+  const Library *library_;
+
+  // Tuning results keyed by matmul signature.
+  std::unordered_map<string, Result> db_;
+};
+
+}  // namespace myelin
+}  // namespace sling
+
+#endif  // SLING_MYELIN_AUTOTUNER_H_
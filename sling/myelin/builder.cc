@@ -311,6 +311,21 @@ Flow::Variable *FlowBuilder::Reduce(const string &op, Variable *x,
   return reduce;
 }
 
+Flow::Variable *FlowBuilder::LayerNorm(Variable *x,
+                                       Variable *gamma, Variable *beta,
+                                       float epsilon) {
+  CHECK((gamma == nullptr) == (beta == nullptr))
+      << "LayerNorm needs both scale and bias";
+  Args args = {x};
+  if (gamma != nullptr) {
+    args.push_back(gamma);
+    args.push_back(beta);
+  }
+  auto *norm = Op("LayerNorm", args, x->type, x->shape);
+  norm->producer->SetAttr("epsilon", epsilon);
+  return norm;
+}
+
 Flow::Variable *FlowBuilder::FNN(Variable *input,
                                  std::vector<int> layers,
                                  bool bias,
@@ -357,11 +357,21 @@ class FlowBuilder : public Scope {
     if (axis != -1 ) softmax->producer->SetAttr("axis", axis);
     return softmax;
   }
-  Variable *LogSoftMax(Variable *x) { return Log(SoftMax(x)); }
+  Variable *LogSoftMax(Variable *x, int axis = -1) {
+    auto *logsoftmax = Op("LogSoftMax", {x});
+    if (axis != -1) logsoftmax->producer->SetAttr("axis", axis);
+    return logsoftmax;
+  }
   Variable *LogSumExp(Variable *x, int axis = -1, bool keepdims = false) {
     return Reduce("LogSumExp", x, axis, keepdims);
   }
 
+  // Layer normalization over the last axis with optional scale and bias. The
+  // scale and bias must either both be specified or both be omitted.
+  Variable *LayerNorm(Variable *x,
+                      Variable *gamma = nullptr, Variable *beta = nullptr,
+                      float epsilon = 1e-6f);
+
   // Shape.
   Variable *TensorShape(Variable *x) {
     return Op("Shape", {x}, DT_INT32, {x->rank()});
@@ -0,0 +1,460 @@
+// Copyright 2025 Ringgaard Research ApS
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "sling/myelin/code-cache.h"
+
+#include <string.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+
+#include "sling/base/logging.h"
+#include "sling/base/types.h"
+#include "sling/file/file.h"
+#include "sling/string/printf.h"
+#include "sling/util/fingerprint.h"
+#include "third_party/jit/cpu.h"
+
+namespace sling {
+namespace myelin {
+
+// Maximum size of constant tensors that are included in the cache key.
+static const size_t kMaxKeyData = 4096;
+
+// Fingerprint builder for computing cache keys.
+class KeyBuilder {
+ public:
+  void AddData(const void *data, size_t size) {
+    fp_ = FingerprintCat(fp_, Fingerprint(static_cast<const char *>(data),
+                                          size));
+  }
+
+  void AddInt(int64 value) {
+    AddData(&value, sizeof(int64));
+  }
+
+  void AddString(const string &str) {
+    AddData(str.data(), str.size());
+  }
+
+  void AddShape(const Shape &shape) {
+    AddInt(shape.rank());
+    for (int d = 0; d < shape.rank(); ++d) AddInt(shape.dim(d));
+  }
+
+  void AddTensor(const Tensor *tensor) {
+    AddString(tensor->name());
+    AddInt(tensor->type());
+    AddShape(tensor->shape());
+    AddShape(tensor->minalign());
+    AddShape(tensor->aligned());
+    AddShape(tensor->stride());
+    AddInt(tensor->size());
+    AddInt(tensor->space());
+    AddInt(tensor->offset());
+    AddInt(tensor->byte_alignment());
+    AddInt(tensor->order());
+    AddInt(tensor->ref());
+    AddInt(tensor->dynamic());
+    AddInt(tensor->constant());
+    AddInt(tensor->IsLocal());
+    AddInt(tensor->in());
+    AddInt(tensor->out());
+    AddInt(tensor->placement());
+    AddInt(tensor->ref_placement());
+    AddString(tensor->cell() != nullptr ? tensor->cell()->name() : "");
+    AddString(tensor->sparse() != nullptr ? tensor->sparse()->name() : "");
+  }
+
+  uint64 fingerprint() const { return fp_; }
+
+ private:
+  uint64 fp_ = 0;
+};
+
+// Reader for cell and tensor directory in cache file.
+class DirectoryReader {
+ public:
+  DirectoryReader(const string &data)
+      : ptr_(data.data()), end_(data.data() + data.size()) {}
+
+  bool Read(void *data, size_t size) {
+    if (static_cast<size_t>(end_ - ptr_) < size) return false;
+    memcpy(data, ptr_, size);
+    ptr_ += size;
+    return true;
+  }
+
+  bool ReadString(string *str) {
+    int size;
+    if (!Read(&size, sizeof(int))) return false;
+    if (size < 0 || end_ - ptr_ < size) return false;
+    str->assign(ptr_, size);
+    ptr_ += size;
+    return true;
+  }
+
+ private:
+  const char *ptr_;
+  const char *end_;
+};
+
+// Append data to cache file buffer.
+static void Append(string *buffer, const void *data, size_t size) {
+  buffer->append(static_cast<const char *>(data), size);
+}
+
+static void AppendString(string *buffer, const string &str) {
+  int size = str.size();
+  Append(buffer, &size, sizeof(int));
+  buffer->append(str);
+}
+
+bool CodeCache::Cacheable(const Network &network) {
+  // Profiling uses addresses that cannot be relocated.
+  const Options &options = network.options();
+  if (options.profiling) return false;
+
+  // Ahead-of-time compiled code is linked by the AOT linker.
+  if (options.aot || options.pic) return false;
+
+  // Device code and device memory addresses cannot be relocated.
+  if (network.runtime()->Device() != nullptr) return false;
+
+  return true;
+}
+
+uint64 CodeCache::Key(const Network &network) {
+  KeyBuilder key;
+  key.AddInt(VERSION);
+
+  // Add executable. The code generators and the addresses of the runtime
+  // functions depend on the binary.
+  FileStat stat;
+  if (File::Stat("/proc/self/exe", &stat).ok()) {
+    key.AddInt(stat.size);
+    key.AddInt(stat.mtime);
+  }
+
+  // Add CPU features.
+  key.AddInt(jit::CPU::SupportedFeatures());
+  key.AddInt(jit::CPU::CacheLineSize());
+  key.AddInt(jit::CPU::L1CacheSize());
+  key.AddInt(jit::CPU::L2CacheSize());
+  key.AddInt(jit::CPU::L3CacheSize());
+
+  // Add compiler options and runtime.
+  const Options &options = network.options();
+  key.AddInt(options.parameter_element_order);
+  key.AddInt(options.debug);
+  key.AddInt(options.external_profiler);
+  key.AddInt(options.global_profiler);
+  key.AddInt(options.dynamic_allocation);
+  key.AddInt(options.shared_tensors);
+  key.AddInt(options.sync_steps);
+  key.AddInt(options.fast_math);
+  key.AddInt(options.sparse_threshold);
+  key.AddInt(options.flops_address != nullptr);
+  key.AddString(network.runtime()->Description());
+
+  // Add parameter tensors.
+  for (const Tensor *tensor : network.parameters()) key.AddTensor(tensor);
+
+  // Add global tensors. Kernels can embed small constants in the generated
+  // code, so the content of these is part of the key. Larger constants like
+  // weight matrices are only accessed through their relocated address.
+  for (const Tensor *tensor : network.globals()) {
+    key.AddTensor(tensor);
+    if (tensor->constant() && tensor->data() != nullptr &&
+        tensor->size() <= kMaxKeyData) {
+      key.AddData(tensor->data(), tensor->size());
+    }
+  }
+
+  // Add cells and steps.
+  for (const Cell *cell : network.cells()) {
+    key.AddString(cell->name());
+    key.AddInt(cell->instance_size());
+    key.AddInt(cell->data_start());
+    key.AddInt(cell->instance_alignment());
+    for (int i = 0; i < cell->num_tasks(); ++i) {
+      key.AddInt(cell->task(i));
+      key.AddInt(cell->task_offset(i));
+    }
+    for (const Step *step : cell->steps()) {
+      key.AddString(step->name());
+      key.AddString(step->type());
+      key.AddString(step->kernel()->Name());
+      key.AddString(step->variant());
+      key.AddInt(step->task_index());
+      for (const Attribute &attr : *step) {
+        key.AddString(attr.name);
+        key.AddString(attr.value);
+      }
+      for (const Tensor *input : step->inputs()) key.AddString(input->name());
+      for (const Tensor *output : step->outputs()) key.AddString(output->name());
+    }
+  }
+
+  return key.fingerprint();
+}
+
+string CodeCache::Filename(uint64 key) const {
+  return StringPrintf("%s/%016llx.jit", dir_.c_str(),
+                      static_cast<unsigned long long>(key));
+}
+
+jit::Address CodeCache::Resolve(const Network &network,
+                                const string &symbol) {
+  // Global tensor data.
+  Tensor *tensor = network.LookupParameter(symbol);
+  if (tensor != nullptr) {
+    if (!tensor->IsGlobal()) return nullptr;
+    return reinterpret_cast<jit::Address>(tensor->data());
+  }
+
+  // Runtime functions.
+  Runtime *runtime = network.runtime();
+  if (symbol == "myelin_start_task") {
+    return reinterpret_cast<jit::Address>(runtime->StartTaskFunc());
+  } else if (symbol == "myelin_wait_task") {
+    return reinterpret_cast<jit::Address>(runtime->WaitTaskFunc());
+  } else if (symbol == "myelin_sync_main") {
+    return reinterpret_cast<jit::Address>(runtime->SyncMainFunc());
+  }
+
+  // FLOPs counter.
+  if (symbol == "myelin_flops") {
+    return reinterpret_cast<jit::Address>(network.options().flops_address);
+  }
+
+  return nullptr;
+}
+
+bool CodeCache::Load(uint64 key, Network *network) {
+  // Open cache file.
+  string filename = Filename(key);
+  File *file;
+  if (!File::Open(filename, "r", &file).ok()) return false;
+
+  // Read header and directory.
+  Header hdr;
+  uint64 size;
+  bool ok = file->Read(&hdr, sizeof(Header)).ok();
+  if (ok) ok = file->GetSize(&size).ok();
+  if (ok) {
+    ok = hdr.magic == MAGIC && hdr.version == VERSION && hdr.key == key &&
+         hdr.directory >= static_cast<int64>(sizeof(Header)) &&
+         static_cast<uint64>(hdr.directory) <= size;
+  }
+  string directory;
+  if (ok) {
+    directory.resize(size - hdr.directory);
+    ok = file->Seek(hdr.directory).ok() &&
+         file->Read(&directory[0], directory.size()).ok();
+  }
+  if (!ok) {
+    LOG(WARNING) << "Invalid code cache file: " << filename;
+    file->Close();
+    return false;
+  }
+
+  // Check that the cached instance layout matches the network.
+  const std::vector<Cell *> &cells = network->cells();
+  const std::vector<Tensor *> &params = network->parameters();
+  DirectoryReader reader(directory);
+  std::vector<CellEntry> entries(hdr.cells);
+  std::vector<std::vector<std::pair<int, string>>> relocs(hdr.cells);
+  std::vector<string> noops(hdr.cells);
+  std::vector<std::vector<string>> variants(hdr.cells);
+  ok = hdr.cells == static_cast<int>(cells.size()) &&
+       hdr.tensors == static_cast<int>(params.size());
+  for (int c = 0; ok && c < hdr.cells; ++c) {
+    Cell *cell = cells[c];
+    CellEntry &entry = entries[c];
+    string name;
+    ok = reader.Read(&entry, sizeof(CellEntry)) &&
+         reader.ReadString(&name) &&
+         name == cell->name() &&
+         entry.instance_size == static_cast<int64>(cell->instance_size()) &&
+         entry.data_start == static_cast<int64>(cell->data_start()) &&
+         entry.steps == static_cast<int>(cell->steps().size()) &&
+         entry.code % ALIGNMENT == 0 &&
+         entry.code_size > 0 &&
+         entry.code + entry.code_size <= hdr.directory;
+    if (ok) {
+      noops[c].resize(entry.steps);
+      ok = reader.Read(&noops[c][0], entry.steps);
+      variants[c].resize(entry.steps);
+    }
+    for (int i = 0; ok && i < entry.steps; ++i) {
+      ok = reader.ReadString(&variants[c][i]);
+    }
+    for (int i = 0; ok && i < entry.relocs; ++i) {
+      int offset;
+      string symbol;
+      ok = reader.Read(&offset, sizeof(int)) && reader.ReadString(&symbol) &&
+           offset >= 0 &&
+           offset + static_cast<int>(sizeof(jit::Address)) <= entry.code_size;
+      relocs[c].emplace_back(offset, symbol);
+    }
+  }
+  for (int t = 0; ok && t < hdr.tensors; ++t) {
+    int64 offset;
+    string name;
+    ok = reader.Read(&offset, sizeof(int64)) && reader.ReadString(&name) &&
+         name == params[t]->name() && offset == static_cast<int64>(params[t]->offset());
+  }
+  if (!ok) {
+    LOG(WARNING) << "Code cache file does not match network: " << filename;
+    file->Close();
+    return false;
+  }
+
+  // Map code blocks into memory and relocate external references.
+  std::vector<char *> code(hdr.cells, nullptr);
+  for (int c = 0; ok && c < hdr.cells; ++c) {
+    const CellEntry &entry = entries[c];
+    code[c] = static_cast<char *>(
+        file->MapPrivateMemory(entry.code, entry.code_size));
+    if (code[c] == nullptr) {
+      ok = false;
+      break;
+    }
+    for (auto &reloc : relocs[c]) {
+      jit::Address address = Resolve(*network, reloc.second);
+      if (address == nullptr) {
+        LOG(WARNING) << "Unresolved symbol in code cache: " << reloc.second;
+        ok = false;
+        break;
+      }
+      memcpy(code[c] + reloc.first, &address, sizeof(jit::Address));
+    }
+  }
+  file->Close();
+  if (!ok) {
+    for (int c = 0; c < hdr.cells; ++c) {
+      if (code[c] != nullptr) {
+        File::FreeMappedMemory(code[c], entries[c].code_size);
+      }
+    }
+    return false;
+  }
+
+  // Install relocated code in cells.
+  for (int c = 0; c < hdr.cells; ++c) {
+    Cell *cell = cells[c];
+    cell->code_.Map(code[c], entries[c].code_size);
+    for (int i = 0; i < entries[c].steps; ++i) {
+      cell->steps_[i]->noop_ = noops[c][i] != 0;
+      cell->steps_[i]->variant_ = variants[c][i];
+    }
+    VLOG(5) << cell->name()
+            << " entry address: " << cell->code_.entry()
+            << " code size: " << cell->code_.size()
+            << " loaded from code cache";
+  }
+
+  return true;
+}
+
+bool CodeCache::Save(uint64 key,
+                     const Network &network,
+                     const std::vector<std::vector<jit::Extern>> &externs) {
+  const std::vector<Cell *> &cells = network.cells();
+  CHECK_EQ(cells.size(), externs.size());
+
+  // Output code blocks and build cell directory.
+  string data(sizeof(Header), 0);
+  string directory;
+  for (int c = 0; c < cells.size(); ++c) {
+    Cell *cell = cells[c];
+
+    // Check that all external references can be relocated.
+    std::vector<std::pair<int, string>> relocs;
+    for (const jit::Extern &ext : externs[c]) {
+      if (Resolve(network, ext.symbol) != ext.address) {
+        VLOG(3) << "Cannot cache code for " << cell->name()
+                << ", unknown symbol: " << ext.symbol;
+        return false;
+      }
+      for (const jit::Extern::Ref &ref : ext.refs) {
+        if (ref.relative) return false;
+        relocs.emplace_back(ref.offset, ext.symbol);
+      }
+    }
+
+    // Add page-aligned code block.
+    CellEntry entry;
+    entry.instance_size = cell->instance_size();
+    entry.data_start = cell->data_start();
+    entry.code = Align(data.size());
+    entry.code_size = cell->code().size();
+    entry.steps = cell->steps().size();
+    entry.relocs = relocs.size();
+    data.resize(entry.code);
+    Append(&data, cell->code().begin(), entry.code_size);
+
+    // Add directory entry for cell.
+    Append(&directory, &entry, sizeof(CellEntry));
+    AppendString(&directory, cell->name());
+    for (const Step *step : cell->steps()) {
+      directory.push_back(step->noop() ? 1 : 0);
+    }
+    for (const Step *step : cell->steps()) {
+      AppendString(&directory, step->variant());
+    }
+    for (auto &reloc : relocs) {
+      Append(&directory, &reloc.first, sizeof(int));
+      AppendString(&directory, reloc.second);
+    }
+  }
+
+  // Add instance offsets for parameters to directory.
+  for (const Tensor *tensor : network.parameters()) {
+    int64 offset = tensor->offset();
+    Append(&directory, &offset, sizeof(int64));
+    AppendString(&directory, tensor->name());
+  }
+
+  // Fill in header.
+  Header hdr;
+  memset(&hdr, 0, sizeof(Header));
+  hdr.magic = MAGIC;
+  hdr.version = VERSION;
+  hdr.key = key;
+  hdr.cells = cells.size();
+  hdr.tensors = network.parameters().size();
+  hdr.directory = data.size();
+  memcpy(&data[0], &hdr, sizeof(Header));
+  data.append(directory);
+
+  // Write cache file. The file is written under a temporary name and then
+  // renamed, so other processes never see a partially written cache file.
+  string filename = Filename(key);
+  string tmpname = StringPrintf("%s.%d", filename.c_str(), getpid());
+  Status st = File::WriteContents(tmpname, data);
+  if (st.ok()) st = File::Rename(tmpname, filename);
+  if (!st.ok()) {
+    LOG(WARNING) << "Error writing code cache file " << filename << ": " << st;
+    File::Delete(tmpname);
+    return false;
+  }
+  VLOG(3) << "Saved network code to " << filename;
+
+  return true;
+}
+
+}  // namespace myelin
+}  // namespace sling
@@ -0,0 +1,107 @@
+// Copyright 2025 Ringgaard Research ApS
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SLING_MYELIN_CODE_CACHE_H_
+#define SLING_MYELIN_CODE_CACHE_H_
+
+#include <string>
+#include <vector>
+
+#include "sling/base/types.h"
+#include "sling/myelin/compute.h"
+#include "third_party/jit/code.h"
+
+namespace sling {
+namespace myelin {
+
+// Persistent cache for JIT-generated network code. The generated code for all
+// the cells in a network is saved in a cache file together with the external
+// references in the code and the instance layout of the cells. When the same
+// network is compiled again, the code generation is skipped and the code is
+// memory-mapped from the cache file and relocated instead.
+//
+// The cache key is a fingerprint of the network after kernel selection and
+// instance allocation, i.e. steps, kernels, tensor layouts, instance offsets,
+// constant data, CPU features, compiler options, and the executable. Only
+// code that can be relocated using symbolic references to global tensors and
+// runtime functions is cached.
+class CodeCache {
+ public:
+  // Initialize code cache for storing cache files in directory.
+  explicit CodeCache(const string &dir) : dir_(dir) {}
+
+  // Check if the generated code for network can be cached.
+  static bool Cacheable(const Network &network);
+
+  // Compute cache key for network.
+  static uint64 Key(const Network &network);
+
+  // Load code for all the cells in the network from the cache. Returns false
+  // if the network is not in the cache.
+  bool Load(uint64 key, Network *network);
+
+  // Save generated code for network in the cache. The external references for
+  // the code of each cell are used for relocating the code when it is loaded.
+  // Returns false if the code cannot be relocated.
+  bool Save(uint64 key,
+            const Network &network,
+            const std::vector<std::vector<jit::Extern>> &externs);
+
+ private:
+  // Current magic and version for cache files.
+  static const int MAGIC = 0x4344434d;
+  static const int VERSION = 2;
+
+  // Alignment of code blocks in cache file.
+  static const int ALIGNMENT = 4096;
+
+  // Cache file header.
+  struct Header {
+    int magic;        // magic number for identifying cache file
+    int version;      // cache file format version
+    uint64 key;       // cache key for network
+    int cells;        // number of cells in network
+    int tensors;      // number of parameter tensors in network
+    int64 directory;  // file position of cell and tensor directory
+  };
+
+  // Cell directory entry.
+  struct CellEntry {
+    int64 instance_size;  // size of instance data block
+    int64 data_start;     // start of data in instance block
+    int64 code;           // file position of code block
+    int code_size;        // size of code block
+    int steps;            // number of steps in cell
+    int relocs;           // number of relocations for code block
+  };
+
+  // Return cache file name for key.
+  string Filename(uint64 key) const;
+
+  // Resolve symbol for external reference. Returns null for unknown symbols.
+  static jit::Address Resolve(const Network &network, const string &symbol);
+
+  // Align file position.
+  static uint64 Align(uint64 pos) {
+    return (pos + ALIGNMENT - 1) & ~static_cast<uint64>(ALIGNMENT - 1);
+  }
+
+  // Directory for cache files.
+  string dir_;
+};
+
+}  // namespace myelin
+}  // namespace sling
+
+#endif  // SLING_MYELIN_CODE_CACHE_H_
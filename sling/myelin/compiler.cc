@@ -15,6 +15,8 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <unistd.h>
+#include <algorithm>
+#include <thread>
 
 #include "sling/myelin/compiler.h"
 
@@ -22,10 +24,14 @@
 #include "sling/base/logging.h"
 #include "sling/base/perf.h"
 #include "sling/file/file.h"
+#include "sling/myelin/autotuner.h"
+#include "sling/myelin/code-cache.h"
 #include "sling/myelin/compute.h"
 #include "sling/myelin/elf-linker.h"
 #include "sling/myelin/flow.h"
 #include "sling/myelin/graph.h"
+#include "sling/myelin/multi-process.h"
+#include "sling/myelin/partitioner.h"
 #include "sling/myelin/profile.h"
 #include "sling/myelin/cuda/cuda-runtime.h"
 #include "sling/myelin/kernel/cuda.h"
@@ -42,6 +48,7 @@ DEFINE_string(input_graph, "", "File for saving raw input flow as SVG file");
 DEFINE_string(graph, "", "File for saving analyzed flow as SVG file");
 DEFINE_string(dot, "", "File for saving analyzed flow as DOT file");
 DEFINE_string(jit_code, "", "File for saving JIT generated code");
+DEFINE_string(code_cache, "", "Directory for caching JIT generated code");
 DEFINE_bool(dump_input_flow, false, "Dump raw input flow to log");
 DEFINE_bool(dump_flow, false, "Dump final analyzed flow to log");
 DEFINE_bool(dump_cells, false, "Dump cells after compilation");
@@ -51,6 +58,12 @@ DEFINE_bool(param_stats, false, "Dump model parameter statistics");
 DEFINE_bool(check_flow_consistency, false, "Check that flow is consistent");
 DEFINE_bool(dynamic_instance_allocation, false, "Dynamic instance allocation");
 DEFINE_bool(mkl, false, "Use Intel Math Kernel Library");
+DEFINE_bool(quantize, false, "Quantize matmul weights to 8-bit integers");
+DEFINE_bool(bf16, false, "Store matmul weights and embeddings as bfloat16");
+DEFINE_bool(autotune, false, "Benchmark matmul kernel configurations");
+DEFINE_string(tuning_db, "", "File with matmul kernel tuning results");
+DEFINE_int32(partition, 0, "Split large ops into parallel tasks on N cores");
+DEFINE_int32(partition_min_cost, 32768, "Minimum cost for parallel op tiles");
 DEFINE_bool(sync_steps, false, "Synchronize all compute steps");
 DEFINE_bool(fast_math, false, "Fast approximate math ops");
 DEFINE_bool(graph_all_vars, false, "Include all variables in DOT graph");
@@ -72,6 +85,10 @@ namespace myelin {
 static myelin::CUDARuntime *cudart = nullptr;
 static int cudart_refs = 0;
 
+// Multi-processor runtime for partitioned ops. This is shared by all networks
+// and is never deleted, since the instances can outlive the compiler.
+static myelin::MultiProcessorRuntime *mprt = nullptr;
+
 Compiler::Compiler() {
   // Register standard kernels.
   library_ = new Library();
@@ -93,6 +110,18 @@ Compiler::Compiler() {
 
   // Add extra kernels.
   if (FLAGS_mkl) RegisterMKLLibrary(library_);
+
+  // Add post-training quantization of weights.
+  if (FLAGS_quantize) RegisterQuantizationTransforms(library_);
+
+  // Add conversion of weights and embeddings to bfloat16.
+  if (FLAGS_bf16) RegisterBF16Transforms(library_);
+
+  // Use multi-processor runtime for computing partitioned ops in parallel.
+  if (FLAGS_partition > 1 && runtime_ == nullptr) {
+    if (mprt == nullptr) mprt = new myelin::MultiProcessorRuntime();
+    runtime_ = mprt;
+  }
 }
 
 Compiler::~Compiler() {
@@ -123,6 +152,31 @@ void Compiler::Compile(Flow *flow, Network *net) {
   // Analyze flow.
   flow->Analyze(*library_);
 
+  // Split large ops into tiles computed by parallel tasks.
+  int cores = std::thread::hardware_concurrency();
+  if (FLAGS_partition > 1 && cores > 1 &&
+      runtime_ != nullptr && runtime_->SupportsAsync()) {
+    Partitioner::Options options;
+    options.tasks = std::min(FLAGS_partition, cores);
+    options.min_cost = FLAGS_partition_min_cost;
+    Partitioner partitioner(options);
+    int partitioned = partitioner.Partition(flow);
+    VLOG(1) << partitioned << " ops partitioned";
+  }
+
+  // Select tuned kernel configurations.
+  if (FLAGS_autotune || !FLAGS_tuning_db.empty()) {
+    AutoTuner tuner(library_);
+    if (!FLAGS_tuning_db.empty() && File::Exists(FLAGS_tuning_db)) {
+      tuner.Load(FLAGS_tuning_db);
+    }
+    int tuned = tuner.Tune(flow, FLAGS_autotune);
+    VLOG(1) << tuned << " ops tuned";
+    if (FLAGS_autotune && !FLAGS_tuning_db.empty()) {
+      CHECK(tuner.Save(FLAGS_tuning_db));
+    }
+  }
+
   // Optionally dump final flow.
   if (FLAGS_dump_flow) {
     LOG(INFO) << "Flow:\n" << flow->ToString();
@@ -160,6 +214,8 @@ void Compiler::Compile(Flow *flow, Network *net) {
   if (!FLAGS_jit_code.empty() || FLAGS_dump_code || FLAGS_dump_raw_code) {
     net->set_linker(&linker);
   }
+  CodeCache code_cache(FLAGS_code_cache);
+  if (!FLAGS_code_cache.empty()) net->set_code_cache(&code_cache);
   if (FLAGS_dynamic_instance_allocation) {
     net->options().dynamic_allocation = true;
   }
@@ -170,6 +226,7 @@ void Compiler::Compile(Flow *flow, Network *net) {
   net->options().sparse_threshold = FLAGS_sparse_threshold;
 
   CHECK(net->Compile(*flow, *library_));
+  net->set_code_cache(nullptr);
 
   // Bind flow artifacts to network tensors, cells, and steps.
   net->Bind(flow);
@@ -288,6 +345,8 @@ void SetCPUFeatures(const string &features) {
     jit::CPU::Disable(jit::AVX);
     jit::CPU::Disable(jit::AVX2);
     jit::CPU::Disable(jit::AVX512F);
+    jit::CPU::Disable(jit::AVX512VNNI);
+    jit::CPU::Disable(jit::AVX512BF16);
     jit::CPU::Disable(jit::FMA3);
   }
 
@@ -321,6 +380,10 @@ void SetCPUFeatures(const string &features) {
       feature = jit::AVX2;
     } else if (name == "avx512") {
       feature = jit::AVX512F;
+    } else if (name == "vnni") {
+      feature = jit::AVX512VNNI;
+    } else if (name == "bf16") {
+      feature = jit::AVX512BF16;
     } else if (name == "fma3") {
       feature = jit::FMA3;
     } else {
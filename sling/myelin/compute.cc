@@ -24,6 +24,7 @@
 #include "sling/base/logging.h"
 #include "sling/base/types.h"
 #include "sling/file/file.h"
+#include "sling/myelin/code-cache.h"
 #include "sling/myelin/macro-assembler.h"
 #include "sling/string/printf.h"
 
@@ -1871,6 +1872,19 @@ bool Network::Compile(const Flow &flow, const Library &library) {
     }
   }
 
+  // Try to load generated code from the code cache.
+  bool cache = code_cache_ != nullptr && linker_ == &jit_linker &&
+               CodeCache::Cacheable(*this);
+  uint64 cache_key = 0;
+  if (cache) {
+    cache_key = CodeCache::Key(*this);
+    if (code_cache_->Load(cache_key, this)) {
+      linker_->EndNetwork(this);
+      return true;
+    }
+  }
+  std::vector<std::vector<jit::Extern>> externs;
+
   // Compile each cell computation.
   for (Cell *cell : cells_) {
     // Start code generation for cell.
@@ -2170,8 +2184,14 @@ bool Network::Compile(const Flow &flow, const Library &library) {
             << " entry address: " << cell->code_.entry()
             << " code size: " << cell->code_.size()
             << " data size: " << cell->instance_size();
+
+    // Keep external references for relocating cached code.
+    if (cache) externs.push_back(masm.externs());
   }
 
+  // Save generated code in the code cache.
+  if (cache) code_cache_->Save(cache_key, *this, externs);
+
   // Notify linker that compilation of network has completed.
   linker_->EndNetwork(this);
 
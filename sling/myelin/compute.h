@@ -37,6 +37,7 @@ class Tensor;
 class TensorData;
 class CUDADevice;
 class CustomKernel;
+class CodeCache;
 class InstanceAllocator;
 class ProfileSummary;
 struct Options;
@@ -844,6 +845,7 @@ class Step : public Attributes {
   bool noop_ = false;
 
   friend class Network;
+  friend class CodeCache;
 };
 
 // A tensor data object is a reference to a tensor value. It does not own the
@@ -1395,6 +1397,7 @@ class Cell {
   friend class Network;
   friend class Step;
   friend class InstanceAllocator;
+  friend class CodeCache;
 };
 
 // Compiler options.
@@ -1494,6 +1497,10 @@ class Network {
   Linker *linker() const { return linker_; }
   void set_linker(Linker *linker) { linker_ = linker; }
 
+  // Persistent cache for generated code.
+  CodeCache *code_cache() const { return code_cache_; }
+  void set_code_cache(CodeCache *cache) { code_cache_ = cache; }
+
   // Compiler options.
   Options &options() { return options_; }
   const Options &options() const { return options_; }
@@ -1562,6 +1569,9 @@ class Network {
   // Linker for linking code and data.
   Linker *linker_;
 
+  // Cache for generated code (not owned).
+  CodeCache *code_cache_ = nullptr;
+
   // Compiler options.
   Options options_;
 
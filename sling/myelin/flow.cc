@@ -1745,12 +1745,14 @@ static bool CompareOpOrder(Flow::Operation *o1, Flow::Operation *o2) {
   return o1->order < o2->order;
 }
 
+// The priority queue returns the op with the highest priority first and ops
+// with the same priority in the order they became ready.
 struct PriorityComparator {
   bool operator ()(Flow::Operation *o1, Flow::Operation *o2) {
     if (o1->priority == o2->priority) {
       return o1->order > o2->order;
     } else {
-      return o1->priority > o2->priority;
+      return o1->priority < o2->priority;
     }
   }
 };
@@ -1758,18 +1760,20 @@ struct PriorityComparator {
 void Flow::Sort() {
   // Set priority for each operation. Operations that other tasks depend on are
   // scheduled early and operations that depend on other tasks are scheduled
-  // late in other to allow for as much parallelism as possible.
+  // late in other to allow for as much parallelism as possible. Parallel
+  // operations are started as soon as their inputs are ready.
   // The operations are assigned the following priorities:
   //   4: operations that parallel operations depend on.
-  //   3: operations with no dependencies on parallel operations.
-  //   2: parallel operation.
+  //   3: parallel operation.
+  //   2: operations with no dependencies on parallel operations.
   //   1: operations that depend on parallel operations.
   std::unordered_set<Operation *> pre;
   std::unordered_set<Operation *> post;
+  for (Operation *op : ops_) op->priority = 2;
   for (Operation *op : ops_) {
     if (op->task != 0) {
       // Parallel operation.
-      op->priority = 2;
+      op->priority = 3;
 
       // Add input to parallel operation to pre-parallel phase.
       for (Variable *var : op->inputs) {
@@ -899,6 +899,10 @@ class Flow {
   // Return unique operation name with prefix.
   string OpName(const string &prefix);
 
+  // Sort operations in topological order of computation. Parallel operations
+  // are scheduled as early as possible.
+  void Sort();
+
  private:
   // Infer which variables are inputs and outputs to functions.
   void InferInputsAndOutputs();
@@ -907,9 +911,6 @@ class Flow {
   // were applied.
   bool Transform(const Transformations &transformations);
 
-  // Sort operations in topological order of computation.
-  void Sort();
-
   // Variables.
   std::vector<Variable *> vars_;
 
@@ -0,0 +1,966 @@
+// Copyright 2025 Ringgaard Research ApS
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <string.h>
+#include <functional>
+#include <map>
+#include <set>
+#include <utility>
+#include <vector>
+
+#include "sling/base/logging.h"
+#include "sling/base/types.h"
+#include "sling/myelin/compute.h"
+#include "sling/myelin/macro-assembler.h"
+
+#define __ masm->
+
+namespace sling {
+namespace myelin {
+
+using namespace jit;
+
+// Minimum number of elements in constant for conversion to bfloat16.
+static const int kMinBF16Elements = 1024;
+
+// Weight matrices for bfloat16 matmuls are stored in pairs of consecutive
+// input elements for each output column, i.e. [n/2][m][2], so each 32-bit
+// lane of a SIMD register holds two weights for one output column. This is the
+// operand layout for vdpbf16ps. The columns are padded to a multiple of 16 and
+// the rows to a multiple of 2.
+static const int kBF16Pair = 2;
+static const int kBF16ColumnAlign = 16;
+
+// Embedding dimensions must be a multiple of the vector size.
+static const int kBF16EmbeddingAlign = 8;
+
+// Check if the CPU supports the AVX-512 BF16 instructions.
+static bool HasBF16() {
+  return CPU::Enabled(AVX512F) && CPU::Enabled(AVX512BF16);
+}
+
+// Check if the CPU supports expanding bfloat16 parameters to floats.
+static bool HasBF16Expansion() {
+  return CPU::Enabled(AVX2) && CPU::Enabled(FMA3);
+}
+
+// Round up to multiple.
+static int RoundUp(int n, int m) {
+  return (n + m - 1) / m * m;
+}
+
+// Convert float to bfloat16 with rounding to nearest even.
+static uint16 FloatToBF16(float f) {
+  uint32 bits;
+  memcpy(&bits, &f, sizeof(float));
+  if ((bits & 0x7fffffff) > 0x7f800000) {
+    // Keep NaNs quiet when truncating the mantissa.
+    return (bits >> 16) | 0x0040;
+  }
+  bits += 0x7fff + ((bits >> 16) & 1);
+  return bits >> 16;
+}
+
+// Check shapes for gather from bfloat16 embedding matrix. The indices are
+// int32[B,F,1] and the result is float[B,F,E] or float[B,E] for pooling.
+static bool BF16GatherShapes(const Shape &params,
+                             const Shape &indices,
+                             const Shape &result,
+                             int batch, bool pooling) {
+  if (params.rank() != 2 || indices.rank() < 1) return false;
+  if (indices.dim(-1) != 1) return false;
+  if (params.dim(1) % kBF16EmbeddingAlign != 0) return false;
+  Shape feature = indices.outside(indices.rank() - 1);
+  Shape outer;
+  if (batch > 0) {
+    outer = feature.outside(batch);
+    feature = feature.inside(batch);
+  }
+  Shape element = params.inside(1);
+  if (!pooling) outer = outer + feature;
+  return result == outer + element;
+}
+
+// Convert activations to bfloat16 with rounding to nearest even. Rows are
+// padded with zeros to an even number of elements.
+//
+// ToBF16(x:float[r,n]) -> xb:bfloat16[r,n']
+class ToBF16 : public Kernel {
+ public:
+  string Name() override { return "AVX512ToBF16"; }
+  string Operation() override { return "ToBF16"; }
+
+  bool Supports(Step *step) override {
+    // Requires CPU with AVX-512 BF16 support.
+    if (!HasBF16()) return false;
+
+    // Check input and output.
+    if (step->indegree() != 1 || step->outdegree() != 1) return false;
+    Tensor *x = step->input(0);
+    Tensor *xb = step->output(0);
+    if (x->type() != DT_FLOAT || x->rank() != 2) return false;
+    if (xb->type() != DT_BFLOAT16 || xb->rank() != 2) return false;
+    if (xb->dim(0) != x->dim(0)) return false;
+    if (xb->dim(1) != RoundUp(x->dim(1), kBF16Pair)) return false;
+
+    return true;
+  }
+
+  void Adjust(Step *step) override {
+    step->input(0)->RequireOrder(ROW_MAJOR);
+    step->output(0)->RequireOrder(ROW_MAJOR);
+  }
+
+  void Generate(Step *step, MacroAssembler *masm) override {
+    // Get input and output.
+    Tensor *x = step->input(0);
+    Tensor *xb = step->output(0);
+    int rows = x->dim(0);
+    int n = x->dim(1);
+    int main = n / 16 * 16;
+    int residual = n - main;
+
+    // Allocate registers. The converted elements are stored with a VEX store,
+    // so the vector register must be one of the lower 16 registers.
+    Register input = masm->rr().alloc();
+    Register output = masm->rr().alloc();
+    Register ofs = masm->rr().alloc();
+    Register row = masm->rr().alloc();
+    ZMMRegister v = ZMMRegister::from_code(masm->mm().alloc(false));
+    OpmaskRegister kmask = masm->kk().alloc();
+    OpmaskRegister kpair = masm->kk().alloc();
+
+    // Load tensor locations.
+    __ LoadTensorAddress(input, x);
+    __ LoadTensorAddress(output, xb);
+
+    // Set up masks for residual input elements and output pairs.
+    if (residual > 0) {
+      __ LoadMask(residual, kmask);
+      __ LoadMask((residual + 1) / kBF16Pair, kpair);
+    }
+
+    // Loop over rows.
+    Label lrow;
+    if (rows > 1) {
+      __ xorq(row, row);
+      __ bind(&lrow);
+    }
+
+    // Convert 16 elements at a time. The offset is in bfloat16 bytes.
+    if (main > 0) {
+      Label l;
+      __ xorq(ofs, ofs);
+      __ LoopStart(&l);
+      __ vcvtneps2bf16(v, Operand(input, ofs, times_2));
+      __ vmovdqu(Operand(output, ofs), v.ymm());
+      __ addq(ofs, Immediate(16 * sizeof(uint16)));
+      __ cmpq(ofs, Immediate(main * sizeof(uint16)));
+      __ j(less, &l);
+    }
+
+    // Convert residual elements. The elements beyond the end of the row are
+    // zeroed by the masked load and become the padding element.
+    if (residual > 0) {
+      __ vmovups(v, Operand(input, main * sizeof(float)), Mask(kmask, zeroing));
+      __ vcvtneps2bf16(v, v);
+      __ vmovdqu32(Operand(output, main * sizeof(uint16)), v,
+                   Mask(kpair, merging));
+    }
+
+    // Next row.
+    if (rows > 1) {
+      __ addq(input, Immediate(x->stride(0)));
+      __ addq(output, Immediate(xb->stride(0)));
+      __ incq(row);
+      __ cmpq(row, Immediate(rows));
+      __ j(less, &lrow);
+    }
+
+    masm->kk().release(kmask);
+    masm->kk().release(kpair);
+  }
+
+  int64 Complexity(const Step *step) override {
+    return step->input(0)->elements();
+  }
+};
+
+// Matrix multiplication with bfloat16 weights. The dot products are
+// accumulated in float32 lanes, one for each output column.
+//
+// BF16MatMul(x:bfloat16[r,n'], W:bfloat16[n'/2,m'*2]) -> y:float[r,m]
+// BF16MatMul(x:float[r,n], W:bfloat16[n'/2,m'*2]) -> y:float[r,m]
+//
+// With bfloat16 activations the dot products are computed with the AVX-512
+// vdpbf16ps instruction. With float activations, the weight pairs are
+// expanded to floats on load and the dot products are computed with FMAs.
+class BF16MatMul : public Kernel {
+ public:
+  string Name() override { return "BF16MatMul"; }
+  string Operation() override { return "BF16MatMul"; }
+
+  bool Supports(Step *step) override {
+    // Requires CPU with AVX2 and FMA3 support.
+    if (!HasBF16Expansion()) return false;
+
+    // Check inputs and output.
+    if (step->indegree() != 2 || step->outdegree() != 1) return false;
+    Tensor *x = step->input(0);
+    Tensor *w = step->input(1);
+    Tensor *y = step->output(0);
+
+    // Check types.
+    if (x->type() != DT_BFLOAT16 && x->type() != DT_FLOAT) return false;
+    if (w->type() != DT_BFLOAT16 || y->type() != DT_FLOAT) return false;
+
+    // Check shapes.
+    if (x->rank() != 2 || w->rank() != 2 || y->rank() != 2) return false;
+    int padded = w->dim(1) / kBF16Pair;
+    if (w->dim(1) % kBF16Pair != 0) return false;
+    if (padded % kBF16ColumnAlign != 0) return false;
+    if (y->dim(0) != x->dim(0) || y->dim(1) > padded) return false;
+    if (w->dim(0) != RoundUp(x->dim(1), kBF16Pair) / kBF16Pair) return false;
+
+    // Bfloat16 activations require AVX-512 BF16 and padded rows.
+    if (x->type() == DT_BFLOAT16) {
+      if (!HasBF16()) return false;
+      if (x->dim(1) % kBF16Pair != 0) return false;
+    }
+
+    return true;
+  }
+
+  void Adjust(Step *step) override {
+    step->input(0)->RequireOrder(ROW_MAJOR);
+    step->input(1)->RequireOrder(ROW_MAJOR);
+    step->output(0)->RequireOrder(ROW_MAJOR);
+    step->input(1)->SetMiniumAlignment(64);
+    step->SetRegisterUsage(8);
+  }
+
+  void Generate(Step *step, MacroAssembler *masm) override {
+    // Get inputs and output.
+    Tensor *x = step->input(0);
+    Tensor *w = step->input(1);
+    Tensor *y = step->output(0);
+    int rows = x->dim(0);
+    int columns = y->dim(1);
+
+    // Select vector instructions.
+    bool bf16 = x->type() == DT_BFLOAT16;
+    bool avx512 = CPU::Enabled(AVX512F);
+    int vecsize = avx512 ? 16 : 8;
+    int vecbytes = vecsize * sizeof(float);
+    int maxunrolls = avx512 ? 8 : 4;
+    step->set_variant(bf16 ? "BF16" : (avx512 ? "AVX512" : "AVX2"));
+
+    // Each iteration of the inner loop consumes a pair of input elements. An
+    // odd float input element is handled after the loop.
+    int dsize = bf16 ? sizeof(uint16) : sizeof(float);
+    int pairs = x->dim(1) / kBF16Pair;
+    bool odd = x->dim(1) % kBF16Pair != 0;
+
+    // Allocate registers.
+    Register input = masm->rr().alloc();
+    Register weights = masm->rr().alloc();
+    Register output = masm->rr().alloc();
+    Register col = masm->rr().alloc();
+    Register kofs = masm->rr().alloc();
+    Register wptr = masm->rr().alloc();
+    Register row = masm->rr().alloc();
+    std::vector<int> acc(maxunrolls);
+    for (auto &r : acc) r = masm->mm().alloc(avx512);
+    int x0 = masm->mm().alloc(avx512);
+    int x1 = bf16 ? -1 : masm->mm().alloc(avx512);
+    int lo = bf16 ? -1 : masm->mm().alloc(avx512);
+    int hi = bf16 ? -1 : masm->mm().alloc(avx512);
+    int himask = bf16 ? -1 : masm->mm().alloc(avx512);
+    int mask = avx512 ? -1 : masm->mm().alloc();
+    OpmaskRegister kmask = avx512 ? masm->kk().alloc() : no_opmask_reg;
+
+    // Load tensor locations. The input pointer points to the end of the input
+    // pairs in the current row, so it can be indexed by a negative offset.
+    __ LoadTensorAddress(input, x);
+    __ addq(input, Immediate(pairs * kBF16Pair * dsize));
+    __ LoadTensorAddress(weights, w);
+    __ LoadTensorAddress(output, y);
+
+    // Set up mask for last partial block of output columns.
+    int full = columns / vecsize;
+    int partial = columns % vecsize;
+    if (partial > 0) {
+      if (avx512) {
+        __ LoadMask(partial, kmask);
+      } else {
+        int32 bits[8];
+        for (int i = 0; i < 8; ++i) bits[i] = i < partial ? -1 : 0;
+        auto *maskbits = masm->GetData(bits, sizeof(bits));
+        __ vmovaps(ymm(mask), Operand(maskbits->address()));
+      }
+    }
+
+    // Set up mask for the high bfloat16 element in each pair.
+    if (!bf16) {
+      auto *himaskbits = masm->GetConstant<int32>(0xffff0000);
+      if (avx512) {
+        __ vpbroadcastd(zmm(himask), Operand(himaskbits->address()));
+      } else {
+        __ vbroadcastss(ymm(himask), Operand(himaskbits->address()));
+      }
+    }
+
+    // Break the output columns into phases of unrolled blocks.
+    struct Phase {
+      int start;    // first column in phase
+      int unrolls;  // number of blocks computed in parallel
+      int repeat;   // number of iterations
+      bool masked;  // last block is partial
+    };
+    std::vector<Phase> phases;
+    int unrolls = std::min(full, maxunrolls);
+    if (unrolls > 0) {
+      int repeat = full / unrolls;
+      phases.push_back({0, unrolls, repeat, false});
+      int residual = full - repeat * unrolls;
+      if (residual > 0) {
+        phases.push_back({repeat * unrolls * vecsize, residual, 1, false});
+      }
+    }
+    if (partial > 0) phases.push_back({full * vecsize, 1, 1, true});
+
+    // Loop over rows.
+    Label lrow;
+    if (rows > 1) {
+      __ xorq(row, row);
+      __ bind(&lrow);
+    }
+
+    for (auto &phase : phases) {
+      // Loop over column blocks in phase.
+      Label lcol;
+      __ movq(col, Immediate(phase.start * sizeof(float)));
+      if (phase.repeat > 1) __ bind(&lcol);
+
+      // Compute dot products between row and column blocks.
+      for (int i = 0; i < phase.unrolls; ++i) {
+        if (avx512) {
+          __ vpxord(zmm(acc[i]), zmm(acc[i]), zmm(acc[i]));
+        } else {
+          __ vxorps(ymm(acc[i]), ymm(acc[i]), ymm(acc[i]));
+        }
+      }
+      __ leaq(wptr, Operand(weights, col));
+      if (pairs > 0) {
+        __ movq(kofs, Immediate(-pairs * kBF16Pair * dsize));
+        Label lk;
+        __ LoopStart(&lk);
+        if (bf16) {
+          __ vpbroadcastd(zmm(x0), Operand(input, kofs));
+          for (int i = 0; i < phase.unrolls; ++i) {
+            __ vdpbf16ps(zmm(acc[i]), zmm(x0), Operand(wptr, i * vecbytes));
+          }
+        } else if (avx512) {
+          __ vbroadcastss(zmm(x0), Operand(input, kofs));
+          __ vbroadcastss(zmm(x1), Operand(input, kofs, times_1, 4));
+          for (int i = 0; i < phase.unrolls; ++i) {
+            Operand wpair(wptr, i * vecbytes);
+            __ vpslld(zmm(lo), wpair, 16);
+            __ vpandd(zmm(hi), zmm(himask), wpair);
+            __ vfmadd231ps(zmm(acc[i]), zmm(lo), zmm(x0));
+            __ vfmadd231ps(zmm(acc[i]), zmm(hi), zmm(x1));
+          }
+        } else {
+          __ vbroadcastss(ymm(x0), Operand(input, kofs));
+          __ vbroadcastss(ymm(x1), Operand(input, kofs, times_1, 4));
+          for (int i = 0; i < phase.unrolls; ++i) {
+            __ vmovdqu(ymm(hi), Operand(wptr, i * vecbytes));
+            __ vpslld(ymm(lo), ymm(hi), 16);
+            __ vandps(ymm(hi), ymm(hi), ymm(himask));
+            __ vfmadd231ps(ymm(acc[i]), ymm(lo), ymm(x0));
+            __ vfmadd231ps(ymm(acc[i]), ymm(hi), ymm(x1));
+          }
+        }
+        __ addq(wptr, Immediate(w->stride(0)));
+        __ addq(kofs, Immediate(kBF16Pair * dsize));
+        __ j(not_zero, &lk);
+      }
+
+      // The last pair of an odd float input only has a low element.
+      if (odd) {
+        if (avx512) {
+          __ vbroadcastss(zmm(x0), Operand(input));
+          for (int i = 0; i < phase.unrolls; ++i) {
+            __ vpslld(zmm(lo), Operand(wptr, i * vecbytes), 16);
+            __ vfmadd231ps(zmm(acc[i]), zmm(lo), zmm(x0));
+          }
+        } else {
+          __ vbroadcastss(ymm(x0), Operand(input));
+          for (int i = 0; i < phase.unrolls; ++i) {
+            __ vmovdqu(ymm(lo), Operand(wptr, i * vecbytes));
+            __ vpslld(ymm(lo), ymm(lo), 16);
+            __ vfmadd231ps(ymm(acc[i]), ymm(lo), ymm(x0));
+          }
+        }
+      }
+
+      // Store results.
+      for (int i = 0; i < phase.unrolls; ++i) {
+        int disp = i * vecbytes;
+        bool masked = phase.masked && i == phase.unrolls - 1;
+        if (avx512) {
+          if (masked) {
+            __ vmovups(Operand(output, col, times_1, disp), zmm(acc[i]),
+                       Mask(kmask, merging));
+          } else {
+            __ vmovups(Operand(output, col, times_1, disp), zmm(acc[i]));
+          }
+        } else {
+          if (masked) {
+            __ vmaskmovps(Operand(output, col, times_1, disp), ymm(mask),
+                          ymm(acc[i]));
+          } else {
+            __ vmovups(Operand(output, col, times_1, disp), ymm(acc[i]));
+          }
+        }
+      }
+
+      // Next column block.
+      if (phase.repeat > 1) {
+        int blksize = phase.unrolls * vecbytes;
+        __ addq(col, Immediate(blksize));
+        __ cmpq(col, Immediate((phase.start * sizeof(float)) +
+                               phase.repeat * blksize));
+        __ j(less, &lcol);
+      }
+    }
+
+    // Next row.
+    if (rows > 1) {
+      __ addq(input, Immediate(x->stride(0)));
+      __ addq(output, Immediate(y->stride(0)));
+      __ incq(row);
+      __ cmpq(row, Immediate(rows));
+      __ j(less, &lrow);
+    }
+
+    if (avx512) masm->kk().release(kmask);
+  }
+
+  int64 Complexity(const Step *step) override {
+    return step->input(0)->elements() * step->output(0)->dim(1) * 2;
+  }
+
+ private:
+  static YMMRegister ymm(int r) { return YMMRegister::from_code(r); }
+  static ZMMRegister zmm(int r) { return ZMMRegister::from_code(r); }
+};
+
+// Look up features in bfloat16 embedding matrix. The embedding vectors are
+// expanded to floats on load. Negative indices give zero vectors for Gather.
+// For pooling, leading negative indices are skipped and the next negative
+// index ends the feature list like for the float kernels.
+//
+// Gather(params:bfloat16[N,E], indices:int32[B,F,1]) -> result:float[B,F,E]
+// GatherSum/Avg/Max(params:bfloat16[N,E], indices:int32[B,F,1])
+//   -> result:float[B,E]
+class BF16Gather : public Kernel {
+ public:
+  // Pooling operations.
+  enum Pooling {NONE, SUM, AVG, MAX};
+
+  BF16Gather(Pooling pooling) : pooling_(pooling) {}
+
+  string Name() override { return "BF16" + Operation(); }
+  string Operation() override {
+    switch (pooling_) {
+      case NONE: return "Gather";
+      case SUM: return "GatherSum";
+      case AVG: return "GatherAvg";
+      case MAX: return "GatherMax";
+      default: return "???";
+    }
+  }
+
+  bool Supports(Step *step) override {
+    // Requires CPU with AVX2 support.
+    if (!HasBF16Expansion()) return false;
+
+    // Check inputs and output.
+    if (step->indegree() != 2 || step->outdegree() != 1) return false;
+    Tensor *params = step->input(0);
+    Tensor *indices = step->input(1);
+    Tensor *result = step->output(0);
+    if (params->type() != DT_BFLOAT16) return false;
+    if (indices->type() != DT_INT32) return false;
+    if (result->type() != DT_FLOAT) return false;
+
+    // Check shapes.
+    int batch = step->GetAttr("batch", 0);
+    if (!BF16GatherShapes(params->shape(), indices->shape(), result->shape(),
+                          batch, pooling_ != NONE)) {
+      return false;
+    }
+
+    return true;
+  }
+
+  void Adjust(Step *step) override {
+    step->input(0)->RequireOrder(ROW_MAJOR);
+    step->input(1)->RequireOrder(ROW_MAJOR);
+    step->output(0)->RequireOrder(ROW_MAJOR);
+    step->SetRegisterUsage(9);
+  }
+
+  void Generate(Step *step, MacroAssembler *masm) override {
+    // Get inputs and output.
+    Tensor *params = step->input(0);
+    Tensor *indices = step->input(1);
+    Tensor *result = step->output(0);
+    int dim = params->dim(1);
+    int outer = result->elements() / dim;
+    int features = indices->elements() / outer;
+
+    // Select vector instructions. Embedding vectors are processed in blocks
+    // of unrolled vectors.
+    Vectors v;
+    v.avx512 = CPU::Enabled(AVX512F) && dim % 16 == 0;
+    v.vecsize = v.avx512 ? 16 : 8;
+    int blocks = dim / v.vecsize;
+    v.unrolls = std::min(blocks, v.avx512 ? 8 : 4);
+    v.repeat = blocks / v.unrolls;
+    v.residual = blocks % v.unrolls;
+    step->set_variant(v.avx512 ? "AVX512" : "AVX2");
+
+    // Allocate registers.
+    Register src = masm->rr().alloc();
+    Register dst = masm->rr().alloc();
+    Register idx = masm->rr().alloc();
+    Register base = masm->rr().alloc();
+    Register ofs = masm->rr().alloc();
+    Register acc = masm->rr().alloc();
+    Register fidx = masm->rr().alloc();
+    Register fcnt = pooling_ == AVG ? masm->rr().alloc() : no_reg;
+    Register out = outer > 1 ? masm->rr().alloc() : no_reg;
+    std::vector<int> elem(v.unrolls);
+    for (auto &r : elem) r = masm->mm().alloc(v.avx512);
+    int zero = masm->mm().alloc(v.avx512);
+    int scalar = pooling_ == AVG ? masm->mm().alloc(false) : -1;
+
+    // Load tensor locations.
+    __ LoadTensorAddress(base, params);
+    __ LoadTensorAddress(idx, indices);
+    __ LoadTensorAddress(dst, result);
+    if (v.avx512) {
+      __ vpxord(zmm(zero), zmm(zero), zmm(zero));
+    } else {
+      __ vxorps(ymm(zero), ymm(zero), ymm(zero));
+    }
+
+    // Generators for computing the output vector blocks.
+    auto copy = [&](int r, const Operand &in, const Operand &out) {
+      Load(masm, v, r, in);
+      Store(masm, v, out, r);
+    };
+    auto accumulate = [&](int r, const Operand &in, const Operand &out) {
+      Load(masm, v, r, in);
+      if (v.avx512) {
+        if (pooling_ == MAX) {
+          __ vmaxps(zmm(r), zmm(r), out);
+        } else {
+          __ vaddps(zmm(r), zmm(r), out);
+        }
+      } else {
+        if (pooling_ == MAX) {
+          __ vmaxps(ymm(r), ymm(r), out);
+        } else {
+          __ vaddps(ymm(r), ymm(r), out);
+        }
+      }
+      Store(masm, v, out, r);
+    };
+    auto clear = [&](int r, const Operand &in, const Operand &out) {
+      Store(masm, v, out, zero);
+    };
+    auto scale = [&](int r, const Operand &in, const Operand &out) {
+      if (v.avx512) {
+        __ vmulps(zmm(r), zmm(scalar), out);
+      } else {
+        __ vmulps(ymm(r), ymm(scalar), out);
+      }
+      Store(masm, v, out, r);
+    };
+
+    // Loop over outputs.
+    Label lout;
+    if (outer > 1) {
+      __ xorq(out, out);
+      __ bind(&lout);
+    }
+
+    Label lempty, lnext;
+    if (pooling_ == NONE) {
+      // Look up embedding vector. Negative indices give zero vectors.
+      __ movsxlq(acc, Operand(idx));
+      __ testq(acc, acc);
+      __ j(negative, &lempty);
+      __ Multiply(acc, params->stride(0));
+      __ leaq(src, Operand(base, acc));
+      Blocks(masm, v, src, dst, ofs, elem, copy);
+    } else {
+      // Find first non-negative feature.
+      Label lfirst, lfeature, ldone;
+      __ xorq(fidx, fidx);
+      __ bind(&lfirst);
+      __ cmpq(fidx, Immediate(features));
+      __ j(greater_equal, &lempty);
+      __ movsxlq(acc, Operand(idx, fidx, times_4));
+      __ incq(fidx);
+      __ testq(acc, acc);
+      __ j(negative, &lfirst);
+
+      // Copy embedding vector for the first feature to the output.
+      __ Multiply(acc, params->stride(0));
+      __ leaq(src, Operand(base, acc));
+      Blocks(masm, v, src, dst, ofs, elem, copy);
+      if (pooling_ == AVG) __ movq(fcnt, Immediate(1));
+
+      // Combine the remaining features with the output until the first
+      // negative index.
+      __ bind(&lfeature);
+      __ cmpq(fidx, Immediate(features));
+      __ j(greater_equal, &ldone);
+      __ movsxlq(acc, Operand(idx, fidx, times_4));
+      __ testq(acc, acc);
+      __ j(negative, &ldone);
+      __ Multiply(acc, params->stride(0));
+      __ leaq(src, Operand(base, acc));
+      Blocks(masm, v, src, dst, ofs, elem, accumulate);
+      __ incq(fidx);
+      if (pooling_ == AVG) __ incq(fcnt);
+      __ jmp(&lfeature);
+      __ bind(&ldone);
+
+      // Divide by the number of features to get the average.
+      if (pooling_ == AVG) {
+        XMMRegister s = XMMRegister::from_code(scalar);
+        __ vcvtqsi2ss(s, s, fcnt);
+        __ vrcpss(s, s, s);
+        if (v.avx512) {
+          __ vbroadcastss(zmm(scalar), zmm(scalar));
+        } else {
+          __ vbroadcastss(ymm(scalar), ymm(scalar));
+        }
+        Blocks(masm, v, dst, dst, ofs, elem, scale);
+      }
+    }
+    __ jmp(&lnext);
+
+    // Output zero vector if there are no features.
+    __ bind(&lempty);
+    Blocks(masm, v, dst, dst, ofs, elem, clear);
+    __ bind(&lnext);
+
+    // Next output.
+    if (outer > 1) {
+      __ addq(idx, Immediate(features * sizeof(int32)));
+      __ addq(dst, Immediate(dim * sizeof(float)));
+      __ incq(out);
+      __ cmpq(out, Immediate(outer));
+      __ j(less, &lout);
+    }
+  }
+
+  int64 Complexity(const Step *step) override {
+    if (pooling_ == NONE) return step->output(0)->elements();
+    int64 ops = step->input(1)->elements() * step->input(0)->dim(1);
+    if (pooling_ == AVG) ops += step->output(0)->elements();
+    return ops;
+  }
+
+ private:
+  // Vector processing strategy for embedding vectors.
+  struct Vectors {
+    bool avx512;   // use 512-bit vectors; otherwise 256-bit vectors
+    int vecsize;   // number of floats per vector
+    int unrolls;   // number of vectors per block
+    int repeat;    // number of blocks
+    int residual;  // number of vectors after the last block
+  };
+
+  // Block generator called with vector register, input operand and output
+  // operand for each vector in the embedding vector.
+  typedef std::function<void(int, const Operand &, const Operand &)> Block;
+
+  // Generate code for all the vectors in an embedding vector. The input
+  // offsets are in bfloat16 bytes and the output offsets are in float bytes.
+  static void Blocks(MacroAssembler *masm, const Vectors &v,
+                     Register src, Register dst, Register ofs,
+                     const std::vector<int> &elem, const Block &block) {
+    int inbytes = v.vecsize * sizeof(uint16);
+    int outbytes = v.vecsize * sizeof(float);
+    int vectors = v.repeat * v.unrolls + v.residual;
+    int start = 0;
+    if (v.repeat > 1) {
+      Label l;
+      __ xorq(ofs, ofs);
+      __ bind(&l);
+      for (int i = 0; i < v.unrolls; ++i) {
+        block(elem[i],
+              Operand(src, ofs, times_1, i * inbytes),
+              Operand(dst, ofs, times_2, i * outbytes));
+      }
+      __ addq(ofs, Immediate(v.unrolls * inbytes));
+      __ cmpq(ofs, Immediate(v.repeat * v.unrolls * inbytes));
+      __ j(less, &l);
+      start = v.repeat * v.unrolls;
+    }
+    for (int i = start; i < vectors; ++i) {
+      block(elem[(i - start) % v.unrolls],
+            Operand(src, i * inbytes),
+            Operand(dst, i * outbytes));
+    }
+  }
+
+  // Load bfloat16 vector and expand it to floats.
+  static void Load(MacroAssembler *masm, const Vectors &v,
+                   int r, const Operand &src) {
+    if (v.avx512) {
+      __ vpmovzxwd(zmm(r), src);
+      __ vpslld(zmm(r), zmm(r), 16);
+    } else {
+      __ vpmovzxwd(ymm(r), src);
+      __ vpslld(ymm(r), ymm(r), 16);
+    }
+  }
+
+  // Store float vector.
+  static void Store(MacroAssembler *masm, const Vectors &v,
+                    const Operand &dst, int r) {
+    if (v.avx512) {
+      __ vmovups(dst, zmm(r));
+    } else {
+      __ vmovups(dst, ymm(r));
+    }
+  }
+
+  static YMMRegister ymm(int r) { return YMMRegister::from_code(r); }
+  static ZMMRegister zmm(int r) { return ZMMRegister::from_code(r); }
+
+  Pooling pooling_;  // pooling operation for combining vectors
+};
+
+// Conversion of large constant float weight matrices and embedding matrices
+// to bfloat16. This halves the memory and bandwidth for the parameters, which
+// dominates the cost of matmuls with a few rows and embedding lookups. MatMul
+// ops are replaced by BF16MatMul ops and the embedding matrices for Gather,
+// GatherSum, GatherAvg, and GatherMax ops are replaced by bfloat16 copies.
+// With AVX-512 BF16 support, the matmul activations are converted to bfloat16
+// by a ToBF16 op so the dot products can be computed with vdpbf16ps. Ops with
+// the attribute bf16=false are left untouched.
+class ConvertToBF16 : public Transformer {
+ public:
+  string Name() override { return "ConvertToBF16"; }
+
+  bool Transform(Flow *flow) override {
+    // The bfloat16 kernels require AVX2 and FMA3.
+    if (!HasBF16Expansion()) return false;
+
+    // Find matmuls and gathers with constant parameters.
+    std::vector<Flow::Operation *> matmuls;
+    std::vector<Flow::Operation *> gathers;
+    for (Flow::Operation *op : flow->ops()) {
+      if (!op->GetAttr("bf16", true)) continue;
+      if (ConvertibleMatMul(op)) matmuls.push_back(op);
+      if (ConvertibleGather(op)) gathers.push_back(op);
+    }
+    if (matmuls.empty() && gathers.empty()) return false;
+
+    // Replace matmuls with bfloat16 matmuls. Weight matrices shared by
+    // several ops are only converted once.
+    bool bf16 = HasBF16();
+    std::map<std::pair<Flow::Variable *, bool>, Flow::Variable *> packed;
+    std::set<Flow::Variable *> replaced;
+    for (Flow::Operation *op : matmuls) {
+      Flow::Variable *x = op->inputs[0];
+      Flow::Variable *w = op->inputs[1];
+      bool transposed = op->GetAttr("transpose_b", false);
+      int rows = x->dim(0);
+      int n = x->dim(1);
+
+      // Convert weights.
+      Flow::Variable *&weights = packed[std::make_pair(w, transposed)];
+      if (weights == nullptr) weights = PackWeights(flow, w, transposed);
+
+      // Add op for converting the activations.
+      Flow::Variable *input = x;
+      if (bf16) {
+        input = flow->AddVariable(op->name + "/bf16", DT_BFLOAT16,
+                                  {rows, RoundUp(n, kBF16Pair)});
+        flow->AddOperation(op->func, op->name + "/ToBF16", "ToBF16",
+                           {x}, {input});
+      }
+
+      // Change matmul into bfloat16 matmul.
+      op->RemoveInput(x);
+      op->RemoveInput(w);
+      op->AddInput(input);
+      op->AddInput(weights);
+      op->type = "BF16MatMul";
+      op->RemoveAttr("transpose_b");
+      replaced.insert(w);
+      VLOG(5) << "Converted " << op->name << " " << w->name << " to bf16";
+    }
+
+    // Replace embedding matrices for gathers with bfloat16 embeddings.
+    std::map<Flow::Variable *, Flow::Variable *> embeddings;
+    for (Flow::Operation *op : gathers) {
+      Flow::Variable *params = op->inputs[0];
+      Flow::Variable *&embedding = embeddings[params];
+      if (embedding == nullptr) embedding = ConvertEmbeddings(flow, params);
+      op->ReplaceInput(params, embedding);
+      replaced.insert(params);
+      VLOG(5) << "Converted " << op->name << " " << params->name << " to bf16";
+    }
+
+    // Remove the float parameters that are no longer used.
+    for (Flow::Variable *var : replaced) {
+      if (var->consumers.empty()) flow->DeleteVariable(var);
+    }
+
+    return true;
+  }
+
+ private:
+  // Check that variable is a dense constant float matrix.
+  static bool ConstantMatrix(Flow::Variable *var) {
+    if (!var->constant() || var->learnable()) return false;
+    if (var->type != DT_FLOAT || var->rank() != 2) return false;
+    if (!var->shape.defined()) return false;
+    if (var->size != var->elements() * sizeof(float)) return false;
+    if (var->elements() < kMinBF16Elements) return false;
+    return true;
+  }
+
+  // Check if matmul can be converted to bfloat16.
+  static bool ConvertibleMatMul(Flow::Operation *op) {
+    if (op->type != "MatMul") return false;
+    if (op->indegree() != 2 || op->outdegree() != 1) return false;
+    if (op->GetAttr("transpose_a", false)) return false;
+    if (op->GetAttr("transpose_c", false)) return false;
+
+    Flow::Variable *x = op->inputs[0];
+    Flow::Variable *w = op->inputs[1];
+    Flow::Variable *y = op->outputs[0];
+    if (x->type != DT_FLOAT || y->type != DT_FLOAT) return false;
+    if (x->rank() != 2 || y->rank() != 2) return false;
+    if (!x->shape.defined() || x->dynamic() || y->dynamic()) return false;
+    if (!ConstantMatrix(w)) return false;
+
+    // Check shapes.
+    bool transposed = op->GetAttr("transpose_b", false);
+    int n = transposed ? w->dim(1) : w->dim(0);
+    int m = transposed ? w->dim(0) : w->dim(1);
+    if (x->dim(1) != n) return false;
+    if (y->shape.defined() && y->shape != Shape({x->dim(0), m})) return false;
+
+    return true;
+  }
+
+  // Check if gather can use bfloat16 embeddings.
+  static bool ConvertibleGather(Flow::Operation *op) {
+    bool pooling;
+    if (op->type == "Gather") {
+      pooling = false;
+    } else if (op->type == "GatherSum" ||
+               op->type == "GatherAvg" ||
+               op->type == "GatherMax") {
+      pooling = true;
+    } else {
+      return false;
+    }
+    if (op->indegree() != 2 || op->outdegree() != 1) return false;
+
+    Flow::Variable *params = op->inputs[0];
+    Flow::Variable *indices = op->inputs[1];
+    Flow::Variable *result = op->outputs[0];
+    if (indices->type != DT_INT32 || result->type != DT_FLOAT) return false;
+    if (!indices->shape.defined() || !result->shape.defined()) return false;
+    if (indices->dynamic() || result->dynamic()) return false;
+    if (!ConstantMatrix(params)) return false;
+
+    int batch = op->GetAttr("batch", 0);
+    return BF16GatherShapes(params->shape, indices->shape, result->shape,
+                            batch, pooling);
+  }
+
+  // Convert weight matrix to bfloat16 pairs. The packed weights are named
+  // after the layout, since a matrix can be packed both plain and transposed
+  // and also be used as an embedding matrix.
+  static Flow::Variable *PackWeights(Flow *flow, Flow::Variable *w,
+                                     bool transposed) {
+    const float *data = reinterpret_cast<const float *>(w->data);
+    int n = transposed ? w->dim(1) : w->dim(0);
+    int m = transposed ? w->dim(0) : w->dim(1);
+    int pairs = RoundUp(n, kBF16Pair) / kBF16Pair;
+    int padded = RoundUp(m, kBF16ColumnAlign);
+    int stride = padded * kBF16Pair;
+
+    string name = w->name + (transposed ? "/bf16/transposed" : "/bf16");
+    Flow::Variable *weights =
+        flow->AddConstant(name, DT_BFLOAT16, {pairs, stride});
+    uint16 *packed = reinterpret_cast<uint16 *>(weights->data);
+    for (int k = 0; k < n; ++k) {
+      int p = k / kBF16Pair;
+      int e = k % kBF16Pair;
+      for (int j = 0; j < m; ++j) {
+        float v = transposed ? data[j * n + k] : data[k * m + j];
+        packed[p * stride + j * kBF16Pair + e] = FloatToBF16(v);
+      }
+    }
+
+    return weights;
+  }
+
+  // Convert embedding matrix to bfloat16.
+  static Flow::Variable *ConvertEmbeddings(Flow *flow,
+                                           Flow::Variable *params) {
+    const float *data = reinterpret_cast<const float *>(params->data);
+    Flow::Variable *embeddings = flow->AddConstant(
+        params->name + "/bf16/embeddings", DT_BFLOAT16, params->shape);
+    uint16 *converted = reinterpret_cast<uint16 *>(embeddings->data);
+    for (int i = 0; i < params->elements(); ++i) {
+      converted[i] = FloatToBF16(data[i]);
+    }
+    return embeddings;
+  }
+};
+
+// Register bfloat16 kernels.
+void RegisterBF16Kernels(Library *library) {
+  library->Register(new ToBF16());
+  library->Register(new BF16MatMul());
+  library->Register(new BF16Gather(BF16Gather::NONE));
+  library->Register(new BF16Gather(BF16Gather::SUM));
+  library->Register(new BF16Gather(BF16Gather::AVG));
+  library->Register(new BF16Gather(BF16Gather::MAX));
+}
+
+// Register bfloat16 transformations.
+void RegisterBF16Transforms(Library *library) {
+  library->RegisterTransformer(new ConvertToBF16());
+}
+
+}  // namespace myelin
+}  // namespace sling
@@ -19,6 +19,7 @@
 #include "sling/myelin/compute.h"
 #include "sling/myelin/builder.h"
 #include "sling/myelin/macro-assembler.h"
+#include "sling/myelin/kernel/library.h"
 
 #define __ masm->
 
@@ -221,7 +222,9 @@ class RemoveCommonSubexpressions : public Transformer {
   }
 };
 
-// Expand composite functions to basic operations.
+// Expand composite functions to basic operations. Normalization functions
+// that can be computed by the fused row kernels in normalize.cc are not
+// expanded.
 class CompositeTransformer : public Transformer {
  public:
   string Name() override { return "CompositeTransformer"; }
@@ -236,6 +239,7 @@ class CompositeTransformer : public Transformer {
     // for better numeric stablity.
     for (Flow::Operation *op : flow->Find("SoftMax")) {
       if (op->indegree() != 1 || op->outdegree() != 1) continue;
+      if (FusableNormalization(op)) continue;
 
       Flow::Variable *x = op->inputs[0];
       Flow::Variable *y = op->outputs[0];
@@ -259,6 +263,7 @@ class CompositeTransformer : public Transformer {
     // for better numeric stablity.
     for (Flow::Operation *op : flow->Find("LogSumExp")) {
       if (op->indegree() != 1 || op->outdegree() != 1) continue;
+      if (FusableNormalization(op)) continue;
 
       Flow::Variable *x = op->inputs[0];
       Flow::Variable *y = op->outputs[0];
@@ -278,6 +283,58 @@ class CompositeTransformer : public Transformer {
       updates++;
     }
 
+    // LogSoftMax is computed as:
+    //   LogSoftMax(x) = Sub(x, LogSumExp(x))
+    for (Flow::Operation *op : flow->Find("LogSoftMax")) {
+      if (op->indegree() != 1 || op->outdegree() != 1) continue;
+      if (FusableNormalization(op)) continue;
+
+      Flow::Variable *x = op->inputs[0];
+      Flow::Variable *y = op->outputs[0];
+      int axis = op->GetAttr("axis", -1);
+
+      FlowBuilder f(flow, op->func);
+      Scope s(&f, op->name, false);
+      auto *logsoftmax = f.Sub(x, f.LogSumExp(x, axis, axis != -1));
+
+      flow->RemoveOperation(op);
+      f.Bind(y, logsoftmax);
+
+      updates++;
+    }
+
+    // LayerNorm is defined as:
+    //   LayerNorm(x) = Mul(Sub(x, Mean(x)), Rsqrt(Add(Var(x), epsilon)))
+    //   LayerNorm(x, gamma, beta) = Add(Mul(LayerNorm(x), gamma), beta)
+    // over the last axis.
+    for (Flow::Operation *op : flow->Find("LayerNorm")) {
+      if (op->indegree() != 1 && op->indegree() != 3) continue;
+      if (op->outdegree() != 1) continue;
+      if (FusableNormalization(op)) continue;
+
+      Flow::Variable *x = op->inputs[0];
+      Flow::Variable *y = op->outputs[0];
+      if (x->rank() < 1) continue;
+      int axis = x->rank() - 1;
+      float epsilon = op->GetAttr("epsilon", 1e-6f);
+
+      FlowBuilder f(flow, op->func);
+      Scope s(&f, op->name, false);
+      auto *scale = f.Const(1.0 / x->dim(axis), x->type);
+      auto *centered = f.Sub(x, f.Mul(f.Sum(x, axis, true), scale));
+      auto *variance = f.Mul(f.Sum(f.Square(centered), axis, true), scale);
+      auto *rstd = f.Rsqrt(f.Add(variance, f.Const(epsilon, x->type)));
+      auto *norm = f.Mul(centered, rstd);
+      if (op->indegree() == 3) {
+        norm = f.Add(f.Mul(norm, op->inputs[1]), op->inputs[2]);
+      }
+
+      flow->RemoveOperation(op);
+      f.Bind(y, norm);
+
+      updates++;
+    }
+
     // Linear (pytorch) is defined as:
     //   Linear(x,w,b) = Add(MatMul(x, Transpose(w)), b)
     for (Flow::Operation *op : flow->Find("Linear")) {
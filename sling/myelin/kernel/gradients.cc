@@ -433,12 +433,23 @@ void sigmoid_grad(Flow::Operation *op, Gradients *g) {
 }
 
 // y = softmax(x)
-// dx =softmax(x) * (1 - softmax(x)) * dy = y * (1 - y) * dy
+// dx = y * (dy - sum(dy * y))
 void softmax_grad(Flow::Operation *op, Gradients *g) {
   auto x = op->inputs[0];
   auto y = op->outputs[0];
-  auto one = g->One(g->v(y)->type);
-  g->add(x, g->Mul(g->d(y), g->Mul(g->v(y), g->Sub(one, g->v(y)))));
+  int axis = op->GetAttr("axis", -1);
+  auto dot = g->Sum(g->Mul(g->d(y), g->v(y)), axis, axis != -1);
+  g->add(x, g->Mul(g->v(y), g->Sub(g->d(y), dot)));
+}
+
+// y = logsoftmax(x)
+// dx = dy - exp(y) * sum(dy)
+void logsoftmax_grad(Flow::Operation *op, Gradients *g) {
+  auto x = op->inputs[0];
+  auto y = op->outputs[0];
+  int axis = op->GetAttr("axis", -1);
+  auto sum = g->Sum(g->d(y), axis, axis != -1);
+  g->add(x, g->Sub(g->d(y), g->Mul(g->Exp(g->v(y)), sum)));
 }
 
 // y = logsumexp(x)
@@ -450,6 +461,50 @@ void logsumexp_grad(Flow::Operation *op, Gradients *g) {
   g->add(x, g->Mul(g->SoftMax(g->v(x), axis), g->d(y)));
 }
 
+// y = layernorm(x, gamma, beta) = xhat * gamma + beta
+// xhat = (x - mean(x)) * rstd, rstd = 1 / sqrt(var(x) + epsilon)
+// dxhat = dy * gamma
+// dx = rstd * (dxhat - mean(dxhat) - xhat * mean(dxhat * xhat))
+// dgamma = sum(dy * xhat)
+// dbeta = sum(dy)
+void layernorm_grad(Flow::Operation *op, Gradients *g) {
+  auto x = op->inputs[0];
+  auto y = op->outputs[0];
+  int axis = x->rank() - 1;
+  int size = x->shape.dim(axis);
+  int rows = x->shape.outer(axis);
+  float epsilon = op->GetAttr("epsilon", 1e-6f);
+
+  // Mean over the last axis.
+  auto scale = g->Const(1.0 / size, x->type);
+  auto mean = [&](Flow::Variable *v) {
+    return g->Mul(g->Sum(v, axis, true), scale);
+  };
+
+  // Recompute normalized input.
+  auto centered = g->Sub(g->v(x), mean(g->v(x)));
+  auto variance = mean(g->Square(centered));
+  auto rstd = g->Rsqrt(g->Add(variance, g->Const(epsilon, x->type)));
+  auto xhat = g->Mul(centered, rstd);
+
+  // Gradient for input.
+  auto dxhat = g->d(y);
+  if (op->indegree() == 3) dxhat = g->Mul(dxhat, g->v(op->inputs[1]));
+  auto dx = g->Sub(g->Sub(dxhat, mean(dxhat)),
+                   g->Mul(xhat, mean(g->Mul(dxhat, xhat))));
+  g->add(x, g->Mul(rstd, dx));
+
+  // Gradients for scale and bias are summed over all the rows.
+  if (op->indegree() == 3) {
+    auto gamma = op->inputs[1];
+    auto beta = op->inputs[2];
+    auto dgamma = g->Reshape(g->Mul(g->d(y), xhat), {rows, size});
+    auto dbeta = g->Reshape(g->d(y), {rows, size});
+    g->add(gamma, g->Reshape(g->Sum(dgamma, 0), gamma->shape));
+    g->add(beta, g->Reshape(g->Sum(dbeta, 0), beta->shape));
+  }
+}
+
 // y = erf(x)
 // dx = 2/sqrt(pi) exp(-x^2) * dy
 void erf_grad(Flow::Operation *op, Gradients *g) {
@@ -671,6 +726,8 @@ void RegisterStandardGradients() {
   RegisterGradient("Pow", pow_grad);
   RegisterGradient("Sigmoid", sigmoid_grad);
   RegisterGradient("SoftMax", softmax_grad);
+  RegisterGradient("LogSoftMax", logsoftmax_grad);
+  RegisterGradient("LayerNorm", layernorm_grad);
   RegisterGradient("LogSumExp", logsumexp_grad);
   RegisterGradient("Erf", erf_grad);
   RegisterGradient("Relu", relu_grad);
@@ -30,10 +30,13 @@ void RegisterStandardLibrary(Library *library, int flags) {
   RegisterConcatKernels(library);
   RegisterGatherKernels(library);
   RegisterReduceKernels(library);
+  RegisterNormalizationKernels(library);
   RegisterTransposeKernels(library);
   RegisterArrayKernels(library);
   RegisterArgMax(library);
   RegisterSIMDMatMulLibrary(library);
+  RegisterQuantizedKernels(library);
+  RegisterBF16Kernels(library);
   RegisterArithmeticLibrary(library);
   if ((flags & LIBRARY_NOPRECOMPUTE) == 0) {
     RegisterPrecomputeLibrary(library);
@@ -37,6 +37,10 @@ void InitExpression(const Step *step, Express *expr);
 // array.cc
 void RegisterArrayKernels(Library *library);
 
+// bfloat16.cc
+void RegisterBF16Kernels(Library *library);
+void RegisterBF16Transforms(Library *library);
+
 // concat.cc
 void RegisterConcatKernels(Library *library);
 
@@ -50,9 +54,17 @@ void RegisterGenericLibrary(Library *library);
 // gradients.cc
 void RegisterStandardGradients();
 
+// normalize.cc
+void RegisterNormalizationKernels(Library *library);
+bool FusableNormalization(const Flow::Operation *op);
+
 // precompute.cc
 void RegisterPrecomputeLibrary(Library *library);
 
+// quantize.cc
+void RegisterQuantizedKernels(Library *library);
+void RegisterQuantizationTransforms(Library *library);
+
 // reduce.cc
 void RegisterReduceKernels(Library *library);
 
@@ -0,0 +1,741 @@
+// Copyright 2025 Ringgaard Research ApS
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "sling/myelin/compute.h"
+#include "sling/myelin/express.h"
+#include "sling/myelin/macro-assembler.h"
+#include "sling/myelin/simd-assembler.h"
+#include "sling/myelin/generator/expression.h"
+#include "sling/myelin/generator/index.h"
+
+#define __ masm->
+
+namespace sling {
+namespace myelin {
+
+using namespace jit;
+
+// Binding of expression variable to memory location in a row computation.
+struct RowArg {
+  enum Kind {
+    VECTOR,    // row vector starting at base address
+    SINGLE,    // single element broadcast over the row
+    CONSTANT,  // constant value broadcast over the row
+  };
+
+  // Row vector at base address.
+  static RowArg Vector(Register base) {
+    return RowArg(VECTOR, base, 0, 0.0);
+  }
+
+  // Single element at base address plus displacement.
+  static RowArg Single(Register base, int disp = 0) {
+    return RowArg(SINGLE, base, disp, 0.0);
+  }
+
+  // Constant value.
+  static RowArg Constant(double value) {
+    return RowArg(CONSTANT, no_reg, 0, value);
+  }
+
+  RowArg(Kind kind, Register base, int disp, double value)
+      : kind(kind), base(base), disp(disp), value(value) {}
+
+  Kind kind;
+  Register base;
+  int disp;
+  double value;
+};
+
+// Index generator for expressions over the elements of a row. The kernel
+// generates the loop over the rows and binds the input and output variables of
+// the expression to row vectors, single elements, or constants. The index
+// generator generates the loop over the elements in the row.
+class RowIndexGenerator : public IndexGenerator {
+ public:
+  RowIndexGenerator(MacroAssembler *masm, Type type, int size,
+                    const std::vector<RowArg> &inputs,
+                    const std::vector<RowArg> &outputs)
+      : IndexGenerator(masm), type_(type), size_(size),
+        inputs_(inputs), outputs_(outputs) {}
+
+  void Initialize(size_t vecsize) override {
+    vecsize_ = vecsize;
+    single_ = size_ * element_size() <= vecsize_;
+  }
+
+  bool EnableSparse(Tensor *sparse) override { return false; }
+
+  bool AllocateRegisters() override {
+    if (!IndexGenerator::AllocateRegisters()) return false;
+    if (!single_) {
+      offset_ = masm_->rr().try_alloc();
+      if (!offset_.is_valid()) return false;
+    }
+    return true;
+  }
+
+  Operand addr(Express::Var *var, int disp) override {
+    if (var->type == Express::NUMBER) {
+      // System-defined constant.
+      switch (type_) {
+        case DT_FLOAT: {
+          float number = Express::NumericFlt32(var->id);
+          int repeat = vecsize_ / sizeof(float);
+          return masm_->GetConstant(number, repeat)->address();
+        }
+        case DT_DOUBLE: {
+          double number = Express::NumericFlt64(var->id);
+          int repeat = vecsize_ / sizeof(double);
+          return masm_->GetConstant(number, repeat)->address();
+        }
+        default:
+          LOG(FATAL) << "Unsupported constant type";
+          return Operand(no_reg);
+      }
+    }
+
+    const RowArg &arg = binding(var);
+    switch (arg.kind) {
+      case RowArg::VECTOR:
+        if (single_) return Operand(arg.base, disp);
+        return Operand(arg.base, offset_, times_1, disp);
+      case RowArg::SINGLE:
+        return Operand(arg.base, arg.disp + disp);
+      case RowArg::CONSTANT: {
+        // Constants are repeated to fill the vector.
+        if (type_ == DT_DOUBLE) {
+          int repeat = vecsize_ / sizeof(double);
+          return masm_->GetConstant(arg.value, repeat)->address();
+        } else {
+          float value = arg.value;
+          int repeat = vecsize_ / sizeof(float);
+          return masm_->GetConstant(value, repeat)->address();
+        }
+      }
+    }
+    return Operand(no_reg);
+  }
+
+  bool NeedsBroadcast(Express::Var *var) override {
+    if (var->type == Express::NUMBER) return false;
+    const RowArg &arg = binding(var);
+    return arg.kind == RowArg::SINGLE && vecsize_ > element_size();
+  }
+
+  const void *data(Express::Var *var) override {
+    LOG(FATAL) << "Constant tensors not supported in row expressions";
+    return nullptr;
+  }
+
+  // Check if the row can be computed without a loop.
+  bool single() const { return single_; }
+
+  // Generate start and end of loop over elements in row.
+  void GenerateLoopBegin() {
+    if (!single_) {
+      MacroAssembler *masm = masm_;
+      __ xorq(offset_, offset_);
+      __ bind(&begin_);
+    }
+  }
+
+  void GenerateLoopEnd() {
+    if (!single_) {
+      MacroAssembler *masm = masm_;
+      __ addq(offset_, Immediate(vecsize_));
+      __ cmpq(offset_, Immediate(size_ * element_size()));
+      __ j(less, &begin_);
+    }
+  }
+
+ private:
+  // Return binding for variable.
+  const RowArg &binding(Express::Var *var) const {
+    if (var->type == Express::OUTPUT) return outputs_[var->id];
+    CHECK_EQ(var->type, Express::INPUT);
+    return inputs_[var->id];
+  }
+
+  // Return element size.
+  size_t element_size() const { return TypeTraits::of(type_).size(); }
+
+  Type type_;                           // element type
+  int size_;                            // number of elements in row
+  const std::vector<RowArg> &inputs_;   // input variable bindings
+  const std::vector<RowArg> &outputs_;  // output variable bindings
+  size_t vecsize_ = 1;                  // vector size in bytes
+  bool single_ = false;                 // only one iteration needed
+  Register offset_ = no_reg;            // offset of current element in row
+  Label begin_;                         // start of loop
+};
+
+// Kernel for computing normalization functions over the rows of a tensor. The
+// row is either the last axis of the input or all the elements in the input.
+// Each row is processed with a number of expression passes over the row while
+// it is still in the cache. The per-row statistics like the maximum, the sum,
+// and the variance are kept in scratch slots on the stack between passes.
+class RowKernel : public Kernel {
+ public:
+  // Maximum number of statistics per row.
+  static const int kSlots = 4;
+
+  // Row context for code generation.
+  struct Row {
+    Type type;                      // element type
+    int size;                       // number of elements in row
+    std::vector<Register> inputs;   // base registers for inputs
+    std::vector<Register> outputs;  // base registers for outputs
+
+    // Inputs and outputs.
+    Register input(int index) const { return inputs[index]; }
+    Register output(int index) const { return outputs[index]; }
+
+    // Scratch slot for row statistic.
+    RowArg slot(int index) const { return RowArg::Single(rsp, index * 8); }
+  };
+
+  bool Supports(Step *step) override {
+    // Check input.
+    if (step->indegree() < 1 || step->outdegree() != 1) return false;
+    Tensor *x = step->input(0);
+    Tensor *y = step->output(0);
+    Type type = x->type();
+    if (type != DT_FLOAT && type != DT_DOUBLE) return false;
+    if (y->type() != type) return false;
+    if (!x->shape().defined() || x->elements() == 0) return false;
+
+    // Get row dimensions.
+    int rows, size;
+    int axis = step->GetAttr("axis", -1);
+    if (!GetRows(x->shape(), axis, &rows, &size)) return false;
+
+    // Check expression generator support.
+    return Selectable(step->indegree(), type, size);
+  }
+
+  // Check if the kernel can compute a flow operation. This makes the same
+  // checks as Supports() on the flow variables, so the composite transformer
+  // only keeps the operations that the kernel will be selected for.
+  virtual bool Fusable(const Flow::Operation *op) {
+    // Check input.
+    if (op->indegree() < 1 || op->outdegree() != 1) return false;
+    Flow::Variable *x = op->inputs[0];
+    Flow::Variable *y = op->outputs[0];
+    Type type = x->type;
+    if (type != DT_FLOAT && type != DT_DOUBLE) return false;
+    if (y->type != type) return false;
+    if (!x->shape.defined() || x->elements() == 0) return false;
+
+    // The kernel only runs on the host. Operations in tasks can be placed on
+    // a device, so these are not fused.
+    if (op->task != 0) return false;
+
+    // Get row dimensions.
+    int rows, size;
+    int axis = op->GetAttr("axis", -1);
+    if (!GetRows(x->shape, axis, &rows, &size)) return false;
+
+    // Check expression generator support.
+    return Selectable(op->indegree(), type, size);
+  }
+
+  void Adjust(Step *step) override {
+    // Require dense standard layout with vector alignment.
+    Type type = step->input(0)->type();
+    int vecbytes = SIMDAssembler::VectorBytes(type);
+    for (Tensor *t : step->inputs()) {
+      t->RequireStandardOrder();
+      t->RequireDense();
+      t->SetMiniumAlignment(vecbytes);
+    }
+    for (Tensor *t : step->outputs()) {
+      t->RequireStandardOrder();
+      t->RequireDense();
+      t->SetMiniumAlignment(vecbytes);
+    }
+
+    // Registers for inputs and outputs, the row counter, and the expressions.
+    step->SetRegisterUsage(step->indegree() + step->outdegree() + 3);
+  }
+
+  void Generate(Step *step, MacroAssembler *masm) override {
+    // Get row dimensions.
+    int rows, size;
+    int axis = step->GetAttr("axis", -1);
+    CHECK(GetRows(step->input(0)->shape(), axis, &rows, &size));
+    Row row;
+    row.type = step->input(0)->type();
+    row.size = size;
+    int dsize = TypeTraits::of(row.type).size();
+    int row_bytes = size * dsize;
+
+    // Load addresses of inputs and outputs. The first input and the outputs
+    // are advanced for each row whereas the other inputs are parameters
+    // shared by all rows. Outputs are either rows or one element per row.
+    std::vector<Register> bases;
+    std::vector<int> strides;
+    for (int i = 0; i < step->indegree(); ++i) {
+      Register base = masm->rr().alloc();
+      __ LoadTensorAddress(base, step->input(i));
+      row.inputs.push_back(base);
+      bases.push_back(base);
+      strides.push_back(i == 0 ? row_bytes : 0);
+    }
+    for (int i = 0; i < step->outdegree(); ++i) {
+      Tensor *y = step->output(i);
+      Register base = masm->rr().alloc();
+      __ LoadTensorAddress(base, y);
+      row.outputs.push_back(base);
+      bases.push_back(base);
+      strides.push_back(y->elements() == rows * size ? row_bytes : dsize);
+    }
+
+    // Allocate scratch slots for row statistics on the stack.
+    __ subq(rsp, Immediate(kSlots * 8));
+
+    // Loop over rows.
+    Register r = masm->rr().alloc();
+    Label lr;
+    if (rows > 1) {
+      __ xorq(r, r);
+      __ bind(&lr);
+    }
+
+    // Compute row.
+    string variant = GenerateRow(step, masm, row);
+    step->set_variant(variant);
+
+    // Next row.
+    if (rows > 1) {
+      for (int i = 0; i < bases.size(); ++i) {
+        if (strides[i] != 0) {
+          __ addq(bases[i], Immediate(strides[i]));
+        }
+      }
+      __ incq(r);
+      __ cmpq(r, Immediate(rows));
+      __ j(less, &lr);
+    }
+
+    // Release scratch slots.
+    __ addq(rsp, Immediate(kSlots * 8));
+  }
+
+  int64 Complexity(const Step *step) override {
+    int rows, size;
+    int axis = step->GetAttr("axis", -1);
+    if (!GetRows(step->input(0)->shape(), axis, &rows, &size)) return 0;
+    int64 ops = 0;
+    for (const string &recipe : Recipes(step->indegree())) {
+      Express expr;
+      expr.Parse(recipe);
+      ops += expr.Complexity();
+    }
+    return ops * rows * size;
+  }
+
+ protected:
+  // Get number of rows and row size for input shape.
+  virtual bool GetRows(const Shape &shape, int axis, int *rows, int *size) {
+    // The normalization is over the axis or over all the elements if no axis
+    // is specified. Only axes with no inner dimensions are supported.
+    if (axis == -1) {
+      *rows = 1;
+      *size = shape.elements();
+    } else {
+      if (axis < 0 || axis >= shape.rank()) return false;
+      if (shape.inner(axis + 1) != 1) return false;
+      *rows = shape.outer(axis);
+      *size = shape.dim(axis);
+    }
+    return *size > 0;
+  }
+
+  // Return recipes for the passes over each row for a number of inputs.
+  virtual std::vector<string> Recipes(int indegree) = 0;
+
+  // Check that there are expression generators for all the row passes.
+  bool Selectable(int indegree, Type type, int size) {
+    for (const string &recipe : Recipes(indegree)) {
+      Express expr;
+      expr.Parse(recipe);
+      auto *generator = ExpressionGenerator::Select(expr, type, size);
+      if (generator == nullptr) return false;
+      delete generator;
+    }
+    return true;
+  }
+
+  // Generate code for computing row. Returns the name of the expression
+  // generator for the row passes.
+  virtual string GenerateRow(Step *step, MacroAssembler *masm,
+                             const Row &row) = 0;
+
+  // Generate code for computing expression over the elements of the row, or
+  // over a single element if size is one. Returns the name of the expression
+  // generator.
+  static string Compute(MacroAssembler *masm, const Row &row, int size,
+                        const string &recipe,
+                        const std::vector<RowArg> &inputs,
+                        const std::vector<RowArg> &outputs) {
+    // Build expression. Inputs that are not row vectors are loop invariant.
+    // Scalar expressions are not marked since hoisting the whole expression
+    // out of the (empty) loop only increases the register pressure.
+    Express expr;
+    expr.Parse(recipe);
+    if (size > 1) {
+      for (auto *var : expr.vars()) {
+        if (var->type == Express::INPUT &&
+            inputs[var->id].kind != RowArg::VECTOR) {
+          var->single = true;
+        }
+      }
+    }
+
+    // The registers for the expression are released after the code for the
+    // expression has been generated.
+    Registers rr = masm->rr();
+    SIMDRegisters mm = masm->mm();
+    OpmaskRegisters kk = masm->kk();
+    bool approx = masm->options().fast_math;
+
+    // Count the number of spare SIMD registers for hoisting constants out of
+    // the loop. No constants are hoisted if there is no loop.
+    int spare_regs = 0;
+    {
+      RowIndexGenerator index(masm, row.type, size, inputs, outputs);
+      std::unique_ptr<ExpressionGenerator> generator(
+          ExpressionGenerator::Select(expr, row.type, size));
+      generator->set_approx(approx);
+      generator->Initialize(expr, row.type, 0, &index);
+      CHECK(index.AllocateRegisters()) << "Register overflow";
+      if (!index.single()) {
+        bool extended = index.extended_regs();
+        while (masm->mm().try_alloc(extended) != -1) spare_regs++;
+      }
+      masm->rr() = rr;
+      masm->mm() = mm;
+      masm->kk() = kk;
+    }
+
+    // Generate code for expression loop.
+    RowIndexGenerator index(masm, row.type, size, inputs, outputs);
+    std::unique_ptr<ExpressionGenerator> generator(
+        ExpressionGenerator::Select(expr, row.type, size));
+    generator->set_approx(approx);
+    generator->Initialize(expr, row.type, spare_regs, &index);
+    CHECK(index.AllocateRegisters()) << "Register overflow";
+    generator->GenerateInit(masm);
+    index.GenerateLoopBegin();
+    generator->GenerateBody(masm);
+    index.GenerateLoopEnd();
+    generator->GenerateEnd(masm);
+
+    masm->rr() = rr;
+    masm->mm() = mm;
+    masm->kk() = kk;
+    return generator->Name();
+  }
+};
+
+// Softmax over row:
+//   max = Max(x)
+//   y = Exp(x - max)
+//   y = y / Sum(y)
+// The exponentials are computed only once and the normalization is done in
+// place in the output.
+class SoftMax : public RowKernel {
+ public:
+  string Name() override { return "SoftMax"; }
+  string Operation() override { return "SoftMax"; }
+
+  bool Supports(Step *step) override {
+    if (step->indegree() != 1) return false;
+    if (step->input(0)->shape() != step->output(0)->shape()) return false;
+    return RowKernel::Supports(step);
+  }
+
+  bool Fusable(const Flow::Operation *op) override {
+    if (op->indegree() != 1 || op->outdegree() != 1) return false;
+    if (op->inputs[0]->shape != op->outputs[0]->shape) return false;
+    return RowKernel::Fusable(op);
+  }
+
+ protected:
+  std::vector<string> Recipes(int indegree) override {
+    return {
+      "@0=Max(%0)",
+      "$0=Exp(Sub(%0,%1));@0=Id($0);@1=Sum($0)",
+      "@0=Mul(%0,Reciprocal(%1))",
+    };
+  }
+
+  string GenerateRow(Step *step, MacroAssembler *masm,
+                     const Row &row) override {
+    auto recipes = Recipes(step->indegree());
+    auto x = RowArg::Vector(row.input(0));
+    auto y = RowArg::Vector(row.output(0));
+    auto max = row.slot(0);
+    auto sum = row.slot(1);
+    string name = Compute(masm, row, row.size, recipes[0], {x}, {max});
+    Compute(masm, row, row.size, recipes[1], {x, max}, {y, sum});
+    Compute(masm, row, row.size, recipes[2], {y, sum}, {y});
+    return name;
+  }
+};
+
+// Log-softmax over row:
+//   max = Max(x)
+//   sum = Sum(Exp(x - max))
+//   lse = max + Log(sum)
+//   y = x - lse
+class LogSoftMax : public RowKernel {
+ public:
+  string Name() override { return "LogSoftMax"; }
+  string Operation() override { return "LogSoftMax"; }
+
+  bool Supports(Step *step) override {
+    if (step->indegree() != 1) return false;
+    if (step->input(0)->shape() != step->output(0)->shape()) return false;
+    return RowKernel::Supports(step);
+  }
+
+  bool Fusable(const Flow::Operation *op) override {
+    if (op->indegree() != 1 || op->outdegree() != 1) return false;
+    if (op->inputs[0]->shape != op->outputs[0]->shape) return false;
+    return RowKernel::Fusable(op);
+  }
+
+ protected:
+  std::vector<string> Recipes(int indegree) override {
+    return {
+      "@0=Max(%0)",
+      "@0=Sum(Exp(Sub(%0,%1)))",
+      "@0=Add(%0,Log(%1))",
+      "@0=Sub(%0,%1)",
+    };
+  }
+
+  string GenerateRow(Step *step, MacroAssembler *masm,
+                     const Row &row) override {
+    auto recipes = Recipes(step->indegree());
+    auto x = RowArg::Vector(row.input(0));
+    auto y = RowArg::Vector(row.output(0));
+    auto max = row.slot(0);
+    auto sum = row.slot(1);
+    auto lse = row.slot(2);
+    string name = Compute(masm, row, row.size, recipes[0], {x}, {max});
+    Compute(masm, row, row.size, recipes[1], {x, max}, {sum});
+    Compute(masm, row, 1, recipes[2], {max, sum}, {lse});
+    Compute(masm, row, row.size, recipes[3], {x, lse}, {y});
+    return name;
+  }
+};
+
+// Log-sum-exp over row:
+//   max = Max(x)
+//   y = max + Log(Sum(Exp(x - max)))
+class LogSumExp : public RowKernel {
+ public:
+  string Name() override { return "LogSumExp"; }
+  string Operation() override { return "LogSumExp"; }
+
+  bool Supports(Step *step) override {
+    if (step->indegree() != 1) return false;
+    Tensor *x = step->input(0);
+    Tensor *y = step->output(0);
+    int axis = step->GetAttr("axis", -1);
+    bool keepdims = step->GetAttr("keepdims", false);
+    if (axis == -1) {
+      if (y->elements() != 1) return false;
+    } else {
+      if (axis < 0 || axis >= x->rank()) return false;
+      if (x->shape().reduced(axis, keepdims) != y->shape()) return false;
+    }
+    return RowKernel::Supports(step);
+  }
+
+  bool Fusable(const Flow::Operation *op) override {
+    if (op->indegree() != 1 || op->outdegree() != 1) return false;
+    Flow::Variable *x = op->inputs[0];
+    Flow::Variable *y = op->outputs[0];
+    int axis = op->GetAttr("axis", -1);
+    bool keepdims = op->GetAttr("keepdims", false);
+    if (axis == -1) {
+      if (y->elements() != 1) return false;
+    } else {
+      if (axis < 0 || axis >= x->rank()) return false;
+      if (x->shape.reduced(axis, keepdims) != y->shape) return false;
+    }
+    return RowKernel::Fusable(op);
+  }
+
+ protected:
+  std::vector<string> Recipes(int indegree) override {
+    return {
+      "@0=Max(%0)",
+      "@0=Sum(Exp(Sub(%0,%1)))",
+      "@0=Add(%0,Log(%1))",
+    };
+  }
+
+  string GenerateRow(Step *step, MacroAssembler *masm,
+                     const Row &row) override {
+    auto recipes = Recipes(step->indegree());
+    auto x = RowArg::Vector(row.input(0));
+    auto y = RowArg::Single(row.output(0));
+    auto max = row.slot(0);
+    auto sum = row.slot(1);
+    string name = Compute(masm, row, row.size, recipes[0], {x}, {max});
+    Compute(masm, row, row.size, recipes[1], {x, max}, {sum});
+    Compute(masm, row, 1, recipes[2], {max, sum}, {y});
+    return name;
+  }
+};
+
+// Layer normalization over the last axis with optional scale (gamma) and
+// bias (beta):
+//   y = (x - mean(x)) / sqrt(var(x) + epsilon) * gamma + beta
+// The mean and variance are computed in one pass over the row from the sum
+// and the sum of squares. The elements are shifted by the first element in the
+// row to avoid cancellation when the mean is large compared to the variance.
+class LayerNorm : public RowKernel {
+ public:
+  string Name() override { return "LayerNorm"; }
+  string Operation() override { return "LayerNorm"; }
+
+  bool Supports(Step *step) override {
+    // Check inputs and outputs.
+    if (step->indegree() != 1 && step->indegree() != 3) return false;
+    Tensor *x = step->input(0);
+    Tensor *y = step->output(0);
+    if (x->rank() < 1 || x->shape() != y->shape()) return false;
+
+    // Scale and bias must match the last dimension.
+    if (step->indegree() == 3) {
+      int size = x->dim(x->rank() - 1);
+      for (int i = 1; i < 3; ++i) {
+        Tensor *param = step->input(i);
+        if (param->type() != x->type()) return false;
+        if (param->elements() != size) return false;
+        if (size > 1 && param->dim(param->rank() - 1) != size) return false;
+      }
+    }
+    return RowKernel::Supports(step);
+  }
+
+  bool Fusable(const Flow::Operation *op) override {
+    // Check inputs and outputs.
+    if (op->indegree() != 1 && op->indegree() != 3) return false;
+    if (op->outdegree() != 1) return false;
+    Flow::Variable *x = op->inputs[0];
+    Flow::Variable *y = op->outputs[0];
+    if (x->rank() < 1 || x->shape != y->shape) return false;
+
+    // Scale and bias must match the last dimension.
+    if (op->indegree() == 3) {
+      int size = x->dim(x->rank() - 1);
+      for (int i = 1; i < 3; ++i) {
+        Flow::Variable *param = op->inputs[i];
+        if (param->type != x->type) return false;
+        if (param->elements() != size) return false;
+        if (size > 1 && param->dim(param->rank() - 1) != size) return false;
+      }
+    }
+    return RowKernel::Fusable(op);
+  }
+
+ protected:
+  bool GetRows(const Shape &shape, int axis, int *rows, int *size) override {
+    // Normalize over the last axis.
+    if (shape.rank() < 1) return false;
+    *rows = shape.outer(shape.rank() - 1);
+    *size = shape.dim(shape.rank() - 1);
+    return *size > 0;
+  }
+
+  std::vector<string> Recipes(int indegree) override {
+    std::vector<string> recipes = {
+      "$0=Sub(%0,%1);@0=Sum($0);@1=Sum(Mul($0,$0))",
+      "$0=Mul(%0,%2);@0=Add(%3,$0);"
+      "@1=Rsqrt(Add(Maximum(Sub(Mul(%1,%2),Mul($0,$0)),_0),%4))",
+    };
+    if (indegree == 3) {
+      recipes.push_back("@0=Add(Mul(Mul(Sub(%0,%1),%2),%3),%4)");
+    } else {
+      recipes.push_back("@0=Mul(Sub(%0,%1),%2)");
+    }
+    return recipes;
+  }
+
+  string GenerateRow(Step *step, MacroAssembler *masm,
+                     const Row &row) override {
+    auto recipes = Recipes(step->indegree());
+    auto x = RowArg::Vector(row.input(0));
+    auto y = RowArg::Vector(row.output(0));
+    auto shift = RowArg::Single(row.input(0));
+    auto sum = row.slot(0);
+    auto sumsq = row.slot(1);
+    auto mean = row.slot(2);
+    auto rstd = row.slot(3);
+    auto scale = RowArg::Constant(1.0 / row.size);
+    auto epsilon = RowArg::Constant(step->GetAttr("epsilon", 1e-6f));
+
+    // Compute sum and sum of squares of shifted elements.
+    string name = Compute(masm, row, row.size, recipes[0],
+                          {x, shift}, {sum, sumsq});
+
+    // Compute mean and reciprocal standard deviation.
+    Compute(masm, row, 1, recipes[1],
+            {sum, sumsq, scale, shift, epsilon}, {mean, rstd});
+
+    // Normalize row.
+    if (step->indegree() == 3) {
+      auto gamma = RowArg::Vector(row.input(1));
+      auto beta = RowArg::Vector(row.input(2));
+      Compute(masm, row, row.size, recipes[2],
+              {x, mean, rstd, gamma, beta}, {y});
+    } else {
+      Compute(masm, row, row.size, recipes[2], {x, mean, rstd}, {y});
+    }
+    return name;
+  }
+};
+
+// Check if normalization operation can be computed by a fused row kernel.
+bool FusableNormalization(const Flow::Operation *op) {
+  static RowKernel *kernels[] = {
+    new SoftMax(), new LogSoftMax(), new LogSumExp(), new LayerNorm(),
+  };
+  for (RowKernel *kernel : kernels) {
+    if (op->type == kernel->Operation()) return kernel->Fusable(op);
+  }
+  return false;
+}
+
+// Register normalization kernels.
+void RegisterNormalizationKernels(Library *library) {
+  library->Register(new SoftMax());
+  library->Register(new LogSoftMax());
+  library->Register(new LogSumExp());
+  library->Register(new LayerNorm());
+}
+
+}  // namespace myelin
+}  // namespace sling
@@ -0,0 +1,644 @@
+// Copyright 2025 Ringgaard Research ApS
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <float.h>
+#include <math.h>
+#include <string.h>
+#include <map>
+#include <vector>
+
+#include "sling/base/logging.h"
+#include "sling/base/types.h"
+#include "sling/myelin/compute.h"
+#include "sling/myelin/macro-assembler.h"
+
+#define __ masm->
+
+namespace sling {
+namespace myelin {
+
+using namespace jit;
+
+// Minimum number of weights in matrix for quantization.
+static const int kMinQuantizedWeights = 1024;
+
+// Quantized weight matrices are stored in groups of four consecutive input
+// elements for each output column, i.e. [n/4][m][4], so each 32-bit lane of
+// a SIMD register holds the weights for one output column. The columns are
+// padded to a multiple of 16 and the rows to a multiple of 4.
+static const int kQuantizedGroup = 4;
+static const int kQuantizedColumnAlign = 16;
+
+// Check if the CPU supports the AVX-512 VNNI instructions.
+static bool HasVNNI() {
+  return CPU::Enabled(AVX512F) && CPU::Enabled(AVX512VNNI);
+}
+
+// Round up to multiple.
+static int RoundUp(int n, int m) {
+  return (n + m - 1) / m * m;
+}
+
+// Quantize activations to unsigned 8-bit integers with a dynamic scale for
+// each row. The input is scaled so the element with the largest magnitude maps
+// to +/-range, and then range + 1 is added to make the result unsigned. The
+// dequantization scale, i.e. max|x| / range, is output for each row.
+//
+// Quantize(x:float[r,n]) -> q:uint8[r,n'], s:float[r]
+class Quantize : public Kernel {
+ public:
+  string Name() override { return "AVXQuantize"; }
+  string Operation() override { return "Quantize"; }
+
+  bool Supports(Step *step) override {
+    // Requires CPU with AVX2 support.
+    if (!CPU::Enabled(AVX2)) return false;
+
+    // Check inputs and outputs.
+    if (step->indegree() != 1 || step->outdegree() != 2) return false;
+    Tensor *x = step->input(0);
+    Tensor *q = step->output(0);
+    Tensor *s = step->output(1);
+    if (x->type() != DT_FLOAT || x->rank() != 2) return false;
+    if (q->type() != DT_UINT8 || q->rank() != 2) return false;
+    if (s->type() != DT_FLOAT || s->elements() != x->dim(0)) return false;
+    if (q->dim(0) != x->dim(0) || q->dim(1) < x->dim(1)) return false;
+
+    // Check quantization range.
+    int range = step->GetAttr("range", 127);
+    if (range < 1 || range > 127) return false;
+
+    return true;
+  }
+
+  void Adjust(Step *step) override {
+    step->input(0)->RequireOrder(ROW_MAJOR);
+    step->output(0)->RequireOrder(ROW_MAJOR);
+    step->input(0)->SetMiniumAlignment(32);
+  }
+
+  void Generate(Step *step, MacroAssembler *masm) override {
+    // Get input and outputs.
+    Tensor *x = step->input(0);
+    Tensor *q = step->output(0);
+    Tensor *s = step->output(1);
+    int range = step->GetAttr("range", 127);
+    int offset = range + 1;
+    int rows = x->dim(0);
+    int n = x->dim(1);
+    int padded = q->dim(1);
+    int main = n / 8 * 8;
+
+    // Allocate registers.
+    Register input = masm->rr().alloc();
+    Register output = masm->rr().alloc();
+    Register scale = masm->rr().alloc();
+    Register ofs = masm->rr().alloc();
+    Register qofs = masm->rr().alloc();
+    Register row = masm->rr().alloc();
+    Register tmp = masm->rr().alloc();
+    YMMRegister absmask = masm->mm().allocy();
+    YMMRegister bias = masm->mm().allocy();
+    YMMRegister maxabs = masm->mm().allocy();
+    YMMRegister aux = masm->mm().allocy();
+    YMMRegister factor = masm->mm().allocy();
+    YMMRegister v = masm->mm().allocy();
+    XMMRegister hi = masm->mm().allocx();
+
+    // Load tensor locations.
+    __ LoadTensorAddress(input, x);
+    __ LoadTensorAddress(output, q);
+    __ LoadTensorAddress(scale, s);
+
+    // Load constants.
+    auto *absbits = masm->GetConstant<int32>(0x7fffffff, 8);
+    auto *offsets = masm->GetConstant<int32>(offset, 8);
+    auto *tiny = masm->GetConstant<float>(FLT_MIN);
+    auto *unit = masm->GetConstant<float>(1.0f / range);
+    auto *limit = masm->GetConstant<float>(range);
+    __ vmovaps(absmask, Operand(absbits->address()));
+    __ vmovaps(bias, Operand(offsets->address()));
+
+    // Loop over rows.
+    Label lrow;
+    if (rows > 1) {
+      __ xorq(row, row);
+      __ bind(&lrow);
+    }
+
+    // Find maximum absolute value in row.
+    __ vxorps(maxabs, maxabs, maxabs);
+    if (main > 0) {
+      Label l1;
+      __ xorq(ofs, ofs);
+      __ LoopStart(&l1);
+      __ vandps(v, absmask, Operand(input, ofs));
+      __ vmaxps(maxabs, maxabs, v);
+      __ addq(ofs, Immediate(8 * sizeof(float)));
+      __ cmpq(ofs, Immediate(main * sizeof(float)));
+      __ j(less, &l1);
+      __ Reduce(REDUCE_MAX, DT_FLOAT, maxabs, aux);
+    }
+    for (int i = main; i < n; ++i) {
+      __ vmovss(v.xmm(), Operand(input, i * sizeof(float)));
+      __ vandps(v.xmm(), absmask.xmm(), v.xmm());
+      __ vmaxss(maxabs.xmm(), maxabs.xmm(), v.xmm());
+    }
+    __ vmaxss(maxabs.xmm(), maxabs.xmm(), Operand(tiny->address()));
+
+    // Output dequantization scale and compute quantization factor.
+    __ vmulss(v.xmm(), maxabs.xmm(), Operand(unit->address()));
+    __ vmovss(Operand(scale), v.xmm());
+    __ vmovss(v.xmm(), Operand(limit->address()));
+    __ vdivss(v.xmm(), v.xmm(), maxabs.xmm());
+    __ vbroadcastss(factor, v);
+
+    // Quantize eight elements at a time.
+    if (main > 0) {
+      Label l2;
+      __ xorq(ofs, ofs);
+      __ xorq(qofs, qofs);
+      __ LoopStart(&l2);
+      __ vmulps(v, factor, Operand(input, ofs));
+      __ vcvtps2dq(v, v);
+      __ vpaddd(v, v, bias);
+      __ vextractf128(hi, v, 1);
+      __ vpackssdw(v.xmm(), v.xmm(), hi);
+      __ vpackuswb(v.xmm(), v.xmm(), v.xmm());
+      __ vmovq(Operand(output, qofs), v.xmm());
+      __ addq(ofs, Immediate(8 * sizeof(float)));
+      __ addq(qofs, Immediate(8));
+      __ cmpq(ofs, Immediate(main * sizeof(float)));
+      __ j(less, &l2);
+    }
+
+    // Quantize residual elements.
+    for (int i = main; i < n; ++i) {
+      __ vmulss(v.xmm(), factor.xmm(), Operand(input, i * sizeof(float)));
+      __ vcvtps2dq(v.xmm(), v.xmm());
+      __ vmovd(tmp, v.xmm());
+      __ addl(tmp, Immediate(offset));
+      __ movb(Operand(output, i), tmp);
+    }
+
+    // Padding elements are set to the zero point.
+    for (int i = n; i < padded; ++i) {
+      __ movb(Operand(output, i), Immediate(offset));
+    }
+
+    // Next row.
+    if (rows > 1) {
+      __ addq(input, Immediate(x->stride(0)));
+      __ addq(output, Immediate(q->stride(0)));
+      __ addq(scale, Immediate(sizeof(float)));
+      __ incq(row);
+      __ cmpq(row, Immediate(rows));
+      __ j(less, &lrow);
+    }
+  }
+
+  int64 Complexity(const Step *step) override {
+    return step->input(0)->elements() * 3;
+  }
+};
+
+// Matrix multiplication of quantized activations and quantized weights. The
+// integer dot products are accumulated in 32-bit lanes, one for each output
+// column, and then converted back to floats using the row scale for the
+// activations and the column scales for the weights. The zero point offset for
+// the unsigned activations is removed by subtracting a pre-computed
+// compensation term, i.e. (range + 1) times the column sum of the weights.
+//
+// QuantizedMatMul(q:uint8[r,n'], s:float[r], W:int8[n'/4,m'*4],
+//                 scales:float[m'], comp:int32[m']) -> y:float[r,m]
+//
+// With AVX-512 VNNI the dot products are computed with vpdpbusd. Otherwise the
+// byte products are computed with vpmaddubsw and summed with vpmaddwd. Since
+// vpmaddubsw saturates at 16 bits, the activations must be quantized to seven
+// bits in this case.
+class QuantizedMatMul : public Kernel {
+ public:
+  string Name() override { return "QuantizedMatMul"; }
+  string Operation() override { return "QuantizedMatMul"; }
+
+  bool Supports(Step *step) override {
+    // Requires CPU with AVX2 support.
+    if (!CPU::Enabled(AVX2)) return false;
+
+    // Check inputs and outputs.
+    if (step->indegree() != 5 || step->outdegree() != 1) return false;
+    Tensor *q = step->input(0);
+    Tensor *s = step->input(1);
+    Tensor *w = step->input(2);
+    Tensor *scales = step->input(3);
+    Tensor *comp = step->input(4);
+    Tensor *y = step->output(0);
+
+    // Check types.
+    if (q->type() != DT_UINT8 || s->type() != DT_FLOAT) return false;
+    if (w->type() != DT_INT8 || scales->type() != DT_FLOAT) return false;
+    if (comp->type() != DT_INT32 || y->type() != DT_FLOAT) return false;
+
+    // Check shapes.
+    if (q->rank() != 2 || w->rank() != 2 || y->rank() != 2) return false;
+    int rows = q->dim(0);
+    int padded = scales->elements();
+    if (s->elements() != rows || y->dim(0) != rows) return false;
+    if (q->dim(1) % kQuantizedGroup != 0) return false;
+    if (padded % kQuantizedColumnAlign != 0) return false;
+    if (comp->elements() != padded || y->dim(1) > padded) return false;
+    if (w->dim(0) != q->dim(1) / kQuantizedGroup) return false;
+    if (w->dim(1) != padded * kQuantizedGroup) return false;
+
+    // Activations must be in seven bit range without VNNI support.
+    int range = step->GetAttr("range", 127);
+    if (range > 63 && !HasVNNI()) return false;
+
+    return true;
+  }
+
+  void Adjust(Step *step) override {
+    step->input(0)->RequireOrder(ROW_MAJOR);
+    step->input(2)->RequireOrder(ROW_MAJOR);
+    step->output(0)->RequireOrder(ROW_MAJOR);
+    step->input(2)->SetMiniumAlignment(64);
+    step->input(3)->SetMiniumAlignment(64);
+    step->input(4)->SetMiniumAlignment(64);
+    step->SetRegisterUsage(11);
+  }
+
+  void Generate(Step *step, MacroAssembler *masm) override {
+    // Get inputs and output.
+    Tensor *q = step->input(0);
+    Tensor *s = step->input(1);
+    Tensor *w = step->input(2);
+    Tensor *scales = step->input(3);
+    Tensor *comp = step->input(4);
+    Tensor *y = step->output(0);
+    int rows = q->dim(0);
+    int groups = q->dim(1) / kQuantizedGroup;
+    int columns = y->dim(1);
+
+    // Select vector instructions.
+    bool vnni = HasVNNI();
+    int vecsize = vnni ? 16 : 8;
+    int vecbytes = vecsize * sizeof(int32);
+    int maxunrolls = vnni ? 8 : 4;
+    step->set_variant(vnni ? "VNNI" : "AVX2");
+
+    // Allocate registers.
+    Register input = masm->rr().alloc();
+    Register scale = masm->rr().alloc();
+    Register weights = masm->rr().alloc();
+    Register wscales = masm->rr().alloc();
+    Register compensation = masm->rr().alloc();
+    Register output = masm->rr().alloc();
+    Register col = masm->rr().alloc();
+    Register kofs = masm->rr().alloc();
+    Register wptr = masm->rr().alloc();
+    Register row = masm->rr().alloc();
+    std::vector<int> acc(maxunrolls);
+    std::vector<int> prod(vnni ? 0 : maxunrolls);
+    for (auto &r : acc) r = masm->mm().alloc(vnni);
+    for (auto &r : prod) r = masm->mm().alloc();
+    int xb = masm->mm().alloc(vnni);
+    int factor = masm->mm().alloc(vnni);
+    int ones = vnni ? -1 : masm->mm().alloc();
+    int mask = vnni ? -1 : masm->mm().alloc();
+    OpmaskRegister kmask = vnni ? masm->kk().alloc() : no_opmask_reg;
+
+    // Load tensor locations. The input pointer points to the end of the
+    // current row, so it can be indexed by a negative offset.
+    __ LoadTensorAddress(input, q);
+    __ addq(input, Immediate(groups * kQuantizedGroup));
+    __ LoadTensorAddress(scale, s);
+    __ LoadTensorAddress(weights, w);
+    __ LoadTensorAddress(wscales, scales);
+    __ LoadTensorAddress(compensation, comp);
+    __ LoadTensorAddress(output, y);
+
+    // Set up mask for last partial block of output columns.
+    int full = columns / vecsize;
+    int partial = columns % vecsize;
+    if (partial > 0) {
+      if (vnni) {
+        __ LoadMask(partial, kmask);
+      } else {
+        int32 bits[8];
+        for (int i = 0; i < 8; ++i) bits[i] = i < partial ? -1 : 0;
+        auto *maskbits = masm->GetData(bits, sizeof(bits));
+        __ vmovaps(ymm(mask), Operand(maskbits->address()));
+      }
+    }
+    if (!vnni) {
+      auto *one = masm->GetConstant<int16>(1, 16);
+      __ vmovaps(ymm(ones), Operand(one->address()));
+    }
+
+    // Break the output columns into phases of unrolled blocks.
+    struct Phase {
+      int start;    // first column in phase
+      int unrolls;  // number of blocks computed in parallel
+      int repeat;   // number of iterations
+      bool masked;  // last block is partial
+    };
+    std::vector<Phase> phases;
+    int unrolls = std::min(full, maxunrolls);
+    if (unrolls > 0) {
+      int repeat = full / unrolls;
+      phases.push_back({0, unrolls, repeat, false});
+      int residual = full - repeat * unrolls;
+      if (residual > 0) {
+        phases.push_back({repeat * unrolls * vecsize, residual, 1, false});
+      }
+    }
+    if (partial > 0) phases.push_back({full * vecsize, 1, 1, true});
+
+    // Loop over rows.
+    Label lrow;
+    if (rows > 1) {
+      __ xorq(row, row);
+      __ bind(&lrow);
+    }
+    if (vnni) {
+      __ vbroadcastss(zmm(factor), Operand(scale));
+    } else {
+      __ vbroadcastss(ymm(factor), Operand(scale));
+    }
+
+    for (auto &phase : phases) {
+      // Loop over column blocks in phase.
+      Label lcol;
+      __ movq(col, Immediate(phase.start * sizeof(int32)));
+      if (phase.repeat > 1) __ bind(&lcol);
+
+      // Compute dot products between row and column blocks.
+      for (int i = 0; i < phase.unrolls; ++i) {
+        if (vnni) {
+          __ vpxord(zmm(acc[i]), zmm(acc[i]), zmm(acc[i]));
+        } else {
+          __ vpxor(ymm(acc[i]), ymm(acc[i]), ymm(acc[i]));
+        }
+      }
+      __ movq(kofs, Immediate(-groups * kQuantizedGroup));
+      __ leaq(wptr, Operand(weights, col));
+      Label lk;
+      __ LoopStart(&lk);
+      if (vnni) {
+        __ vpbroadcastd(zmm(xb), Operand(input, kofs));
+        for (int i = 0; i < phase.unrolls; ++i) {
+          __ vpdpbusd(zmm(acc[i]), zmm(xb), Operand(wptr, i * vecbytes));
+        }
+      } else {
+        __ vpbroadcastd(ymm(xb), Operand(input, kofs));
+        for (int i = 0; i < phase.unrolls; ++i) {
+          __ vpmaddubsw(ymm(prod[i]), ymm(xb), Operand(wptr, i * vecbytes));
+          __ vpmaddwd(ymm(prod[i]), ymm(prod[i]), ymm(ones));
+          __ vpaddd(ymm(acc[i]), ymm(acc[i]), ymm(prod[i]));
+        }
+      }
+      __ addq(wptr, Immediate(w->stride(0)));
+      __ addq(kofs, Immediate(kQuantizedGroup));
+      __ j(not_zero, &lk);
+
+      // Dequantize and store results.
+      for (int i = 0; i < phase.unrolls; ++i) {
+        int disp = i * vecbytes;
+        bool masked = phase.masked && i == phase.unrolls - 1;
+        if (vnni) {
+          ZMMRegister r = zmm(acc[i]);
+          __ vpsubd(r, r, Operand(compensation, col, times_1, disp));
+          __ vcvtdq2ps(r, r);
+          __ vmulps(r, r, Operand(wscales, col, times_1, disp));
+          __ vmulps(r, r, zmm(factor));
+          if (masked) {
+            __ vmovups(Operand(output, col, times_1, disp), r,
+                       Mask(kmask, merging));
+          } else {
+            __ vmovups(Operand(output, col, times_1, disp), r);
+          }
+        } else {
+          YMMRegister r = ymm(acc[i]);
+          __ vpsubd(r, r, Operand(compensation, col, times_1, disp));
+          __ vcvtdq2ps(r, r);
+          __ vmulps(r, r, Operand(wscales, col, times_1, disp));
+          __ vmulps(r, r, ymm(factor));
+          if (masked) {
+            __ vmaskmovps(Operand(output, col, times_1, disp), ymm(mask), r);
+          } else {
+            __ vmovups(Operand(output, col, times_1, disp), r);
+          }
+        }
+      }
+
+      // Next column block.
+      if (phase.repeat > 1) {
+        int blksize = phase.unrolls * vecbytes;
+        __ addq(col, Immediate(blksize));
+        __ cmpq(col, Immediate((phase.start * sizeof(int32)) +
+                               phase.repeat * blksize));
+        __ j(less, &lcol);
+      }
+    }
+
+    // Next row.
+    if (rows > 1) {
+      __ addq(input, Immediate(q->stride(0)));
+      __ addq(scale, Immediate(sizeof(float)));
+      __ addq(output, Immediate(y->stride(0)));
+      __ incq(row);
+      __ cmpq(row, Immediate(rows));
+      __ j(less, &lrow);
+    }
+
+    if (vnni) masm->kk().release(kmask);
+  }
+
+  int64 Complexity(const Step *step) override {
+    return step->input(0)->elements() * step->output(0)->dim(1) * 2;
+  }
+
+ private:
+  static YMMRegister ymm(int r) { return YMMRegister::from_code(r); }
+  static ZMMRegister zmm(int r) { return ZMMRegister::from_code(r); }
+};
+
+// Post-training quantization of matrix multiplications with constant float
+// weight matrices. The weights are quantized to signed 8-bit integers with a
+// scale for each output column, and the MatMul is replaced by a Quantize op
+// for the activations followed by a QuantizedMatMul. Ops with the attribute
+// quantize=false are left untouched.
+class QuantizeMatMul : public Transformer {
+ public:
+  string Name() override { return "QuantizeMatMul"; }
+
+  bool Transform(Flow *flow) override {
+    // Quantized kernels require AVX2.
+    if (!CPU::Enabled(AVX2)) return false;
+
+    // Find matmuls with constant weight matrices.
+    std::vector<Flow::Operation *> candidates;
+    for (Flow::Operation *op : flow->ops()) {
+      if (Quantizable(op)) candidates.push_back(op);
+    }
+    if (candidates.empty()) return false;
+
+    // The activations can use the full eight bits with VNNI support.
+    int range = HasVNNI() ? 127 : 63;
+
+    // Replace matmuls with quantized matmuls. Weight matrices shared by
+    // several ops with the same layout are only quantized once.
+    std::map<std::pair<Flow::Variable *, bool>, Weights> quantized;
+    for (Flow::Operation *op : candidates) {
+      Flow::Variable *x = op->inputs[0];
+      Flow::Variable *w = op->inputs[1];
+      bool transposed = op->GetAttr("transpose_b", false);
+      int rows = x->dim(0);
+      int n = x->dim(1);
+
+      // Quantize weights.
+      Weights &weights = quantized[std::make_pair(w, transposed)];
+      if (weights.data == nullptr) {
+        weights = QuantizeWeights(flow, w, transposed, range + 1);
+      }
+
+      // Add op for quantizing the activations.
+      int padded = RoundUp(n, kQuantizedGroup);
+      auto *q = flow->AddVariable(op->name + "/quantized", DT_UINT8,
+                                  {rows, padded});
+      auto *s = flow->AddVariable(op->name + "/scale", DT_FLOAT, {rows});
+      auto *quantize = flow->AddOperation(op->func, op->name + "/Quantize",
+                                          "Quantize", {x}, {q, s});
+      quantize->SetAttr("range", range);
+
+      // Change matmul into quantized matmul.
+      op->RemoveInput(x);
+      op->RemoveInput(w);
+      op->AddInput(q);
+      op->AddInput(s);
+      op->AddInput(weights.data);
+      op->AddInput(weights.scales);
+      op->AddInput(weights.comp);
+      op->type = "QuantizedMatMul";
+      op->RemoveAttr("transpose_b");
+      op->SetAttr("range", range);
+      VLOG(5) << "Quantized " << op->name << " " << w->name;
+    }
+
+    return true;
+  }
+
+ private:
+  // Quantized weights.
+  struct Weights {
+    Flow::Variable *data = nullptr;    // quantized weight matrix
+    Flow::Variable *scales = nullptr;  // column scales
+    Flow::Variable *comp = nullptr;    // zero point compensation
+  };
+
+  // Check if matmul can be quantized.
+  static bool Quantizable(Flow::Operation *op) {
+    if (op->type != "MatMul") return false;
+    if (op->indegree() != 2 || op->outdegree() != 1) return false;
+    if (!op->GetAttr("quantize", true)) return false;
+    if (op->GetAttr("transpose_a", false)) return false;
+    if (op->GetAttr("transpose_c", false)) return false;
+
+    Flow::Variable *x = op->inputs[0];
+    Flow::Variable *w = op->inputs[1];
+    Flow::Variable *y = op->outputs[0];
+    if (x->type != DT_FLOAT || w->type != DT_FLOAT) return false;
+    if (y->type != DT_FLOAT) return false;
+    if (x->rank() != 2 || w->rank() != 2 || y->rank() != 2) return false;
+    if (!x->shape.defined() || !w->shape.defined()) return false;
+    if (x->dynamic() || y->dynamic()) return false;
+
+    // Only constant weights can be quantized.
+    if (!w->constant() || w->learnable()) return false;
+    if (w->size != w->elements() * sizeof(float)) return false;
+    if (w->elements() < kMinQuantizedWeights) return false;
+
+    // Check shapes.
+    bool transposed = op->GetAttr("transpose_b", false);
+    int n = transposed ? w->dim(1) : w->dim(0);
+    int m = transposed ? w->dim(0) : w->dim(1);
+    if (x->dim(1) != n) return false;
+    if (y->shape.defined() && y->shape != Shape({x->dim(0), m})) return false;
+
+    return true;
+  }
+
+  // Quantize weight matrix with a scale for each output column.
+  static Weights QuantizeWeights(Flow *flow, Flow::Variable *w,
+                                 bool transposed, int offset) {
+    const float *data = reinterpret_cast<const float *>(w->data);
+    int n = transposed ? w->dim(1) : w->dim(0);
+    int m = transposed ? w->dim(0) : w->dim(1);
+    int groups = RoundUp(n, kQuantizedGroup) / kQuantizedGroup;
+    int padded = RoundUp(m, kQuantizedColumnAlign);
+    int stride = padded * kQuantizedGroup;
+
+    Weights weights;
+    string name = transposed ? w->name + "/transposed" : w->name;
+    weights.data = flow->AddConstant(name + "/int8", DT_INT8,
+                                     {groups, stride});
+    weights.scales = flow->AddConstant(name + "/scales", DT_FLOAT, {padded});
+    weights.comp = flow->AddConstant(name + "/comp", DT_INT32, {padded});
+    int8 *packed = reinterpret_cast<int8 *>(weights.data->data);
+    float *scales = reinterpret_cast<float *>(weights.scales->data);
+    int32 *comp = reinterpret_cast<int32 *>(weights.comp->data);
+
+    for (int j = 0; j < m; ++j) {
+      // Find largest weight magnitude in column.
+      auto weight = [&](int k) {
+        return transposed ? data[j * n + k] : data[k * m + j];
+      };
+      float maxabs = 0.0;
+      for (int k = 0; k < n; ++k) {
+        maxabs = std::max(maxabs, fabsf(weight(k)));
+      }
+      float factor = maxabs > 0.0 ? 127.0 / maxabs : 0.0;
+      scales[j] = maxabs / 127.0;
+
+      // Quantize column.
+      int32 sum = 0;
+      for (int k = 0; k < n; ++k) {
+        int v = lrintf(weight(k) * factor);
+        if (v > 127) v = 127;
+        if (v < -127) v = -127;
+        int g = k / kQuantizedGroup;
+        int e = k % kQuantizedGroup;
+        packed[g * stride + j * kQuantizedGroup + e] = v;
+        sum += v;
+      }
+      comp[j] = sum * offset;
+    }
+
+    return weights;
+  }
+};
+
+// Register quantized kernels.
+void RegisterQuantizedKernels(Library *library) {
+  library->Register(new Quantize());
+  library->Register(new QuantizedMatMul());
+}
+
+// Register quantization transformations.
+void RegisterQuantizationTransforms(Library *library) {
+  library->RegisterTransformer(new QuantizeMatMul());
+}
+
+}  // namespace myelin
+}  // namespace sling
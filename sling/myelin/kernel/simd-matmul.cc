@@ -12,6 +12,7 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <algorithm>
 #include <string>
 #include <utility>
 
@@ -273,6 +274,20 @@ class SIMDMatMul : public Kernel {
       args.b().tensor->RequireOrder(ROW_MAJOR);
     }
 
+    // The loop order for the matrix multiplication is determined by the
+    // element order of B. The order of a constant B matrix can be tuned with
+    // the loop_order attribute, where vertical summation uses row-major and
+    // horizontal summation uses column-major order for B.
+    const string &loop_order = step->GetAttr("loop_order");
+    Tensor *b = args.b().tensor;
+    if (!loop_order.empty() && b->constant() &&
+        b->order() == ANY_ORDER && b->consumers().size() == 1 &&
+        args.a().batch_size() == 1 && !args.c().transposed) {
+      bool column = loop_order == "horizontal";
+      if (args.b().transposed) column = !column;
+      b->RequireOrder(column ? COLUMN_MAJOR : ROW_MAJOR);
+    }
+
     // Set alignment.
     Type type = args.c().type();
     int vecbytes = SIMDAssembler::VectorBytes(type);
@@ -347,7 +362,7 @@ class SIMDMatMul : public Kernel {
     }
 
     // Compute vector processing strategy.
-    SIMDStrategy strategy(&sasm, args.b().width());
+    SIMDStrategy strategy(&sasm, args.b().width(), MaxUnrolls(step));
     strategy.PreloadMasks();
 
     // Allocate registers.
@@ -594,7 +609,7 @@ class SIMDMatMul : public Kernel {
     CHECK_EQ(args.a().batch_size(), 1);
 
     // Compute vector processing strategy.
-    SIMDStrategy strategy(&sasm, args.b().width());
+    SIMDStrategy strategy(&sasm, args.b().width(), MaxUnrolls(step));
     strategy.PreloadMasks();
 
     // Allocate registers.
@@ -840,7 +855,7 @@ class SIMDMatMul : public Kernel {
     step->set_variant(sasm.name() + "VI");
 
     // Compute vector processing strategy.
-    SIMDStrategy strategy(&sasm, args.a().columns());
+    SIMDStrategy strategy(&sasm, args.a().columns(), MaxUnrolls(step));
     strategy.PreloadMasks();
 
     // Allocate registers.
@@ -960,7 +975,7 @@ class SIMDMatMul : public Kernel {
     step->set_variant(sasm.name() + "VO");
 
     // Compute vector processing strategy.
-    SIMDStrategy strategy(&sasm, args.a().rows());
+    SIMDStrategy strategy(&sasm, args.a().rows(), MaxUnrolls(step));
     strategy.PreloadMasks();
 
     // Get matrix dimensions.
@@ -1131,6 +1146,13 @@ class SIMDMatMul : public Kernel {
     }
   }
 
+  // Maximum number of unrolls for the vector processing strategy. This can be
+  // tuned with the unroll attribute.
+  static int MaxUnrolls(const Step *step) {
+    int unrolls = step->GetAttr("unroll", SIMDStrategy::kMaxUnrolls);
+    return std::max(1, std::min(unrolls, SIMDStrategy::kMaxUnrolls));
+  }
+
   int64 Complexity(const Step *step) override {
     MatMulArgs args(step);
     int64 ops = args.c().tensor->elements();
@@ -0,0 +1,322 @@
+// Copyright 2025 Ringgaard Research ApS
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "sling/myelin/partitioner.h"
+
+#include <string.h>
+#include <algorithm>
+#include <set>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include "sling/base/logging.h"
+
+namespace sling {
+namespace myelin {
+
+// Tiles are aligned to cache lines.
+static const int kTileAlign = 64;
+
+// Check that variable is a dense row-major constant matrix.
+static bool ConstantMatrix(const Flow::Variable *var) {
+  if (!var->constant() || var->learnable()) return false;
+  if (var->rank() != 2 || !var->shape.defined()) return false;
+  if (var->is(Flow::Variable::COL)) return false;
+  if (var->size != var->elements() * TypeTraits::of(var->type).size()) {
+    return false;
+  }
+  return true;
+}
+
+// Check that op is a plain matmul with a constant weight matrix and return
+// the number of output columns.
+static int MatMulColumns(const Flow::Operation *op) {
+  if (op->type != "MatMul") return 0;
+  if (op->indegree() != 2 || op->outdegree() != 1) return 0;
+  if (op->GetAttr("transpose_a", false)) return 0;
+  if (op->GetAttr("transpose_c", false)) return 0;
+
+  Flow::Variable *x = op->inputs[0];
+  Flow::Variable *w = op->inputs[1];
+  Flow::Variable *y = op->outputs[0];
+  if (x->type != DT_FLOAT && x->type != DT_DOUBLE) return 0;
+  if (w->type != x->type || y->type != x->type) return 0;
+  if (x->rank() != 2 || y->rank() != 2) return 0;
+  if (!x->shape.defined() || !y->shape.defined()) return 0;
+  if (x->dynamic() || y->dynamic()) return 0;
+  if (x->is(Flow::Variable::COL) || y->is(Flow::Variable::COL)) return 0;
+  if (!ConstantMatrix(w)) return 0;
+
+  bool transposed = op->GetAttr("transpose_b", false);
+  int k = transposed ? w->dim(1) : w->dim(0);
+  int n = transposed ? w->dim(0) : w->dim(1);
+  if (x->dim(1) != k) return 0;
+  if (y->shape != Shape({x->dim(0), n})) return 0;
+  return n;
+}
+
+// Check that op is a pooled gather from a constant embedding matrix and
+// return the number of embedding columns.
+static int GatherColumns(const Flow::Operation *op) {
+  if (op->type != "GatherSum" &&
+      op->type != "GatherAvg" &&
+      op->type != "GatherMax") {
+    return 0;
+  }
+  if (op->indegree() != 2 || op->outdegree() != 1) return 0;
+
+  Flow::Variable *params = op->inputs[0];
+  Flow::Variable *indices = op->inputs[1];
+  Flow::Variable *result = op->outputs[0];
+  if (params->type != DT_FLOAT && params->type != DT_DOUBLE) return 0;
+  if (result->type != params->type) return 0;
+  if (indices->type != DT_INT32 || indices->rank() < 1) return 0;
+  if (indices->dim(-1) != 1) return 0;
+  if (!indices->shape.defined() || !result->shape.defined()) return 0;
+  if (indices->dynamic() || result->dynamic()) return 0;
+  if (result->rank() < 1 || result->dim(-1) != params->dim(1)) return 0;
+  if (!ConstantMatrix(params)) return 0;
+  return params->dim(1);
+}
+
+int Partitioner::Tiles(const Flow::Operation *op, int max_tiles) const {
+  // Only split ops in the main task.
+  if (op->task != 0) return 1;
+  if (!op->GetAttr("partition", true)) return 1;
+
+  // Compute cost of op.
+  int64 cost = 0;
+  int64 output = 0;
+  int columns = MatMulColumns(op);
+  if (columns > 0) {
+    Flow::Variable *x = op->inputs[0];
+    output = op->outputs[0]->elements();
+    cost = output * x->dim(1);
+  } else {
+    columns = GatherColumns(op);
+    if (columns == 0) return 1;
+    output = op->outputs[0]->elements();
+    cost = op->inputs[1]->elements() * columns;
+  }
+
+  // Each tile needs to cover at least one cache line of output columns and
+  // the cost of the tile must pay for the overhead of the parallel task.
+  int align = kTileAlign / TypeTraits::of(op->outputs[0]->type).size();
+  int64 tiles = std::min(options_.tasks, max_tiles);
+  tiles = std::min<int64>(tiles, (columns + align - 1) / align);
+  tiles = std::min<int64>(tiles, cost / options_.min_cost);
+  if (tiles < 2) return 1;
+
+  // The saving from computing the tiles in parallel must outweigh the cost of
+  // concatenating the partial results.
+  int64 saving = cost - cost / tiles;
+  if (saving < options_.min_gain * output) return 1;
+
+  return tiles;
+}
+
+int Partitioner::Partition(Flow *flow) {
+  // Get the budget for parallel tasks in each function. The main task runs on
+  // one of the cores, so by default, there is a parallel task for each of the
+  // other cores.
+  int budget = options_.max_tasks;
+  if (budget < 0) budget = std::thread::hardware_concurrency() - 1;
+  if (budget < 1) return 0;
+
+  // Parallel tasks already in the flow count against the budget.
+  std::set<std::pair<Flow::Function *, int>> existing;
+  std::unordered_map<Flow::Function *, int> used;
+  for (Flow::Operation *op : flow->ops()) {
+    next_task_ = std::max(next_task_, op->task + 1);
+    if (op->task != 0 && existing.emplace(op->func, op->task).second) {
+      used[op->func]++;
+    }
+  }
+
+  // Find ops to split. Each op gets as many tiles as the remaining budget for
+  // its function allows.
+  std::vector<std::pair<Flow::Operation *, int>> candidates;
+  for (Flow::Operation *op : flow->ops()) {
+    int &tasks = used[op->func];
+    int tiles = Tiles(op, budget - tasks + 1);
+    if (tiles < 2) continue;
+    tasks += tiles - 1;
+    candidates.emplace_back(op, tiles);
+  }
+  if (candidates.empty()) return 0;
+
+  // Split ops into tiles.
+  for (auto &c : candidates) {
+    Flow::Operation *op = c.first;
+    int tiles = c.second;
+    VLOG(5) << "Partition " << op->name << " into " << tiles << " tiles";
+    if (op->type == "MatMul") {
+      PartitionMatMul(flow, op, tiles);
+    } else {
+      PartitionGather(flow, op, tiles);
+    }
+  }
+
+  // Remove constants that have been replaced by tiles.
+  std::set<Flow::Variable *> replaced;
+  for (auto &it : split_) replaced.insert(std::get<0>(it.first));
+  for (Flow::Variable *var : replaced) {
+    if (var->consumers.empty()) flow->DeleteVariable(var);
+  }
+  split_.clear();
+
+  // Order the tiles for parallel computation.
+  flow->Sort();
+
+  return candidates.size();
+}
+
+void Partitioner::PartitionMatMul(Flow *flow, Flow::Operation *op,
+                                  int tiles) {
+  Flow::Variable *x = op->inputs[0];
+  Flow::Variable *w = op->inputs[1];
+  bool transposed = op->GetAttr("transpose_b", false);
+  auto &weights = SplitConstant(flow, w, transposed, tiles);
+
+  // Compute each tile with a matmul on the tile of the weight matrix. The
+  // original op computes the first tile.
+  std::vector<Flow::Operation *> parts;
+  for (int i = 0; i < tiles; ++i) {
+    Flow::Operation *part = op;
+    if (i > 0) {
+      string name = flow->OpName(op->name + "/tile" + std::to_string(i));
+      part = flow->AddOperation(op->func, name, op->type);
+      part->CopyAttrsFrom(*op);
+      part->AddInput(x);
+      part->AddInput(weights[i]);
+    }
+    parts.push_back(part);
+  }
+  op->ReplaceInput(w, weights[0]);
+  Concatenate(flow, op, parts);
+}
+
+void Partitioner::PartitionGather(Flow *flow, Flow::Operation *op,
+                                  int tiles) {
+  Flow::Variable *params = op->inputs[0];
+  Flow::Variable *indices = op->inputs[1];
+  auto &embeddings = SplitConstant(flow, params, false, tiles);
+
+  // Gather from each tile of the embedding matrix. The original op gathers
+  // from the first tile.
+  std::vector<Flow::Operation *> parts;
+  for (int i = 0; i < tiles; ++i) {
+    Flow::Operation *part = op;
+    if (i > 0) {
+      string name = flow->OpName(op->name + "/tile" + std::to_string(i));
+      part = flow->AddOperation(op->func, name, op->type);
+      part->CopyAttrsFrom(*op);
+      part->AddInput(embeddings[i]);
+      part->AddInput(indices);
+    }
+    parts.push_back(part);
+  }
+  op->ReplaceInput(params, embeddings[0]);
+  Concatenate(flow, op, parts);
+}
+
+const std::vector<Flow::Variable *> &Partitioner::SplitConstant(
+    Flow *flow, Flow::Variable *var, bool transposed, int tiles) {
+  // Check if constant has already been split.
+  auto &split = split_[std::make_tuple(var, transposed, tiles)];
+  if (!split.empty()) return split;
+
+  int rows = var->dim(0);
+  int columns = var->dim(1);
+  int dsize = TypeTraits::of(var->type).size();
+  int align = kTileAlign / dsize;
+  for (int i = 0; i < tiles; ++i) {
+    string name = flow->VarName(var->name + "/tile" + std::to_string(i));
+    Flow::Variable *tile;
+    if (transposed) {
+      // The matrix is transposed, so the tile is a contiguous block of rows.
+      auto range = TileRange(rows, align, tiles, i);
+      int height = range.second - range.first;
+      tile = flow->AddConstant(name, var->type, {height, columns});
+      memcpy(tile->data, var->data + range.first * columns * dsize,
+             height * columns * dsize);
+    } else {
+      // Copy the columns of the tile from each row.
+      auto range = TileRange(columns, align, tiles, i);
+      int width = range.second - range.first;
+      tile = flow->AddConstant(name, var->type, {rows, width});
+      for (int r = 0; r < rows; ++r) {
+        memcpy(tile->data + r * width * dsize,
+               var->data + (r * columns + range.first) * dsize,
+               width * dsize);
+      }
+    }
+    tile->flags |= var->flags & Flow::Variable::ROW;
+    split.push_back(tile);
+  }
+
+  return split;
+}
+
+void Partitioner::Concatenate(Flow *flow,
+                              Flow::Operation *op,
+                              const std::vector<Flow::Operation *> &parts) {
+  // Add output variables for tiles.
+  Flow::Variable *output = op->outputs[0];
+  int axis = output->rank() - 1;
+  std::vector<Flow::Variable *> inputs;
+  for (int i = 0; i < parts.size(); ++i) {
+    Flow::Operation *part = parts[i];
+    Flow::Variable *w = part->inputs[part->type == "MatMul" ? 1 : 0];
+    bool transposed = part->GetAttr("transpose_b", false);
+    int width = transposed ? w->dim(0) : w->dim(1);
+    Shape shape = output->shape;
+    shape.set(axis, width);
+    string name = flow->VarName(output->name + "/tile" + std::to_string(i));
+    auto *tile = flow->AddVariable(name, output->type, shape);
+    if (part == op) {
+      op->ReplaceOutput(output, tile);
+    } else {
+      part->AddOutput(tile);
+    }
+    inputs.push_back(tile);
+  }
+
+  // Concatenate tiles into original output.
+  auto *dim = flow->AddConstant(flow->VarName(output->name + "/axis"),
+                                DT_INT32, {}, &axis);
+  inputs.push_back(dim);
+  auto *concat = flow->AddOperation(op->func,
+                                    flow->OpName(op->name + "/concat"),
+                                    "Concat", inputs, {output});
+  concat->SetAttr("N", static_cast<int>(parts.size()));
+
+  // Run all tiles except the first one as parallel tasks.
+  for (int i = 1; i < parts.size(); ++i) {
+    parts[i]->task = next_task_++;
+  }
+}
+
+std::pair<int, int> Partitioner::TileRange(int columns, int align,
+                                           int tiles, int tile) {
+  int units = (columns + align - 1) / align;
+  int begin = units * tile / tiles * align;
+  int end = std::min(units * (tile + 1) / tiles * align, columns);
+  return std::make_pair(begin, end);
+}
+
+}  // namespace myelin
+}  // namespace sling
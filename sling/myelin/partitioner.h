@@ -0,0 +1,106 @@
+// Copyright 2025 Ringgaard Research ApS
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SLING_MYELIN_PARTITIONER_H_
+#define SLING_MYELIN_PARTITIONER_H_
+
+#include <map>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+#include "sling/base/types.h"
+#include "sling/myelin/flow.h"
+
+namespace sling {
+namespace myelin {
+
+// The partitioner splits large MatMul and pooled gather (GatherSum, GatherAvg,
+// GatherMax) ops into column tiles that are computed as parallel tasks. The
+// constant weight matrix or embedding table of the op is split into a separate
+// constant for each tile, and the tiles are computed by copies of the op. The
+// first tile is computed by the main task and the other tiles are computed by
+// parallel tasks, and the partial results are concatenated into the original
+// output. A runtime with support for asynchronous tasks, e.g. the
+// multi-processor runtime, is needed for running the tiles in parallel.
+//
+// A simple cost model decides how many tiles each op is split into. The cost
+// of an op is the number of multiply-adds for matmuls and the number of
+// additions or comparisons for pooled gathers. Each tile must have a cost of
+// at least min_cost to pay for starting and waiting for a parallel task, and
+// the ops that are split must save at least min_gain times the cost of
+// concatenating the tiles. The total number of parallel tasks in each function
+// is limited to max_tasks, since a function with more parallel tasks than
+// there are cores runs slower than the unpartitioned function. Once the budget
+// for a function has been used up, the remaining ops are not split.
+class Partitioner {
+ public:
+  // Partitioning options.
+  struct Options {
+    int tasks = 4;             // maximum number of tiles per op
+    int64 min_cost = 32768;    // minimum cost for each tile
+    double min_gain = 4.0;     // minimum saving relative to concatenation
+    int max_tasks = -1;        // parallel tasks per function (-1 for cores-1)
+  };
+
+  Partitioner(const Options &options) : options_(options) {}
+
+  // Split large ops in analyzed flow into tiles computed by parallel tasks.
+  // Returns the number of partitioned ops.
+  int Partition(Flow *flow);
+
+  // Return the number of tiles for op or 1 if the op should not be split. The
+  // op is split into at most max_tiles tiles.
+  int Tiles(const Flow::Operation *op, int max_tiles) const;
+
+ private:
+  // Split matmul op into column tiles.
+  void PartitionMatMul(Flow *flow, Flow::Operation *op, int tiles);
+
+  // Split pooled gather op into embedding column tiles.
+  void PartitionGather(Flow *flow, Flow::Operation *op, int tiles);
+
+  // Split the columns of a constant matrix into tiles. If transposed is true,
+  // the rows of the matrix are split instead. Tiles are shared between ops
+  // that split the same constant in the same way.
+  const std::vector<Flow::Variable *> &SplitConstant(Flow *flow,
+                                                     Flow::Variable *var,
+                                                     bool transposed,
+                                                     int tiles);
+
+  // Add concatenation of tile outputs into original output of op. The tile
+  // ops are assigned to parallel tasks except for the first tile.
+  void Concatenate(Flow *flow,
+                   Flow::Operation *op,
+                   const std::vector<Flow::Operation *> &parts);
+
+  // Return column range for tile.
+  static std::pair<int, int> TileRange(int columns, int align,
+                                       int tiles, int tile);
+
+  // Partitioning options.
+  Options options_;
+
+  // Next task id for parallel tasks.
+  int next_task_ = 1;
+
+  // Tiles for constants split by the partitioner.
+  std::map<std::tuple<Flow::Variable *, bool, int>,
+           std::vector<Flow::Variable *>> split_;
+};
+
+}  // namespace myelin
+}  // namespace sling
+
+#endif  // SLING_MYELIN_PARTITIONER_H_
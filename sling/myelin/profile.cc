@@ -144,6 +144,8 @@ string Profile::ASCIIReport() const {
   if (jit::CPU::Enabled(jit::AVX)) report.append(" AVX");
   if (jit::CPU::Enabled(jit::AVX2)) report.append(" AVX2");
   if (jit::CPU::Enabled(jit::AVX512F)) report.append(" AVX512F");
+  if (jit::CPU::Enabled(jit::AVX512VNNI)) report.append(" AVX512VNNI");
+  if (jit::CPU::Enabled(jit::AVX512BF16)) report.append(" AVX512BF16");
   if (jit::CPU::Enabled(jit::FMA3)) report.append(" FMA3");
   report.append("\n");
   string runtime_info = cell()->runtime()->Description();
@@ -187,6 +189,10 @@ string Profile::ASCIIReport() const {
     if (!expr.empty()) {
       StringAppendF(&report, " [%s]", expr.c_str());
     }
+    const string &tuned = step(i)->GetAttr("tuned");
+    if (!tuned.empty()) {
+      StringAppendF(&report, " [tuned %s]", tuned.c_str());
+    }
     report.push_back('\n');
   }
 
@@ -3377,7 +3377,7 @@ void SIMDAssembler::Reduce(Reduction op, const std::vector<int> &regs) {
   }
 }
 
-SIMDStrategy::SIMDStrategy(SIMDAssembler *sasm, int size) {
+SIMDStrategy::SIMDStrategy(SIMDAssembler *sasm, int size, int max_unrolls) {
   // Use scalar generator for singletons.
   if (size == 1) {
     phases_.emplace_back(sasm->scalar());
@@ -3388,7 +3388,7 @@ SIMDStrategy::SIMDStrategy(SIMDAssembler *sasm, int size) {
   // Add bulk phase.
   int vecsize = sasm->main()->VectorSize();
   int main = (size / vecsize) * vecsize;
-  int max_unrolls = sasm->main()->SupportsUnroll() ? kMaxUnrolls : 1;
+  if (!sasm->main()->SupportsUnroll()) max_unrolls = 1;
   int unrolls = std::min(main / vecsize, max_unrolls);
   int remaining = size;
   int offset = 0;
@@ -187,8 +187,9 @@ class SIMDStrategy {
     SIMDGenerator *generator;   // code generator for phase
   };
 
-  // Compute a strategy for processing a vector of a certain size.
-  SIMDStrategy(SIMDAssembler *sasm, int size);
+  // Compute a strategy for processing a vector of a certain size. The bulk
+  // phase is unrolled at most max_unrolls times.
+  SIMDStrategy(SIMDAssembler *sasm, int size, int max_unrolls = kMaxUnrolls);
 
   // Maximum number of unrolls.
   int MaxUnrolls();
@@ -0,0 +1,156 @@
+// Copyright 2025 Ringgaard Research ApS
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <math.h>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "sling/base/flags.h"
+#include "sling/base/init.h"
+#include "sling/base/logging.h"
+#include "sling/file/file.h"
+#include "sling/myelin/autotuner.h"
+#include "sling/myelin/builder.h"
+#include "sling/myelin/compute.h"
+#include "sling/myelin/flow.h"
+#include "sling/myelin/kernel/library.h"
+
+DEFINE_string(tuning_db, "", "Tuning database (default: temp file)");
+
+using namespace sling;
+using namespace sling::myelin;
+
+// Matrix dimensions for test cases.
+struct Dims {
+  int m;
+  int k;
+  int n;
+};
+
+// Build flow with matmuls with constant weights and random inputs.
+static void BuildFlow(Flow *flow, const std::vector<Dims> &tests) {
+  std::mt19937 prng(314159);
+  std::normal_distribution<float> normal(0.0, 1.0);
+  FlowBuilder f(flow, "f");
+  for (int t = 0; t < tests.size(); ++t) {
+    const Dims &d = tests[t];
+    std::vector<float> weights(d.k * d.n);
+    for (float &w : weights) w = normal(prng);
+    auto *W = f.Const(weights.data(), DT_FLOAT, {d.k, d.n});
+    auto *x = f.Placeholder("x" + std::to_string(t), DT_FLOAT, {d.m, d.k});
+    f.Name(f.MatMul(x, W), "y" + std::to_string(t))->set_out();
+  }
+}
+
+// Compile flow and compute outputs for each test case.
+static std::vector<std::vector<float>> Run(Flow *flow,
+                                           const Library &library,
+                                           const std::vector<Dims> &tests) {
+  Network network;
+  CHECK(network.Compile(*flow, library));
+  Cell *cell = network.GetCell("f");
+  Instance data(cell);
+  for (int t = 0; t < tests.size(); ++t) {
+    Tensor *x = cell->GetParameter("f/x" + std::to_string(t));
+    float *input = data.Get<float>(x);
+    for (int i = 0; i < x->elements(); ++i) input[i] = sin(i * 0.1 + t);
+  }
+  data.Compute();
+
+  std::vector<std::vector<float>> outputs;
+  for (int t = 0; t < tests.size(); ++t) {
+    Tensor *y = cell->GetParameter("f/y" + std::to_string(t));
+    float *output = data.Get<float>(y);
+    outputs.emplace_back(output, output + y->elements());
+  }
+  return outputs;
+}
+
+int main(int argc, char *argv[]) {
+  InitProgram(&argc, &argv);
+
+  Library library;
+  RegisterStandardLibrary(&library);
+
+  std::vector<Dims> tests = {
+    {1, 128, 1290},
+    {1, 67, 33},
+    {3, 128, 1290},
+    {1, 512, 512},
+    {1, 1024, 64},
+  };
+
+  // Compute reference outputs with default kernel configuration.
+  Flow reference;
+  BuildFlow(&reference, tests);
+  reference.Analyze(library);
+  auto expected = Run(&reference, library, tests);
+
+  // Tune the matmul ops and save the tuning results.
+  string db = FLAGS_tuning_db;
+  if (db.empty()) {
+    string dir;
+    CHECK(File::CreateTempDir(&dir));
+    db = dir + "/tuning.db";
+  }
+  Flow flow;
+  BuildFlow(&flow, tests);
+  flow.Analyze(library);
+  AutoTuner tuner(&library);
+  int tuned = tuner.Tune(&flow, true);
+  CHECK(tuner.Save(db));
+  for (auto &it : tuner.results()) {
+    const AutoTuner::Result &result = it.second;
+    LOG(INFO) << it.first << ": unroll " << result.config.unroll
+              << " " << result.config.loop_order
+              << " " << result.baseline << " us -> " << result.best << " us";
+  }
+
+  // Check that the tuned network computes the same outputs.
+  auto actual = Run(&flow, library, tests);
+  for (int t = 0; t < tests.size(); ++t) {
+    for (int i = 0; i < expected[t].size(); ++i) {
+      CHECK_LT(fabs(expected[t][i] - actual[t][i]), 1e-3)
+          << "test " << t << " element " << i;
+    }
+  }
+
+  // Check that the tuning results are reused from the database.
+  Flow flow2;
+  BuildFlow(&flow2, tests);
+  flow2.Analyze(library);
+  AutoTuner tuner2(&library);
+  CHECK(tuner2.Load(db));
+  CHECK_EQ(tuner2.results().size(), tuner.results().size());
+  CHECK_EQ(tuner2.Tune(&flow2, false), tuned);
+  for (int i = 0; i < flow.ops().size(); ++i) {
+    const Flow::Operation *op1 = flow.ops()[i];
+    const Flow::Operation *op2 = flow2.ops()[i];
+    CHECK_EQ(op1->GetAttr("unroll", 0), op2->GetAttr("unroll", 0));
+    CHECK_EQ(op1->GetAttr("loop_order"), op2->GetAttr("loop_order"));
+  }
+
+  // Check that tuning databases with an older format are ignored.
+  string old = db + ".old";
+  string entry = "MatMul:float32:1x128:128x1290k:1x1290:000:7ff 2 - 10 5\n";
+  CHECK(File::WriteContents(old, entry).ok());
+  AutoTuner tuner3(&library);
+  CHECK(!tuner3.Load(old));
+  CHECK(tuner3.results().empty());
+  File::Delete(old);
+
+  LOG(INFO) << "Autotuner test passed, " << tuned << " ops tuned";
+  return 0;
+}
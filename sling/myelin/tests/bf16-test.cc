@@ -0,0 +1,344 @@
+// Copyright 2025 Ringgaard Research ApS
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <math.h>
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "sling/base/clock.h"
+#include "sling/base/flags.h"
+#include "sling/base/init.h"
+#include "sling/base/logging.h"
+#include "sling/myelin/builder.h"
+#include "sling/myelin/compute.h"
+#include "sling/myelin/flow.h"
+#include "sling/myelin/kernel/library.h"
+#include "third_party/jit/cpu.h"
+
+DEFINE_int32(vocabulary, 10000, "Number of embeddings for gather tests");
+DEFINE_int32(repeat, 1000, "Number of benchmark iterations");
+DEFINE_double(tolerance, 0.01, "Maximum relative error");
+
+using namespace sling;
+using namespace sling::myelin;
+
+// Test case with a matmul or gather op.
+struct Case {
+  string op;          // op type
+  int rows;           // rows (matmul) or batch size (gather)
+  int inputs;         // input dimension (matmul) or features (gather)
+  int outputs;        // output columns
+  bool transposed;    // transposed weight matrix
+};
+
+// Return name of test case.
+static string CaseName(const Case &c) {
+  return c.op + " " + std::to_string(c.rows) + "x" +
+         std::to_string(c.inputs) + "x" + std::to_string(c.outputs) +
+         (c.transposed ? "T" : "");
+}
+
+// Build flow for test case.
+static void BuildFlow(Flow *flow, const Case &c) {
+  std::mt19937 prng(314159);
+  FlowBuilder f(flow, "f");
+  if (c.op == "MatMul") {
+    std::normal_distribution<float> normal(0.0, 1.0 / sqrt(c.inputs));
+    std::vector<float> weights(c.inputs * c.outputs);
+    for (float &w : weights) w = normal(prng);
+    Shape shape = c.transposed ? Shape({c.outputs, c.inputs})
+                               : Shape({c.inputs, c.outputs});
+    auto *W = f.Const(weights.data(), DT_FLOAT, shape);
+    auto *x = f.Placeholder("x", DT_FLOAT, {c.rows, c.inputs});
+    auto *y = f.Op("MatMul", {x, W}, DT_FLOAT, {c.rows, c.outputs});
+    if (c.transposed) y->producer->SetAttr("transpose_b", true);
+    f.Name(y, "y")->set_out();
+  } else {
+    std::normal_distribution<float> normal(0.0, 1.0);
+    std::vector<float> embeddings(FLAGS_vocabulary * c.outputs);
+    for (float &e : embeddings) e = normal(prng);
+    auto *E = f.Const(embeddings.data(), DT_FLOAT,
+                      {FLAGS_vocabulary, c.outputs});
+    auto *x = f.Placeholder("x", DT_INT32, {c.rows, c.inputs, 1});
+    Flow::Variable *y;
+    if (c.op == "Gather") {
+      y = f.Op(c.op, {E, x}, DT_FLOAT, {c.rows, c.inputs, c.outputs});
+    } else {
+      y = f.Op(c.op, {E, x}, DT_FLOAT, {c.rows, c.outputs});
+      y->producer->SetAttr("batch", 1);
+    }
+    f.Name(y, "y")->set_out();
+  }
+}
+
+// Fill input for test case.
+static void FillInput(const Case &c, Instance *data, Tensor *x, int seed) {
+  std::mt19937 prng(seed);
+  if (c.op == "MatMul") {
+    std::uniform_real_distribution<float> uniform(-1.0, 1.0);
+    float *input = data->Get<float>(x);
+    for (int i = 0; i < x->elements(); ++i) input[i] = uniform(prng);
+  } else {
+    // Pooled gathers skip leading empty feature slots in the first batch and
+    // end the feature list at the first empty slot in the other batches. The
+    // last batch has no features if there are more than two batches.
+    std::uniform_int_distribution<int> uniform(0, FLAGS_vocabulary - 1);
+    int *input = data->Get<int>(x);
+    for (int b = 0; b < c.rows; ++b) {
+      for (int f = 0; f < c.inputs; ++f) {
+        int index = uniform(prng);
+        if (c.op != "Gather") {
+          if (b == 0 && f < c.inputs / 4) index = -1;
+          if (b > 0 && f >= c.inputs / 2) index = -1;
+          if (b > 1 && b == c.rows - 1) index = -1;
+        }
+        input[b * c.inputs + f] = index;
+      }
+    }
+  }
+}
+
+// Get output from instance. The output of a single float embedding lookup is
+// a reference into the embedding matrix.
+static const float *Output(Instance *data, Tensor *y) {
+  return y->ref() ? data->GetRef<float>(y) : data->Get<float>(y);
+}
+
+// Float and bfloat16 version of the same model.
+struct Model {
+  Model(const Case &c) {
+    BuildFlow(&flow, c);
+    BuildFlow(&bflow, c);
+
+    // Compile float network.
+    RegisterStandardLibrary(&library);
+    flow.Analyze(library);
+    CHECK(network.Compile(flow, library));
+
+    // Compile bfloat16 network.
+    RegisterStandardLibrary(&blibrary);
+    RegisterBF16Transforms(&blibrary);
+    bflow.Analyze(blibrary);
+    CHECK(bnetwork.Compile(bflow, blibrary));
+  }
+
+  // Return kernel variant for op in bfloat16 network.
+  string Variant() {
+    for (const Step *step : bnetwork.GetCell("f")->steps()) {
+      if (step->type() == "BF16MatMul") return step->variant();
+      if (step->input(0)->type() == DT_BFLOAT16) {
+        return step->kernel()->Name() + ":" + step->variant();
+      }
+    }
+    return "";
+  }
+
+  Flow flow;
+  Flow bflow;
+  Library library;
+  Library blibrary;
+  Network network;
+  Network bnetwork;
+};
+
+// Compare float and bfloat16 model on random inputs. Returns the relative
+// error.
+static double Check(const Case &c) {
+  Model model(c);
+  string variant = model.Variant();
+  CHECK(!variant.empty()) << CaseName(c) << ": No ops converted to bf16";
+
+  Cell *cell = model.network.GetCell("f");
+  Cell *bcell = model.bnetwork.GetCell("f");
+  Tensor *x = cell->GetParameter("f/x");
+  Tensor *y = cell->GetParameter("f/y");
+  Tensor *bx = bcell->GetParameter("f/x");
+  Tensor *by = bcell->GetParameter("f/y");
+
+  Instance data(cell);
+  Instance bdata(bcell);
+  double err2 = 0.0;
+  double norm2 = 0.0;
+  double maxerr = 0.0;
+  for (int iter = 0; iter < 10; ++iter) {
+    FillInput(c, &data, x, iter);
+    FillInput(c, &bdata, bx, iter);
+    data.Compute();
+    bdata.Compute();
+    const float *expected = Output(&data, y);
+    const float *actual = Output(&bdata, by);
+    for (int i = 0; i < y->elements(); ++i) {
+      double diff = actual[i] - expected[i];
+      err2 += diff * diff;
+      norm2 += expected[i] * expected[i];
+      maxerr = std::max(maxerr, fabs(diff));
+    }
+  }
+
+  double relerr = norm2 > 0.0 ? sqrt(err2 / norm2) : sqrt(err2);
+  LOG(INFO) << CaseName(c) << " " << variant
+            << " relative error: " << relerr
+            << " max error: " << maxerr;
+  return relerr;
+}
+
+// Check embedding matrix tied to the output projection. The matrix is used for
+// an embedding lookup and for matmuls with both plain and transposed layout,
+// so it is converted to bfloat16 in three different layouts, which must have
+// different names. Returns the relative error.
+static double CheckTied(int dims) {
+  Flow flows[2];
+  Library libraries[2];
+  Network networks[2];
+  for (int i = 0; i < 2; ++i) {
+    std::mt19937 prng(314159);
+    std::normal_distribution<float> normal(0.0, 1.0 / sqrt(dims));
+    std::vector<float> embeddings(FLAGS_vocabulary * dims);
+    for (float &e : embeddings) e = normal(prng);
+
+    FlowBuilder f(&flows[i], "f");
+    auto *E = f.Const(embeddings.data(), DT_FLOAT, {FLAGS_vocabulary, dims});
+    f.Name(E, "embeddings");
+    auto *x = f.Placeholder("x", DT_INT32, {1, 8, 1});
+    auto *h = f.Op("GatherSum", {E, x}, DT_FLOAT, {1, dims});
+    h->producer->SetAttr("batch", 1);
+    auto *logits = f.Op("MatMul", {h, E}, DT_FLOAT, {1, FLAGS_vocabulary});
+    logits->producer->SetAttr("transpose_b", true);
+    f.Name(logits, "logits")->set_out();
+    f.Name(f.MatMul(logits, E), "y")->set_out();
+
+    RegisterStandardLibrary(&libraries[i]);
+    if (i == 1) RegisterBF16Transforms(&libraries[i]);
+    flows[i].Analyze(libraries[i]);
+    CHECK(networks[i].Compile(flows[i], libraries[i]));
+  }
+  CHECK_EQ(flows[1].Find("BF16MatMul").size(), 2);
+
+  // Each converted matrix can be looked up by name.
+  int converted = 0;
+  for (Tensor *t : networks[1].globals()) {
+    CHECK(networks[1].GetParameter(t->name()) == t) << t->name();
+    if (t->type() == DT_BFLOAT16) converted++;
+  }
+  CHECK_EQ(converted, 3);
+
+  Cell *cells[2];
+  Instance *data[2];
+  for (int i = 0; i < 2; ++i) {
+    cells[i] = networks[i].GetCell("f");
+    data[i] = new Instance(cells[i]);
+    int *input = data[i]->Get<int>(cells[i]->GetParameter("f/x"));
+    for (int k = 0; k < 8; ++k) input[k] = k * 997 % FLAGS_vocabulary;
+    data[i]->Compute();
+  }
+
+  double relerr = 0.0;
+  for (const char *output : {"f/logits", "f/y"}) {
+    Tensor *y = cells[0]->GetParameter(output);
+    Tensor *by = cells[1]->GetParameter(output);
+    const float *expected = data[0]->Get<float>(y);
+    const float *actual = data[1]->Get<float>(by);
+    double err2 = 0.0;
+    double norm2 = 0.0;
+    for (int j = 0; j < y->elements(); ++j) {
+      err2 += (actual[j] - expected[j]) * (actual[j] - expected[j]);
+      norm2 += expected[j] * expected[j];
+    }
+    relerr = std::max(relerr, sqrt(err2 / norm2));
+  }
+  for (int i = 0; i < 2; ++i) delete data[i];
+
+  LOG(INFO) << "Tied " << FLAGS_vocabulary << "x" << dims
+            << " embeddings relative error: " << relerr;
+  return relerr;
+}
+
+// Measure speed of float and bfloat16 model.
+static void Benchmark(const Case &c) {
+  Model model(c);
+  double time[2];
+  for (int i = 0; i < 2; ++i) {
+    Cell *cell = (i == 0 ? model.network : model.bnetwork).GetCell("f");
+    Instance data(cell);
+    FillInput(c, &data, cell->GetParameter("f/x"), 0);
+    data.Compute();
+    Clock clock;
+    clock.start();
+    for (int r = 0; r < FLAGS_repeat; ++r) data.Compute();
+    clock.stop();
+    time[i] = clock.us() / FLAGS_repeat;
+  }
+  LOG(INFO) << CaseName(c) << " " << model.Variant() << ": float32 "
+            << time[0] << " us, bfloat16 " << time[1] << " us";
+}
+
+int main(int argc, char *argv[]) {
+  InitProgram(&argc, &argv);
+
+  std::vector<Case> tests = {
+    // Odd sizes for residual and masked code paths.
+    {"MatMul", 1, 64, 64, false},
+    {"MatMul", 1, 100, 37, true},
+    {"MatMul", 1, 257, 300, false},
+    {"MatMul", 3, 129, 129, true},
+    {"MatMul", 2, 37, 1000, false},
+    {"MatMul", 5, 512, 512, true},
+    {"MatMul", 1, 768, 3072, false},
+
+    // Embedding lookups with and without pooling.
+    {"Gather", 1, 1, 64, false},
+    {"Gather", 3, 5, 72, false},
+    {"GatherSum", 1, 16, 128, false},
+    {"GatherSum", 4, 20, 40, false},
+    {"GatherAvg", 3, 8, 256, false},
+    {"GatherMax", 3, 9, 64, false},
+  };
+
+  std::vector<Case> benchmarks = {
+    {"MatMul", 1, 1024, 4096, false},
+    {"GatherSum", 1, 64, 256, false},
+  };
+
+  // Check all kernel variants supported by the CPU: AVX-512 BF16 dot
+  // products, and AVX-512 and AVX2 expansion of bfloat16 to floats.
+  bool avx512 = jit::CPU::Enabled(jit::AVX512F);
+  bool bf16 = jit::CPU::Enabled(jit::AVX512BF16);
+  int failures = 0;
+  for (int mode = 0; mode < 3; ++mode) {
+    if (mode == 0 && !(avx512 && bf16)) continue;
+    if (mode == 1 && !avx512) continue;
+    if (mode >= 1) jit::CPU::Disable(jit::AVX512BF16);
+    if (mode >= 2) jit::CPU::Disable(jit::AVX512F);
+
+    for (const Case &c : tests) {
+      if (Check(c) > FLAGS_tolerance) failures++;
+    }
+    if (CheckTied(64) > FLAGS_tolerance) failures++;
+    if (FLAGS_repeat > 0) {
+      for (const Case &c : benchmarks) Benchmark(c);
+    }
+
+    if (avx512) jit::CPU::Enable(jit::AVX512F);
+    if (bf16) jit::CPU::Enable(jit::AVX512BF16);
+  }
+
+  if (failures > 0) {
+    LOG(ERROR) << failures << " bfloat16 checks failed";
+    return 1;
+  }
+  LOG(INFO) << "All bfloat16 checks passed";
+  return 0;
+}
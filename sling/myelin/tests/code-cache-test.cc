@@ -0,0 +1,189 @@
+// Copyright 2025 Ringgaard Research ApS
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <math.h>
+#include <string.h>
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "sling/base/clock.h"
+#include "sling/base/flags.h"
+#include "sling/base/init.h"
+#include "sling/base/logging.h"
+#include "sling/file/file.h"
+#include "sling/myelin/builder.h"
+#include "sling/myelin/code-cache.h"
+#include "sling/myelin/compute.h"
+#include "sling/myelin/flow.h"
+#include "sling/myelin/kernel/library.h"
+
+DEFINE_string(cache_dir, "", "Code cache directory (default: temp dir)");
+DEFINE_int32(inputs, 256, "Input dimension");
+DEFINE_int32(hidden, 512, "Hidden dimension");
+DEFINE_int32(layers, 8, "Number of layers");
+
+using namespace sling;
+using namespace sling::myelin;
+
+// Build feed-forward network with an embedding lookup and random weights.
+static void BuildFlow(Flow *flow) {
+  std::mt19937 prng(314159);
+  std::normal_distribution<float> normal(0.0, 0.1);
+  FlowBuilder f(flow, "f");
+  std::vector<float> embeddings(100 * FLAGS_inputs);
+  for (float &w : embeddings) w = normal(prng);
+  auto *E = f.Const(embeddings.data(), DT_FLOAT, {100, FLAGS_inputs});
+  auto *index = f.Placeholder("index", DT_INT32, {1, 1});
+  auto *h = f.Gather(E, index);
+  int n = FLAGS_inputs;
+  for (int l = 0; l < FLAGS_layers; ++l) {
+    std::vector<float> weights(n * FLAGS_hidden);
+    for (float &w : weights) w = normal(prng);
+    auto *W = f.Const(weights.data(), DT_FLOAT, {n, FLAGS_hidden});
+    h = f.Tanh(f.MatMul(h, W));
+    n = FLAGS_hidden;
+  }
+  f.Name(h, "y")->set_out();
+}
+
+// Compile network and return network compilation time in milliseconds.
+static double Compile(Network *network, Flow *flow, const Library &library) {
+  BuildFlow(flow);
+  flow->Analyze(library);
+  Clock clock;
+  clock.start();
+  CHECK(network->Compile(*flow, library));
+  clock.stop();
+  return clock.ms();
+}
+
+// Return name of global tensor at address, or empty string if there is none.
+static string GlobalAt(const Network &network, const char *address) {
+  for (const Tensor *tensor : network.globals()) {
+    if (tensor->data() == address) return tensor->name();
+  }
+  return "";
+}
+
+// Check that the code generated for two networks is identical except for
+// relocated references to global tensors. Each differing byte must be part of
+// an address of the same global tensor in both networks.
+static void CompareCode(const Network &network1, const jit::Code &code1,
+                        const Network &network2, const jit::Code &code2) {
+  CHECK_EQ(code1.size(), code2.size());
+  CHECK(code1.begin() != code2.begin());
+  const char *bytes1 = reinterpret_cast<const char *>(code1.begin());
+  const char *bytes2 = reinterpret_cast<const char *>(code2.begin());
+  int size = code1.size();
+  int relocs = 0;
+  int pos = 0;
+  while (pos < size) {
+    if (bytes1[pos] == bytes2[pos]) {
+      pos++;
+      continue;
+    }
+
+    // Find address of the same global tensor covering the differing byte.
+    bool found = false;
+    for (int start = std::max(pos - 7, 0); start <= pos; ++start) {
+      if (start + sizeof(char *) > size) break;
+      const char *address1;
+      const char *address2;
+      memcpy(&address1, bytes1 + start, sizeof(char *));
+      memcpy(&address2, bytes2 + start, sizeof(char *));
+      string name = GlobalAt(network1, address1);
+      if (!name.empty() && name == GlobalAt(network2, address2)) {
+        pos = start + sizeof(char *);
+        relocs++;
+        found = true;
+        break;
+      }
+    }
+    CHECK(found) << "Cached code differs at offset " << pos;
+  }
+  VLOG(1) << "Code size " << size << ", " << relocs << " relocations";
+}
+
+// Run network and return output.
+static std::vector<float> Run(Network *network, int index) {
+  Cell *cell = network->GetCell("f");
+  Instance data(cell);
+  *data.Get<int>(cell->GetParameter("f/index")) = index;
+  data.Compute();
+  Tensor *y = cell->GetParameter("f/y");
+  float *output = data.Get<float>(y);
+  return std::vector<float>(output, output + y->elements());
+}
+
+int main(int argc, char *argv[]) {
+  InitProgram(&argc, &argv);
+
+  string dir = FLAGS_cache_dir;
+  if (dir.empty()) CHECK(File::CreateTempDir(&dir));
+  CodeCache cache(dir);
+
+  Library library;
+  RegisterStandardLibrary(&library);
+
+  // Compile network without code cache for reference.
+  Flow flow;
+  Network network;
+  double plain = Compile(&network, &flow, library);
+
+  // Compile network twice with code cache. The first compilation generates
+  // the code and saves it in the cache and the second loads it from the cache.
+  Flow flow1;
+  Network network1;
+  network1.set_code_cache(&cache);
+  double miss = Compile(&network1, &flow1, library);
+  CHECK_EQ(File::Match(dir + "/*.jit").size(), 1);
+
+  Flow flow2;
+  Network network2;
+  network2.set_code_cache(&cache);
+  double hit = Compile(&network2, &flow2, library);
+
+  LOG(INFO) << "Compile time: " << plain << " ms without cache, "
+            << miss << " ms on cache miss, "
+            << hit << " ms on cache hit";
+
+  // Check that the cached code is identical to the generated code.
+  for (int c = 0; c < network.cells().size(); ++c) {
+    Cell *cell = network.cells()[c];
+    Cell *cached = network2.cells()[c];
+    CompareCode(network, cell->code(), network2, cached->code());
+    for (int i = 0; i < cell->steps().size(); ++i) {
+      const Step *step = cell->steps()[i];
+      const Step *loaded = cached->steps()[i];
+      CHECK_EQ(step->variant(), loaded->variant()) << step->name();
+      CHECK_EQ(step->noop(), loaded->noop()) << step->name();
+    }
+  }
+
+  // Check that the networks compute the same outputs.
+  for (int index = 0; index < 100; index += 7) {
+    std::vector<float> expected = Run(&network, index);
+    std::vector<float> y1 = Run(&network1, index);
+    std::vector<float> y2 = Run(&network2, index);
+    for (int i = 0; i < expected.size(); ++i) {
+      CHECK_EQ(expected[i], y1[i]) << "index " << index << " element " << i;
+      CHECK_EQ(expected[i], y2[i]) << "index " << index << " element " << i;
+    }
+  }
+
+  LOG(INFO) << "Code cache test passed";
+  return 0;
+}
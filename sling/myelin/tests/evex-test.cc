@@ -0,0 +1,327 @@
+// Copyright 2025 Ringgaard Research ApS
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Check the EVEX encoding of AVX-512 instructions where the memory operand is
+// a fixed fraction of the vector length, e.g. vpmovzxbd and vpmovdb. The
+// compressed disp8*N displacement must be scaled by the memory operand size
+// for the vector length of the instruction. The expected encodings have been
+// generated with the GNU assembler.
+
+#include <map>
+#include <string>
+
+#include "sling/base/flags.h"
+#include "sling/base/init.h"
+#include "sling/base/logging.h"
+#include "sling/string/printf.h"
+#include "third_party/jit/assembler.h"
+
+using namespace sling;
+using namespace sling::jit;
+
+// Instruction and expected encoding.
+struct Encoding {
+  const char *instruction;
+  const char *bytes;
+};
+
+static const Encoding kExpected[] = {
+  {"vcvtps2pd xmm17, [rcx+64]", "62 e1 7c 08 5a 49 08"},
+  {"vcvtps2pd xmm17, [rcx-200]", "62 e1 7c 08 5a 49 e7"},
+  {"vcvtps2pd ymm17, [rcx+64]", "62 e1 7c 28 5a 49 04"},
+  {"vcvtps2pd ymm17, [rcx-200]", "62 e1 7c 28 5a 89 38 ff ff ff"},
+  {"vcvtps2pd zmm17, [rcx+64]", "62 e1 7c 48 5a 49 02"},
+  {"vcvtps2pd zmm17, [rcx-200]", "62 e1 7c 48 5a 89 38 ff ff ff"},
+  {"vcvtudq2pd xmm17, [rcx+64]", "62 e1 7e 08 7a 49 08"},
+  {"vcvtudq2pd xmm17, [rcx-200]", "62 e1 7e 08 7a 49 e7"},
+  {"vcvtudq2pd ymm17, [rcx+64]", "62 e1 7e 28 7a 49 04"},
+  {"vcvtudq2pd ymm17, [rcx-200]", "62 e1 7e 28 7a 89 38 ff ff ff"},
+  {"vcvtudq2pd zmm17, [rcx+64]", "62 e1 7e 48 7a 49 02"},
+  {"vcvtudq2pd zmm17, [rcx-200]", "62 e1 7e 48 7a 89 38 ff ff ff"},
+  {"vpmovsxbd xmm17, [rcx+64]", "62 e2 7d 08 21 49 10"},
+  {"vpmovsxbd xmm17, [rcx-200]", "62 e2 7d 08 21 49 ce"},
+  {"vpmovsxbd ymm17, [rcx+64]", "62 e2 7d 28 21 49 08"},
+  {"vpmovsxbd ymm17, [rcx-200]", "62 e2 7d 28 21 49 e7"},
+  {"vpmovsxbd zmm17, [rcx+64]", "62 e2 7d 48 21 49 04"},
+  {"vpmovsxbd zmm17, [rcx-200]", "62 e2 7d 48 21 89 38 ff ff ff"},
+  {"vpmovsxbq xmm17, [rcx+64]", "62 e2 7d 08 22 49 20"},
+  {"vpmovsxbq xmm17, [rcx-200]", "62 e2 7d 08 22 49 9c"},
+  {"vpmovsxbq ymm17, [rcx+64]", "62 e2 7d 28 22 49 10"},
+  {"vpmovsxbq ymm17, [rcx-200]", "62 e2 7d 28 22 49 ce"},
+  {"vpmovsxbq zmm17, [rcx+64]", "62 e2 7d 48 22 49 08"},
+  {"vpmovsxbq zmm17, [rcx-200]", "62 e2 7d 48 22 49 e7"},
+  {"vpmovsxdq xmm17, [rcx+64]", "62 e2 7d 08 25 49 08"},
+  {"vpmovsxdq xmm17, [rcx-200]", "62 e2 7d 08 25 49 e7"},
+  {"vpmovsxdq ymm17, [rcx+64]", "62 e2 7d 28 25 49 04"},
+  {"vpmovsxdq ymm17, [rcx-200]", "62 e2 7d 28 25 89 38 ff ff ff"},
+  {"vpmovsxdq zmm17, [rcx+64]", "62 e2 7d 48 25 49 02"},
+  {"vpmovsxdq zmm17, [rcx-200]", "62 e2 7d 48 25 89 38 ff ff ff"},
+  {"vpmovsxwd xmm17, [rcx+64]", "62 e2 7d 08 23 49 08"},
+  {"vpmovsxwd xmm17, [rcx-200]", "62 e2 7d 08 23 49 e7"},
+  {"vpmovsxwd ymm17, [rcx+64]", "62 e2 7d 28 23 49 04"},
+  {"vpmovsxwd ymm17, [rcx-200]", "62 e2 7d 28 23 89 38 ff ff ff"},
+  {"vpmovsxwd zmm17, [rcx+64]", "62 e2 7d 48 23 49 02"},
+  {"vpmovsxwd zmm17, [rcx-200]", "62 e2 7d 48 23 89 38 ff ff ff"},
+  {"vpmovsxwq xmm17, [rcx+64]", "62 e2 7d 08 24 49 10"},
+  {"vpmovsxwq xmm17, [rcx-200]", "62 e2 7d 08 24 49 ce"},
+  {"vpmovsxwq ymm17, [rcx+64]", "62 e2 7d 28 24 49 08"},
+  {"vpmovsxwq ymm17, [rcx-200]", "62 e2 7d 28 24 49 e7"},
+  {"vpmovsxwq zmm17, [rcx+64]", "62 e2 7d 48 24 49 04"},
+  {"vpmovsxwq zmm17, [rcx-200]", "62 e2 7d 48 24 89 38 ff ff ff"},
+  {"vpmovzxbd xmm17, [rcx+64]", "62 e2 7d 08 31 49 10"},
+  {"vpmovzxbd xmm17, [rcx-200]", "62 e2 7d 08 31 49 ce"},
+  {"vpmovzxbd ymm17, [rcx+64]", "62 e2 7d 28 31 49 08"},
+  {"vpmovzxbd ymm17, [rcx-200]", "62 e2 7d 28 31 49 e7"},
+  {"vpmovzxbd zmm17, [rcx+64]", "62 e2 7d 48 31 49 04"},
+  {"vpmovzxbd zmm17, [rcx-200]", "62 e2 7d 48 31 89 38 ff ff ff"},
+  {"vpmovzxbq xmm17, [rcx+64]", "62 e2 7d 08 32 49 20"},
+  {"vpmovzxbq xmm17, [rcx-200]", "62 e2 7d 08 32 49 9c"},
+  {"vpmovzxbq ymm17, [rcx+64]", "62 e2 7d 28 32 49 10"},
+  {"vpmovzxbq ymm17, [rcx-200]", "62 e2 7d 28 32 49 ce"},
+  {"vpmovzxbq zmm17, [rcx+64]", "62 e2 7d 48 32 49 08"},
+  {"vpmovzxbq zmm17, [rcx-200]", "62 e2 7d 48 32 49 e7"},
+  {"vpmovzxdq xmm17, [rcx+64]", "62 e2 7d 08 35 49 08"},
+  {"vpmovzxdq xmm17, [rcx-200]", "62 e2 7d 08 35 49 e7"},
+  {"vpmovzxdq ymm17, [rcx+64]", "62 e2 7d 28 35 49 04"},
+  {"vpmovzxdq ymm17, [rcx-200]", "62 e2 7d 28 35 89 38 ff ff ff"},
+  {"vpmovzxdq zmm17, [rcx+64]", "62 e2 7d 48 35 49 02"},
+  {"vpmovzxdq zmm17, [rcx-200]", "62 e2 7d 48 35 89 38 ff ff ff"},
+  {"vpmovzxwd xmm17, [rcx+64]", "62 e2 7d 08 33 49 08"},
+  {"vpmovzxwd xmm17, [rcx-200]", "62 e2 7d 08 33 49 e7"},
+  {"vpmovzxwd ymm17, [rcx+64]", "62 e2 7d 28 33 49 04"},
+  {"vpmovzxwd ymm17, [rcx-200]", "62 e2 7d 28 33 89 38 ff ff ff"},
+  {"vpmovzxwd zmm17, [rcx+64]", "62 e2 7d 48 33 49 02"},
+  {"vpmovzxwd zmm17, [rcx-200]", "62 e2 7d 48 33 89 38 ff ff ff"},
+  {"vpmovzxwq xmm17, [rcx+64]", "62 e2 7d 08 34 49 10"},
+  {"vpmovzxwq xmm17, [rcx-200]", "62 e2 7d 08 34 49 ce"},
+  {"vpmovzxwq ymm17, [rcx+64]", "62 e2 7d 28 34 49 08"},
+  {"vpmovzxwq ymm17, [rcx-200]", "62 e2 7d 28 34 49 e7"},
+  {"vpmovzxwq zmm17, [rcx+64]", "62 e2 7d 48 34 49 04"},
+  {"vpmovzxwq zmm17, [rcx-200]", "62 e2 7d 48 34 89 38 ff ff ff"},
+  {"vcvtps2ph [rcx+64], xmm17, 0", "62 e3 7d 08 1d 49 08 00"},
+  {"vcvtps2ph [rcx-200], xmm17, 0", "62 e3 7d 08 1d 49 e7 00"},
+  {"vcvtps2ph [rcx+64], ymm17, 0", "62 e3 7d 28 1d 49 04 00"},
+  {"vcvtps2ph [rcx-200], ymm17, 0", "62 e3 7d 28 1d 89 38 ff ff ff 00"},
+  {"vcvtps2ph [rcx+64], zmm17, 0", "62 e3 7d 48 1d 49 02 00"},
+  {"vcvtps2ph [rcx-200], zmm17, 0", "62 e3 7d 48 1d 89 38 ff ff ff 00"},
+  {"vpmovdb [rcx+64], xmm17", "62 e2 7e 08 31 49 10"},
+  {"vpmovdb [rcx-200], xmm17", "62 e2 7e 08 31 49 ce"},
+  {"vpmovdb [rcx+64], ymm17", "62 e2 7e 28 31 49 08"},
+  {"vpmovdb [rcx-200], ymm17", "62 e2 7e 28 31 49 e7"},
+  {"vpmovdb [rcx+64], zmm17", "62 e2 7e 48 31 49 04"},
+  {"vpmovdb [rcx-200], zmm17", "62 e2 7e 48 31 89 38 ff ff ff"},
+  {"vpmovdw [rcx+64], xmm17", "62 e2 7e 08 33 49 08"},
+  {"vpmovdw [rcx-200], xmm17", "62 e2 7e 08 33 49 e7"},
+  {"vpmovdw [rcx+64], ymm17", "62 e2 7e 28 33 49 04"},
+  {"vpmovdw [rcx-200], ymm17", "62 e2 7e 28 33 89 38 ff ff ff"},
+  {"vpmovdw [rcx+64], zmm17", "62 e2 7e 48 33 49 02"},
+  {"vpmovdw [rcx-200], zmm17", "62 e2 7e 48 33 89 38 ff ff ff"},
+  {"vpmovqb [rcx+64], xmm17", "62 e2 7e 08 32 49 20"},
+  {"vpmovqb [rcx-200], xmm17", "62 e2 7e 08 32 49 9c"},
+  {"vpmovqb [rcx+64], ymm17", "62 e2 7e 28 32 49 10"},
+  {"vpmovqb [rcx-200], ymm17", "62 e2 7e 28 32 49 ce"},
+  {"vpmovqb [rcx+64], zmm17", "62 e2 7e 48 32 49 08"},
+  {"vpmovqb [rcx-200], zmm17", "62 e2 7e 48 32 49 e7"},
+  {"vpmovqd [rcx+64], xmm17", "62 e2 7e 08 35 49 08"},
+  {"vpmovqd [rcx-200], xmm17", "62 e2 7e 08 35 49 e7"},
+  {"vpmovqd [rcx+64], ymm17", "62 e2 7e 28 35 49 04"},
+  {"vpmovqd [rcx-200], ymm17", "62 e2 7e 28 35 89 38 ff ff ff"},
+  {"vpmovqd [rcx+64], zmm17", "62 e2 7e 48 35 49 02"},
+  {"vpmovqd [rcx-200], zmm17", "62 e2 7e 48 35 89 38 ff ff ff"},
+  {"vpmovqw [rcx+64], xmm17", "62 e2 7e 08 34 49 10"},
+  {"vpmovqw [rcx-200], xmm17", "62 e2 7e 08 34 49 ce"},
+  {"vpmovqw [rcx+64], ymm17", "62 e2 7e 28 34 49 08"},
+  {"vpmovqw [rcx-200], ymm17", "62 e2 7e 28 34 49 e7"},
+  {"vpmovqw [rcx+64], zmm17", "62 e2 7e 48 34 49 04"},
+  {"vpmovqw [rcx-200], zmm17", "62 e2 7e 48 34 89 38 ff ff ff"},
+  {"vpmovsdb [rcx+64], xmm17", "62 e2 7e 08 21 49 10"},
+  {"vpmovsdb [rcx-200], xmm17", "62 e2 7e 08 21 49 ce"},
+  {"vpmovsdb [rcx+64], ymm17", "62 e2 7e 28 21 49 08"},
+  {"vpmovsdb [rcx-200], ymm17", "62 e2 7e 28 21 49 e7"},
+  {"vpmovsdb [rcx+64], zmm17", "62 e2 7e 48 21 49 04"},
+  {"vpmovsdb [rcx-200], zmm17", "62 e2 7e 48 21 89 38 ff ff ff"},
+  {"vpmovsdw [rcx+64], xmm17", "62 e2 7e 08 23 49 08"},
+  {"vpmovsdw [rcx-200], xmm17", "62 e2 7e 08 23 49 e7"},
+  {"vpmovsdw [rcx+64], ymm17", "62 e2 7e 28 23 49 04"},
+  {"vpmovsdw [rcx-200], ymm17", "62 e2 7e 28 23 89 38 ff ff ff"},
+  {"vpmovsdw [rcx+64], zmm17", "62 e2 7e 48 23 49 02"},
+  {"vpmovsdw [rcx-200], zmm17", "62 e2 7e 48 23 89 38 ff ff ff"},
+  {"vpmovsqb [rcx+64], xmm17", "62 e2 7e 08 22 49 20"},
+  {"vpmovsqb [rcx-200], xmm17", "62 e2 7e 08 22 49 9c"},
+  {"vpmovsqb [rcx+64], ymm17", "62 e2 7e 28 22 49 10"},
+  {"vpmovsqb [rcx-200], ymm17", "62 e2 7e 28 22 49 ce"},
+  {"vpmovsqb [rcx+64], zmm17", "62 e2 7e 48 22 49 08"},
+  {"vpmovsqb [rcx-200], zmm17", "62 e2 7e 48 22 49 e7"},
+  {"vpmovsqd [rcx+64], xmm17", "62 e2 7e 08 25 49 08"},
+  {"vpmovsqd [rcx-200], xmm17", "62 e2 7e 08 25 49 e7"},
+  {"vpmovsqd [rcx+64], ymm17", "62 e2 7e 28 25 49 04"},
+  {"vpmovsqd [rcx-200], ymm17", "62 e2 7e 28 25 89 38 ff ff ff"},
+  {"vpmovsqd [rcx+64], zmm17", "62 e2 7e 48 25 49 02"},
+  {"vpmovsqd [rcx-200], zmm17", "62 e2 7e 48 25 89 38 ff ff ff"},
+  {"vpmovsqw [rcx+64], xmm17", "62 e2 7e 08 24 49 10"},
+  {"vpmovsqw [rcx-200], xmm17", "62 e2 7e 08 24 49 ce"},
+  {"vpmovsqw [rcx+64], ymm17", "62 e2 7e 28 24 49 08"},
+  {"vpmovsqw [rcx-200], ymm17", "62 e2 7e 28 24 49 e7"},
+  {"vpmovsqw [rcx+64], zmm17", "62 e2 7e 48 24 49 04"},
+  {"vpmovsqw [rcx-200], zmm17", "62 e2 7e 48 24 89 38 ff ff ff"},
+  {"vpmovusdb [rcx+64], xmm17", "62 e2 7e 08 11 49 10"},
+  {"vpmovusdb [rcx-200], xmm17", "62 e2 7e 08 11 49 ce"},
+  {"vpmovusdb [rcx+64], ymm17", "62 e2 7e 28 11 49 08"},
+  {"vpmovusdb [rcx-200], ymm17", "62 e2 7e 28 11 49 e7"},
+  {"vpmovusdb [rcx+64], zmm17", "62 e2 7e 48 11 49 04"},
+  {"vpmovusdb [rcx-200], zmm17", "62 e2 7e 48 11 89 38 ff ff ff"},
+  {"vpmovusdw [rcx+64], xmm17", "62 e2 7e 08 13 49 08"},
+  {"vpmovusdw [rcx-200], xmm17", "62 e2 7e 08 13 49 e7"},
+  {"vpmovusdw [rcx+64], ymm17", "62 e2 7e 28 13 49 04"},
+  {"vpmovusdw [rcx-200], ymm17", "62 e2 7e 28 13 89 38 ff ff ff"},
+  {"vpmovusdw [rcx+64], zmm17", "62 e2 7e 48 13 49 02"},
+  {"vpmovusdw [rcx-200], zmm17", "62 e2 7e 48 13 89 38 ff ff ff"},
+  {"vpmovusqb [rcx+64], xmm17", "62 e2 7e 08 12 49 20"},
+  {"vpmovusqb [rcx-200], xmm17", "62 e2 7e 08 12 49 9c"},
+  {"vpmovusqb [rcx+64], ymm17", "62 e2 7e 28 12 49 10"},
+  {"vpmovusqb [rcx-200], ymm17", "62 e2 7e 28 12 49 ce"},
+  {"vpmovusqb [rcx+64], zmm17", "62 e2 7e 48 12 49 08"},
+  {"vpmovusqb [rcx-200], zmm17", "62 e2 7e 48 12 49 e7"},
+  {"vpmovusqd [rcx+64], xmm17", "62 e2 7e 08 15 49 08"},
+  {"vpmovusqd [rcx-200], xmm17", "62 e2 7e 08 15 49 e7"},
+  {"vpmovusqd [rcx+64], ymm17", "62 e2 7e 28 15 49 04"},
+  {"vpmovusqd [rcx-200], ymm17", "62 e2 7e 28 15 89 38 ff ff ff"},
+  {"vpmovusqd [rcx+64], zmm17", "62 e2 7e 48 15 49 02"},
+  {"vpmovusqd [rcx-200], zmm17", "62 e2 7e 48 15 89 38 ff ff ff"},
+  {"vpmovusqw [rcx+64], xmm17", "62 e2 7e 08 14 49 10"},
+  {"vpmovusqw [rcx-200], xmm17", "62 e2 7e 08 14 49 ce"},
+  {"vpmovusqw [rcx+64], ymm17", "62 e2 7e 28 14 49 08"},
+  {"vpmovusqw [rcx-200], ymm17", "62 e2 7e 28 14 49 e7"},
+  {"vpmovusqw [rcx+64], zmm17", "62 e2 7e 48 14 49 04"},
+  {"vpmovusqw [rcx-200], zmm17", "62 e2 7e 48 14 89 38 ff ff ff"},
+};
+
+// Instructions that load a memory operand with a fraction of the vector
+// length.
+typedef void (Assembler::*LoadOp)(ZMMRegister, const Operand &, Mask);
+static const std::pair<const char *, LoadOp> kLoads[] = {
+  {"vcvtps2pd", &Assembler::vcvtps2pd},
+  {"vcvtudq2pd", &Assembler::vcvtudq2pd},
+  {"vpmovsxbd", &Assembler::vpmovsxbd},
+  {"vpmovsxbq", &Assembler::vpmovsxbq},
+  {"vpmovsxdq", &Assembler::vpmovsxdq},
+  {"vpmovsxwd", &Assembler::vpmovsxwd},
+  {"vpmovsxwq", &Assembler::vpmovsxwq},
+  {"vpmovzxbd", &Assembler::vpmovzxbd},
+  {"vpmovzxbq", &Assembler::vpmovzxbq},
+  {"vpmovzxdq", &Assembler::vpmovzxdq},
+  {"vpmovzxwd", &Assembler::vpmovzxwd},
+  {"vpmovzxwq", &Assembler::vpmovzxwq},
+};
+
+// Instructions that store a memory operand with a fraction of the vector
+// length.
+typedef void (Assembler::*StoreOp)(const Operand &, ZMMRegister, Mask);
+static const std::pair<const char *, StoreOp> kStores[] = {
+  {"vpmovdb", &Assembler::vpmovdb},
+  {"vpmovdw", &Assembler::vpmovdw},
+  {"vpmovqb", &Assembler::vpmovqb},
+  {"vpmovqd", &Assembler::vpmovqd},
+  {"vpmovqw", &Assembler::vpmovqw},
+  {"vpmovsdb", &Assembler::vpmovsdb},
+  {"vpmovsdw", &Assembler::vpmovsdw},
+  {"vpmovsqb", &Assembler::vpmovsqb},
+  {"vpmovsqd", &Assembler::vpmovsqd},
+  {"vpmovsqw", &Assembler::vpmovsqw},
+  {"vpmovusdb", &Assembler::vpmovusdb},
+  {"vpmovusdw", &Assembler::vpmovusdw},
+  {"vpmovusqb", &Assembler::vpmovusqb},
+  {"vpmovusqd", &Assembler::vpmovusqd},
+  {"vpmovusqw", &Assembler::vpmovusqw},
+};
+
+// Displacements with and without compressed encoding.
+static const int kDisplacements[] = {64, -200};
+
+// Register names for vector lengths.
+static const char *kRegisterNames[] = {"xmm17", "ymm17", "zmm17"};
+
+// Assembler for encoding single instructions.
+class Encoder {
+ public:
+  Encoder() {
+    for (const Encoding &e : kExpected) expected_[e.instruction] = e.bytes;
+  }
+
+  // Return register for vector length, i.e. 0 for 128, 1 for 256, and 2 for
+  // 512 bits.
+  static ZMMRegister Reg(int length) {
+    switch (length) {
+      case 0: return zmm17.x();
+      case 1: return zmm17.y();
+      default: return zmm17.z();
+    }
+  }
+
+  // Start encoding new instruction.
+  Assembler *Begin() {
+    start_ = masm_.pc_offset();
+    return &masm_;
+  }
+
+  // Compare encoding of instruction with expected encoding.
+  void Check(const string &instruction) {
+    string actual;
+    for (int pos = start_; pos < masm_.pc_offset(); ++pos) {
+      if (!actual.empty()) actual.push_back(' ');
+      StringAppendF(&actual, "%02x", masm_.byte_at(pos));
+    }
+    auto f = expected_.find(instruction);
+    CHECK(f != expected_.end()) << "No expected encoding for " << instruction;
+    CHECK_EQ(actual, f->second) << instruction;
+    checked_++;
+  }
+
+  int checked() const { return checked_; }
+
+ private:
+  Assembler masm_{nullptr, 0};
+  int start_ = 0;
+  int checked_ = 0;
+  std::map<string, string> expected_;
+};
+
+int main(int argc, char *argv[]) {
+  InitProgram(&argc, &argv);
+  Encoder encoder;
+
+  for (int length = 0; length < 3; ++length) {
+    ZMMRegister reg = Encoder::Reg(length);
+    const char *name = kRegisterNames[length];
+    for (int disp : kDisplacements) {
+      Operand mem(rcx, disp);
+      for (auto &load : kLoads) {
+        (encoder.Begin()->*load.second)(reg, mem, nomask);
+        encoder.Check(StringPrintf("%s %s, [rcx%+d]", load.first, name, disp));
+      }
+      for (auto &store : kStores) {
+        (encoder.Begin()->*store.second)(mem, reg, nomask);
+        encoder.Check(StringPrintf("%s [rcx%+d], %s",
+                                   store.first, disp, name));
+      }
+      encoder.Begin()->vcvtps2ph(mem, reg, 0);
+      encoder.Check(StringPrintf("vcvtps2ph [rcx%+d], %s, 0", disp, name));
+    }
+  }
+  CHECK_EQ(encoder.checked(), sizeof(kExpected) / sizeof(Encoding));
+
+  LOG(INFO) << "EVEX encoding test passed, " << encoder.checked()
+            << " instructions checked";
+  return 0;
+}
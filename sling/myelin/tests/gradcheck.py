@@ -484,6 +484,22 @@ def check_softmax():
   y = f.softmax(x, name="y")
   gradcheck(f, [x], [y])
 
+def check_log_softmax():
+  flow = myelin.Flow()
+  f = flow.define("log_softmax")
+  x = f.var("x", dtype, shape)
+  y = f.log_softmax(x, name="y")
+  gradcheck(f, [x], [y], tol=1e-3)
+
+def check_layer_norm():
+  flow = myelin.Flow()
+  f = flow.define("layer_norm")
+  x = f.var("x", dtype, [4, 16])
+  gamma = f.var("gamma", dtype, [16])
+  beta = f.var("beta", dtype, [16])
+  y = f.layer_norm(x, gamma, beta, name="y")
+  gradcheck(f, [x, gamma, beta], [y], eps=1e-2, tol=1e-2)
+
 def check_logsumexp():
   flow = myelin.Flow()
   f = flow.define("logsumexp")
@@ -590,8 +606,10 @@ check_normalize()
 check_sum()
 check_max()
 check_min()
-#check_softmax()
+check_softmax()
+check_log_softmax()
 check_logsumexp()
+check_layer_norm()
 check_matmul()
 check_bcast_add()
 check_bcast_mul()
@@ -273,7 +273,7 @@ class Tagger {
       StringDecoder decoder(&store_, record.value.data(), record.value.size());
       Document *document = new Document(decoder.Decode().AsFrame(), names_);
       corpus->push_back(document);
-      for (auto &t : document->tokens()) {
+      for (Token t : document->tokens()) {
         FrameDatum *datum = store_.GetFrame(t.handle());
         Handle tag = datum->get(n_pos_);
         auto f = tagmap_.find(tag);
@@ -317,11 +317,11 @@ class Tagger {
       // Build lexicon.
       std::unordered_map<string, int> words;
       for (Document *s : train_) {
-        for (const Token &t : s->tokens()) words[t.word()]++;
+        for (Token t : s->tokens()) words[t.word().str()]++;
       }
       if (!FLAGS_embeddings.empty()) {
         for (Document *s : dev_) {
-          for (const Token &t : s->tokens()) words[t.word()]++;
+          for (Token t : s->tokens()) words[t.word().str()]++;
         }
       }
       Vocabulary::HashMapIterator vocab(words);
@@ -0,0 +1,275 @@
+// Copyright 2025 Ringgaard Research ApS
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <math.h>
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "sling/base/clock.h"
+#include "sling/base/flags.h"
+#include "sling/base/init.h"
+#include "sling/base/logging.h"
+#include "sling/myelin/builder.h"
+#include "sling/myelin/compute.h"
+#include "sling/myelin/flow.h"
+#include "sling/myelin/kernel/library.h"
+
+DEFINE_bool(benchmark, false, "Benchmark fused kernels");
+
+using namespace sling;
+using namespace sling::myelin;
+
+// Epsilon for layer normalization.
+static const float kEpsilon = 1e-5f;
+
+// Compute op with fused kernel and compare the result with a reference
+// computation in double precision. The op is computed over the given axis, or
+// over all elements for axis -1. Layer normalization is always computed over
+// the last axis, with scale and bias if affine is true.
+template <typename T> static void Check(const string &op,
+                                        const std::vector<int> &dims,
+                                        int axis, bool affine) {
+  Library library;
+  RegisterStandardLibrary(&library);
+
+  // Build flow for op.
+  Flow flow;
+  FlowBuilder f(&flow, "f");
+  Type type = Traits<T>().type();
+  Shape shape(dims);
+  int n = dims.back();
+  auto *x = f.Placeholder("x", type, shape);
+  Flow::Variable *y;
+  if (op == "SoftMax") {
+    y = f.SoftMax(x, axis);
+  } else if (op == "LogSoftMax") {
+    y = f.LogSoftMax(x, axis);
+  } else if (op == "LogSumExp") {
+    y = f.LogSumExp(x, axis);
+  } else {
+    Flow::Variable *gamma = nullptr;
+    Flow::Variable *beta = nullptr;
+    if (affine) {
+      gamma = f.Placeholder("gamma", type, {n});
+      beta = f.Placeholder("beta", type, {n});
+    }
+    y = f.LayerNorm(x, gamma, beta, kEpsilon);
+  }
+  f.Name(y, "y")->set_out();
+
+  // Compile flow and check that the fused kernel is used when the op is
+  // computed over the last axis.
+  flow.Analyze(library);
+  Network network;
+  CHECK(network.Compile(flow, library));
+  Cell *cell = network.GetCell("f");
+  bool last = op == "LayerNorm" || axis == dims.size() - 1 || dims.size() == 1;
+  if (last) {
+    bool fused = false;
+    for (const Step *step : cell->steps()) {
+      if (step->type() == op && step->kernel()->Name() == op) fused = true;
+    }
+    CHECK(fused) << op << " " << shape.ToString() << " not fused";
+  }
+
+  // Fill input with random values. Layer normalization inputs have a large
+  // offset to check that the variance is computed in a stable way.
+  Instance data(cell);
+  std::mt19937 prng(314159);
+  std::normal_distribution<double> normal(0.0, 3.0);
+  int elements = shape.elements();
+  std::vector<double> input(elements), scale(n), bias(n);
+  T *xdata = data.Get<T>(cell->GetParameter("f/x"));
+  double offset = op == "LayerNorm" ? 100.0 : 0.0;
+  for (int i = 0; i < elements; ++i) {
+    xdata[i] = normal(prng) + offset;
+    input[i] = xdata[i];
+  }
+  if (affine) {
+    T *gamma = data.Get<T>(cell->GetParameter("f/gamma"));
+    T *beta = data.Get<T>(cell->GetParameter("f/beta"));
+    for (int i = 0; i < n; ++i) {
+      gamma[i] = normal(prng);
+      beta[i] = normal(prng);
+      scale[i] = gamma[i];
+      bias[i] = beta[i];
+    }
+  }
+  data.Compute();
+  const T *output = data.Get<T>(cell->GetParameter("f/y"));
+
+  // Compute reference and compare with output. The rows are contiguous for
+  // the last axis, otherwise the elements in a row are strided.
+  int size;
+  if (op == "LayerNorm") {
+    size = n;
+  } else if (axis == -1) {
+    size = elements;
+  } else {
+    size = dims[axis];
+  }
+  int stride = 1;
+  if (op != "LayerNorm" && axis != -1) {
+    for (int d = axis + 1; d < dims.size(); ++d) stride *= dims[d];
+  }
+  int rows = elements / size;
+  double error = 0.0;
+  for (int r = 0; r < rows; ++r) {
+    int base = (r / stride) * size * stride + r % stride;
+    auto at = [&](int i) { return base + i * stride; };
+    double max = -INFINITY;
+    double sum = 0.0;
+    double mean = 0.0;
+    double var = 0.0;
+    for (int i = 0; i < size; ++i) max = std::max(max, input[at(i)]);
+    for (int i = 0; i < size; ++i) sum += exp(input[at(i)] - max);
+    for (int i = 0; i < size; ++i) mean += input[at(i)];
+    mean /= size;
+    for (int i = 0; i < size; ++i) {
+      var += (input[at(i)] - mean) * (input[at(i)] - mean);
+    }
+    var /= size;
+    double lse = max + log(sum);
+
+    if (op == "LogSumExp") {
+      error = std::max(error, fabs(output[r] - lse));
+      continue;
+    }
+    for (int i = 0; i < size; ++i) {
+      double v = input[at(i)];
+      double expected;
+      if (op == "SoftMax") {
+        expected = exp(v - lse);
+      } else if (op == "LogSoftMax") {
+        expected = v - lse;
+      } else {
+        expected = (v - mean) / sqrt(var + kEpsilon);
+        if (affine) expected = expected * scale[i] + bias[i];
+      }
+      error = std::max(error, fabs(output[at(i)] - expected));
+    }
+  }
+
+  VLOG(1) << op << " " << TypeTraits::of(type).name() << " "
+          << shape.ToString() << " axis " << axis
+          << (affine ? " affine" : "") << " error " << error;
+  double tolerance = type == DT_FLOAT ? 2e-4 : 1e-8;
+  CHECK_LT(error, tolerance)
+      << op << " " << TypeTraits::of(type).name() << " " << shape.ToString()
+      << " axis " << axis << (affine ? " affine" : "");
+
+  // Benchmark fused kernel.
+  if (FLAGS_benchmark) {
+    const int iterations = 10000;
+    Clock clock;
+    clock.start();
+    for (int i = 0; i < iterations; ++i) data.Compute();
+    clock.stop();
+    LOG(INFO) << op << " " << TypeTraits::of(type).name() << " "
+              << shape.ToString() << ": " << clock.us() / iterations << " us";
+  }
+}
+
+// Normalization ops that are not supported by the fused kernels are expanded
+// into basic ops. Layer normalization with scalar scale and bias is not
+// supported by the kernel, and ops in tasks can be placed on a device.
+static void CheckExpanded() {
+  Library library;
+  RegisterStandardLibrary(&library);
+
+  Flow flow;
+  FlowBuilder f(&flow, "f");
+  auto *x = f.Placeholder("x", DT_FLOAT, {4, 7});
+  auto *gamma = f.Placeholder("gamma", DT_FLOAT, {1});
+  auto *beta = f.Placeholder("beta", DT_FLOAT, {1});
+  f.Name(f.LayerNorm(x, gamma, beta, kEpsilon), "norm")->set_out();
+  auto *softmax = f.Name(f.SoftMax(x, 1), "softmax");
+  softmax->set_out();
+  softmax->producer->task = 1;
+
+  flow.Analyze(library);
+  Network network;
+  CHECK(network.Compile(flow, library));
+  Cell *cell = network.GetCell("f");
+  for (const Step *step : cell->steps()) {
+    CHECK(step->type() != "LayerNorm" && step->type() != "SoftMax")
+        << step->type() << " not expanded";
+  }
+
+  // Compute ops and compare with reference.
+  Instance data(cell);
+  float *xdata = data.Get<float>(cell->GetParameter("f/x"));
+  for (int i = 0; i < 28; ++i) xdata[i] = (i * 7 % 11) - 5.0f;
+  *data.Get<float>(cell->GetParameter("f/gamma")) = 2.0f;
+  *data.Get<float>(cell->GetParameter("f/beta")) = 0.5f;
+  data.Compute();
+  const float *norm = data.Get<float>(cell->GetParameter("f/norm"));
+  const float *sm = data.Get<float>(cell->GetParameter("f/softmax"));
+  for (int r = 0; r < 4; ++r) {
+    const float *row = xdata + r * 7;
+    double mean = 0.0, var = 0.0, max = -INFINITY, sum = 0.0;
+    for (int i = 0; i < 7; ++i) mean += row[i] / 7.0;
+    for (int i = 0; i < 7; ++i) var += (row[i] - mean) * (row[i] - mean) / 7.0;
+    for (int i = 0; i < 7; ++i) max = std::max(max, double(row[i]));
+    for (int i = 0; i < 7; ++i) sum += exp(row[i] - max);
+    for (int i = 0; i < 7; ++i) {
+      double expected = (row[i] - mean) / sqrt(var + kEpsilon) * 2.0 + 0.5;
+      CHECK_LT(fabs(norm[r * 7 + i] - expected), 2e-4);
+      CHECK_LT(fabs(sm[r * 7 + i] - exp(row[i] - max) / sum), 2e-4);
+    }
+  }
+}
+
+int main(int argc, char *argv[]) {
+  InitProgram(&argc, &argv);
+
+  // Row sizes cover single elements, partial vectors, multiple vectors with
+  // residuals, and long rows.
+  std::vector<std::vector<int>> shapes = {
+    {1}, {7}, {8}, {16}, {33}, {1000}, {4, 7}, {5, 16}, {3, 4, 129},
+  };
+
+  // Softmax, log-softmax, and log-sum-exp over the last axis, over all
+  // elements, and over the first axis.
+  for (const char *op : {"SoftMax", "LogSoftMax", "LogSumExp"}) {
+    for (const std::vector<int> &dims : shapes) {
+      int last = dims.size() - 1;
+      Check<float>(op, dims, last, false);
+      Check<double>(op, dims, last, false);
+      Check<float>(op, dims, -1, false);
+      Check<double>(op, dims, -1, false);
+      if (dims.size() > 1) {
+        Check<float>(op, dims, 0, false);
+        Check<double>(op, dims, 0, false);
+      }
+    }
+  }
+
+  // Layer normalization with and without scale and bias.
+  shapes.push_back({16, 768});
+  for (const std::vector<int> &dims : shapes) {
+    for (bool affine : {false, true}) {
+      Check<float>("LayerNorm", dims, -1, affine);
+      Check<double>("LayerNorm", dims, -1, affine);
+    }
+  }
+
+  // Unsupported ops are expanded.
+  CheckExpanded();
+
+  LOG(INFO) << "Normalization kernel test passed";
+  return 0;
+}
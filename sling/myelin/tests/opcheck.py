@@ -539,6 +539,32 @@ def softmax_axis_test(n, m, a):
   y = f.softmax(x, axis=a)
   check(flow, (n, m, a))
 
+def log_softmax_test(n):
+  flow = myelin.Flow()
+  f = flow.define("log_softmax")
+  x = f.var("x", dt, [n])
+  y = f.log_softmax(x)
+  check(flow, n, atol=1e-6)
+
+def log_softmax_axis_test(n, m, a):
+  flow = myelin.Flow()
+  f = flow.define("log_softmax_axis")
+  x = f.var("x", dt, [n, m])
+  y = f.log_softmax(x, axis=a)
+  check(flow, (n, m, a), atol=1e-6)
+
+def layer_norm_test(n, m, affine):
+  flow = myelin.Flow()
+  f = flow.define("layer_norm")
+  x = f.var("x", dt, [n, m])
+  if affine:
+    gamma = f.var("gamma", dt, [m])
+    beta = f.var("beta", dt, [m])
+    y = f.layer_norm(x, gamma, beta)
+  else:
+    y = f.layer_norm(x)
+  check(flow, (n, m, affine), rtol=1e-4, atol=1e-5)
+
 def logsumexp_test(n):
   flow = myelin.Flow()
   f = flow.define("logsumexp")
@@ -1119,6 +1145,7 @@ for i in sizes:
     erf_test(i)
     sigmoid_test(i)
     softmax_test(i)
+    log_softmax_test(i)
     logsumexp_test(i)
     sum_test(i)
     product_test(i)
@@ -1149,9 +1176,14 @@ for i in sizes:
       argmax_axis_test([i, j], axis)
       if dt == myelin.DT_FLOAT or dt == myelin.DT_DOUBLE:
         softmax_axis_test(i, j, axis)
+        log_softmax_axis_test(i, j, axis)
         for keepdims in [False, True]:
           logsumexp_axis_test(i, j, axis, keepdims)
 
+    if dt == myelin.DT_FLOAT or dt == myelin.DT_DOUBLE:
+      for affine in [False, True]:
+        layer_norm_test(i, j, affine)
+
     bcast_outer_test(i, j)
     matmul_transpose_test(i, j)
     if not flags.arg.mkl: matmul_all_orders_test(i, j, 32)
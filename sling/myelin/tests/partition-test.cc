@@ -0,0 +1,230 @@
+// Copyright 2025 Ringgaard Research ApS
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <math.h>
+#include <random>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "sling/base/clock.h"
+#include "sling/base/flags.h"
+#include "sling/base/init.h"
+#include "sling/base/logging.h"
+#include "sling/myelin/builder.h"
+#include "sling/myelin/compute.h"
+#include "sling/myelin/flow.h"
+#include "sling/myelin/kernel/library.h"
+#include "sling/myelin/multi-process.h"
+#include "sling/myelin/partitioner.h"
+
+DEFINE_int32(tasks, 4, "Maximum number of tiles per op");
+DEFINE_int32(max_tasks, -1, "Parallel tasks per function (-1 for cores-1)");
+DEFINE_int32(repeat, 100, "Number of repetitions for timing");
+
+using namespace sling;
+using namespace sling::myelin;
+
+// Test case with a matmul or pooled gather op.
+struct Case {
+  string op;          // op type
+  int m;              // rows (matmul) or vocabulary size (gather)
+  int k;              // inner dimension (matmul) or features (gather)
+  int n;              // output columns
+  bool transposed;    // transposed weight matrix
+};
+
+// Build flow for test case.
+static void BuildFlow(Flow *flow, const Case &c) {
+  std::mt19937 prng(314159);
+  std::normal_distribution<float> normal(0.0, 1.0);
+  FlowBuilder f(flow, "f");
+  if (c.op == "MatMul") {
+    std::vector<float> weights(c.k * c.n);
+    for (float &w : weights) w = normal(prng);
+    Shape shape = c.transposed ? Shape({c.n, c.k}) : Shape({c.k, c.n});
+    auto *W = f.Const(weights.data(), DT_FLOAT, shape);
+    auto *x = f.Placeholder("x", DT_FLOAT, {c.m, c.k});
+    auto *y = f.Op("MatMul", {x, W}, DT_FLOAT, {c.m, c.n});
+    if (c.transposed) y->producer->SetAttr("transpose_b", true);
+    f.Name(y, "y")->set_out();
+  } else {
+    std::vector<float> embeddings(c.m * c.n);
+    for (float &e : embeddings) e = normal(prng);
+    auto *E = f.Const(embeddings.data(), DT_FLOAT, {c.m, c.n});
+    auto *x = f.Placeholder("x", DT_INT32, {1, c.k, 1});
+    auto *y = f.Op(c.op, {E, x}, DT_FLOAT, {1, c.n});
+    y->producer->SetAttr("batch", 1);
+    f.Name(y, "y")->set_out();
+  }
+}
+
+// Compile flow and compute output for test case. Returns the time in
+// microseconds per computation.
+static double Run(Flow *flow, const Case &c, const Library &library,
+                  Runtime *runtime, std::vector<float> *output) {
+  Network network;
+  if (runtime != nullptr) network.set_runtime(runtime);
+  CHECK(network.Compile(*flow, library));
+  Cell *cell = network.GetCell("f");
+
+  double time;
+  {
+    Instance data(cell);
+    Tensor *x = cell->GetParameter("f/x");
+    if (c.op == "MatMul") {
+      float *input = data.Get<float>(x);
+      for (int i = 0; i < x->elements(); ++i) input[i] = sin(i * 0.1);
+    } else {
+      // Use half of the feature slots and leave the rest empty.
+      int *input = data.Get<int>(x);
+      for (int i = 0; i < x->elements(); ++i) {
+        input[i] = i < c.k / 2 ? (i * 7919) % c.m : -1;
+      }
+    }
+
+    Clock clock;
+    data.Compute();
+    clock.start();
+    for (int i = 0; i < FLAGS_repeat; ++i) data.Compute();
+    clock.stop();
+    time = clock.us() / FLAGS_repeat;
+
+    Tensor *y = cell->GetParameter("f/y");
+    float *result = data.Get<float>(y);
+    output->assign(result, result + y->elements());
+  }
+  return time;
+}
+
+// Check that the number of parallel tasks in a function stays within the
+// budget when several ops are partitioned.
+static void TestBudget(const Library &library) {
+  std::mt19937 prng(314159);
+  std::normal_distribution<float> normal(0.0, 1.0);
+  Flow flow;
+  FlowBuilder f(&flow, "f");
+  auto *x = f.Placeholder("x", DT_FLOAT, {1, 512});
+  for (int i = 0; i < 3; ++i) {
+    std::vector<float> weights(512 * 4096);
+    for (float &w : weights) w = normal(prng);
+    auto *W = f.Const(weights.data(), DT_FLOAT, {512, 4096});
+    f.Name(f.MatMul(x, W), "y" + std::to_string(i))->set_out();
+  }
+  flow.Analyze(library);
+
+  // The first op gets four tiles, i.e. three parallel tasks, the second op
+  // gets the remaining parallel task, and the last op is not split.
+  Partitioner::Options options;
+  options.tasks = 4;
+  options.max_tasks = 4;
+  Partitioner partitioner(options);
+  CHECK_EQ(partitioner.Partition(&flow), 2);
+  CHECK(flow.IsConsistent());
+  std::set<int> tasks;
+  int tiles = 0;
+  for (Flow::Operation *op : flow.ops()) {
+    if (op->type != "MatMul") continue;
+    tiles++;
+    if (op->task != 0) tasks.insert(op->task);
+  }
+  CHECK_EQ(tasks.size(), 4);
+  CHECK_EQ(tiles, 4 + 2 + 1);
+
+  // Nothing is split without a budget for parallel tasks.
+  Flow single;
+  FlowBuilder g(&single, "f");
+  std::vector<float> weights(512 * 4096);
+  auto *W = g.Const(weights.data(), DT_FLOAT, {512, 4096});
+  g.MatMul(g.Placeholder("x", DT_FLOAT, {1, 512}), W);
+  single.Analyze(library);
+  options.max_tasks = 0;
+  Partitioner none(options);
+  CHECK_EQ(none.Partition(&single), 0);
+
+  LOG(INFO) << "Partition budget test passed";
+}
+
+int main(int argc, char *argv[]) {
+  InitProgram(&argc, &argv);
+
+  Library library;
+  RegisterStandardLibrary(&library);
+  MultiProcessorRuntime runtime;
+
+  std::vector<Case> tests = {
+    {"MatMul", 1, 512, 4096, false},
+    {"MatMul", 1, 1024, 1024, true},
+    {"MatMul", 8, 256, 1000, false},
+    {"MatMul", 1, 64, 64, false},
+    {"GatherSum", 100000, 512, 64, false},
+    {"GatherMax", 100000, 512, 64, false},
+    {"GatherAvg", 10000, 2048, 256, false},
+    {"GatherSum", 1000, 16, 64, false},
+  };
+
+  TestBudget(library);
+
+  // The test cases are only partitioned on hosts with multiple cores, since
+  // the default budget is one parallel task per additional core.
+  Partitioner::Options options;
+  options.tasks = FLAGS_tasks;
+  options.max_tasks = FLAGS_max_tasks;
+  int total = 0;
+  for (const Case &c : tests) {
+    string name = c.op + " " + std::to_string(c.m) + "x" +
+                  std::to_string(c.k) + "x" + std::to_string(c.n) +
+                  (c.transposed ? "T" : "");
+
+    // Compute reference output without partitioning.
+    Flow reference;
+    BuildFlow(&reference, c);
+    reference.Analyze(library);
+    std::vector<float> expected;
+    double baseline = Run(&reference, c, library, nullptr, &expected);
+
+    // Partition op and compute output with parallel tasks.
+    Flow flow;
+    BuildFlow(&flow, c);
+    flow.Analyze(library);
+    Partitioner partitioner(options);
+    int partitioned = partitioner.Partition(&flow);
+    CHECK(flow.IsConsistent()) << name;
+    std::vector<float> actual;
+    double time = Run(&flow, c, library, &runtime, &actual);
+    total += partitioned;
+
+    // Check that the partitioned op computes the same output.
+    CHECK_EQ(expected.size(), actual.size()) << name;
+    for (int i = 0; i < expected.size(); ++i) {
+      CHECK_LT(fabs(expected[i] - actual[i]), 1e-3)
+          << name << " element " << i;
+    }
+
+    int tiles = 0;
+    for (Flow::Operation *op : flow.ops()) {
+      if (op->type == c.op) tiles++;
+    }
+    LOG(INFO) << name << ": " << tiles << " tiles, "
+              << baseline << " us -> " << time << " us";
+  }
+  int cores = std::thread::hardware_concurrency();
+  if (FLAGS_max_tasks > 0 || (FLAGS_max_tasks < 0 && cores > 1)) {
+    CHECK_GT(total, 0);
+  }
+
+  LOG(INFO) << "Partition test passed, " << total << " ops partitioned";
+  return 0;
+}
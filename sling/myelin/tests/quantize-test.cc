@@ -0,0 +1,269 @@
+// Copyright 2025 Ringgaard Research ApS
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Check accuracy and speed of quantized matrix multiplication.
+
+#include <math.h>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "sling/base/clock.h"
+#include "sling/base/flags.h"
+#include "sling/base/init.h"
+#include "sling/base/logging.h"
+#include "sling/myelin/builder.h"
+#include "sling/myelin/compute.h"
+#include "sling/myelin/flow.h"
+#include "sling/myelin/kernel/library.h"
+#include "third_party/jit/cpu.h"
+
+DEFINE_int32(rows, 1, "Number of input rows for benchmark");
+DEFINE_int32(inputs, 512, "Input dimension for benchmark");
+DEFINE_int32(outputs, 512, "Output dimension for benchmark");
+DEFINE_int32(layers, 2, "Number of layers for benchmark");
+DEFINE_int32(repeat, 10000, "Number of benchmark iterations");
+DEFINE_double(tolerance, 0.02, "Maximum relative error");
+DEFINE_bool(transposed, false, "Use transposed weight matrices");
+DEFINE_bool(sweep, true, "Check accuracy for range of matrix sizes");
+DEFINE_bool(avx512, true, "Use AVX-512 kernels if supported");
+
+using namespace sling;
+using namespace sling::myelin;
+
+// Feed-forward network with tanh activations and a float and a quantized
+// version of the same model.
+struct Model {
+  Model(int rows, int inputs, int outputs, int layers, bool transposed) {
+    // Build flows with the same random weights.
+    BuildFlow(&flow, rows, inputs, outputs, layers, transposed);
+    BuildFlow(&qflow, rows, inputs, outputs, layers, transposed);
+
+    // Compile float network.
+    RegisterStandardLibrary(&library);
+    flow.Analyze(library);
+    CHECK(network.Compile(flow, library));
+
+    // Compile quantized network.
+    RegisterStandardLibrary(&qlibrary);
+    RegisterQuantizationTransforms(&qlibrary);
+    qflow.Analyze(qlibrary);
+    CHECK(qnetwork.Compile(qflow, qlibrary));
+    CHECK(!qflow.Find("QuantizedMatMul").empty()) << "No ops quantized";
+  }
+
+  static void BuildFlow(Flow *flow, int rows, int inputs, int outputs,
+                        int layers, bool transposed) {
+    std::mt19937 prng(314159);
+    FlowBuilder f(flow, "f");
+    auto *h = f.Placeholder("x", DT_FLOAT, {rows, inputs});
+    int n = inputs;
+    for (int l = 0; l < layers; ++l) {
+      std::normal_distribution<float> normal(0.0, 1.0 / sqrt(n));
+      std::vector<float> weights(n * outputs);
+      for (float &w : weights) w = normal(prng);
+      Shape shape = transposed ? Shape({outputs, n}) : Shape({n, outputs});
+      auto *W = f.Const(weights.data(), DT_FLOAT, shape);
+      if (transposed) {
+        h = f.Op("MatMul", {h, W}, DT_FLOAT, {rows, outputs});
+        h->producer->SetAttr("transpose_b", true);
+      } else {
+        h = f.MatMul(h, W);
+      }
+      if (l < layers - 1) h = f.Tanh(h);
+      n = outputs;
+    }
+    f.Name(h, "y")->set_out();
+  }
+
+  Flow flow;
+  Flow qflow;
+  Library library;
+  Library qlibrary;
+  Network network;
+  Network qnetwork;
+};
+
+// Compare float and quantized model on random inputs. Returns the relative
+// error.
+double Check(int rows, int inputs, int outputs, int layers, bool transposed) {
+  Model model(rows, inputs, outputs, layers, transposed);
+  Cell *cell = model.network.GetCell("f");
+  Cell *qcell = model.qnetwork.GetCell("f");
+  Tensor *x = cell->GetParameter("f/x");
+  Tensor *y = cell->GetParameter("f/y");
+  Tensor *qx = qcell->GetParameter("f/x");
+  Tensor *qy = qcell->GetParameter("f/y");
+
+  Instance data(cell);
+  Instance qdata(qcell);
+  std::mt19937 prng(271828);
+  std::uniform_real_distribution<float> uniform(-1.0, 1.0);
+  double err2 = 0.0;
+  double norm2 = 0.0;
+  double maxerr = 0.0;
+  for (int iter = 0; iter < 10; ++iter) {
+    for (int r = 0; r < rows; ++r) {
+      for (int i = 0; i < inputs; ++i) {
+        float v = uniform(prng);
+        *data.Get<float>(x, r, i) = v;
+        *qdata.Get<float>(qx, r, i) = v;
+      }
+    }
+    data.Compute();
+    qdata.Compute();
+    for (int r = 0; r < rows; ++r) {
+      for (int j = 0; j < outputs; ++j) {
+        double expected = *data.Get<float>(y, r, j);
+        double actual = *qdata.Get<float>(qy, r, j);
+        double diff = actual - expected;
+        err2 += diff * diff;
+        norm2 += expected * expected;
+        maxerr = std::max(maxerr, fabs(diff));
+      }
+    }
+  }
+
+  double relerr = norm2 > 0.0 ? sqrt(err2 / norm2) : sqrt(err2);
+  LOG(INFO) << rows << "x" << inputs << "x" << outputs
+            << (transposed ? "T" : "") << " layers: " << layers
+            << " relative error: " << relerr
+            << " max error: " << maxerr;
+  return relerr;
+}
+
+// Check model where the same square weight matrix is used both as is and
+// transposed. The two uses need separately quantized weights. Returns the
+// largest relative error of the two outputs.
+double CheckShared(int n) {
+  Flow flows[2];
+  Library libraries[2];
+  Network networks[2];
+  for (int i = 0; i < 2; ++i) {
+    std::mt19937 prng(314159);
+    std::normal_distribution<float> normal(0.0, 1.0 / sqrt(n));
+    std::vector<float> weights(n * n);
+    for (float &w : weights) w = normal(prng);
+
+    FlowBuilder f(&flows[i], "f");
+    auto *x = f.Placeholder("x", DT_FLOAT, {1, n});
+    auto *W = f.Const(weights.data(), DT_FLOAT, {n, n});
+    f.Name(f.MatMul(x, W), "y1")->set_out();
+    auto *y2 = f.Op("MatMul", {x, W}, DT_FLOAT, {1, n});
+    y2->producer->SetAttr("transpose_b", true);
+    f.Name(y2, "y2")->set_out();
+
+    RegisterStandardLibrary(&libraries[i]);
+    if (i == 1) RegisterQuantizationTransforms(&libraries[i]);
+    flows[i].Analyze(libraries[i]);
+    CHECK(networks[i].Compile(flows[i], libraries[i]));
+  }
+  CHECK_EQ(flows[1].Find("QuantizedMatMul").size(), 2);
+
+  Cell *cells[2];
+  Instance *data[2];
+  for (int i = 0; i < 2; ++i) {
+    cells[i] = networks[i].GetCell("f");
+    data[i] = new Instance(cells[i]);
+  }
+  std::mt19937 prng(271828);
+  std::uniform_real_distribution<float> uniform(-1.0, 1.0);
+  for (int k = 0; k < n; ++k) {
+    float v = uniform(prng);
+    for (int i = 0; i < 2; ++i) {
+      *data[i]->Get<float>(cells[i]->GetParameter("f/x"), 0, k) = v;
+    }
+  }
+  for (int i = 0; i < 2; ++i) data[i]->Compute();
+
+  double relerr = 0.0;
+  for (const char *output : {"f/y1", "f/y2"}) {
+    Tensor *y = cells[0]->GetParameter(output);
+    Tensor *qy = cells[1]->GetParameter(output);
+    double err2 = 0.0;
+    double norm2 = 0.0;
+    for (int j = 0; j < n; ++j) {
+      double expected = *data[0]->Get<float>(y, 0, j);
+      double actual = *data[1]->Get<float>(qy, 0, j);
+      err2 += (actual - expected) * (actual - expected);
+      norm2 += expected * expected;
+    }
+    relerr = std::max(relerr, sqrt(err2 / norm2));
+  }
+  for (int i = 0; i < 2; ++i) delete data[i];
+
+  LOG(INFO) << n << "x" << n << " shared relative error: " << relerr;
+  return relerr;
+}
+
+// Measure speed of float and quantized model.
+void Benchmark(int rows, int inputs, int outputs, int layers, int repeat) {
+  Model model(rows, inputs, outputs, layers, FLAGS_transposed);
+  for (Network *net : {&model.network, &model.qnetwork}) {
+    Cell *cell = net->GetCell("f");
+    Instance data(cell);
+    data.Clear();
+    Clock clock;
+    clock.start();
+    for (int i = 0; i < repeat; ++i) data.Compute();
+    clock.stop();
+    int64 ops = 2LL * rows * (inputs * outputs +
+                              (layers - 1) * outputs * outputs);
+    LOG(INFO) << (net == &model.network ? "float32" : "int8   ") << ": "
+              << clock.us() / repeat << " us/call, "
+              << ops * repeat / clock.secs() / 1e9 << " GOPS";
+  }
+}
+
+int main(int argc, char *argv[]) {
+  InitProgram(&argc, &argv);
+  if (!FLAGS_avx512) {
+    jit::CPU::Disable(jit::AVX512F);
+    jit::CPU::Disable(jit::AVX512VNNI);
+  }
+
+  int failures = 0;
+  if (FLAGS_sweep) {
+    // Check odd sizes for residual and masked code paths.
+    static const int sizes[][3] = {
+      {1, 64, 64}, {1, 100, 37}, {1, 256, 300}, {3, 129, 129},
+      {1, 1000, 16}, {2, 37, 1000}, {5, 512, 512}, {1, 768, 3072},
+    };
+    for (auto &size : sizes) {
+      for (bool transposed : {false, true}) {
+        double error = Check(size[0], size[1], size[2], 1, transposed);
+        if (error > FLAGS_tolerance) failures++;
+      }
+    }
+
+    // Check weight matrix shared between plain and transposed matmul.
+    if (CheckShared(256) > FLAGS_tolerance) failures++;
+  }
+
+  // Check and benchmark multi-layer model.
+  double error = Check(FLAGS_rows, FLAGS_inputs, FLAGS_outputs, FLAGS_layers,
+                       FLAGS_transposed);
+  if (error > FLAGS_tolerance) failures++;
+  if (FLAGS_repeat > 0) {
+    Benchmark(FLAGS_rows, FLAGS_inputs, FLAGS_outputs, FLAGS_layers,
+              FLAGS_repeat);
+  }
+
+  if (failures > 0) {
+    LOG(ERROR) << failures << " quantization checks failed";
+    return 1;
+  }
+  LOG(INFO) << "All quantization checks passed";
+  return 0;
+}
@@ -28,20 +28,60 @@
 namespace sling {
 namespace nlp {
 
-uint64 Token::Fingerprint() const {
-  // Compute token fingerprint if not already done.
-  if (fingerprint_ == 0) fingerprint_ = Fingerprinter::Fingerprint(word_);
-  return fingerprint_;
-}
-
-CaseForm Token::Form() const {
-  if (form_ == CASE_INVALID) {
-    form_ = UTF8::Case(word_);
-
-    // Case for first token in a sentence is indeterminate.
-    if (initial() && form_ == CASE_TITLE) form_ = CASE_NONE;
-  }
-  return form_;
+void Document::TokenColumns::push_back(Handle h, int b, int e, int w,
+                                       BreakType brk, int style) {
+  handle.push_back(h);
+  begin.push_back(b);
+  end.push_back(e);
+  word.push_back(w);
+  this->brk.push_back(brk);
+  this->style.push_back(style);
+  fingerprint.push_back(0);
+  form.push_back(CASE_INVALID);
+  span.push_back(nullptr);
+}
+
+void Document::TokenColumns::clear() {
+  handle.clear();
+  begin.clear();
+  end.clear();
+  word.clear();
+  brk.clear();
+  style.clear();
+  fingerprint.clear();
+  form.clear();
+  span.clear();
+  words.clear();
+}
+
+void Document::TokenColumns::reserve(int n) {
+  handle.reserve(n);
+  begin.reserve(n);
+  end.reserve(n);
+  word.reserve(n);
+  brk.reserve(n);
+  style.reserve(n);
+  fingerprint.reserve(n);
+  form.reserve(n);
+  span.reserve(n);
+}
+
+int Document::TokenColumns::AddWord(Text word) {
+  words.emplace_back(word.data(), word.size());
+  return words.size() - 1;
+}
+
+void Document::TokenColumns::swap(TokenColumns &other) {
+  handle.swap(other.handle);
+  begin.swap(other.begin);
+  end.swap(other.end);
+  word.swap(other.word);
+  brk.swap(other.brk);
+  style.swap(other.style);
+  fingerprint.swap(other.fingerprint);
+  form.swap(other.form);
+  span.swap(other.span);
+  words.swap(other.words);
 }
 
 void Span::Evoke(const Frame &frame) {
@@ -210,7 +250,7 @@ Document::Document(const Frame &top, const DocumentNames *names)
   if (tokens.valid()) {
     // Initialize tokens.
     int num_tokens = tokens.length();
-    tokens_.resize(num_tokens);
+    tokens_.reserve(num_tokens);
     for (int i = 0; i < num_tokens; ++i) {
       // Get token information from token frame.
       Handle h = tokens.get(i);
@@ -221,37 +261,24 @@ Document::Document(const Frame &top, const DocumentNames *names)
       Handle brk = token->get(names_->n_break.handle());
       Handle style = token->get(names_->n_style.handle());
 
-      // Fill token from frame.
-      Token &t = tokens_[i];
-      t.document_ = this;
-      t.handle_ = h;
-      t.index_ = i;
+      // Add token from frame. The word is only stored in the token frame if
+      // it is different from the document text.
+      int b = -1;
+      int e = -1;
       if (!start.IsNil()) {
-        t.begin_ = start.AsInt();
-        t.end_ = t.begin_ + (size.IsNil() ? 1 : size.AsInt());
-      } else {
-        t.begin_ = -1;
-        t.end_ = -1;
+        b = start.AsInt();
+        e = b + (size.IsNil() ? 1 : size.AsInt());
       }
+      int w = -1;
       if (!word.IsNil()) {
-        StringDatum *str = store()->GetString(word);
-        t.word_.assign(str->data(), str->length());
-      } else if (t.begin_ != -1 && t.end_ != -1) {
-        t.word_ = text_.substr(t.begin_, t.end_ - t.begin_);
-      }
-      if (!brk.IsNil()) {
-        t.brk_ = static_cast<BreakType>(brk.AsInt());
-      } else {
-        t.brk_ = i == 0 ? NO_BREAK : SPACE_BREAK;
+        w = tokens_.AddWord(store()->GetString(word)->str());
+      } else if (b == -1) {
+        w = tokens_.AddWord(Text());
       }
-      if (!style.IsNil()) {
-        t.style_ = style.AsInt();
-      } else {
-        t.style_ = 0;
-      }
-      t.fingerprint_ = 0;
-      t.form_ = CASE_INVALID;
-      t.span_ = nullptr;
+      BreakType t_brk = i == 0 ? NO_BREAK : SPACE_BREAK;
+      if (!brk.IsNil()) t_brk = static_cast<BreakType>(brk.AsInt());
+      int t_style = style.IsNil() ? 0 : style.AsInt();
+      tokens_.push_back(h, b, e, w, t_brk, t_style);
     }
   }
 
@@ -293,11 +320,8 @@ Document::Document(const Document &other, bool annotations)
   }
   top_ = builder.Create();
 
-  // Update tokens.
-  for (Token &token : tokens_) {
-    token.document_ = this;
-    token.span_ = nullptr;
-  }
+  // Clear span index for tokens.
+  std::fill(tokens_.span.begin(), tokens_.span.end(), nullptr);
 
   if (annotations) {
     // Copy mention spans.
@@ -332,26 +356,30 @@ Document::Document(const Document &other,
   int length = end - begin;
   int text_begin = other.text().size();
   int text_end = 0;
-  tokens_.resize(length);
-  for (int i = 0; i < length; ++i) {
-    const Token &o = other.tokens_[i + begin];
-    Token &t = tokens_[i];
-    t = o;
-    t.document_ = this;
-    t.index_ = i;
-    t.span_ = nullptr;
-    if (o.begin_ < text_begin) text_begin = o.begin_;
-    if (o.end_ > text_end) text_end = o.end_;
+  for (int i = begin; i < end; ++i) {
+    if (other.tokens_.begin[i] < text_begin) {
+      text_begin = other.tokens_.begin[i];
+    }
+    if (other.tokens_.end[i] > text_end) text_end = other.tokens_.end[i];
   }
   if (length > 0) tokens_changed_ = true;
 
-  // Copy text and adjust token positions.
+  // Copy text and tokens and adjust token positions.
+  int offset = 0;
   if (text_end > text_begin) {
     text_ = other.text_.substr(text_begin, text_end - text_begin);
-    for (Token &t : tokens_) {
-      t.begin_ -= text_begin;
-      t.end_ -= text_begin;
-    }
+    offset = text_begin;
+  }
+  tokens_.reserve(length);
+  for (int i = begin; i < end; ++i) {
+    int b = other.tokens_.begin[i];
+    int e = other.tokens_.end[i];
+    if (b != -1) b -= offset;
+    if (e != -1) e -= offset;
+    int w = other.tokens_.word[i];
+    if (w != -1) w = tokens_.AddWord(other.tokens_.GetWord(w));
+    tokens_.push_back(other.tokens_.handle[i], b, e, w,
+                      other.tokens_.brk[i], other.tokens_.style[i]);
   }
 
   // Copy annotations.
@@ -392,23 +420,27 @@ void Document::Update() {
     Handles tokens(store());
     tokens.reserve(tokens_.size());
     for (int i = 0; i < tokens_.size(); ++i) {
-      Token &t = tokens_[i];
+      int begin = tokens_.begin[i];
+      int end = tokens_.end[i];
       Builder token(store());
-      if (t.begin_ != -1 && t.end_ != -1 &&
-          text_.compare(t.begin_, t.end_ - t.begin_, t.word_) != 0) {
-        token.Add(names_->n_word, t.word_);
+      if (begin != -1 && end != -1 && tokens_.word[i] != -1) {
+        Text word = tokens_.GetWord(tokens_.word[i]);
+        if (text_.compare(begin, end - begin, word.data(), word.size()) != 0) {
+          token.Add(names_->n_word, word);
+        }
       }
-      if (t.begin_ != -1) {
-        token.Add(names_->n_start, t.begin_);
-        if (t.end_ != -1 && t.end_ != t.begin_ + 1) {
-          token.Add(names_->n_size, t.end_ - t.begin_);
+      if (begin != -1) {
+        token.Add(names_->n_start, begin);
+        if (end != -1 && end != begin + 1) {
+          token.Add(names_->n_size, end - begin);
         }
       }
-      if (t.brk_ != (i == 0 ? NO_BREAK : SPACE_BREAK)) {
-        token.Add(names_->n_break, t.brk_);
+      BreakType brk = tokens_.brk[i];
+      if (brk != (i == 0 ? NO_BREAK : SPACE_BREAK)) {
+        token.Add(names_->n_break, brk);
       }
-      if (t.style_ != 0) {
-        token.Add(names_->n_style, t.style_);
+      if (tokens_.style[i] != 0) {
+        token.Add(names_->n_style, tokens_.style[i]);
       }
       tokens.push_back(token.Create().handle());
     }
@@ -454,26 +486,38 @@ void Document::SetText(Text text) {
 
 void Document::AddToken(Text word, int begin, int end,
                         BreakType brk, int style) {
-  // Expand token array.
-  int index = tokens_.size();
-  tokens_.resize(index + 1);
-
-  // Fill new token.
-  Token &t = tokens_[index];
-  t.document_ = this;
-  t.handle_ = Handle::nil();
-  t.index_ = index;
-  t.begin_ = begin;
-  t.end_ = end;
-  t.word_.assign(word.data(), word.size());
-  t.brk_ = brk;
-  t.style_ = style;
-  t.fingerprint_ = 0;
-  t.form_ = CASE_INVALID;
-  t.span_ = nullptr;
+  // Only store the word if it is not the same as the token text.
+  int w = -1;
+  if (begin == -1 || end == -1 || end > text_.size() ||
+      text_.compare(begin, end - begin, word.data(), word.size()) != 0) {
+    w = tokens_.AddWord(word);
+  }
+  tokens_.push_back(Handle::nil(), begin, end, w, brk, style);
   tokens_changed_ = true;
 }
 
+Text Document::token_word(int index) const {
+  int w = tokens_.word[index];
+  if (w != -1) return tokens_.GetWord(w);
+  int begin = tokens_.begin[index];
+  return Text(text_.data() + begin, tokens_.end[index] - begin);
+}
+
+CaseForm Document::TokenForm(int token) const {
+  CaseForm &form = tokens_.form[token];
+  if (form == CASE_INVALID) {
+    Text word = token_word(token);
+    form = UTF8::Case(word.data(), word.size());
+
+    // Case for first token in a sentence is indeterminate.
+    if (form == CASE_TITLE &&
+        (token == 0 || tokens_.brk[token] >= SENTENCE_BREAK)) {
+      form = CASE_NONE;
+    }
+  }
+  return form;
+}
+
 Span *Document::AddSpan(int begin, int end, Handle type) {
   // Add new span for the phrase or get existing span.
   Span *span = Insert(begin, end);
@@ -529,7 +573,7 @@ int Document::Locate(int position) const {
   while (len > 0) {
     int width = len / 2;
     int mid = index + width;
-    if (tokens_[mid].begin() < position) {
+    if (tokens_.begin[mid] < position) {
       index = mid + 1;
       len -= width + 1;
     } else {
@@ -567,9 +611,9 @@ CaseForm Document::PhraseForm(int begin, int end) const {
 string Document::PhraseText(int begin, int end) const {
   string phrase;
   for (int t = begin; t < end; ++t) {
-    const Token &token = tokens_[t];
-    if (t > begin && token.brk() != NO_BREAK) phrase.push_back(' ');
-    phrase.append(token.word());
+    if (t > begin && tokens_.brk[t] != NO_BREAK) phrase.push_back(' ');
+    Text word = token_word(t);
+    phrase.append(word.data(), word.size());
   }
 
   return phrase;
@@ -580,7 +624,7 @@ Span *Document::EnclosingSpan(int begin, int end, bool *crossing) {
   Span *prev = nullptr;
   *crossing = false;
   for (int t = begin; t < end; ++t) {
-    Span *s = tokens_[t].span_;
+    Span *s = tokens_.span[t];
 
     // Skip if it has the same leaf span as the previous token.
     if (s == prev) continue;
@@ -634,7 +678,7 @@ Span *Document::Insert(int begin, int end) {
     Span *tail = nullptr;
     for (int t = begin; t < end; ++t) {
       // Find top-level span at position t.
-      Span *s = tokens_[t].span_;
+      Span *s = tokens_.span[t];
       if (s == nullptr) continue;
       while (s->parent_ != nullptr) s = s->parent_;
 
@@ -701,7 +745,7 @@ Span *Document::Insert(int begin, int end) {
   // Update leaf pointers.
   Span *parent = span->parent_;
   for (int t = begin; t < end; ++t) {
-    if (tokens_[t].span_ == parent) tokens_[t].span_ = span;
+    if (tokens_.span[t] == parent) tokens_.span[t] = span;
   }
 
   return span;
@@ -710,7 +754,7 @@ Span *Document::Insert(int begin, int end) {
 void Document::Remove(Span *span) {
   // Move leaf spans to parent.
   for (int t = span->begin(); t < span->end(); ++t) {
-    if (tokens_[t].span_ == span) tokens_[t].span_ = span->parent_;
+    if (tokens_.span[t] == span) tokens_.span[t] = span->parent_;
   }
 
   // Move parent pointers of children to grandparent.
@@ -741,7 +785,7 @@ void Document::Remove(Span *span) {
 }
 
 Span *Document::GetSpan(int begin, int end) const {
-  Span *span = tokens_[begin].span();
+  Span *span = tokens_.span[begin];
   while (span != nullptr) {
     if (span->begin() == begin && span->end() == end) return span;
     span = span->parent_;
@@ -750,7 +794,7 @@ Span *Document::GetSpan(int begin, int end) const {
 }
 
 void Document::ClearAnnotations() {
-  for (Token &t : tokens_) t.span_ = nullptr;
+  std::fill(tokens_.span.begin(), tokens_.span.end(), nullptr);
   for (Span *s : spans_) delete s;
   spans_.clear();
   themes_.clear();
@@ -15,6 +15,7 @@
 #ifndef SLING_NLP_DOCUMENT_DOCUMENT_H_
 #define SLING_NLP_DOCUMENT_DOCUMENT_H_
 
+#include <deque>
 #include <string>
 #include <vector>
 #include <unordered_map>
@@ -22,6 +23,7 @@
 #include "sling/base/types.h"
 #include "sling/frame/object.h"
 #include "sling/frame/store.h"
+#include "sling/nlp/document/fingerprinter.h"
 #include "sling/nlp/document/token-properties.h"
 #include "sling/string/text.h"
 #include "sling/util/unicode.h"
@@ -58,14 +60,20 @@ struct DocumentNames : public SharedNames {
 };
 
 // A token represents a range of characters in the document text. A token is a
-// word or any other kind of lexical unit like punctuation, number, etc.
+// word or any other kind of lexical unit like punctuation, number, etc. The
+// token information is stored column-wise in the document, and a token is
+// just a lightweight reference to a token in a document.
 class Token {
  public:
+  Token(const Document *document, int index)
+      : document_(document), index_(index) {}
+
   // Document that the token belongs to.
-  Document *document() const { return document_; }
+  const Document *document() const { return document_; }
 
-  // Handle for token in the store.
-  Handle handle() const { return handle_; }
+  // Handle for token frame in the store. This is nil for tokens that have not
+  // been read from a document frame.
+  inline Handle handle() const;
 
   // Index of token in document.
   int index() const { return index_; }
@@ -74,52 +82,71 @@ class Token {
   // range of the UTF-8 encoded token in the document text, where begin is the
   // index of the first byte of the token and end is the first byte after the
   // token.
-  int begin() const { return begin_; }
-  int end() const { return end_; }
-  int size() const { return end_ - begin_; }
+  inline int begin() const;
+  inline int end() const;
+  int size() const { return end() - begin(); }
 
-  // Token word.
-  const string &word() const { return word_; }
+  // Token word. This is normally a slice of the document text, so it is only
+  // valid until the document text is changed or the tokens are cleared.
+  // Adding tokens does not invalidate the words of existing tokens.
+  inline Text word() const;
 
   // Break level before token.
-  BreakType brk() const { return brk_; }
+  inline BreakType brk() const;
 
   // Token style change before token.
-  int style() const { return style_; }
+  inline int style() const;
 
   // Lowest span covering the token.
-  Span *span() const { return span_; }
+  inline Span *span() const;
 
   // Token fingerprint.
-  uint64 Fingerprint() const;
+  inline uint64 Fingerprint() const;
 
   // Token case form.
-  CaseForm Form() const;
+  inline CaseForm Form() const;
 
   // Punctuation tokens etc. are skipped in phrase comparison.
   bool skipped() const { return Fingerprint() == 1; }
 
   // Check for initial token in a sentence.
-  bool initial() const { return index_ == 0 || brk_ >= SENTENCE_BREAK; }
+  bool initial() const { return index_ == 0 || brk() >= SENTENCE_BREAK; }
 
  private:
-  Document *document_;          // document the token belongs to
-  Handle handle_;               // handle for token in the store
+  const Document *document_;    // document the token belongs to
   int index_;                   // index of token in document
+};
+
+// Iterator over the tokens in a document.
+class TokenIterator {
+ public:
+  TokenIterator(const Document *document, int index)
+      : document_(document), index_(index) {}
 
-  int begin_;                   // first byte position of token
-  int end_;                     // first byte position after token
+  Token operator *() const { return Token(document_, index_); }
+  TokenIterator &operator ++() { index_++; return *this; }
+  bool operator !=(const TokenIterator &other) const {
+    return index_ != other.index_;
+  }
 
-  string word_;                 // token word
-  BreakType brk_;               // break level before token
-  int style_;                   // token style change before token
+ private:
+  const Document *document_;
+  int index_;
+};
 
-  mutable uint64 fingerprint_;  // fingerprint for token text
-  mutable CaseForm form_;       // case form for token
+// Range of all tokens in a document for range-based for loops.
+class TokenRange {
+ public:
+  TokenRange(const Document *document, int size)
+      : document_(document), size_(size) {}
 
-  Span *span_;                  // lowest span covering the token
+  TokenIterator begin() const { return TokenIterator(document_, 0); }
+  TokenIterator end() const { return TokenIterator(document_, size_); }
+  int size() const { return size_; }
 
-  friend class Document;
+ private:
+  const Document *document_;
+  int size_;
 };
 
 // A span represents a range of tokens in the document. The token span is
@@ -218,8 +245,8 @@ class Span {
   CaseForm Form() const;
 
   // Returns first/last token in span.
-  inline const Token &first() const;
-  inline const Token &last() const;
+  inline Token first() const;
+  inline Token last() const;
 
   // Check for initial span in a sentence.
   bool initial() const { return first().initial(); }
@@ -331,19 +358,33 @@ class Document {
   int num_tokens() const { return tokens_.size(); }  // deprecated
 
   // Return token in the document.
-  const Token &token(int index) const { return tokens_[index]; }
+  Token token(int index) const { return Token(this, index); }
 
   // Return document tokens.
-  const std::vector<Token> &tokens() const { return tokens_; }
+  TokenRange tokens() const { return TokenRange(this, tokens_.size()); }
+
+  // Column-wise access to token information. See Token for details.
+  Handle token_handle(int index) const { return tokens_.handle[index]; }
+  int token_begin(int index) const { return tokens_.begin[index]; }
+  int token_end(int index) const { return tokens_.end[index]; }
+  Text token_word(int index) const;
+  BreakType token_break(int index) const { return tokens_.brk[index]; }
+  int token_style(int index) const { return tokens_.style[index]; }
+  Span *token_span(int index) const { return tokens_.span[index]; }
 
   // Locate token index containing text position.
   int Locate(int position) const;
 
   // Return fingerprint for token in document.
   uint64 TokenFingerprint(int token) const {
-    return tokens_[token].Fingerprint();
+    uint64 &fp = tokens_.fingerprint[token];
+    if (fp == 0) fp = Fingerprinter::Fingerprint(token_word(token));
+    return fp;
   }
 
+  // Return case form for token in document.
+  CaseForm TokenForm(int token) const;
+
   // Returns the fingerprint for [begin, end).
   uint64 PhraseFingerprint(int begin, int end) const;
 
@@ -358,7 +399,7 @@ class Document {
 
   // Returns lowest span at token position or null if no spans are covering the
   // token.
-  Span *GetSpanAt(int index) const { return tokens_[index].span(); }
+  Span *GetSpanAt(int index) const { return tokens_.span[index]; }
 
   // Adds thematic frame to document.
   void AddTheme(Handle handle);
@@ -399,6 +440,48 @@ class Document {
   // Removes the span from the span index.
   void Remove(Span *span);
 
+  // Token information stored column-wise. The token word is normally the
+  // token text in the document, in which case the word column is -1. Words
+  // that differ from the document text are stored in the word list, and the
+  // word column is the index of the word in the list. Words are never moved
+  // when new words are added, so word slices stay valid when tokens are
+  // added.
+  struct TokenColumns {
+    // Return the number of tokens.
+    int size() const { return begin.size(); }
+
+    // Add new token.
+    void push_back(Handle h, int b, int e, int w, BreakType brk, int style);
+
+    // Remove all tokens and words.
+    void clear();
+
+    // Reserve space for tokens.
+    void reserve(int n);
+
+    // Add word to word list and return its index.
+    int AddWord(Text word);
+
+    // Return word from word list.
+    Text GetWord(int index) const { return words[index]; }
+
+    // Swap contents with other token columns.
+    void swap(TokenColumns &other);
+
+    std::vector<Handle> handle;                // handle for token frame
+    std::vector<int> begin;                    // first byte position of token
+    std::vector<int> end;                      // first byte after token
+    std::vector<int> word;                     // index of word in word buffer
+    std::vector<BreakType> brk;                // break level before token
+    std::vector<int> style;                    // style change before token
+    mutable std::vector<uint64> fingerprint;   // fingerprint for token word
+    mutable std::vector<CaseForm> form;        // case form for token
+    std::vector<Span *> span;                  // lowest span covering token
+
+    // Words that are not slices of the document text.
+    std::deque<string> words;
+  };
+
   // Document frame.
   Frame top_;
 
@@ -406,7 +489,7 @@ class Document {
   string text_;
 
   // Document tokens.
-  std::vector<Token> tokens_;
+  TokenColumns tokens_;
 
   // If the tokens have been changed the Update() method will update the tokens
   // in the document frame.
@@ -488,8 +571,27 @@ class SentenceIterator : public DocumentIterator {
       : DocumentIterator(document, SENTENCE_BREAK, skip) {}
 };
 
-inline const Token &Span::first() const { return document_->token(begin_); }
-inline const Token &Span::last() const { return document_->token(end_ - 1); }
+inline Handle Token::handle() const {
+  return document_->token_handle(index_);
+}
+
+inline int Token::begin() const { return document_->token_begin(index_); }
+inline int Token::end() const { return document_->token_end(index_); }
+inline Text Token::word() const { return document_->token_word(index_); }
+inline BreakType Token::brk() const { return document_->token_break(index_); }
+inline int Token::style() const { return document_->token_style(index_); }
+inline Span *Token::span() const { return document_->token_span(index_); }
+
+inline uint64 Token::Fingerprint() const {
+  return document_->TokenFingerprint(index_);
+}
+
+inline CaseForm Token::Form() const {
+  return document_->TokenForm(index_);
+}
+
+inline Token Span::first() const { return document_->token(begin_); }
+inline Token Span::last() const { return document_->token(end_ - 1); }
 
 }  // namespace nlp
 }  // namespace sling
@@ -186,7 +186,7 @@ static void OutputStyle(int style, Output *output) {
   }
 }
 
-static void OutputToken(const string &word, Output *output) {
+static void OutputToken(Text word, Output *output) {
   if (word == "``") {
     output->Write("“");
   } else if (word == "''") {
@@ -223,7 +223,7 @@ string ToLex(const Document &document) {
   // Output all tokens with mentions and evoked frames.
   Handles evoked(document.store());
   int styles = 0;
-  for (const Token &token : document.tokens()) {
+  for (Token token : document.tokens()) {
     // Add style end.
     int style = token.style();
     if (style != 0) {
@@ -302,7 +302,7 @@ string ToHTML(const Document &document) {
   // Convert document to simplified HTML.
   Store *store = document.store();
   int styles = 0;
-  for (const Token &token : document.tokens()) {
+  for (Token token : document.tokens()) {
     // Add style end.
     int style = token.style();
     if (style != 0) {
@@ -22,7 +22,7 @@
 namespace sling {
 namespace nlp {
 
-void WordShape::Extract(const string &word) {
+void WordShape::Extract(Text word) {
   quote = NO_QUOTE;
   hyphen = NO_HYPHEN;
   bool has_upper = false;
@@ -190,12 +190,12 @@ void Lexicon::PrecomputeShapes() {
   }
 }
 
-int Lexicon::Lookup(const string &word,
+int Lexicon::Lookup(Text word,
                     Affix **prefix, Affix **suffix,
                     WordShape *shape) const {
   // Normalize word.
   string normalized;
-  UTF8::Normalize(word, normalization_, &normalized);
+  UTF8::Normalize(word.data(), word.size(), normalization_, &normalized);
 
   // Look up word in vocabulary.
   int id = vocabulary_.Lookup(normalized);
@@ -20,6 +20,7 @@
 
 #include "sling/base/types.h"
 #include "sling/nlp/document/affix.h"
+#include "sling/string/text.h"
 #include "sling/util/unicode.h"
 #include "sling/util/vocabulary.h"
 
@@ -71,7 +72,7 @@ struct WordShape {
   };
 
   // Extract shape features from word.
-  void Extract(const string &word);
+  void Extract(Text word);
 
   Hyphen hyphen = NO_HYPHEN;                  // hyphenation
   Capitalization capitalization = LOWERCASE;  // capitalization
@@ -110,7 +111,7 @@ class Lexicon {
   // the pre-computed affix and shape information from the lexicon is returned.
   // Otherwise, OOV is returned, and the affix and shape information is computed
   // on-the-fly.
-  int Lookup(const string &word,
+  int Lookup(Text word,
              Affix **prefix, Affix **suffix,
              WordShape *shape) const;
 
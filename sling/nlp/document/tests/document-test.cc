@@ -0,0 +1,198 @@
+// Copyright 2025 Ringgaard Research ApS
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <string>
+#include <vector>
+
+#include "sling/base/flags.h"
+#include "sling/base/init.h"
+#include "sling/base/logging.h"
+#include "sling/frame/object.h"
+#include "sling/frame/store.h"
+#include "sling/nlp/document/document.h"
+#include "sling/nlp/document/fingerprinter.h"
+#include "sling/string/strcat.h"
+
+DEFINE_int32(tokens, 10000, "Number of tokens added in tests");
+
+using namespace sling;
+using namespace sling::nlp;
+
+// Expected token information.
+struct Expected {
+  string word;
+  int begin;
+  int end;
+  BreakType brk;
+  int style;
+};
+
+// Document text with quotes that are normalized in the token words.
+static const char *kText = "He said \xe2\x80\x9chi\xe2\x80\x9d to Bob. Bye.";
+
+// Tokens for test document. The words for the quotes differ from the text.
+static std::vector<Expected> TestTokens() {
+  return {
+    {"He", 0, 2, NO_BREAK, 0},
+    {"said", 3, 7, SPACE_BREAK, 0},
+    {"\"", 8, 11, SPACE_BREAK, 0},
+    {"hi", 11, 13, NO_BREAK, 1},
+    {"\"", 13, 16, NO_BREAK, 0},
+    {"to", 17, 19, SPACE_BREAK, 0},
+    {"Bob", 20, 23, SPACE_BREAK, 0},
+    {".", 23, 24, NO_BREAK, 0},
+    {"Bye", 25, 28, SENTENCE_BREAK, 0},
+    {".", 28, 29, NO_BREAK, 0},
+  };
+}
+
+// Check tokens in document through both the token objects and the columns.
+static void CheckTokens(const Document &document,
+                        const std::vector<Expected> &expected) {
+  CHECK_EQ(document.length(), expected.size());
+  int index = 0;
+  for (Token token : document.tokens()) {
+    const Expected &e = expected[index];
+    CHECK_EQ(token.index(), index);
+    CHECK(token.word() == Text(e.word)) << index << " " << token.word();
+    CHECK_EQ(token.begin(), e.begin) << index;
+    CHECK_EQ(token.end(), e.end) << index;
+    CHECK_EQ(token.brk(), e.brk) << index;
+    CHECK_EQ(token.style(), e.style) << index;
+    CHECK_EQ(token.Fingerprint(), Fingerprinter::Fingerprint(e.word));
+    CHECK(document.token_word(index) == token.word());
+    CHECK_EQ(document.token_begin(index), e.begin);
+    CHECK_EQ(document.token_end(index), e.end);
+    CHECK_EQ(document.token_break(index), e.brk);
+    CHECK_EQ(document.token_style(index), e.style);
+    index++;
+  }
+  CHECK_EQ(index, expected.size());
+}
+
+// Add tokens to document.
+static void AddTokens(Document *document,
+                      const std::vector<Expected> &tokens) {
+  for (const Expected &t : tokens) {
+    document->AddToken(t.word, t.begin, t.end, t.brk, t.style);
+  }
+}
+
+// Words are slices of the document text, except for words that differ from
+// the text.
+static void TestTokenWords(Store *store) {
+  Document document(store);
+  document.SetText(kText);
+  std::vector<Expected> expected = TestTokens();
+  AddTokens(&document, expected);
+  CheckTokens(document, expected);
+
+  const string &text = document.text();
+  for (Token token : document.tokens()) {
+    Text word = token.word();
+    bool slice = word.data() >= text.data() &&
+                 word.data() + word.size() <= text.data() + text.size();
+    CHECK_EQ(slice, word != "\"") << token.index();
+  }
+
+  // Case forms are computed from the words, and the first token in a
+  // sentence has no case.
+  CHECK_EQ(document.token(0).Form(), CASE_NONE);
+  CHECK_EQ(document.token(6).Form(), CASE_TITLE);
+  CHECK_EQ(document.token(8).Form(), CASE_NONE);
+  CHECK(document.token(8).initial());
+  CHECK(!document.token(7).initial());
+}
+
+// Words taken from tokens stay valid when more tokens are added.
+static void TestStableWords(Store *store) {
+  Document document(store);
+  document.SetText(kText);
+  std::vector<Expected> expected = TestTokens();
+  AddTokens(&document, expected);
+
+  std::vector<Text> words;
+  for (Token token : document.tokens()) words.push_back(token.word());
+
+  // Add tokens with words that are not in the text, and tokens without text
+  // positions.
+  for (int i = 0; i < FLAGS_tokens; ++i) {
+    string word = StrCat("word", i, string(i % 40, 'x'));
+    if (i % 2 == 0) {
+      document.AddToken(word, 0, 2);
+    } else {
+      document.AddToken(word);
+    }
+    expected.push_back({word, i % 2 == 0 ? 0 : -1, i % 2 == 0 ? 2 : -1,
+                        SPACE_BREAK, 0});
+    if (i % 100 == 0) words.push_back(document.token(i + 10).word());
+  }
+
+  // Check that the words taken before the tokens were added are unchanged.
+  for (int i = 0; i < 10; ++i) {
+    CHECK(words[i] == Text(expected[i].word)) << i;
+  }
+  for (int i = 0; i < FLAGS_tokens / 100; ++i) {
+    CHECK(words[i + 10] == Text(expected[i * 100 + 10].word)) << i;
+  }
+  CheckTokens(document, expected);
+}
+
+// Tokens are stored in the document frame and read back.
+static void TestTokenFrames(Store *store) {
+  std::vector<Expected> expected = TestTokens();
+  Document document(store);
+  document.SetText(kText);
+  AddTokens(&document, expected);
+  document.Update();
+
+  // Only words that differ from the text are stored in token frames.
+  Handle n_word = store->Lookup("word");
+  Array tokens = document.top().Get("tokens").AsArray();
+  CHECK_EQ(tokens.length(), expected.size());
+  for (int i = 0; i < tokens.length(); ++i) {
+    Frame token(store, tokens.get(i));
+    CHECK_EQ(token.Has(n_word), expected[i].word == "\"") << i;
+  }
+
+  Document copy(document.top());
+  CHECK(copy.text() == document.text());
+  CheckTokens(copy, expected);
+  for (int i = 0; i < copy.length(); ++i) {
+    CHECK(copy.token_handle(i) == tokens.get(i));
+  }
+
+  // Make a copy of a part of the document. The token positions are relative
+  // to the text of the copy.
+  Document part(document, 2, 7, false);
+  std::vector<Expected> subset(expected.begin() + 2, expected.begin() + 7);
+  for (Expected &e : subset) {
+    e.begin -= 8;
+    e.end -= 8;
+  }
+  CheckTokens(part, subset);
+  CHECK(part.text() == string(kText + 8, 15));
+}
+
+int main(int argc, char *argv[]) {
+  InitProgram(&argc, &argv);
+
+  Store store;
+  TestTokenWords(&store);
+  TestStableWords(&store);
+  TestTokenFrames(&store);
+
+  LOG(INFO) << "Document test passed";
+  return 0;
+}
@@ -44,7 +44,7 @@ class WordVocabularyMapper : public DocumentProcessor {
   void Process(Slice key, const Document &document) override {
     // Output normalize token words.
     bool in_header = false;
-    for (const Token &token : document.tokens()) {
+    for (Token token : document.tokens()) {
       // Track section headings.
       if (token.style() & HEADING_BEGIN) in_header = true;
       if (token.style() & HEADING_END) in_header = false;
@@ -55,7 +55,8 @@ class WordVocabularyMapper : public DocumentProcessor {
 
       // Normalize token.
       string normalized;
-      UTF8::Normalize(token.word(), normalization_, &normalized);
+      Text word = token.word();
+      UTF8::Normalize(word.data(), word.size(), normalization_, &normalized);
 
       // Discard empty tokens.
       if (normalized.empty()) continue;
@@ -73,9 +73,9 @@ class WordVocabularySampler {
   }
 
   // Look up word in dictionary. Return OOV for unknown words.
-  int Lookup(const string &word, Normalization flags) const {
+  int Lookup(Text word, Normalization flags) const {
     string normalized;
-    UTF8::Normalize(word, flags, &normalized);
+    UTF8::Normalize(word.data(), word.size(), flags, &normalized);
     auto f = dictionary_.find(normalized);
     return f != dictionary_.end() ? f->second : oov_;
   }
@@ -303,7 +303,7 @@ class WordEmbeddingsTrainer : public Process {
         words.clear();
         for (int t = s.begin(); t < s.end(); ++t) {
           // Sub-sample words.
-          const string &word = document.token(t).word();
+          Text word = document.token(t).word();
           int index = vocabulary_.Lookup(word, normalization_);
           if (rnd.UniformProb() < vocabulary_.SubsamplingProbability(index)) {
             words.push_back(index);
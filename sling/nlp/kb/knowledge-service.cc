@@ -371,12 +371,13 @@ void KnowledgeService::ConnectSearch(const string &search_server) {
 void KnowledgeService::OpenItems(const string &filename) {
   delete items_;
   RecordFileOptions options;
+  options.mmap = true;
   items_ = new RecordDatabase(filename, options);
 }
 
 void KnowledgeService::OpenItemDatabase(const string &db) {
   delete itemdb_;
-  itemdb_ = new DBClient();
+  itemdb_ = new AsyncDBClient();
   CHECK(itemdb_->Connect(db, "kb"));
 }
 
@@ -418,12 +419,12 @@ Handle KnowledgeService::RetrieveItem(Store *store, Text id) const {
   }
 
   if (handle.IsNil() && itemdb_ != nullptr) {
-    // Try looking up item in the offline item database.
-    MutexLock lock(&mu_);
-    DBRecord rec;
-    Status st = itemdb_->Get(key, &rec);
-    if (st.ok() && !rec.value.empty()) {
-      ArrayInputStream stream(rec.value);
+    // Try looking up item in the offline item database. Lookups from
+    // concurrent requests are batched by the database client.
+    string value;
+    Status st = itemdb_->Get(key, &value);
+    if (st.ok() && !value.empty()) {
+      ArrayInputStream stream(value);
       InputParser parser(store, &stream);
       handle = parser.Read().handle();
     }
@@ -461,12 +462,11 @@ void KnowledgeService::Preload(const Frame &item, Store *store) {
         keys.push_back(store->FrameId(h));
       }
 
-      MutexLock lock(&mu_);
-      std::vector<DBRecord> recs;
-      Status st = itemdb_->Get(keys, &recs);
+      std::vector<string> values;
+      Status st = itemdb_->Get(keys, &values);
       if (st.ok()) {
-        for (auto &rec : recs) {
-          ArrayInputStream stream(rec.value);
+        for (auto &value : values) {
+          ArrayInputStream stream(value);
           InputParser parser(store, &stream);
           parser.Read();
         }
@@ -19,7 +19,7 @@
 #include <regex>
 
 #include "sling/base/types.h"
-#include "sling/db/dbclient.h"
+#include "sling/db/async-dbclient.h"
 #include "sling/file/recordio.h"
 #include "sling/frame/object.h"
 #include "sling/frame/store.h"
@@ -271,7 +271,7 @@ class KnowledgeService {
 
   // Record database for looking up items that are not in the knowledge base.
   RecordDatabase *items_ = nullptr;
-  DBClient *itemdb_ = nullptr;
+  AsyncDBClient *itemdb_ = nullptr;
   mutable Mutex mu_;
 
   // Knowledge base browser app.
@@ -24,7 +24,8 @@
 //    the parser over them, and reports frame evaluation numbers.
 //
 // For B and C, --maxdocs can be used to limit the processing to the specified
-// number of documents.
+// number of documents. When benchmarking, --batch documents at a time are
+// parsed in parallel using --threads worker threads.
 
 #include <iostream>
 #include <string>
@@ -62,6 +63,8 @@ DEFINE_bool(evaluate_roles, false, "Detailed role evaluation");
 DEFINE_bool(hparams, false, "Output hyperparameters");
 DEFINE_int32(maxdocs, -1, "Maximum number of documents to process");
 DEFINE_string(commons, "", "Commons store");
+DEFINE_int32(batch, 1, "Number of documents per batch for benchmarking");
+DEFINE_int32(threads, 1, "Number of worker threads for benchmarking");
 
 using namespace sling;
 using namespace sling::nlp;
@@ -222,24 +225,44 @@ int main(int argc, char *argv[]) {
     DocumentCorpus corpus(&commons, FLAGS_corpus);
     int num_documents = 0;
     int num_tokens = 0;
+    std::vector<Store *> stores;
+    std::vector<Document *> batch;
     clock.start();
-    for (;;) {
-      if (FLAGS_maxdocs != -1 && num_documents >= FLAGS_maxdocs) break;
-
-      Store store(&commons);
-      Document *document = corpus.Next(&store);
-      if (document == nullptr) break;
-
-      num_documents++;
-      num_tokens += document->num_tokens();
-      if (num_documents % 100 == 0) {
-        std::cout << num_documents << " documents\r";
-        std::cout.flush();
+    bool done = false;
+    while (!done) {
+      // Read next batch of documents.
+      while (batch.size() < FLAGS_batch) {
+        if (FLAGS_maxdocs != -1 && num_documents >= FLAGS_maxdocs) {
+          done = true;
+          break;
+        }
+
+        Store *store = new Store(&commons);
+        Document *document = corpus.Next(store);
+        if (document == nullptr) {
+          delete store;
+          done = true;
+          break;
+        }
+
+        num_documents++;
+        num_tokens += document->num_tokens();
+        if (num_documents % 100 == 0) {
+          std::cout << num_documents << " documents\r";
+          std::cout.flush();
+        }
+        document->ClearAnnotations();
+        stores.push_back(store);
+        batch.push_back(document);
       }
-      document->ClearAnnotations();
-      parser.Parse(document);
 
-      delete document;
+      // Parse documents in batch.
+      parser.ParseBatch(batch, FLAGS_threads);
+
+      for (Document *document : batch) delete document;
+      for (Store *store : stores) delete store;
+      batch.clear();
+      stores.clear();
     }
     clock.stop();
     LOG(INFO) << num_documents << " documents, "
@@ -101,7 +101,7 @@ class ParserTrainer : public task::LearnerTask {
         Document *document = training_corpus_->Next(&commons_);
         if (document == nullptr) break;
         pipeline_.Annotate(document);
-        for (const Token &t : document->tokens()) words_[t.word()]++;
+        for (Token t : document->tokens()) words_[t.word().str()]++;
         delete document;
       }
     }
@@ -14,8 +14,11 @@
 
 #include "sling/nlp/parser/parser.h"
 
+#include <algorithm>
+
 #include "sling/base/logging.h"
 #include "sling/frame/serialization.h"
+#include "sling/util/threadpool.h"
 
 namespace sling {
 namespace nlp {
@@ -23,6 +26,7 @@ namespace nlp {
 using namespace myelin;
 
 Parser::~Parser() {
+  for (Instance *instance : pool_) delete instance;
   delete encoder_;
   delete decoder_;
 }
@@ -76,11 +80,43 @@ void Parser::Load(Store *store, const string &filename) {
 }
 
 void Parser::Parse(Document *document) const {
-  // Create encoder and decoder predictors.
-  ParserEncoder::Predictor *encoder = encoder_->CreatePredictor();
-  ParserDecoder::Predictor *decoder = decoder_->CreatePredictor();
+  Instance *instance = Acquire();
+  Parse(document, instance);
+  Release(instance);
+}
+
+void Parser::ParseBatch(const std::vector<Document *> &documents,
+                        int threads) const {
+  // Sort documents by decreasing length.
+  std::vector<Document *> queue(documents);
+  std::stable_sort(queue.begin(), queue.end(),
+                   [](const Document *a, const Document *b) {
+                     return a->length() > b->length();
+                   });
+
+  // Parse documents in a thread pool. The documents are scheduled one at a
+  // time, so they are dealt out round-robin to the workers and each worker
+  // gets its share of the longest documents. Idle workers steal documents from
+  // the other worker queues. Each task acquires a parser instance from the
+  // instance pool.
+  if (threads > queue.size()) threads = queue.size();
+  if (threads <= 1) {
+    Instance *instance = Acquire();
+    for (Document *document : queue) Parse(document, instance);
+    Release(instance);
+    return;
+  }
+  ThreadPool pool(threads, queue.size());
+  pool.StartWorkers();
+  for (Document *document : queue) {
+    pool.Schedule([this, document]() { Parse(document); });
+  }
+}
 
+void Parser::Parse(Document *document, Instance *instance) const {
   // Parse each sentence of the document.
+  ParserEncoder::Predictor *encoder = instance->encoder;
+  ParserDecoder::Predictor *decoder = instance->decoder;
   decoder->Switch(document);
   for (SentenceIterator s(document, skip_mask_); s.more(); s.next()) {
     // Encode tokens in the sentence using encoder.
@@ -89,9 +125,28 @@ void Parser::Parse(Document *document) const {
     // Decode sentence using decoder.
     decoder->Decode(s.begin(), s.end(), encodings);
   }
+}
+
+Parser::Instance *Parser::Acquire() const {
+  {
+    MutexLock lock(&mu_);
+    if (!pool_.empty()) {
+      Instance *instance = pool_.back();
+      pool_.pop_back();
+      return instance;
+    }
+  }
+
+  // Create encoder and decoder predictors for new instance.
+  Instance *instance = new Instance();
+  instance->encoder = encoder_->CreatePredictor();
+  instance->decoder = decoder_->CreatePredictor();
+  return instance;
+}
 
-  delete encoder;
-  delete decoder;
+void Parser::Release(Instance *instance) const {
+  MutexLock lock(&mu_);
+  pool_.push_back(instance);
 }
 
 }  // namespace nlp
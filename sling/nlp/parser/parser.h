@@ -26,6 +26,7 @@
 #include "sling/myelin/flow.h"
 #include "sling/nlp/document/document.h"
 #include "sling/nlp/parser/parser-codec.h"
+#include "sling/util/mutex.h"
 
 namespace sling {
 namespace nlp {
@@ -44,6 +45,11 @@ class Parser {
   // Parse document.
   void Parse(Document *document) const;
 
+  // Parse a batch of documents using a number of worker threads. The
+  // documents are parsed longest first to balance the load between the
+  // workers.
+  void ParseBatch(const std::vector<Document *> &documents, int threads) const;
+
   // Neural network model for parser.
   const myelin::Network &model() const { return model_; }
 
@@ -51,6 +57,24 @@ class Parser {
   const HyperParams &hparams() const { return hparams_; }
 
  private:
+  // Encoder and decoder predictors for parsing documents. Instances are kept
+  // in a pool and reused between documents, since creating the predictors
+  // requires allocating instances for all the cells in the model.
+  struct Instance {
+    ~Instance() { delete encoder; delete decoder; }
+    ParserEncoder::Predictor *encoder;
+    ParserDecoder::Predictor *decoder;
+  };
+
+  // Get parser instance from pool or create a new one.
+  Instance *Acquire() const;
+
+  // Return parser instance to pool.
+  void Release(Instance *instance) const;
+
+  // Parse document using parser instance.
+  void Parse(Document *document, Instance *instance) const;
+
   // JIT compiler.
   myelin::Compiler compiler_;
 
@@ -68,6 +92,10 @@ class Parser {
 
   // Sentence skip mask. Default to skipping headings.
   int skip_mask_ = HEADING_BEGIN;
+
+  // Pool of idle parser instances.
+  mutable std::vector<Instance *> pool_;
+  mutable Mutex mu_;
 };
 
 }  // namespace nlp
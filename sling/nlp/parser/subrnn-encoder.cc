@@ -213,8 +213,9 @@ class SubwordRNNEncoder : public ParserEncoder {
       string normalized;
       for (int t = 0; t < length; ++t) {
         token_start_[t] = subword_index_.size();
-        const Token &token = document.token(t + begin);
-        UTF8::Normalize(token.word(), encoder_->normalization_, &normalized);
+        Text word = document.token(t + begin).word();
+        UTF8::Normalize(word.data(), word.size(), encoder_->normalization_,
+                        &normalized);
         encoder_->subtokenizer_.Tokenize(normalized, &subword_index_);
       }
 
@@ -271,8 +272,9 @@ class SubwordRNNEncoder : public ParserEncoder {
       string normalized;
       for (int t = 0; t < length; ++t) {
         token_start_[t] = subword_index_.size();
-        const Token &token = document.token(t + begin);
-        UTF8::Normalize(token.word(), encoder_->normalization_, &normalized);
+        Text word = document.token(t + begin).word();
+        UTF8::Normalize(word.data(), word.size(), encoder_->normalization_,
+                        &normalized);
         encoder_->subtokenizer_.Tokenize(normalized, &subword_index_);
       }
 
@@ -15,6 +15,9 @@
 #include <algorithm>
 #include <string>
 #include <vector>
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
 
 #include "sling/nlp/search/search-engine.h"
 
@@ -170,10 +173,26 @@ int SearchEngine::Search(Text query, Results *results) {
   QueryToString(expression, &str);
   LOG(INFO) << "Query: " << query << " -> " << str;
 
+  // Use top-k pruning for term queries with compressed posting lists.
+  ExtractTerms(expression, &results->query_terms_);
+  if (expression->type == TERMS || expression->type == PHRASE) {
+    std::vector<const Term *> terms;
+    bool prunable = LookupTerms(expression, &terms) && !terms.empty();
+    for (const Term *term : terms) {
+      if (!term->bounded()) prunable = false;
+    }
+    if (prunable) {
+      delete expression;
+      int hits = SearchTerms(terms, results);
+      results->total_hits_ = hits;
+      results->hits_.sort();
+      return hits;
+    }
+  }
+
   // Find matches.
   Matches matches;
   Match(expression, &matches);
-  ExtractTerms(expression, &results->query_terms_);
   delete expression;
 
   // Rank hits.
@@ -280,22 +299,8 @@ void SearchEngine::Match(Query *query, Matches *matches) {
       Match(query->right, &right);
 
       if (!left.empty() && !right.empty()) {
-        const uint32 *l = left.begin();
-        const uint32 *lend = left.end();
-        const uint32 *r = right.begin();
-        const uint32 *rend = right.end();
-
-        while (l < lend && r < rend) {
-          if (*l < *r) {
-            l++;
-          } else if (*r < *l) {
-            r++;
-          } else {
-            matches->add(*l);
-            r++;
-            l++;
-          }
-        }
+        Intersect(left.begin(), left.end(), right.begin(), right.end(),
+                  matches);
       }
       break;
     }
@@ -307,49 +312,48 @@ void SearchEngine::Match(Query *query, Matches *matches) {
   }
 }
 
-void SearchEngine::MatchTerms(Query *query, Matches *matches) {
+bool SearchEngine::LookupTerms(Query *query,
+                               std::vector<const Term *> *terms) {
   // Look up posting lists for tokens in search index.
-  std::vector<const SearchIndex::Term *> terms;
   for (uint64 token : query->fingerprints) {
     if (index_.stopword(token)) continue;
     token = index_.map(token);
 
     const SearchIndex::Term *term = index_.Find(token);
-    if (term == nullptr) return;
-    terms.push_back(term);
+    if (term == nullptr) return false;
+    terms->push_back(term);
   }
-  if (terms.empty()) return;
 
   // Sort search terms by frequency starting with the most rare terms.
-  std::sort(terms.begin(), terms.end(),
+  std::sort(terms->begin(), terms->end(),
     [](const SearchIndex::Term *a, const SearchIndex::Term *b) {
         return a->num_documents() < b->num_documents();
     });
+  return true;
+}
+
+void SearchEngine::MatchTerms(Query *query, Matches *matches) {
+  // Look up posting lists for tokens in search index.
+  std::vector<const SearchIndex::Term *> terms;
+  if (!LookupTerms(query, &terms)) return;
+  if (terms.empty()) return;
 
   // Initialize candidates from first term.
   Matches candidates(terms[0]);
 
   // Match the rest of the search terms.
   for (int i = 1;  i < terms.size(); ++i) {
-    Matches next(terms[i]);
-
-    const uint32 *c = candidates.begin();
-    const uint32 *cend = candidates.end();
-    const uint32 *n = next.begin();
-    const uint32 *nend = next.end();
+    const Term *next = terms[i];
 
     // Intersect current candidates with postings for term.
     Matches intersection;
-    while (c < cend && n < nend) {
-      if (*n < *c) {
-        n++;
-      } else if (*c < *n) {
-        c++;
-      } else {
-        intersection.add(*c);
-        c++;
-        n++;
-      }
+    if (next->compressed()) {
+      Intersect(candidates.begin(), candidates.end(), next, &intersection);
+    } else {
+      const uint32 *n = next->documents();
+      Intersect(candidates.begin(), candidates.end(),
+                n, n + next->num_documents(),
+                &intersection);
     }
 
     // Bail out if there are no more candidates.
@@ -362,6 +366,172 @@ void SearchEngine::MatchTerms(Query *query, Matches *matches) {
   matches->swap(candidates);
 }
 
+int SearchEngine::SearchTerms(const std::vector<const Term *> &terms,
+                              Results *results) {
+  const Term *lead = terms[0];
+  const Term::Bound *bounds = lead->bounds();
+  uint32 docids[Term::BLOCK_SIZE];
+  int64 matched = 0;
+  int64 evaluated = 0;
+  int64 skipped = 0;
+  int scored = 0;
+  for (int b = 0; b < lead->num_blocks(); ++b) {
+    // Stop when no remaining document can enter the top-k hits.
+    int64 threshold = results->threshold();
+    if (bounds[b].remaining <= threshold) {
+      for (int r = b; r < lead->num_blocks(); ++r) {
+        skipped += lead->block_size(r);
+      }
+      break;
+    }
+
+    // Skip block if none of its documents can enter the top-k hits.
+    if (bounds[b].block <= threshold) {
+      skipped += lead->block_size(b);
+      continue;
+    }
+
+    // Decode block and intersect it with the other search terms.
+    int n = lead->Decode(b, docids);
+    evaluated += n;
+    Matches candidates;
+    candidates.docids.assign(docids, docids + n);
+    for (int i = 1; i < terms.size() && !candidates.empty(); ++i) {
+      Matches intersection;
+      Intersect(candidates.begin(), candidates.end(), terms[i],
+                &intersection);
+      candidates.swap(intersection);
+    }
+    matched += candidates.size();
+
+    // Score matching documents.
+    for (uint32 docid : candidates.docids) {
+      Hit hit(index_.GetDocument(docid));
+      hit.score = results->Score(hit.document);
+      results->hits_.push(hit);
+    }
+
+    // Limit the number of scored documents for very ambiguous queries.
+    scored += candidates.size();
+    if (scored >= results->maxambig()) {
+      for (int r = b + 1; r < lead->num_blocks(); ++r) {
+        skipped += lead->block_size(r);
+      }
+      break;
+    }
+  }
+
+  // Estimate the total number of matches from the selectivity of the
+  // evaluated blocks if some blocks were skipped.
+  if (skipped > 0) {
+    results->estimated_ = true;
+    if (evaluated > 0) matched += skipped * matched / evaluated;
+  }
+  return matched;
+}
+
+// Find first element in sorted list that is not less than value using
+// exponential search followed by binary search.
+static const uint32 *Gallop(const uint32 *begin, const uint32 *end,
+                            uint32 value) {
+  size_t size = end - begin;
+  size_t lo = 0;
+  size_t hi = 1;
+  while (hi < size && begin[hi] < value) {
+    lo = hi;
+    hi <<= 1;
+  }
+  if (hi > size) hi = size;
+  return std::lower_bound(begin + lo, begin + hi, value);
+}
+
+// Merge intersection of two sorted lists. With SSE2, blocks of four elements
+// from each list are compared against each other using rotations.
+static void MergeIntersect(const uint32 *a, const uint32 *aend,
+                           const uint32 *b, const uint32 *bend,
+                           SearchEngine::Matches *matches) {
+#ifdef __SSE2__
+  while (a + 4 <= aend && b + 4 <= bend) {
+    __m128i va = _mm_loadu_si128(reinterpret_cast<const __m128i *>(a));
+    __m128i vb = _mm_loadu_si128(reinterpret_cast<const __m128i *>(b));
+    __m128i eq = _mm_cmpeq_epi32(va, vb);
+    vb = _mm_shuffle_epi32(vb, _MM_SHUFFLE(0, 3, 2, 1));
+    eq = _mm_or_si128(eq, _mm_cmpeq_epi32(va, vb));
+    vb = _mm_shuffle_epi32(vb, _MM_SHUFFLE(0, 3, 2, 1));
+    eq = _mm_or_si128(eq, _mm_cmpeq_epi32(va, vb));
+    vb = _mm_shuffle_epi32(vb, _MM_SHUFFLE(0, 3, 2, 1));
+    eq = _mm_or_si128(eq, _mm_cmpeq_epi32(va, vb));
+    int mask = _mm_movemask_ps(_mm_castsi128_ps(eq));
+    if (mask != 0) {
+      for (int i = 0; i < 4; ++i) {
+        if (mask & (1 << i)) matches->add(a[i]);
+      }
+    }
+
+    uint32 amax = a[3];
+    uint32 bmax = b[3];
+    if (amax <= bmax) a += 4;
+    if (bmax <= amax) b += 4;
+  }
+#endif
+
+  while (a < aend && b < bend) {
+    if (*a < *b) {
+      a++;
+    } else if (*b < *a) {
+      b++;
+    } else {
+      matches->add(*a);
+      a++;
+      b++;
+    }
+  }
+}
+
+void SearchEngine::Intersect(const uint32 *a, const uint32 *aend,
+                             const uint32 *b, const uint32 *bend,
+                             Matches *matches) {
+  // Use galloping search in the longer list if the lists are very skewed.
+  if (aend - a > bend - b) {
+    std::swap(a, b);
+    std::swap(aend, bend);
+  }
+  if ((aend - a) * 32 < bend - b) {
+    for (; a < aend && b < bend; ++a) {
+      b = Gallop(b, bend, *a);
+      if (b < bend && *b == *a) matches->add(*b++);
+    }
+  } else {
+    MergeIntersect(a, aend, b, bend, matches);
+  }
+}
+
+void SearchEngine::Intersect(const uint32 *a, const uint32 *aend,
+                             const Term *term,
+                             Matches *matches) {
+  const Term::Block *blocks = term->blocks();
+  int num_blocks = term->num_blocks();
+  uint32 docids[Term::BLOCK_SIZE];
+  int b = 0;
+  while (a < aend && b < num_blocks) {
+    // Skip blocks where the last document id is before the next candidate.
+    uint32 next = *a;
+    b = std::lower_bound(blocks + b, blocks + num_blocks, next,
+          [](const Term::Block &block, uint32 docid) {
+            return block.last < docid;
+          }) - blocks;
+    if (b == num_blocks) break;
+
+    // Decode block and intersect it with the candidates in its range.
+    uint32 last = blocks[b].last;
+    const uint32 *limit = std::upper_bound(a, aend, last);
+    int n = term->Decode(b, docids);
+    Intersect(a, limit, docids, docids + n, matches);
+    a = limit;
+    b++;
+  }
+}
+
 int SearchEngine::Results::Score(const Document *document) {
   int unigrams = 0;
   int bigrams = 0;
@@ -378,13 +548,13 @@ int SearchEngine::Results::Score(const Document *document) {
         bigrams += importance;
       }
     }
-    if (token == WORDFP_BREAK) importance = 1;
-    if (token == WORDFP_IMPORTANT) importance = 50;
+    importance = SearchIndex::Importance(token, importance);
     prev = token;
   }
 
-  int boost = 100 * bigrams + 10 * unigrams + 1;
-  if (unigrams == query_terms_.size()) boost++;
+  int boost = SearchIndex::BIGRAM_WEIGHT * bigrams +
+              SearchIndex::UNIGRAM_WEIGHT * unigrams + 1;
+  if (unigrams == query_terms_.size()) boost += SearchIndex::FULL_MATCH_BOOST;
   return (document->score() + 1) * boost;
 }
 
@@ -111,8 +111,14 @@ class SearchEngine {
 
   // Posting list with document ids.
   struct Matches {
-    // Initialize posting list from repository term.
-    Matches(const Term *term = nullptr) : term(term) {}
+    // Initialize posting list from repository term. Compressed posting lists
+    // are decoded into the document id list.
+    Matches(const Term *term = nullptr) : term(term) {
+      if (term != nullptr && term->compressed()) {
+        term->Decode(&docids);
+        this->term = nullptr;
+      }
+    }
 
     // Start of match list.
     const uint32 *begin() {
@@ -153,11 +159,16 @@ class SearchEngine {
   // Search results.
   class Results {
    public:
-    Results(int limit, int maxambig) : hits_(limit), maxambig_(maxambig) {}
+    Results(int limit, int maxambig)
+        : hits_(limit), limit_(limit), maxambig_(maxambig) {}
 
     // Return search matches.
     const Hits &hits() const { return hits_; }
 
+    // Check if the total number of matches is an estimate because some
+    // posting list blocks were pruned.
+    bool estimated() const { return estimated_; }
+
     // Score document against query.
     int Score(const Document *document);
 
@@ -171,15 +182,27 @@ class SearchEngine {
     // Check for bigram query match.
     bool Bigram(uint16 term1, uint16 term2) const;
 
+    // Minimum score needed for entering the top-k hits, or -1 if there are
+    // still fewer than k hits.
+    int64 threshold() const {
+      return hits_.size() < limit_ ? -1 : hits_.front().score;
+    }
+
     // Work fingerprints for search terms.
     std::vector<uint16> query_terms_;
 
     // Search hits.
     Hits hits_;
 
+    // Maximum number of hits.
+    int limit_;
+
     // Total number of matches.
     int total_hits_ = 0;
 
+    // Total number of matches is estimated.
+    bool estimated_ = false;
+
     // Maximum ambiguity.
     int maxambig_ = 0;
 
@@ -205,6 +228,28 @@ class SearchEngine {
   void Match(Query *query, Matches *matches);
   void MatchTerms(Query *query, Matches *matches);
 
+  // Look up posting lists for query terms sorted by frequency. Returns false
+  // if some term is not in the index.
+  bool LookupTerms(Query *query, std::vector<const Term *> *terms);
+
+  // Find top-k matches for terms with block-max pruning. Blocks in the
+  // posting list for the most rare term are skipped when their score bound
+  // cannot beat the current top-k threshold, and the search stops when no
+  // remaining block can. All posting lists must have score bounds. Returns
+  // the (estimated) total number of matches.
+  int SearchTerms(const std::vector<const Term *> &terms, Results *results);
+
+  // Add document ids that are in both of the sorted lists to matches.
+  static void Intersect(const uint32 *a, const uint32 *aend,
+                        const uint32 *b, const uint32 *bend,
+                        Matches *matches);
+
+  // Intersect sorted list with compressed posting list for term. Blocks in
+  // the posting list without any candidates are skipped without decoding.
+  static void Intersect(const uint32 *a, const uint32 *aend,
+                        const Term *term,
+                        Matches *matches);
+
   // Check if search index has been loaded.
   bool loaded() const { return index_.loaded(); }
 
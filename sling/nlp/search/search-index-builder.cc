@@ -23,6 +23,7 @@
 #include "sling/nlp/kb/calendar.h"
 #include "sling/nlp/search/search-dictionary.h"
 #include "sling/nlp/search/search-config.h"
+#include "sling/nlp/search/search-index.h"
 #include "sling/nlp/wiki/wiki.h"
 #include "sling/task/frames.h"
 #include "sling/task/task.h"
@@ -213,7 +214,7 @@ class SearchIndexMapper : public task::FrameProcessor {
     }
 
     // Add text to terms.
-    for (const Token &token : document.tokens()) {
+    for (Token token : document.tokens()) {
       uint64 term = config_.fingerprint(token.word());
       if (config_.stopword(term)) {
         num_stopwords_->Increment();
@@ -305,9 +306,16 @@ class SearchIndexBuilder : public task::Processor {
     config.Load(&store, task->GetInputFile("config"));
     num_buckets_ = config.buckets();
 
+    // Index format version. Version 2 uses compressed posting lists and
+    // version 3 adds score bounds to compressed posting lists.
+    version_ = task->Get("version", 3);
+    CHECK(version_ >= 1 && version_ <= 3)
+        << "Unsupported version " << version_;
+
     // Add search configuration to repository.
     JSON::Object params;
     params.Add("normalization", config.normalization());
+    params.Add("version", version_);
     repository_.AddBlock("params", params.AsString());
 
     // Add stopwords to repository.
@@ -344,6 +352,7 @@ class SearchIndexBuilder : public task::Processor {
     num_posting_lists_ = task->GetCounter("posting_lists");
     num_postings_ = task->GetCounter("postings");
     num_documents_ = task->GetCounter("documents");
+    num_compressed_ = task->GetCounter("compressed_posting_lists");
   }
 
   void Receive(task::Channel *channel, task::Message *message) override {
@@ -372,6 +381,13 @@ class SearchIndexBuilder : public task::Processor {
     document_items_->Write(docid.data(), idlen);
     document_items_->Write(data.data() + sizeof(uint32), token_bytes);
 
+    // Compute score bound for document for top-k pruning.
+    uint32 score = *reinterpret_cast<const uint32 *>(data.data());
+    const uint16 *tokens =
+        reinterpret_cast<const uint16 *>(data.data() + sizeof(uint32));
+    document_bounds_.push_back(
+        SearchIndex::ScoreBound(score, tokens, num_tokens));
+
     // Compute offset of next entry.
     document_offset_ += 2 * sizeof(uint32) + sizeof(uint8) +
                         idlen + token_bytes;
@@ -424,18 +440,49 @@ class SearchIndexBuilder : public task::Processor {
     // Clean up.
     ClearStreams();
     posting_list_.clear();
+    document_bounds_.clear();
   }
 
   void FlushTerm() {
     // Sort posting list.
     std::sort(posting_list_.begin(), posting_list_.end());
 
-    // Write term posting list.
+    // Compress posting list. Short posting lists are only compressed if this
+    // makes them smaller.
     uint32 size = posting_list_.size();
+    uint32 plain = size * sizeof(uint32);
+    compressed_.clear();
+    if (version_ >= 2) {
+      // Get score bounds for documents. Documents are received before the
+      // shuffled terms, but use the maximum bound for unknown documents.
+      bounds_.resize(size);
+      for (int i = 0; i < size; ++i) {
+        uint32 docid = posting_list_[i];
+        if (docid < document_bounds_.size()) {
+          bounds_[i] = document_bounds_[docid];
+        } else {
+          bounds_[i] = 0xFFFFFFFF;
+        }
+      }
+      SearchIndex::Term::Compress(posting_list_.data(),
+                                  version_ >= 3 ? bounds_.data() : nullptr,
+                                  size, &compressed_);
+    }
+
+    // Write term posting list.
     term_items_->Write(&current_term_, sizeof(uint64));
-    term_items_->Write(&size, sizeof(uint32));
-    term_items_->Write(posting_list_.data(), size * sizeof(uint32));
-    term_offset_ += sizeof(uint64) + (size + 1) * sizeof(uint32);
+    if (!compressed_.empty() && compressed_.size() < plain) {
+      uint32 doclen = size | SearchIndex::Term::COMPRESSED;
+      if (version_ >= 3) doclen |= SearchIndex::Term::BOUNDED;
+      term_items_->Write(&doclen, sizeof(uint32));
+      term_items_->Write(compressed_.data(), compressed_.size());
+      term_offset_ += sizeof(uint64) + sizeof(uint32) + compressed_.size();
+      num_compressed_->Increment();
+    } else {
+      term_items_->Write(&size, sizeof(uint32));
+      term_items_->Write(posting_list_.data(), plain);
+      term_offset_ += sizeof(uint64) + sizeof(uint32) + plain;
+    }
 
     posting_list_.clear();
     num_posting_lists_->Increment();
@@ -475,9 +522,21 @@ class SearchIndexBuilder : public task::Processor {
   int next_bucket_ = 0;
   uint64 current_term_ = 0;
 
+  // Index format version.
+  int version_ = 3;
+
   // Entities for current term.
   std::vector<uint32> posting_list_;
 
+  // Buffer for compressed posting list.
+  string compressed_;
+
+  // Score bounds for documents indexed by document id.
+  std::vector<uint32> document_bounds_;
+
+  // Score bounds for documents in current posting list.
+  std::vector<uint32> bounds_;
+
   // Offset for next document item.
   uint64 document_offset_ = 0;
 
@@ -488,6 +547,7 @@ class SearchIndexBuilder : public task::Processor {
   task::Counter *num_posting_lists_ = nullptr;
   task::Counter *num_postings_ = nullptr;
   task::Counter *num_documents_ = nullptr;
+  task::Counter *num_compressed_ = nullptr;
 };
 
 REGISTER_TASK_PROCESSOR("search-index-builder", SearchIndexBuilder);
@@ -14,6 +14,11 @@
 
 #include "sling/nlp/search/search-index.h"
 
+#include <string.h>
+#include <algorithm>
+#include <string>
+#include <vector>
+
 namespace sling {
 namespace nlp {
 
@@ -55,6 +60,119 @@ void SearchIndex::Load(const string &filename) {
   }
 }
 
+int SearchIndex::Term::Decode(int block, uint32 *docids) const {
+  // Get bit width for block.
+  const uint8 *p = data_ptr() + blocks()[block].offset;
+  int bits = *p++;
+  uint64 mask = (1ULL << bits) - 1;
+
+  // Unpack deltas and add them to the last document id of the previous block.
+  // The block data is padded, so it is safe to read eight bytes at a time.
+  uint32 docid = block == 0 ? 0 : blocks()[block - 1].last;
+  int n = block_size(block);
+  uint64 bitpos = 0;
+  for (int i = 0; i < n; ++i) {
+    uint64 word;
+    memcpy(&word, p + (bitpos >> 3), sizeof(uint64));
+    docid += (word >> (bitpos & 7)) & mask;
+    docids[i] = docid;
+    bitpos += bits;
+  }
+
+  return n;
+}
+
+void SearchIndex::Term::Decode(std::vector<uint32> *docids) const {
+  docids->resize(num_documents());
+  if (compressed()) {
+    uint32 *output = docids->data();
+    for (int b = 0; b < num_blocks(); ++b) {
+      output += Decode(b, output);
+    }
+  } else {
+    memcpy(docids->data(), documents(), num_documents() * sizeof(uint32));
+  }
+}
+
+void SearchIndex::Term::Compress(const uint32 *docids, const uint32 *bounds,
+                                 int num_docs, string *data) {
+  std::vector<Block> blocks;
+  std::vector<Bound> limits;
+  string packed;
+  uint32 prev = 0;
+  for (int start = 0; start < num_docs; start += BLOCK_SIZE) {
+    int end = std::min(start + BLOCK_SIZE, num_docs);
+
+    // Find number of bits needed for the deltas in the block.
+    int bits = 0;
+    uint32 last = prev;
+    for (int i = start; i < end; ++i) {
+      uint32 delta = docids[i] - last;
+      while (bits < 32 && (delta >> bits) != 0) bits++;
+      last = docids[i];
+    }
+
+    // Add block to skip table.
+    Block block;
+    block.last = docids[end - 1];
+    block.offset = packed.size();
+    blocks.push_back(block);
+
+    // Add score bound for block.
+    if (bounds != nullptr) {
+      Bound limit;
+      limit.block = *std::max_element(bounds + start, bounds + end);
+      limit.remaining = limit.block;
+      limits.push_back(limit);
+    }
+
+    // Bit-pack deltas.
+    packed.push_back(bits);
+    uint64 acc = 0;
+    int nbits = 0;
+    for (int i = start; i < end; ++i) {
+      acc |= static_cast<uint64>(docids[i] - prev) << nbits;
+      nbits += bits;
+      while (nbits >= 8) {
+        packed.push_back(acc & 0xFF);
+        acc >>= 8;
+        nbits -= 8;
+      }
+      prev = docids[i];
+    }
+    if (nbits > 0) packed.push_back(acc & 0xFF);
+  }
+
+  // Compute score bounds for the remaining blocks.
+  for (int b = static_cast<int>(limits.size()) - 2; b >= 0; --b) {
+    limits[b].remaining = std::max(limits[b].block, limits[b + 1].remaining);
+  }
+
+  // Pad block data for unaligned 64-bit reads when decoding the last block.
+  packed.append(sizeof(uint64) - 1, 0);
+
+  // Output block data size, skip table, score bounds, and block data.
+  uint32 datalen = packed.size();
+  data->append(reinterpret_cast<const char *>(&datalen), sizeof(uint32));
+  data->append(reinterpret_cast<const char *>(blocks.data()),
+               blocks.size() * sizeof(Block));
+  data->append(reinterpret_cast<const char *>(limits.data()),
+               limits.size() * sizeof(Bound));
+  data->append(packed);
+}
+
+uint32 SearchIndex::ScoreBound(uint32 score, const uint16 *tokens,
+                               int num_tokens) {
+  uint64 boost = 1 + FULL_MATCH_BOOST;
+  int importance = 1;
+  for (int i = 0; i < num_tokens; ++i) {
+    boost += (UNIGRAM_WEIGHT + BIGRAM_WEIGHT) * importance;
+    importance = Importance(tokens[i], importance);
+  }
+  uint64 bound = (score + 1ULL) * boost;
+  return bound > 0xFFFFFFFF ? 0xFFFFFFFF : bound;
+}
+
 const SearchIndex::Term *SearchIndex::Find(uint64 fp) const {
   int bucket = fp % num_buckets_;
   const Term *term = term_index_.GetBucket(bucket);
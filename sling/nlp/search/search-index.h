@@ -18,10 +18,12 @@
 #include <string>
 #include <unordered_map>
 #include <unordered_set>
+#include <vector>
 
 #include "sling/base/types.h"
 #include "sling/file/repository.h"
 #include "sling/string/text.h"
+#include "sling/util/fingerprint.h"
 #include "sling/util/json.h"
 
 namespace sling {
@@ -62,22 +64,96 @@ class SearchIndex {
     REPOSITORY_FIELD(uint16, tokens, *tokenlen_ptr(), AFTER(id));
   };
 
-  // Term with posting list in repository.
+  // Term with posting list in repository. The posting list is either stored
+  // as an array of document ids, or compressed as blocks of delta-encoded and
+  // bit-packed document ids. Compressed posting lists have a skip table with
+  // the last document id and the data offset for each block, so blocks can be
+  // skipped without being decoded. In version 3 indices, the skip table is
+  // followed by a table with upper bounds for the scores of the documents in
+  // each block and in the rest of the posting list for top-k pruning.
   class Term : public RepositoryObject {
    public:
+    // Flag in document count for compressed posting lists.
+    static const uint32 COMPRESSED = 0x80000000;
+
+    // Flag in document count for compressed posting lists with score bounds.
+    static const uint32 BOUNDED = 0x40000000;
+
+    // Flags in document count.
+    static const uint32 FLAGS = COMPRESSED | BOUNDED;
+
+    // Number of document ids in each compressed block.
+    static const int BLOCK_SIZE = 128;
+
+    // Skip table entry for compressed block.
+    struct Block {
+      uint32 last;       // last document id in block
+      uint32 offset;     // offset of block in block data
+    };
+
+    // Score bounds for compressed block.
+    struct Bound {
+      uint32 block;      // upper bound on document scores in block
+      uint32 remaining;  // upper bound on scores in this and later blocks
+    };
+
     // Return fingerprint.
     uint64 fingerprint() const { return *fingerprint_ptr(); }
 
     // Return number of documents matching term.
-    int num_documents() const { return *doclen_ptr(); }
+    int num_documents() const { return *doclen_ptr() & ~FLAGS; }
 
-    // Return array of documents matching term.
+    // Check if posting list is compressed.
+    bool compressed() const { return (*doclen_ptr() & COMPRESSED) != 0; }
+
+    // Check if compressed posting list has score bounds.
+    bool bounded() const { return (*doclen_ptr() & BOUNDED) != 0; }
+
+    // Return array of documents matching term for uncompressed posting list.
     const uint32 *documents() const { return documents_ptr(); }
 
+    // Return number of blocks in compressed posting list.
+    int num_blocks() const {
+      return (num_documents() + BLOCK_SIZE - 1) / BLOCK_SIZE;
+    }
+
+    // Return skip table for compressed posting list.
+    const Block *blocks() const { return blocks_ptr(); }
+
+    // Return score bounds for bounded posting list.
+    const Bound *bounds() const { return bounds_ptr(); }
+
+    // Return upper bound on document scores for bounded posting list.
+    uint32 bound() const { return bounds()[0].remaining; }
+
+    // Return number of documents in compressed block.
+    int block_size(int block) const {
+      int remaining = num_documents() - block * BLOCK_SIZE;
+      return remaining < BLOCK_SIZE ? remaining : BLOCK_SIZE;
+    }
+
+    // Decode document ids in compressed block. The output array must have
+    // room for BLOCK_SIZE document ids. Returns the number of document ids.
+    int Decode(int block, uint32 *docids) const;
+
+    // Decode all document ids for term.
+    void Decode(std::vector<uint32> *docids) const;
+
+    // Compress sorted posting list. The bounds array has the score bound for
+    // each document, or is null for posting lists without score bounds. This
+    // outputs the block data size, the skip table, the score bounds, and the
+    // block data for the term.
+    static void Compress(const uint32 *docids, const uint32 *bounds,
+                         int num_docs, string *data);
+
     // Return next term in list.
     const Term *next() const {
-      int size = sizeof(uint64) + sizeof(uint32) +
-                 num_documents() * sizeof(uint32);
+      int size = sizeof(uint64) + sizeof(uint32);
+      if (compressed()) {
+        size += sizeof(uint32) + blocks_size() + bounds_size() + data_size();
+      } else {
+        size += num_documents() * sizeof(uint32);
+      }
       const char *self = reinterpret_cast<const char *>(this);
       return reinterpret_cast<const Term *>(self + size);
     }
@@ -89,11 +165,41 @@ class SearchIndex {
     // Document list.
     REPOSITORY_FIELD(uint32, doclen, 1, AFTER(fingerprint));
     REPOSITORY_FIELD(uint32, documents, num_documents(), AFTER(doclen));
+
+    // Compressed document list.
+    REPOSITORY_FIELD(uint32, datalen, 1, AFTER(doclen));
+    REPOSITORY_FIELD(Block, blocks, num_blocks(), AFTER(datalen));
+    REPOSITORY_FIELD(Bound, bounds, bounded() ? num_blocks() : 0,
+                     AFTER(blocks));
+    REPOSITORY_FIELD(uint8, data, *datalen_ptr(), AFTER(bounds));
   };
 
+  // Scoring weights. Documents are scored by boosting the base score with the
+  // number of query unigrams and bigrams in the document weighted by the
+  // importance of the matching tokens. Documents matching all query terms get
+  // an extra boost.
+  static const int UNIGRAM_WEIGHT = 10;
+  static const int BIGRAM_WEIGHT = 100;
+  static const int FULL_MATCH_BOOST = 1;
+
+  // Importance of tokens following an important-token marker. Tokens after a
+  // break have importance one.
+  static const int IMPORTANT_WEIGHT = 50;
+
+  // Return importance for the tokens after token.
+  static int Importance(uint16 token, int importance) {
+    if (token == WORDFP_BREAK) return 1;
+    if (token == WORDFP_IMPORTANT) return IMPORTANT_WEIGHT;
+    return importance;
+  }
+
   // Load search index from file.
   void Load(const string &filename);
 
+  // Compute upper bound on the score of a document for any query using the
+  // scoring weights, assuming that every token matches a unigram and bigram.
+  static uint32 ScoreBound(uint32 score, const uint16 *tokens, int num_tokens);
+
   // Find matching term in term table. Return null if term is not found.
   const Term *Find(uint64 fp) const;
 
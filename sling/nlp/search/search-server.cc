@@ -56,6 +56,7 @@ struct SearchShard {
 
     engine.Load(repo);
     if (!items.empty()) {
+      itemdb_options.mmap = true;
       database = new RecordDatabase(items, itemdb_options);
       if (!snippets.empty()) {
        snipper = nlp::SnippetGenerator::Create(snippets);
@@ -184,6 +185,7 @@ class SearchService {
     // Return result.
     JSON::Object json;
     json.Add("total", total);
+    if (result.estimated()) json.Add("estimated", true);
     json.Add("fetchable", shard->fetchable());
     json.Add("time", clock.ms());
     JSON::Array *hits = json.AddArray("hits");
@@ -269,6 +271,7 @@ class SearchService {
 
     // Return result.
     response->Add("total", total);
+    if (result.estimated()) response->Add("estimated", true);
     response->Add("fetchable", shard->fetchable());
     response->Add("time", clock.ms());
     JSON::Array *hits = response->AddArray("hits");
@@ -0,0 +1,339 @@
+// Copyright 2025 Ringgaard Research ApS
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "sling/base/flags.h"
+#include "sling/base/init.h"
+#include "sling/base/logging.h"
+#include "sling/file/repository.h"
+#include "sling/nlp/document/phrase-tokenizer.h"
+#include "sling/nlp/search/search-engine.h"
+#include "sling/nlp/search/search-index.h"
+#include "sling/string/strcat.h"
+#include "sling/util/fingerprint.h"
+#include "sling/util/json.h"
+
+DEFINE_int32(seed, 1, "Random seed");
+DEFINE_int32(documents, 20000, "Number of documents in pruning test index");
+DEFINE_int32(vocabulary, 40, "Number of words in pruning test index");
+DEFINE_int32(queries, 50, "Number of queries in pruning test");
+DEFINE_string(dir, "/tmp", "Directory for test search indices");
+
+using namespace sling;
+using namespace sling::nlp;
+
+typedef SearchIndex::Term Term;
+typedef std::vector<uint32> DocIds;
+
+static std::mt19937 rng;
+
+// Generate sorted list of unique document ids with gaps up to maxgap.
+static DocIds RandomPostings(int n, uint32 maxgap) {
+  std::uniform_int_distribution<uint32> gap(1, maxgap);
+  DocIds docids;
+  uint32 docid = gap(rng) - 1;
+  for (int i = 0; i < n; ++i) {
+    docids.push_back(docid);
+    docid += gap(rng);
+  }
+  return docids;
+}
+
+// Build compressed term object for posting list in buffer.
+static const Term *CompressTerm(const DocIds &docids, const DocIds *bounds,
+                                string *buffer) {
+  uint64 fp = 0x0123456789ABCDEF;
+  uint32 doclen = docids.size() | Term::COMPRESSED;
+  if (bounds != nullptr) doclen |= Term::BOUNDED;
+  buffer->assign(reinterpret_cast<const char *>(&fp), sizeof(uint64));
+  buffer->append(reinterpret_cast<const char *>(&doclen), sizeof(uint32));
+  Term::Compress(docids.data(),
+                 bounds != nullptr ? bounds->data() : nullptr,
+                 docids.size(), buffer);
+  return reinterpret_cast<const Term *>(buffer->data());
+}
+
+// Check that compressed posting lists decode to the original document ids.
+static void TestRoundTrip(int n, uint32 maxgap, bool bounded) {
+  DocIds docids = RandomPostings(n, maxgap);
+  DocIds bounds;
+  std::uniform_int_distribution<uint32> score(0, 1000000);
+  for (int i = 0; i < n; ++i) bounds.push_back(score(rng));
+
+  string buffer;
+  const Term *term = CompressTerm(docids, bounded ? &bounds : nullptr,
+                                  &buffer);
+  CHECK(term->compressed());
+  CHECK_EQ(term->bounded(), bounded);
+  CHECK_EQ(term->num_documents(), n);
+  CHECK_EQ(term->next(),
+           reinterpret_cast<const Term *>(buffer.data() + buffer.size()));
+
+  // Decode all document ids.
+  DocIds decoded;
+  term->Decode(&decoded);
+  CHECK(decoded == docids) << "n=" << n << " maxgap=" << maxgap;
+
+  // Decode each block and check skip table and score bounds.
+  uint32 block[Term::BLOCK_SIZE];
+  uint32 remaining = 0;
+  for (int b = term->num_blocks() - 1; b >= 0; --b) {
+    int start = b * Term::BLOCK_SIZE;
+    int size = term->Decode(b, block);
+    CHECK_EQ(size, term->block_size(b));
+    CHECK(std::equal(block, block + size, docids.begin() + start));
+    CHECK_EQ(term->blocks()[b].last, docids[start + size - 1]);
+    if (bounded) {
+      uint32 limit = *std::max_element(bounds.begin() + start,
+                                       bounds.begin() + start + size);
+      remaining = std::max(remaining, limit);
+      CHECK_EQ(term->bounds()[b].block, limit);
+      CHECK_EQ(term->bounds()[b].remaining, remaining);
+    }
+  }
+  if (bounded) {
+    CHECK_EQ(term->bound(), *std::max_element(bounds.begin(), bounds.end()));
+  }
+}
+
+// Check intersection of sorted lists against the standard library.
+static void TestIntersect(int na, uint32 gapa, int nb, uint32 gapb) {
+  DocIds a = RandomPostings(na, gapa);
+  DocIds b = RandomPostings(nb, gapb);
+  DocIds expected;
+  std::set_intersection(a.begin(), a.end(), b.begin(), b.end(),
+                        std::back_inserter(expected));
+
+  // Intersect plain lists in both argument orders.
+  SearchEngine::Matches ab;
+  SearchEngine::Intersect(a.data(), a.data() + a.size(),
+                          b.data(), b.data() + b.size(), &ab);
+  CHECK(ab.docids == expected) << na << "x" << nb;
+
+  SearchEngine::Matches ba;
+  SearchEngine::Intersect(b.data(), b.data() + b.size(),
+                          a.data(), a.data() + a.size(), &ba);
+  CHECK(ba.docids == expected) << nb << "x" << na;
+
+  // Intersect list with compressed posting list.
+  string buffer;
+  const Term *term = CompressTerm(b, nullptr, &buffer);
+  SearchEngine::Matches at;
+  SearchEngine::Intersect(a.data(), a.data() + a.size(), term, &at);
+  CHECK(at.docids == expected) << na << "x" << nb << " compressed";
+
+  // Decoding a compressed posting list into matches must give the same list.
+  SearchEngine::Matches decoded(term);
+  CHECK(decoded.docids == b);
+}
+
+// Document in test corpus.
+struct TestDocument {
+  uint32 score;
+  std::vector<uint16> tokens;
+};
+
+// Write search index repository for corpus with all posting lists
+// compressed. Version 3 indices have score bounds for block-max pruning.
+static void WriteIndex(const std::vector<TestDocument> &corpus,
+                       const std::vector<uint64> &words,
+                       int version,
+                       const string &filename) {
+  Repository repository;
+  JSON::Object params;
+  params.Add("normalization", "");
+  params.Add("version", version);
+  repository.AddBlock("params", params.AsString());
+  repository.AddBlock("stopwords", nullptr, 0);
+  repository.AddBlock("synonyms", nullptr, 0);
+
+  // Write documents and collect posting lists.
+  string index;
+  string items;
+  DocIds bounds;
+  std::vector<DocIds> postings(words.size());
+  for (uint32 docid = 0; docid < corpus.size(); ++docid) {
+    const TestDocument &doc = corpus[docid];
+    uint64 offset = items.size();
+    string id = StrCat("Q", docid);
+    uint8 idlen = id.size();
+    uint32 num_tokens = doc.tokens.size();
+    index.append(reinterpret_cast<const char *>(&offset), sizeof(uint64));
+    items.append(reinterpret_cast<const char *>(&doc.score), sizeof(uint32));
+    items.append(reinterpret_cast<const char *>(&idlen), sizeof(uint8));
+    items.append(reinterpret_cast<const char *>(&num_tokens), sizeof(uint32));
+    items.append(id);
+    items.append(reinterpret_cast<const char *>(doc.tokens.data()),
+                 num_tokens * sizeof(uint16));
+    bounds.push_back(SearchIndex::ScoreBound(doc.score, doc.tokens.data(),
+                                             num_tokens));
+
+    for (int w = 0; w < words.size(); ++w) {
+      uint16 word = WordFingerprint(words[w]);
+      auto &list = postings[w];
+      for (uint16 token : doc.tokens) {
+        if (token == word && (list.empty() || list.back() != docid)) {
+          list.push_back(docid);
+        }
+      }
+    }
+  }
+  repository.AddBlock("DocumentIndex", index);
+  repository.AddBlock("DocumentItems", items);
+
+  // Write terms into a single bucket.
+  string terms;
+  for (int w = 0; w < words.size(); ++w) {
+    const DocIds &list = postings[w];
+    if (list.empty()) continue;
+    DocIds limits;
+    for (uint32 docid : list) limits.push_back(bounds[docid]);
+    uint32 doclen = list.size() | Term::COMPRESSED;
+    if (version >= 3) doclen |= Term::BOUNDED;
+    terms.append(reinterpret_cast<const char *>(&words[w]), sizeof(uint64));
+    terms.append(reinterpret_cast<const char *>(&doclen), sizeof(uint32));
+    Term::Compress(list.data(), version >= 3 ? limits.data() : nullptr,
+                   list.size(), &terms);
+  }
+  uint64 buckets[2] = {0, terms.size()};
+  repository.AddBlock("TermBuckets", buckets, sizeof(buckets));
+  repository.AddBlock("TermItems", terms);
+
+  repository.Write(filename);
+}
+
+// Check that top-k search with block-max pruning finds hits with the same
+// scores as exhaustive scoring of all matching documents.
+static void TestPruning() {
+  // Word fingerprints for vocabulary.
+  PhraseTokenizer tokenizer;
+  std::vector<string> vocabulary;
+  std::vector<uint64> words;
+  for (int i = 0; i < FLAGS_vocabulary; ++i) {
+    string word = StrCat("w", i);
+    std::vector<uint64> fps;
+    tokenizer.TokenFingerprints(word, &fps);
+    CHECK_EQ(fps.size(), 1);
+    vocabulary.push_back(word);
+    words.push_back(fps[0]);
+  }
+
+  // Generate corpus with skewed word and score distributions. Some documents
+  // have important sections which have higher weight in the scores.
+  std::vector<TestDocument> corpus(FLAGS_documents);
+  std::geometric_distribution<int> word(0.1);
+  std::geometric_distribution<uint32> score(0.01);
+  std::uniform_int_distribution<int> length(2, 20);
+  std::uniform_int_distribution<int> marker(0, 30);
+  for (TestDocument &doc : corpus) {
+    doc.score = score(rng);
+    int n = length(rng);
+    for (int i = 0; i < n; ++i) {
+      int m = marker(rng);
+      if (m == 0) doc.tokens.push_back(WORDFP_IMPORTANT);
+      if (m == 1) doc.tokens.push_back(WORDFP_BREAK);
+      int w = word(rng) % FLAGS_vocabulary;
+      doc.tokens.push_back(WordFingerprint(words[w]));
+    }
+  }
+
+  // Write index with and without score bounds.
+  string bounded = FLAGS_dir + "/search-test-v3.repo";
+  string exhaustive = FLAGS_dir + "/search-test-v2.repo";
+  WriteIndex(corpus, words, 3, bounded);
+  WriteIndex(corpus, words, 2, exhaustive);
+  SearchEngine pruned;
+  SearchEngine baseline;
+  pruned.Load(bounded);
+  baseline.Load(exhaustive);
+
+  // Compare results for random queries with one to three terms.
+  std::uniform_int_distribution<int> terms(1, 3);
+  std::uniform_int_distribution<int> limit(1, 50);
+  int estimated = 0;
+  for (int q = 0; q < FLAGS_queries; ++q) {
+    string query;
+    int n = terms(rng);
+    for (int i = 0; i < n; ++i) {
+      if (!query.empty()) query.push_back(' ');
+      query.append(vocabulary[word(rng) % FLAGS_vocabulary]);
+    }
+    int k = limit(rng);
+    SearchEngine::Results fast(k, 1 << 30);
+    SearchEngine::Results full(k, 1 << 30);
+    int fast_total = pruned.Search(query, &fast);
+    int full_total = baseline.Search(query, &full);
+
+    CHECK(!full.estimated());
+    CHECK_EQ(fast.hits().size(), full.hits().size()) << query;
+    for (int i = 0; i < full.hits().size(); ++i) {
+      CHECK_EQ(fast.hits()[i].score, full.hits()[i].score)
+          << query << " hit " << i;
+      CHECK_LE(fast.hits()[i].score,
+               SearchIndex::ScoreBound(fast.hits()[i].document->score(),
+                                       fast.hits()[i].document->tokens(),
+                                       fast.hits()[i].document->num_tokens()));
+    }
+    if (fast.estimated()) {
+      estimated++;
+    } else {
+      CHECK_EQ(fast_total, full_total) << query;
+    }
+  }
+
+  // Some of the queries should have been pruned.
+  CHECK_GT(estimated, 0);
+  LOG(INFO) << estimated << " of " << FLAGS_queries << " queries pruned";
+}
+
+int main(int argc, char *argv[]) {
+  InitProgram(&argc, &argv);
+  rng.seed(FLAGS_seed);
+
+  // Compressed posting lists with full and partial blocks and with deltas
+  // from one bit up to full 32-bit deltas.
+  for (int n : {1, 2, 127, 128, 129, 1000, 4096}) {
+    for (uint32 maxgap : {1u, 2u, 100u, 100000u, 0x7FFFFFFFu / 4096}) {
+      TestRoundTrip(n, maxgap, false);
+      TestRoundTrip(n, maxgap, true);
+    }
+  }
+  DocIds wide = {0, 0xFFFFFFF0, 0xFFFFFFFF};
+  string buffer;
+  DocIds decoded;
+  CompressTerm(wide, nullptr, &buffer)->Decode(&decoded);
+  CHECK(decoded == wide);
+  LOG(INFO) << "Round-trip test passed";
+
+  // Balanced lists use merge intersection and skewed lists use galloping.
+  TestIntersect(0, 10, 100, 10);
+  TestIntersect(1, 10, 1, 10);
+  TestIntersect(3, 2, 5, 2);
+  TestIntersect(1000, 3, 1000, 3);
+  TestIntersect(1000, 2, 2000, 1);
+  TestIntersect(10, 1000, 10000, 2);
+  TestIntersect(5, 50000, 100000, 3);
+  TestIntersect(500, 5, 50000, 2);
+  LOG(INFO) << "Intersection test passed";
+
+  TestPruning();
+  LOG(INFO) << "Pruning test passed";
+
+  LOG(INFO) << "Search index test passed";
+  return 0;
+}
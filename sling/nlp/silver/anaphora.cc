@@ -89,7 +89,7 @@ class AnaphoraAnnotator : public Annotator {
     int t = 0;
     while (t < document->length()) {
       // Increment current sentence number on begining of new sentence.
-      const Token &token = document->token(t);
+      Token token = document->token(t);
       BreakType brk = token.brk();
       if (t > 0 && brk >= SENTENCE_BREAK) {
         sentence++;
@@ -98,7 +98,7 @@ class SpanChart {
   }
 
   // Return token for chart item. The index is relative to the chart.
-  const Token &token(int index) const {
+  Token token(int index) const {
     return document_->token(index + begin_);
   }
 
@@ -76,7 +76,7 @@ class VocabularyMapper : public DocumentProcessor {
     // Collect fingerprints for all the words in the document.
     std::unordered_set<uint64> fingerprints;
     int paragraph = 0;
-    for (const Token &token : document.tokens()) {
+    for (Token token : document.tokens()) {
       // Skip first paragraph if requested.
       if (token.brk() >= PARAGRAPH_BREAK) paragraph++;
       if (skip_intro_ && paragraph == 0) continue;
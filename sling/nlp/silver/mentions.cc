@@ -159,13 +159,14 @@ void CommonWordPruner::Annotate(const IDFTable &dictionary, SpanChart *chart) {
     // Get chart item for single token.
     auto &item = chart->item(t);
     if (item.matches == nullptr) continue;
-    const Token &token = chart->token(t);
+    Token token = chart->token(t);
 
     // Keep predicates.
     if (item.is(SPAN_PREDICATE)) continue;
 
     // Check case form.
-    CaseForm form =  UTF8::Case(token.word());
+    Text word = token.word();
+    CaseForm form =  UTF8::Case(word.data(), word.size());
     bool common = (form == CASE_LOWER);
     if (token.initial() && form == CASE_TITLE) common = true;
 
@@ -400,11 +401,11 @@ int SpanTaxonomy::Classify(const Frame &item) {
   return f->second;
 }
 
-std::unordered_set<string> PersonNameAnnotator::particles = {
+std::unordered_set<Text> PersonNameAnnotator::particles = {
   "de", "du", "di", "dos", "von", "van", "bin", "ibn",
 };
 
-std::unordered_set<string> PersonNameAnnotator::blacklist = {
+std::unordered_set<Text> PersonNameAnnotator::blacklist = {
   "General", "Sir",
 };
 
@@ -412,12 +413,12 @@ void PersonNameAnnotator::Annotate(SpanChart *chart) {
   // Mark initials and dashes.
   int size = chart->size();
   for (int i = 0; i < size; ++i) {
-    const Token &token = chart->token(i);
-    const string &word = token.word();
-    if (UTF8::IsInitials(word)) {
+    Token token = chart->token(i);
+    Text word = token.word();
+    if (UTF8::IsInitials(word.data(), word.size())) {
       chart->item(i).flags |= SPAN_INITIALS;
     }
-    if (UTF8::IsDash(word) && token.brk() == NO_BREAK) {
+    if (UTF8::IsDash(word.data(), word.size()) && token.brk() == NO_BREAK) {
       chart->item(i).flags |= SPAN_DASH;
     }
   }
@@ -553,7 +554,7 @@ void NumberAnnotator::Annotate(SpanChart *chart) {
   Format format = (lang == n_english_ ? IMPERIAL : STANDARD);
 
   for (int t = chart->begin(); t < chart->end(); ++t) {
-    const string &word = document->token(t).word();
+    Text word = document->token(t).word();
 
     // Check if token contains digits.
     bool has_digits = false;
@@ -855,7 +856,8 @@ void MeasureAnnotator::Annotate(const PhraseTable *aliases, SpanChart *chart) {
 
       // Find number to the left.
       int left_end = b;
-      if (left_end > 0 && UTF8::IsDash(chart->token(left_end - 1).word())) {
+      Text dash = left_end > 0 ? chart->token(left_end - 1).word() : Text();
+      if (left_end > 0 && UTF8::IsDash(dash.data(), dash.size())) {
         // Allow dash between number and unit.
         left_end--;
       }
@@ -976,7 +978,7 @@ int DateAnnotator::GetYear(const PhraseTable *aliases,
                            int pos, int *end) {
   // Skip date delimiters.
   if (pos == chart->size()) return 0;
-  const string &word = chart->token(pos).word();
+  Text word = chart->token(pos).word();
   if (word == "," || word == "de" || word == "del") pos++;
 
   // Try to find year annotation at position.
@@ -1122,7 +1124,7 @@ void AbbreviationAnnotator::Annotate(SpanChart *chart,
     if (chart->token(b + 3).word() != ")") continue;
 
     // Get letters in abbreviation.
-    const string &abbreviation = chart->token(b + 2).word();
+    Text abbreviation = chart->token(b + 2).word();
     std::vector<int> letters = Letters(abbreviation);
     if (letters.size() < 2) continue;
 
@@ -1130,8 +1132,8 @@ void AbbreviationAnnotator::Annotate(SpanChart *chart,
     int l = letters.size() - 1;
     int i = b;
     while (l >= 0 && i >= 0) {
-      const Token &t = chart->token(i);
-      const string &word = t.word();
+      Token t = chart->token(i);
+      Text word = t.word();
       int letter = letters[l];
 
       // Try to match first letter.
@@ -29,6 +29,7 @@
 #include "sling/nlp/kb/resolver.h"
 #include "sling/nlp/silver/chart.h"
 #include "sling/nlp/silver/idf.h"
+#include "sling/string/text.h"
 
 namespace sling {
 namespace nlp {
@@ -227,10 +228,10 @@ class PersonNameAnnotator {
   }
 
   // Notability particles.
-  static std::unordered_set<string> particles;
+  static std::unordered_set<Text> particles;
 
   // Blacklisted names.
-  static std::unordered_set<string> blacklist;
+  static std::unordered_set<Text> blacklist;
 };
 
 // Score annotated spans based on case patterns. Adds a penalty if a span starts
@@ -18,14 +18,12 @@
 #include "sling/base/logging.h"
 #include "sling/base/types.h"
 #include "sling/frame/encoder.h"
+#include "sling/frame/json-reader.h"
 #include "sling/frame/object.h"
-#include "sling/frame/reader.h"
 #include "sling/frame/serialization.h"
 #include "sling/frame/store.h"
 #include "sling/nlp/wiki/wiki.h"
 #include "sling/nlp/wiki/wikidata-converter.h"
-#include "sling/stream/input.h"
-#include "sling/stream/memory.h"
 #include "sling/string/strcat.h"
 #include "sling/string/numbers.h"
 #include "sling/string/text.h"
@@ -42,6 +40,7 @@ class WikidataImporter : public task::Processor {
  public:
   ~WikidataImporter() override {
     delete converter_;
+    delete pool_;
     delete commons_;
   }
 
@@ -70,6 +69,7 @@ class WikidataImporter : public task::Processor {
 
     names_.Bind(commons_);
     commons_->Freeze();
+    pool_ = new StorePool(commons_);
   }
 
   // Convert Wikidata item from JSON to SLING.
@@ -81,12 +81,10 @@ class WikidataImporter : public task::Processor {
     }
 
     // Read Wikidata item in JSON format into local SLING store.
-    Store store(commons_);
-    ArrayInputStream stream(message->value());
-    Input input(&stream);
-    Reader reader(&store, &input);
-    reader.set_json(true);
-    Object obj = reader.Read();
+    PooledStore local(pool_);
+    Store *store = local.store();
+    JSONReader reader(store);
+    Object obj = reader.Read(message->value());
     CHECK(obj.valid());
     CHECK(obj.IsFrame()) << message->value();
     delete message;
@@ -101,7 +99,7 @@ class WikidataImporter : public task::Processor {
     UpdateRevision(revision, profile.Id().str());
 
     // Coalesce strings.
-    store.CoalesceStrings(string_buckets_);
+    store->CoalesceStrings(string_buckets_);
 
     // Output property or item.
     if (is_lexeme) {
@@ -133,6 +131,8 @@ class WikidataImporter : public task::Processor {
     // Clean up.
     delete converter_;
     converter_ = nullptr;
+    delete pool_;
+    pool_ = nullptr;
     delete commons_;
     commons_ = nullptr;
   }
@@ -154,6 +154,9 @@ class WikidataImporter : public task::Processor {
   // Commons store.
   Store *commons_ = nullptr;
 
+  // Pool of local stores for items.
+  StorePool *pool_ = nullptr;
+
   // Wikidata converter.
   WikidataConverter *converter_ = nullptr;
 
@@ -182,6 +185,10 @@ REGISTER_TASK_PROCESSOR("wikidata-importer", WikidataImporter);
 // Split Wikidata frames into items, properties, and redirects.
 class WikidataSplitter : public task::Processor {
  public:
+  ~WikidataSplitter() override {
+    delete pool_;
+  }
+
   // Initialize Wikidata splitter.
   void Start(task::Task *task) override {
     // Get output channels.
@@ -200,13 +207,14 @@ class WikidataSplitter : public task::Processor {
     // Bind symbols.
     CHECK(names_.Bind(&commons_));
     commons_.Freeze();
+    pool_ = new StorePool(&commons_);
   }
 
   // Split Wikidata frames.
   void Receive(task::Channel *channel, task::Message *message) override {
     // Decode frame from message.
-    Store store(&commons_);
-    Frame frame = DecodeMessage(&store, message);
+    PooledStore local(pool_);
+    Frame frame = DecodeMessage(local.store(), message);
     CHECK(frame.valid());
 
     // Output frame to appropriate channel.
@@ -246,6 +254,9 @@ class WikidataSplitter : public task::Processor {
   Store commons_;
   Names names_;
   Name n_property_{names_, "/w/property"};
+
+  // Pool of local stores for decoding frames.
+  StorePool *pool_ = nullptr;
 };
 
 REGISTER_TASK_PROCESSOR("wikidata-splitter", WikidataSplitter);
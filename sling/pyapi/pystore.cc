@@ -132,7 +132,8 @@ PyObject *PyStore::Load(PyObject *args, PyObject *kw) {
   // Read frames from file.
   if (snapshot && store->Pristine() && Snapshot::Valid(filename)) {
     // Load store from snapshot.
-    Status st = Snapshot::Read(store, filename);
+    Status st = Snapshot::Map(store, filename);
+    if (!st.ok()) st = Snapshot::Read(store, filename);
     if (!st.ok()) {
       PyErr_SetString(PyExc_IOError, st.message());
       return nullptr;
@@ -64,6 +64,16 @@ class Input {
     }
   }
 
+  // Returns the data in the input buffer without consuming it, reading more
+  // data from the input stream if the buffer is empty. The data can be
+  // consumed with Skip(). Returns false at the end of the input.
+  bool PeekBuffer(const char **data, int *size) {
+    if (empty() && !Fill()) return false;
+    *data = current_;
+    *size = limit_ - current_;
+    return true;
+  }
+
   // Reads 'size' bytes from input and append them to the string.
   bool ReadString(int size, string *output);
 
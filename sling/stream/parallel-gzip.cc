@@ -0,0 +1,482 @@
+// Copyright 2025 Ringgaard Research ApS
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "sling/stream/parallel-gzip.h"
+
+#include <string.h>
+#include <algorithm>
+
+#include "sling/base/logging.h"
+
+namespace sling {
+
+// Number of compressed bytes after a candidate member start needed for
+// verifying the member header.
+static const int kProbeInput = 1 << 16;
+
+// Number of decompressed bytes needed for accepting a member boundary.
+static const int kProbeOutput = 1 << 15;
+
+// Maximum number of bytes returned by Next().
+static const size_t kMaxChunk = 1 << 30;
+
+// Number of segments buffered without finding a member boundary before
+// falling back to sequential decompression.
+static const int kStreamingSegments = 4;
+
+ParallelGZipDecompressor::ParallelGZipDecompressor(InputStream *source,
+                                                   int num_workers,
+                                                   bool ordered,
+                                                   int segment_size)
+    : source_(source),
+      num_workers_(num_workers),
+      ordered_(ordered),
+      segment_size_(segment_size),
+      splitter_([this]() { Split(); }) {
+  CHECK_GT(num_workers, 0);
+  max_in_flight_ = 2 * num_workers + 1;
+  memset(&probe_, 0, sizeof(probe_));
+  CHECK(inflateInit2(&probe_, 15 + 16) == Z_OK);
+  probe_buffer_ = new char[kProbeOutput];
+
+  // Start splitter and decompression workers.
+  splitter_.SetJoinable(true);
+  splitter_.Start();
+  workers_.Start(num_workers, [this](int index) { Work(); });
+}
+
+ParallelGZipDecompressor::~ParallelGZipDecompressor() {
+  // Stop splitter and wait for workers to finish.
+  {
+    std::unique_lock<std::mutex> lock(mu_);
+    stop_ = true;
+    space_.notify_all();
+  }
+  splitter_.Join();
+  workers_.Join();
+
+  // Free segments.
+  delete current_;
+  for (auto &it : ready_) delete it.second;
+  CHECK(inflateEnd(&probe_) == Z_OK);
+  delete [] probe_buffer_;
+}
+
+bool ParallelGZipDecompressor::Next(const void **data, int *size) {
+  // Get next segment when the current segment has been consumed.
+  while (current_ == nullptr || position_ == current_->data.size()) {
+    if (!NextSegment()) return false;
+  }
+
+  // Return remaining data in current segment.
+  size_t n = std::min(current_->data.size() - position_, kMaxChunk);
+  *data = current_->data.data() + position_;
+  *size = n;
+  position_ += n;
+  total_bytes_ += n;
+  return true;
+}
+
+void ParallelGZipDecompressor::BackUp(int count) {
+  CHECK(current_ != nullptr);
+  CHECK_LE(static_cast<size_t>(count), position_);
+  position_ -= count;
+  total_bytes_ -= count;
+}
+
+bool ParallelGZipDecompressor::Skip(int count) {
+  while (count > 0) {
+    const void *chunk;
+    int bytes;
+    if (!Next(&chunk, &bytes)) return false;
+    if (count >= bytes) {
+      count -= bytes;
+    } else {
+      BackUp(bytes - count);
+      count = 0;
+    }
+  }
+  return true;
+}
+
+int64 ParallelGZipDecompressor::ByteCount() const {
+  return total_bytes_;
+}
+
+bool ParallelGZipDecompressor::NextSegment() {
+  delete current_;
+  current_ = nullptr;
+  position_ = 0;
+
+  // Wait until the next segment has been decompressed.
+  std::unique_lock<std::mutex> lock(mu_);
+  for (;;) {
+    Segment *segment = Pick();
+    if (segment != nullptr) {
+      Take(segment);
+      if (segment->status == TRUNCATED) Merge(segment, &lock);
+      current_ = segment;
+      return true;
+    }
+    if (num_segments_ != -1 && consumed_ == num_segments_) return false;
+    ready_signal_.wait(lock);
+  }
+}
+
+ParallelGZipDecompressor::Segment *ParallelGZipDecompressor::Pick() {
+  for (auto &it : ready_) {
+    Segment *segment = it.second;
+    if (ordered_ && segment->seqno != low_) break;
+    if (segment->status == COMPLETE) return segment;
+
+    // A segment that could not be decompressed on its own is normally the
+    // continuation of a truncated member in the preceding segment, and it is
+    // merged into that segment. Once the preceding segment has been consumed,
+    // it is either the start of a truncated member that continues in the next
+    // segment, or the input is corrupt.
+    if (segment->seqno == 0 || Consumed(segment->seqno - 1)) {
+      CHECK(segment->status != FAILED)
+          << "GZIP input error: " << segment->error;
+      return segment;
+    }
+  }
+  return nullptr;
+}
+
+void ParallelGZipDecompressor::Take(Segment *segment) {
+  ready_.erase(segment->seqno);
+  done_.insert(segment->seqno);
+  while (done_.erase(low_) > 0) low_++;
+  consumed_++;
+  in_flight_--;
+  space_.notify_one();
+}
+
+void ParallelGZipDecompressor::Merge(Segment *segment,
+                                     std::unique_lock<std::mutex> *lock) {
+  // The splitter has cut the input at a false member boundary, e.g. a GZIP
+  // file stored inside a member. Append the compressed data for the following
+  // segments and decompress the combined segment until the last member is
+  // complete.
+  int64 seqno = segment->seqno;
+  while (segment->status == TRUNCATED) {
+    seqno++;
+    auto it = ready_.find(seqno);
+    while (it == ready_.end()) {
+      CHECK(!Consumed(seqno)) << "GZIP member truncated at segment boundary";
+      ready_signal_.wait(*lock);
+      it = ready_.find(seqno);
+    }
+    Segment *next = it->second;
+    CHECK(next->status != COMPLETE)
+        << "GZIP member truncated at segment boundary";
+    Take(next);
+    segment->compressed.append(next->compressed);
+    segment->last = next->last;
+    delete next;
+
+    lock->unlock();
+    Decompress(segment);
+    lock->lock();
+    CHECK(segment->status != FAILED) << "GZIP input error: " << segment->error;
+  }
+}
+
+void ParallelGZipDecompressor::Split() {
+  // Input is buffered until a segment boundary is found. Segments are split
+  // off by advancing the start of the unconsumed input, and the consumed input
+  // is only removed when it is larger than the rest of the buffer, so each
+  // input byte is moved a bounded number of times.
+  string buffer;
+  size_t start = 0;
+  size_t scan = 0;
+  int64 seqno = 0;
+  bool eof = false;
+  bool stopped = false;
+  while (!eof && !stopped) {
+    // Read next chunk from source.
+    const void *chunk;
+    int bytes;
+    if (source_->Next(&chunk, &bytes)) {
+      if (start > 0 && start >= buffer.size() - start) {
+        buffer.erase(0, start);
+        start = 0;
+      }
+      buffer.append(static_cast<const char *>(chunk), bytes);
+    } else {
+      eof = true;
+    }
+
+    // Split off segments ending at member boundaries.
+    size_t boundary;
+    while ((boundary = FindBoundary(buffer.data() + start,
+                                    buffer.size() - start,
+                                    &scan, eof)) > 0) {
+      Segment *segment = new Segment();
+      segment->seqno = seqno++;
+      segment->last = false;
+      segment->compressed.assign(buffer, start, boundary);
+      start += boundary;
+      scan = 0;
+      if (!Dispatch(segment)) {
+        stopped = true;
+        break;
+      }
+    }
+
+    // Decompress the rest of the input sequentially if no member boundary has
+    // been found for a while, so the buffer does not grow without bounds.
+    if (!eof && !stopped &&
+        buffer.size() - start > kStreamingSegments * segment_size_) {
+      VLOG(1) << "No GZIP member boundary found, decompressing sequentially";
+      buffer.erase(0, start);
+      stopped = !Stream(&buffer, &seqno);
+      break;
+    }
+
+    // Add remaining input as the last segment.
+    if (eof && !stopped && buffer.size() > start) {
+      Segment *segment = new Segment();
+      segment->seqno = seqno++;
+      segment->last = true;
+      buffer.erase(0, start);
+      segment->compressed.swap(buffer);
+      Dispatch(segment);
+    }
+  }
+
+  // Signal end of input to consumer and workers.
+  {
+    std::unique_lock<std::mutex> lock(mu_);
+    num_segments_ = seqno;
+    ready_signal_.notify_all();
+  }
+  for (int i = 0; i < num_workers_; ++i) work_.put(nullptr);
+}
+
+size_t ParallelGZipDecompressor::FindBoundary(const char *data,
+                                              size_t size,
+                                              size_t *scan,
+                                              bool eof) {
+  // Only split when the segment has reached its minimum size and there is
+  // enough input after the candidate boundary for verifying it.
+  if (size <= segment_size_) return 0;
+  size_t end = size;
+  if (!eof) {
+    if (end < kProbeInput) return 0;
+    end -= kProbeInput;
+  }
+
+  // Search for GZIP header.
+  size_t pos = std::max(*scan, segment_size_);
+  while (pos < end) {
+    const char *p = static_cast<const char *>(
+        memchr(data + pos, 0x1f, end - pos));
+    if (p == nullptr) break;
+    pos = p - data;
+    if (IsMemberStart(p, size - pos)) return pos;
+    pos++;
+  }
+  *scan = std::max(end, segment_size_);
+  return 0;
+}
+
+bool ParallelGZipDecompressor::IsMemberStart(const char *data, size_t size) {
+  // Check GZIP magic number, deflate compression method, and reserved flags.
+  const uint8 *header = reinterpret_cast<const uint8 *>(data);
+  if (size < 18) return false;
+  if (header[1] != 0x8b || header[2] != 8 || (header[3] & 0xe0) != 0) {
+    return false;
+  }
+
+  // Decompress the beginning of the member. Random data matching the header
+  // almost always fails with an invalid block type, code, or distance.
+  // The candidate is only accepted if the member ends or the probe buffer is
+  // filled, so a short run of valid-looking data is not enough.
+  CHECK(inflateReset(&probe_) == Z_OK);
+  probe_.next_in = const_cast<Bytef *>(header);
+  probe_.avail_in = std::min<size_t>(size, kProbeInput);
+  probe_.next_out = reinterpret_cast<Bytef *>(probe_buffer_);
+  probe_.avail_out = kProbeOutput;
+  int rc = inflate(&probe_, Z_NO_FLUSH);
+  if (rc == Z_STREAM_END) return true;
+  return rc == Z_OK && probe_.avail_out == 0;
+}
+
+bool ParallelGZipDecompressor::Stream(string *buffer, int64 *seqno) {
+  z_stream stream;
+  memset(&stream, 0, sizeof(stream));
+  CHECK(inflateInit2(&stream, 15 + 16) == Z_OK);
+  stream.next_in = reinterpret_cast<Bytef *>(&(*buffer)[0]);
+  stream.avail_in = buffer->size();
+
+  // Decompress input into output segments of the segment size.
+  Segment *segment = nullptr;
+  size_t used = 0;
+  bool eof = false;
+  bool member_end = false;
+  bool stopped = false;
+  for (;;) {
+    // Read more input from source when the buffered input has been consumed.
+    if (stream.avail_in == 0) {
+      const void *chunk;
+      int bytes;
+      if (!eof && source_->Next(&chunk, &bytes)) {
+        stream.next_in = static_cast<Bytef *>(const_cast<void *>(chunk));
+        stream.avail_in = bytes;
+        continue;
+      }
+      eof = true;
+      if (!member_end) LOG(WARNING) << "GZIP input truncated";
+      break;
+    }
+
+    // Start decompressing next member.
+    if (member_end) {
+      CHECK(inflateReset(&stream) == Z_OK);
+      member_end = false;
+    }
+
+    // Allocate new output segment.
+    if (segment == nullptr) {
+      segment = new Segment();
+      segment->seqno = (*seqno)++;
+      segment->last = false;
+      segment->status = COMPLETE;
+      segment->data.resize(segment_size_);
+      used = 0;
+    }
+
+    // Decompress input into output segment.
+    string &output = segment->data;
+    stream.next_out = reinterpret_cast<Bytef *>(&output[used]);
+    stream.avail_out = output.size() - used;
+    int rc = inflate(&stream, Z_NO_FLUSH);
+    used = reinterpret_cast<char *>(stream.next_out) - &output[0];
+    if (rc == Z_STREAM_END) {
+      member_end = true;
+    } else {
+      CHECK(rc == Z_OK || rc == Z_BUF_ERROR)
+          << "GZIP input error " << rc << ": " << stream.msg;
+    }
+
+    // Output segment when it is full.
+    if (used == output.size()) {
+      bool ok = Dispatch(segment, true);
+      segment = nullptr;
+      if (!ok) {
+        stopped = true;
+        break;
+      }
+    }
+  }
+  CHECK(inflateEnd(&stream) == Z_OK);
+  string().swap(*buffer);
+
+  // Output final segment.
+  if (segment != nullptr) {
+    if (stopped) {
+      delete segment;
+    } else {
+      segment->data.resize(used);
+      stopped = !Dispatch(segment, true);
+    }
+  }
+  return !stopped;
+}
+
+bool ParallelGZipDecompressor::Dispatch(Segment *segment, bool decompressed) {
+  // Wait for room in the decompression pipeline.
+  {
+    std::unique_lock<std::mutex> lock(mu_);
+    while (!stop_ && in_flight_ >= max_in_flight_) space_.wait(lock);
+    if (stop_) {
+      delete segment;
+      return false;
+    }
+    in_flight_++;
+
+    // Decompressed segments are ready for output right away.
+    if (decompressed) {
+      ready_[segment->seqno] = segment;
+      ready_signal_.notify_all();
+      return true;
+    }
+  }
+  work_.put(segment);
+  return true;
+}
+
+void ParallelGZipDecompressor::Work() {
+  for (;;) {
+    Segment *segment = work_.get();
+    if (segment == nullptr) break;
+    Decompress(segment);
+
+    std::unique_lock<std::mutex> lock(mu_);
+    ready_[segment->seqno] = segment;
+    ready_signal_.notify_all();
+  }
+}
+
+void ParallelGZipDecompressor::Decompress(Segment *segment) {
+  z_stream stream;
+  memset(&stream, 0, sizeof(stream));
+  CHECK(inflateInit2(&stream, 15 + 16) == Z_OK);
+  stream.next_in = reinterpret_cast<Bytef *>(&segment->compressed[0]);
+  stream.avail_in = segment->compressed.size();
+
+  // Decompress all members in segment, growing the output buffer as needed.
+  string &output = segment->data;
+  output.resize(std::max<size_t>(segment->compressed.size() * 4, 1 << 16));
+  size_t used = 0;
+  segment->status = COMPLETE;
+  for (;;) {
+    if (used == output.size()) output.resize(output.size() * 2);
+    stream.next_out = reinterpret_cast<Bytef *>(&output[used]);
+    stream.avail_out = std::min<size_t>(output.size() - used, 1 << 30);
+    int rc = inflate(&stream, Z_NO_FLUSH);
+    used = reinterpret_cast<char *>(stream.next_out) - &output[0];
+    if (rc == Z_STREAM_END) {
+      // Start decompressing next member.
+      if (stream.avail_in == 0) break;
+      CHECK(inflateReset(&stream) == Z_OK);
+    } else if (rc == Z_BUF_ERROR && stream.avail_in == 0) {
+      // Truncated member. At the end of the input, the partial member is
+      // returned. Otherwise, the member continues in the next segment.
+      if (segment->last) {
+        LOG(WARNING) << "GZIP input truncated";
+      } else {
+        segment->status = TRUNCATED;
+      }
+      break;
+    } else if (rc != Z_OK) {
+      segment->status = FAILED;
+      segment->error = stream.msg != nullptr ? stream.msg : "unknown error";
+      break;
+    }
+  }
+  CHECK(inflateEnd(&stream) == Z_OK);
+
+  // Keep the compressed data for merging if the segment could not be
+  // decompressed on its own.
+  if (segment->status == COMPLETE) {
+    output.resize(used);
+    string().swap(segment->compressed);
+  } else {
+    string().swap(output);
+  }
+}
+
+}  // namespace sling
@@ -0,0 +1,187 @@
+// Copyright 2025 Ringgaard Research ApS
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SLING_STREAM_PARALLEL_GZIP_H_
+#define SLING_STREAM_PARALLEL_GZIP_H_
+
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <set>
+#include <string>
+
+#include "sling/base/types.h"
+#include "sling/stream/stream.h"
+#include "sling/util/queue.h"
+#include "sling/util/thread.h"
+#include "third_party/zlib/zlib.h"
+
+namespace sling {
+
+// Parallel decompression of multi-member GZIP streams. A splitter thread reads
+// the compressed input and cuts it into segments at GZIP member boundaries.
+// The segments are decompressed independently by a pool of worker threads and
+// the decompressed segments are returned either in input order or in the
+// order they are completed. Unordered output is only meaningful when records
+// never span members, e.g. WARC files where each record is a separate member.
+//
+// Member boundaries cannot be located without decompressing, so the splitter
+// looks for GZIP headers and verifies each candidate by decompressing a prefix
+// of the member. If a segment still turns out to end with a truncated member,
+// i.e. it was split at a false boundary, it is merged with the following
+// segments. If no member boundary is found within a few segments, e.g. for a
+// stream with a single member, the splitter falls back to decompressing the
+// rest of the input sequentially.
+class ParallelGZipDecompressor : public InputStream {
+ public:
+  // Initialize decompressor and start splitter and worker threads.
+  ParallelGZipDecompressor(InputStream *source,
+                           int num_workers,
+                           bool ordered = true,
+                           int segment_size = 1 << 22);
+  ~ParallelGZipDecompressor() override;
+
+  // Implementation of InputStream interface.
+  bool Next(const void **data, int *size) override;
+  void BackUp(int count) override;
+  bool Skip(int count) override;
+  int64 ByteCount() const override;
+
+ private:
+  // Result of decompressing a segment.
+  enum Status {
+    COMPLETE,   // all members in segment decompressed
+    TRUNCATED,  // last member continues in the next segment
+    FAILED,     // segment does not start at a valid member
+  };
+
+  // Segment of compressed input starting at a member boundary. The compressed
+  // data is kept if the segment could not be decompressed on its own.
+  struct Segment {
+    int64 seqno;         // segment number in input
+    bool last;           // last segment in input
+    Status status;       // decompression status
+    string error;        // decompression error message
+    string compressed;   // compressed input data
+    string data;         // decompressed data
+  };
+
+  // Split input into segments and queue them for decompression.
+  void Split();
+
+  // Find next segment boundary in input, starting the search at *scan.
+  // Returns 0 if no boundary was found.
+  size_t FindBoundary(const char *data, size_t size, size_t *scan, bool eof);
+
+  // Check if there is a valid GZIP member starting at data.
+  bool IsMemberStart(const char *data, size_t size);
+
+  // Decompress the buffered input and the rest of the source sequentially in
+  // the splitter thread. Returns false if decompressor is stopped.
+  bool Stream(string *buffer, int64 *seqno);
+
+  // Queue segment for decompression, or queue it for output if it has already
+  // been decompressed. Returns false if decompressor is stopped.
+  bool Dispatch(Segment *segment, bool decompressed = false);
+
+  // Decompress segments from the work queue.
+  void Work();
+
+  // Decompress all the members in segment.
+  static void Decompress(Segment *segment);
+
+  // Get next decompressed segment. Returns false when all segments have been
+  // consumed.
+  bool NextSegment();
+
+  // Find next segment that is ready to be consumed. Segments that could not be
+  // decompressed on their own are held back until the preceding segment has
+  // been consumed. Must be called with the lock held.
+  Segment *Pick();
+
+  // Remove segment from the ready queue. Must be called with the lock held.
+  void Take(Segment *segment);
+
+  // Check if segment has been consumed. Must be called with the lock held.
+  bool Consumed(int64 seqno) const {
+    return seqno < low_ || done_.count(seqno) > 0;
+  }
+
+  // Merge segment ending with a truncated member with the following segments
+  // until the last member is complete.
+  void Merge(Segment *segment, std::unique_lock<std::mutex> *lock);
+
+  // Source for compressed input.
+  InputStream *source_;
+
+  // Number of worker threads.
+  int num_workers_;
+
+  // Return segments in input order.
+  bool ordered_;
+
+  // Minimum size of compressed segments.
+  size_t segment_size_;
+
+  // Maximum number of segments being decompressed or waiting to be consumed.
+  int max_in_flight_;
+
+  // Decompressor for verifying member boundaries.
+  z_stream probe_;
+  char *probe_buffer_;
+
+  // Segments waiting for decompression.
+  Queue<Segment *> work_;
+
+  // Decompressed segments keyed by segment number.
+  std::map<int64, Segment *> ready_;
+
+  // Number of segments queued but not yet consumed.
+  int in_flight_ = 0;
+
+  // Total number of segments, or -1 until the splitter is done.
+  int64 num_segments_ = -1;
+
+  // All segments before the low-water mark have been consumed, as well as the
+  // segments in the done set. The low-water mark is the next segment to return
+  // in ordered mode.
+  int64 low_ = 0;
+  std::set<int64> done_;
+
+  // Number of segments consumed.
+  int64 consumed_ = 0;
+
+  // Flag to stop splitter thread.
+  bool stop_ = false;
+
+  // Current segment being consumed and position in segment.
+  Segment *current_ = nullptr;
+  size_t position_ = 0;
+
+  // Number of decompressed bytes returned.
+  int64 total_bytes_ = 0;
+
+  // Mutex and signals for segment queues.
+  std::mutex mu_;
+  std::condition_variable ready_signal_;
+  std::condition_variable space_;
+
+  // Splitter and decompression threads.
+  ClosureThread splitter_;
+  WorkerPool workers_;
+};
+
+}  // namespace sling
+
+#endif  // SLING_STREAM_PARALLEL_GZIP_H_
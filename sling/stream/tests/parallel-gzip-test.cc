@@ -0,0 +1,181 @@
+// Copyright 2025 Ringgaard Research ApS
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <string.h>
+#include <algorithm>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "sling/base/flags.h"
+#include "sling/base/init.h"
+#include "sling/base/logging.h"
+#include "sling/stream/memory.h"
+#include "sling/stream/parallel-gzip.h"
+#include "third_party/zlib/zlib.h"
+
+DEFINE_int32(workers, 4, "Number of decompression workers");
+DEFINE_int32(segment_size, 1 << 16, "Segment size for tests");
+
+using namespace sling;
+
+// Compress data into a GZIP member.
+static string Compress(const string &data, int level) {
+  z_stream stream;
+  memset(&stream, 0, sizeof(stream));
+  CHECK(deflateInit2(&stream, level, Z_DEFLATED, 15 + 16, 8,
+                     Z_DEFAULT_STRATEGY) == Z_OK);
+  string output(deflateBound(&stream, data.size()), 0);
+  stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data.data()));
+  stream.avail_in = data.size();
+  stream.next_out = reinterpret_cast<Bytef *>(&output[0]);
+  stream.avail_out = output.size();
+  CHECK(deflate(&stream, Z_FINISH) == Z_STREAM_END);
+  output.resize(stream.total_out);
+  CHECK(deflateEnd(&stream) == Z_OK);
+  return output;
+}
+
+// Generate text record with random words.
+static string Record(std::mt19937 *prng, int id, int size) {
+  static const char *kWords[] = {
+    "the", "quick", "brown", "fox", "jumps", "over", "lazy", "dog",
+    "lorem", "ipsum", "dolor", "sit", "amet", "archive", "record", "data",
+  };
+  std::uniform_int_distribution<int> word(0, 15);
+  std::uniform_int_distribution<int> number(0, 1000000);
+  string text = "<record " + std::to_string(id) + ">\n";
+  while (text.size() < size) {
+    text.append(kWords[word(*prng)]);
+    text.push_back(' ');
+    text.append(std::to_string(number(*prng)));
+    text.push_back(text.size() % 80 < 8 ? '\n' : ' ');
+  }
+  text.append("\n</record>\n");
+  return text;
+}
+
+// Decompress input with parallel decompressor.
+static string Decompress(const string &input, bool ordered) {
+  ArrayInputStream source(input.data(), input.size(), 1 << 14);
+  ParallelGZipDecompressor gzip(&source, FLAGS_workers, ordered,
+                                FLAGS_segment_size);
+  string output;
+  const void *data;
+  int size;
+  while (gzip.Next(&data, &size)) {
+    output.append(static_cast<const char *>(data), size);
+  }
+  CHECK_EQ(gzip.ByteCount(), output.size());
+  return output;
+}
+
+// Split output into sorted records for comparing unordered output.
+static std::vector<string> Records(const string &text) {
+  std::vector<string> records;
+  static const char kEnd[] = "</record>\n";
+  size_t start = 0;
+  while (start < text.size()) {
+    size_t end = text.find(kEnd, start);
+    CHECK(end != string::npos);
+    end += strlen(kEnd);
+    records.push_back(text.substr(start, end - start));
+    start = end;
+  }
+  std::sort(records.begin(), records.end());
+  return records;
+}
+
+// Check that the input decompresses to the expected output in both ordered and
+// unordered mode.
+static void Check(const string &input, const string &expected,
+                  const string &name) {
+  string ordered = Decompress(input, true);
+  CHECK(ordered == expected) << name << ": ordered output differs";
+
+  string unordered = Decompress(input, false);
+  CHECK_EQ(unordered.size(), expected.size()) << name;
+  CHECK(Records(unordered) == Records(expected))
+      << name << ": unordered output differs";
+
+  LOG(INFO) << name << ": " << input.size() << " compressed bytes, "
+            << expected.size() << " decompressed bytes";
+}
+
+// Input with many small members, which is split into many segments.
+static void TestMultiMember() {
+  std::mt19937 prng(314159);
+  string input;
+  string expected;
+  for (int i = 0; i < 300; ++i) {
+    string record = Record(&prng, i, 1000 + (i * 7919) % 30000);
+    input.append(Compress(record, 6));
+    expected.append(record);
+  }
+  Check(input, expected, "multi-member");
+}
+
+// Input with a single large member, which is decompressed sequentially.
+static void TestSingleMember() {
+  std::mt19937 prng(271828);
+  string expected;
+  for (int i = 0; i < 100; ++i) expected.append(Record(&prng, i, 20000));
+  string input = Compress(expected, 6);
+  CHECK_GT(input.size(), 4 * FLAGS_segment_size);
+  Check(input, expected, "single-member");
+
+  // Multiple members followed by a single large member.
+  string mixed;
+  string prefix = Record(&prng, 1000, 50000);
+  mixed.append(Compress(prefix, 6));
+  mixed.append(input);
+  Check(mixed, prefix + expected, "mixed");
+}
+
+// Input where a member contains complete GZIP files stored uncompressed, so
+// the splitter finds GZIP headers inside the member that pass verification.
+static void TestFalseMagic() {
+  std::mt19937 prng(161803);
+  string input;
+  string expected;
+  for (int i = 0; i < 20; ++i) {
+    string record = Record(&prng, i, 5000);
+    if (i % 5 == 2) {
+      // Embed small GZIP files in a large record and store it uncompressed.
+      string inner = Compress(Record(&prng, 1000 + i, 8000), 9);
+      string outer = Record(&prng, i, 4 * FLAGS_segment_size);
+      for (size_t pos = 1000; pos < outer.size(); pos += 8000) {
+        outer.insert(pos, inner);
+        pos += inner.size();
+      }
+      input.append(Compress(outer, 0));
+      expected.append(outer);
+    } else {
+      input.append(Compress(record, 6));
+      expected.append(record);
+    }
+  }
+  Check(input, expected, "false-magic");
+}
+
+int main(int argc, char *argv[]) {
+  InitProgram(&argc, &argv);
+
+  TestMultiMember();
+  TestSingleMember();
+  TestFalseMagic();
+
+  LOG(INFO) << "Parallel GZIP test passed";
+  return 0;
+}
@@ -48,6 +48,7 @@ void FrameProcessor::Start(Task *task) {
 
   // Freeze commons store.
   commons_->Freeze();
+  pool_ = new StorePool(commons_);
 
   // Update statistics for common store.
   MemoryUsage usage;
@@ -70,11 +71,12 @@ void FrameProcessor::Receive(Channel *channel, Message *message) {
   // Register task context.
   TaskContext ctxt("Frame", message);
 
-  // Create store for frame.
-  Store store(commons_);
+  // Get local store for frame from pool.
+  PooledStore local(pool_);
+  Store *store = local.store();
 
   // Decode frame from message.
-  Frame frame = DecodeMessage(&store, message);
+  Frame frame = DecodeMessage(store, message);
   CHECK(frame.valid());
 
   // Process frame.
@@ -82,7 +84,7 @@ void FrameProcessor::Receive(Channel *channel, Message *message) {
 
   // Update statistics.
   MemoryUsage usage;
-  store.GetMemoryUsage(&usage, true);
+  store->GetMemoryUsage(&usage, true);
   frame_memory_->Increment(usage.memory_used());
   frame_handles_->Increment(usage.used_handles());
   frame_symbols_->Increment(usage.num_symbols());
@@ -97,7 +99,9 @@ void FrameProcessor::Done(Task *task) {
   // Flush output.
   Flush(task);
 
-  // Delete commons store.
+  // Delete store pool and commons store.
+  delete pool_;
+  pool_ = nullptr;
   delete commons_;
   commons_ = nullptr;
 }
@@ -25,7 +25,10 @@ namespace task {
 // Task processor for receiving and sending frames.
 class FrameProcessor : public Processor {
  public:
-  ~FrameProcessor() override { delete commons_; }
+  ~FrameProcessor() override {
+    delete pool_;
+    delete commons_;
+  }
 
   // Task processor implementation.
   void Start(Task *task) override;
@@ -62,6 +65,9 @@ class FrameProcessor : public Processor {
   // Commons store for messages.
   Store *commons_ = nullptr;
 
+  // Pool of local stores for decoding messages.
+  StorePool *pool_ = nullptr;
+
   // Name bindings.
   Names names_;
 
@@ -12,17 +12,98 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <condition_variable>
+#include <deque>
+#include <mutex>
 #include <string>
+#include <vector>
 
 #include "sling/base/logging.h"
 #include "sling/file/recordio.h"
 #include "sling/task/process.h"
 #include "sling/task/task.h"
+#include "sling/util/thread.h"
 
 namespace sling {
 namespace task {
 
-// Read records from record file and output to channel.
+// Bounded queue with batches of decoded messages from the decoder thread.
+class MessageBatchQueue {
+ public:
+  typedef std::vector<Message *> Batch;
+
+  explicit MessageBatchQueue(int capacity) : capacity_(capacity) {}
+
+  ~MessageBatchQueue() {
+    for (Batch *batch : batches_) {
+      for (Message *message : *batch) delete message;
+      delete batch;
+    }
+  }
+
+  // Add batch to queue and wait if the queue is full. Returns false if the
+  // consumer has stopped reading from the queue.
+  bool Put(Batch *batch) {
+    std::unique_lock<std::mutex> lock(mu_);
+    while (!cancelled_ && batches_.size() >= capacity_) space_.wait(lock);
+    if (cancelled_) {
+      for (Message *message : *batch) delete message;
+      delete batch;
+      return false;
+    }
+    batches_.push_back(batch);
+    ready_.notify_one();
+    return true;
+  }
+
+  // Get next batch from queue. Returns null when there are no more batches.
+  // Sets the stalled flag if the consumer had to wait for the decoder.
+  Batch *Get(bool *stalled) {
+    std::unique_lock<std::mutex> lock(mu_);
+    *stalled = batches_.empty() && !closed_;
+    while (batches_.empty() && !closed_) ready_.wait(lock);
+    if (batches_.empty()) return nullptr;
+    Batch *batch = batches_.front();
+    batches_.pop_front();
+    space_.notify_one();
+    return batch;
+  }
+
+  // Signal that no more batches will be added.
+  void Close() {
+    std::unique_lock<std::mutex> lock(mu_);
+    closed_ = true;
+    ready_.notify_all();
+  }
+
+  // Signal that the consumer has stopped reading batches.
+  void Cancel() {
+    std::unique_lock<std::mutex> lock(mu_);
+    cancelled_ = true;
+    space_.notify_all();
+  }
+
+ private:
+  // Maximum number of batches in queue.
+  size_t capacity_;
+
+  // Queue of decoded message batches.
+  std::deque<Batch *> batches_;
+
+  // Producer and consumer state.
+  bool closed_ = false;
+  bool cancelled_ = false;
+
+  // Mutex and signals for queue.
+  std::mutex mu_;
+  std::condition_variable ready_;
+  std::condition_variable space_;
+};
+
+// Read records from record file and output to channel. If prefetching is
+// enabled, the input file is read by a background I/O thread, and the records
+// are decoded by a separate decoder thread, so reading, decompression, and
+// processing of the records overlap.
 class RecordFileReader : public Process {
  public:
   // Process input files.
@@ -39,11 +120,27 @@ class RecordFileReader : public Process {
 
     RecordFileOptions options;
     options.buffer_size = task->Get("buffer_size", options.buffer_size);
+    options.mmap = task->Get("mmap", options.mmap);
+    options.prefetch = task->Get("prefetch", options.prefetch);
 
     // Statistics counters.
     Counter *records_read = task->GetCounter("records_read");
     Counter *key_bytes_read = task->GetCounter("key_bytes_read");
     Counter *value_bytes_read = task->GetCounter("value_bytes_read");
+    Counter *prefetch_blocks = nullptr;
+    Counter *prefetch_queued_blocks = nullptr;
+    Counter *prefetch_max_queue_depth = nullptr;
+    Counter *prefetch_stalls = nullptr;
+    Counter *prefetch_stall_time = nullptr;
+    Counter *decoder_stalls = nullptr;
+    if (options.prefetch > 0) {
+      prefetch_blocks = task->GetCounter("prefetch_blocks");
+      prefetch_queued_blocks = task->GetCounter("prefetch_queued_blocks");
+      prefetch_max_queue_depth = task->GetCounter("prefetch_max_queue_depth");
+      prefetch_stalls = task->GetCounter("prefetch_stalls");
+      prefetch_stall_time = task->GetCounter("prefetch_stall_time");
+      decoder_stalls = task->GetCounter("decoder_stalls");
+    }
 
     // The "limit" parameter can be used to limit the number of records read.
     int64 limit = -1;
@@ -56,27 +153,93 @@ class RecordFileReader : public Process {
       RecordReader reader(input->resource()->name(), options);
       uint64 serial = input->resource()->serial();
 
-      // Read records from file and output to output channel.
-      Record record;
-      while (!reader.Done()) {
-        // Read record.
-        CHECK(reader.Read(&record))
-            << ", file: " << input->resource()->name()
-            << ", position: " << reader.Tell();
-
-        // Update stats.
-        records_read->Increment();
-        key_bytes_read->Increment(record.key.size());
-        value_bytes_read->Increment(record.value.size());
-
-        // Send message with record to output channel.
-        Message *message = new Message(record.key,
-                                       serial ? serial : record.version,
-                                       record.value);
-        output->Send(message);
-
-        // Check for early stopping.
-        if (limit != -1 && ++num_records >= limit) break;
+      if (options.prefetch > 0) {
+        // Decode records in decoder thread.
+        MessageBatchQueue queue(options.prefetch);
+        ClosureThread decoder([&]() {
+          auto *batch = new MessageBatchQueue::Batch();
+          Record record;
+          while (!reader.Done()) {
+            CHECK(reader.Read(&record))
+                << ", file: " << input->resource()->name()
+                << ", position: " << reader.Tell();
+            batch->push_back(new Message(record.key,
+                                         serial ? serial : record.version,
+                                         record.value));
+            if (batch->size() == kBatchSize) {
+              if (!queue.Put(batch)) return;
+              batch = new MessageBatchQueue::Batch();
+            }
+          }
+          queue.Put(batch);
+          queue.Close();
+        });
+        decoder.SetJoinable(true);
+        decoder.Start();
+
+        // Output decoded messages to output channel.
+        bool done = false;
+        bool stalled;
+        while (!done) {
+          MessageBatchQueue::Batch *batch = queue.Get(&stalled);
+          if (batch == nullptr) break;
+          if (stalled) decoder_stalls->Increment();
+          for (Message *message : *batch) {
+            if (done) {
+              delete message;
+              continue;
+            }
+
+            // Update stats.
+            records_read->Increment();
+            key_bytes_read->Increment(message->key().size());
+            value_bytes_read->Increment(message->value().size());
+
+            // Send message to output channel.
+            output->Send(message);
+
+            // Check for early stopping.
+            if (limit != -1 && ++num_records >= limit) done = true;
+          }
+          delete batch;
+        }
+        queue.Cancel();
+        decoder.Join();
+
+        // Update prefetch statistics. The number of queued blocks is summed
+        // over all block reads, so divided by the number of blocks it gives
+        // the average read-ahead queue depth.
+        const RecordReader::PrefetchStats &stats = reader.prefetch_stats();
+        prefetch_blocks->Increment(stats.blocks);
+        prefetch_queued_blocks->Increment(stats.queued);
+        if (stats.max_queued > prefetch_max_queue_depth->value()) {
+          prefetch_max_queue_depth->Set(stats.max_queued);
+        }
+        prefetch_stalls->Increment(stats.stalls);
+        prefetch_stall_time->Increment(stats.stall_time);
+      } else {
+        // Read records from file and output to output channel.
+        Record record;
+        while (!reader.Done()) {
+          // Read record.
+          CHECK(reader.Read(&record))
+              << ", file: " << input->resource()->name()
+              << ", position: " << reader.Tell();
+
+          // Update stats.
+          records_read->Increment();
+          key_bytes_read->Increment(record.key.size());
+          value_bytes_read->Increment(record.value.size());
+
+          // Send message with record to output channel.
+          Message *message = new Message(record.key,
+                                         serial ? serial : record.version,
+                                         record.value);
+          output->Send(message);
+
+          // Check for early stopping.
+          if (limit != -1 && ++num_records >= limit) break;
+        }
       }
 
       // Close reader.
@@ -86,10 +249,13 @@ class RecordFileReader : public Process {
     // Close output channel.
     output->Close();
   }
+
+ private:
+  // Number of messages in each decoded batch.
+  static const int kBatchSize = 256;
 };
 
 REGISTER_TASK_PROCESSOR("record-file-reader", RecordFileReader);
 
 }  // namespace task
 }  // namespace sling
-
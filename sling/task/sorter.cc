@@ -13,8 +13,9 @@
 // limitations under the License.
 
 #include <algorithm>
-#include <queue>
+#include <atomic>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "sling/base/logging.h"
@@ -23,45 +24,204 @@
 #include "sling/string/printf.h"
 #include "sling/task/task.h"
 #include "sling/util/mutex.h"
+#include "sling/util/threadpool.h"
 
 namespace sling {
 namespace task {
 
-// Element in the merge sort queue.
-struct MergeItem {
-  Record record;          // current record
-  RecordReader *reader;   // record reader for reading records from merge file
+// Message comparator.
+struct MessageComparator {
+  bool operator ()(const Message *a, const Message *b) const {
+    if (a->key() == b->key()) {
+      return a->serial() < b->serial();
+    } else {
+      return a->key() < b->key();
+    }
+  }
+};
+
+// Sorted run of messages for merging.
+class MergeInput {
+ public:
+  virtual ~MergeInput() = default;
+
+  // Key and serial for current message.
+  Slice key() const { return key_; }
+  uint64 serial() const { return serial_; }
+
+  // Check if all messages have been read from input.
+  bool done() const { return done_; }
+
+  // Advance to next message in input.
+  virtual void Next() = 0;
+
+  // Return current message. The caller takes ownership of the message.
+  virtual Message *Take() = 0;
+
+  // Write current message to merge file.
+  virtual void Write(RecordWriter *writer) = 0;
+
+ protected:
+  Slice key_;
+  uint64 serial_ = 0;
+  bool done_ = false;
 };
 
-// Comparator for elements in merge sort queue.
-struct ItemComparator {
-  bool operator ()(const MergeItem *a, const MergeItem *b) {
-    if (a->record.key == b->record.key) {
-      return a->record.version > b->record.version;
+// Sorted run of messages in memory.
+class MemoryInput : public MergeInput {
+ public:
+  // Take ownership of the sorted messages.
+  explicit MemoryInput(std::vector<Message *> *messages) {
+    messages_.swap(*messages);
+    pos_ = -1;
+    Next();
+  }
+
+  ~MemoryInput() override {
+    for (int i = pos_; i < messages_.size(); ++i) delete messages_[i];
+  }
+
+  void Next() override {
+    if (++pos_ < messages_.size()) {
+      key_ = messages_[pos_]->key();
+      serial_ = messages_[pos_]->serial();
     } else {
-      return a->record.key > b->record.key;
+      done_ = true;
     }
   }
+
+  Message *Take() override {
+    Message *message = messages_[pos_];
+    messages_[pos_] = nullptr;
+    return message;
+  }
+
+  void Write(RecordWriter *writer) override {
+    Message *message = messages_[pos_];
+    CHECK(writer->Write(message->key(), message->serial(), message->value()));
+  }
+
+ private:
+  std::vector<Message *> messages_;
+  int pos_;
 };
 
-// Message comparator.
-struct MessageComparator {
-  bool operator ()(const Message *a, const Message *b) const {
-    if (a->key() == b->key()) {
-      return a->serial() < b->serial();
+// Sorted run of messages in merge file.
+class FileInput : public MergeInput {
+ public:
+  explicit FileInput(const string &filename) : reader_(filename) {
+    Next();
+  }
+
+  ~FileInput() override {
+    CHECK(reader_.Close());
+  }
+
+  void Next() override {
+    if (reader_.Done()) {
+      done_ = true;
     } else {
-      return a->key() < b->key();
+      CHECK(reader_.Read(&record_));
+      key_ = record_.key;
+      serial_ = record_.version;
+    }
+  }
+
+  Message *Take() override {
+    return new Message(record_.key, record_.version, record_.value);
+  }
+
+  void Write(RecordWriter *writer) override {
+    CHECK(writer->Write(record_.key, record_.version, record_.value));
+  }
+
+ private:
+  RecordReader reader_;
+  Record record_;
+};
+
+// Loser tree for k-way merging of sorted inputs. Each internal node holds the
+// loser of the match between its subtrees, so replacing the winner only needs
+// log k comparisons along the path from its leaf to the root.
+class LoserTree {
+ public:
+  explicit LoserTree(const std::vector<MergeInput *> &inputs)
+      : inputs_(inputs), tree_(inputs.size()) {
+    // Play the initial tournament bottom-up.
+    int k = inputs_.size();
+    if (k == 0) return;
+    std::vector<int> winners(2 * k);
+    for (int i = 0; i < k; ++i) winners[k + i] = i;
+    for (int n = k - 1; n >= 1; --n) {
+      int left = winners[2 * n];
+      int right = winners[2 * n + 1];
+      if (Less(left, right)) {
+        winners[n] = left;
+        tree_[n] = right;
+      } else {
+        winners[n] = right;
+        tree_[n] = left;
+      }
+    }
+    winner_ = k == 1 ? 0 : winners[1];
+  }
+
+  // Return input with the smallest current message, or null if all inputs
+  // have been exhausted.
+  MergeInput *top() const {
+    if (inputs_.empty()) return nullptr;
+    MergeInput *input = inputs_[winner_];
+    return input->done() ? nullptr : input;
+  }
+
+  // Advance the winning input and replay the matches on the path to the root.
+  void Next() {
+    int w = winner_;
+    inputs_[w]->Next();
+    for (int n = (w + inputs_.size()) / 2; n >= 1; n /= 2) {
+      if (Less(tree_[n], w)) std::swap(tree_[n], w);
     }
+    winner_ = w;
   }
+
+ private:
+  // Check if input a has a smaller current message than input b. Exhausted
+  // inputs are larger than everything else, and ties are broken by input
+  // number to keep the merge stable.
+  bool Less(int a, int b) const {
+    const MergeInput *x = inputs_[a];
+    const MergeInput *y = inputs_[b];
+    if (x->done()) return false;
+    if (y->done()) return true;
+    int c = x->key().compare(y->key());
+    if (c != 0) return c < 0;
+    if (x->serial() != y->serial()) return x->serial() < y->serial();
+    return a < b;
+  }
+
+  std::vector<MergeInput *> inputs_;
+  std::vector<int> tree_;
+  int winner_ = 0;
 };
 
 // Sorts all the input messages by key and output these in sorted order on the
-// output channel.
+// output channel. Each input channel has its own sort buffer, and full buffers
+// are sorted and written to merge files by a pool of background threads, so
+// producers are only blocked when all the sort threads are busy. A sort buffer
+// is also handed over to the sort threads when the total size of the messages
+// in all the sort buffers exceeds the sort buffer size and the buffer has at
+// least the minimum run size, so merge files are never tiny. If there are
+// more merge files than the merge fan-in, groups of merge files are merged in
+// parallel into larger merge files before the final merge.
 class Sorter : public Processor {
  public:
   Sorter() {}
   ~Sorter() override {
-    for (auto *m : messages_) delete m;
+    for (auto *b : buffers_) {
+      for (auto *m : b->messages) delete m;
+      delete b;
+    }
+    delete pool_;
   }
 
   void Start(Task *task) override {
@@ -69,44 +229,102 @@ class Sorter : public Processor {
     output_ = task->GetSink("output");
     CHECK(output_ != nullptr) << "Output channel missing";
     task->Fetch("sort_buffer_size", &max_buffer_size_);
+    task->Fetch("sort_threads", &sort_threads_);
+    task->Fetch("merge_fanin", &merge_fanin_);
+    task->Fetch("min_run_size", &min_run_size_);
+    CHECK_GE(merge_fanin_, 2);
     num_merge_files_ = task->GetCounter("merge_files");
+    num_merge_passes_ = task->GetCounter("merge_passes");
+    sort_buffer_peak_ = task->GetCounter("sort_buffer_peak");
+
+    // Allocate a sort buffer for each input channel. The sort buffer size is
+    // split between the input buffers. Each buffer is allowed to grow to at
+    // least the minimum run size to avoid tiny merge files, so the total size
+    // of the buffers is bounded by the sort buffer size plus the minimum run
+    // size for each buffer.
+    for (Channel *channel : task->sources()) {
+      channels_[channel] = buffers_.size();
+      buffers_.push_back(new Buffer());
+    }
+    if (buffers_.empty()) buffers_.push_back(new Buffer());
+    run_size_ = std::max<int64>(max_buffer_size_ / buffers_.size(),
+                                min_run_size_);
+
+    // Start background threads for sorting and spilling sort buffers.
+    pool_ = new ThreadPool(sort_threads_, sort_threads_);
+    pool_->StartWorkers();
   }
 
   void Receive(Channel *channel, Message *message) override {
-    MutexLock lock(&mu_);
-
-    // Add message to buffer.
-    messages_.push_back(message);
-    buffer_bytes_ += message->size();
-
-    // Sort and write buffer when buffer is full.
-    if (buffer_bytes_ > max_buffer_size_) {
-      // Sort messages in sort buffer.
-      SortMessages();
-
-      // Flush messages to merge file.
-      Flush();
+    // Add message to sort buffer for channel.
+    auto f = channels_.find(channel);
+    Buffer *buffer = buffers_[f != channels_.end() ? f->second : 0];
+    std::vector<Message *> *run = nullptr;
+    {
+      MutexLock lock(&buffer->mu);
+      buffer->messages.push_back(message);
+      buffer->bytes += message->size();
+      int64 total = buffered_ += message->size();
+      UpdatePeak(total);
+
+      // Hand over buffer to a sort thread when it is full, or when the sort
+      // buffers have used up the sort buffer size and the buffer is large
+      // enough for a merge file.
+      bool full = buffer->bytes > run_size_;
+      bool spill = total > max_buffer_size_ && buffer->bytes >= min_run_size_;
+      if (full || spill) {
+        run = new std::vector<Message *>();
+        run->swap(buffer->messages);
+        buffered_ -= buffer->bytes;
+        buffer->bytes = 0;
+      }
+    }
+    if (run != nullptr) {
+      pool_->Schedule([this, run]() {
+        SortMessages(run);
+        Spill(run);
+        delete run;
+      });
     }
   }
 
   void Done(Task *task) override {
-    MutexLock lock(&mu_);
-
-    // Send sorted messages to output channel.
-    if (next_merge_file_ == 0) {
-      // All messages are in the sort buffer.
-      SendMessageBuffer();
-    } else {
-      // Sort and flush remaining messages to merge file.
-      SortMessages();
-      Flush();
-
-      // Send messages from merge files to output channel.
-      SendMergedMessages();
-
-      // Remove temporary files.
-      RemoveTempFiles();
+    // Sort the remaining messages in the sort buffers in parallel, and wait
+    // for all background spills to complete.
+    std::vector<ThreadPool::Task> sorts;
+    for (Buffer *buffer : buffers_) {
+      if (buffer->messages.empty()) continue;
+      sorts.emplace_back([this, buffer]() { SortMessages(&buffer->messages); });
     }
+    pool_->ScheduleBatch(&sorts);
+    delete pool_;
+    pool_ = nullptr;
+    sort_buffer_peak_->Set(peak_);
+
+    // Reduce the number of merge files to the merge fan-in.
+    while (files_.size() > merge_fanin_) MergePass();
+
+    // Merge sorted buffers and merge files and send messages to output.
+    std::vector<MergeInput *> inputs;
+    for (Buffer *buffer : buffers_) {
+      if (buffer->messages.empty()) continue;
+      inputs.push_back(new MemoryInput(&buffer->messages));
+      buffered_ -= buffer->bytes;
+      buffer->bytes = 0;
+    }
+    for (const string &filename : files_) {
+      inputs.push_back(new FileInput(filename));
+    }
+    VLOG(3) << "Merge " << inputs.size() << " runs";
+    LoserTree merger(inputs);
+    while (MergeInput *input = merger.top()) {
+      output_->Send(input->Take());
+      merger.Next();
+    }
+    for (MergeInput *input : inputs) delete input;
+
+    // Remove temporary files.
+    RemoveTempFiles();
 
     // Close output channel.
     output_->Close();
@@ -115,128 +333,151 @@ class Sorter : public Processor {
   // Remove temporary files.
   void RemoveTempFiles() {
     // Remove temporary merge files.
-    for (int i = 0; i < next_merge_file_; ++i) {
-      File::Delete(MergeFileName(i));
+    for (const string &filename : files_) {
+      File::Delete(filename);
     }
+    files_.clear();
 
     // Remove directory.
     if (!tmpdir_.empty()) File::Rmdir(tmpdir_);
   }
 
-  // Return file name of merge file.
-  string MergeFileName(int index) const {
-    return StringPrintf("%s/%05d", tmpdir_.c_str(), index);
-  }
-
-  // Flush sort buffer to new merge file.
-  void Flush() {
-    // Check if there are any messages to flush.
-    if (messages_.empty()) return;
+  // Allocate file name for new merge file.
+  string NewMergeFile() {
+    MutexLock lock(&mu_);
 
     // Create temp dir if not already done.
     if (tmpdir_.empty()) {
       CHECK(File::CreateTempDir(&tmpdir_));
     }
+    return StringPrintf("%s/%05d", tmpdir_.c_str(), next_merge_file_++);
+  }
 
-    // Write messages to next merge file.
-    int fileno = next_merge_file_++;
-    VLOG(3) << "Flush " << buffer_bytes_ << " bytes and "
-            << messages_.size() << " messages to " << MergeFileName(fileno);
+  // Add merge file to the list of merge files.
+  void AddMergeFile(const string &filename) {
+    MutexLock lock(&mu_);
+    files_.push_back(filename);
+    num_merge_files_->Increment();
+  }
+
+  // Write sorted messages to new merge file.
+  void Spill(std::vector<Message *> *messages) {
+    string filename = NewMergeFile();
+    VLOG(3) << "Flush " << messages->size() << " messages to " << filename;
     RecordFileOptions options;
-    RecordWriter writer(MergeFileName(fileno), options);
-    for (Message *message : messages_) {
+    RecordWriter writer(filename, options);
+    for (Message *message : *messages) {
       CHECK(writer.Write(message->key(), message->serial(), message->value()));
       delete message;
     }
     CHECK(writer.Close());
-    num_merge_files_->Increment();
+    messages->clear();
+    AddMergeFile(filename);
+  }
 
-    // Clear sort buffer.
-    messages_.clear();
-    buffer_bytes_ = 0;
+  // Update peak size of the sort buffers.
+  void UpdatePeak(int64 total) {
+    int64 peak = peak_.load();
+    while (total > peak && !peak_.compare_exchange_weak(peak, total)) {}
   }
 
   // Sort messages in sort buffer.
-  void SortMessages() {
-    VLOG(3) << "Sort " << messages_.size() << " messages";
+  void SortMessages(std::vector<Message *> *messages) {
+    VLOG(3) << "Sort " << messages->size() << " messages";
     MessageComparator comparator;
-    std::sort(messages_.begin(), messages_.end(), comparator);
+    std::sort(messages->begin(), messages->end(), comparator);
   }
 
-  // Send messages in sort buffer to output channel.
-  void SendMessageBuffer() {
-    // Sort the messages in the buffer.
-    SortMessages();
-
-    // Send messages to output.
-    VLOG(3) << "Output " << messages_.size() << " messages";
-    for (Message *message : messages_) {
-      output_->Send(message);
+  // Merge groups of merge files into larger merge files in parallel.
+  void MergePass() {
+    std::vector<string> files;
+    files.swap(files_);
+    VLOG(3) << "Merge pass over " << files.size() << " files";
+    num_merge_passes_->Increment();
+
+    ThreadPool pool(sort_threads_, sort_threads_);
+    pool.StartWorkers();
+    for (int start = 0; start < files.size(); start += merge_fanin_) {
+      int end = std::min<int>(start + merge_fanin_, files.size());
+      std::vector<string> group(files.begin() + start, files.begin() + end);
+      if (group.size() == 1) {
+        MutexLock lock(&mu_);
+        files_.push_back(group[0]);
+        continue;
+      }
+      pool.Schedule([this, group]() {
+        // Merge group of files into new merge file.
+        std::vector<MergeInput *> inputs;
+        for (const string &filename : group) {
+          inputs.push_back(new FileInput(filename));
+        }
+        string filename = NewMergeFile();
+        RecordFileOptions options;
+        RecordWriter writer(filename, options);
+        LoserTree merger(inputs);
+        while (MergeInput *input = merger.top()) {
+          input->Write(&writer);
+          merger.Next();
+        }
+        CHECK(writer.Close());
+        for (MergeInput *input : inputs) delete input;
+
+        // Remove the merged input files.
+        for (const string &filename : group) File::Delete(filename);
+        AddMergeFile(filename);
+      });
     }
-    messages_.clear();
   }
 
-  // Send messages in merge files to output channel.
-  void SendMergedMessages() {
-    // Priority queue for merging files.
-    typedef std::vector<MergeItem *> MergeItemArray;
-    std::priority_queue<MergeItem *, MergeItemArray, ItemComparator> merger;
-
-    // Open merge files.
-    int num_files = next_merge_file_;
-    std::vector<MergeItem> items(num_files);
-    for (int i = 0; i < num_files; ++i) {
-      // Open reader for merge file.
-      MergeItem &item = items[i];
-      item.reader = new RecordReader(MergeFileName(i));
-
-      // Add first record to sort queue.
-      if (!item.reader->Done()) {
-        CHECK(item.reader->Read(&item.record));
-        merger.push(&item);
-      }
-    }
+ private:
+  // Sort buffer for input channel.
+  struct Buffer {
+    // Messages that have not yet been sorted and written to merge file.
+    std::vector<Message *> messages;
 
-    // Merge files and output sorted messages to output channel.
-    VLOG(3) << "Merge " << num_files << " files";
-    while (!merger.empty()) {
-      // Get next item from queue.
-      MergeItem *item = merger.top();
-      merger.pop();
-
-      // Send message to output channel.
-      Message *message = new Message(item->record.key,
-                                     item->record.version,
-                                     item->record.value);
-      output_->Send(message);
-
-      // Get next item from merge file and add it to queue.
-      if (!item->reader->Done()) {
-        CHECK(item->reader->Read(&item->record));
-        merger.push(item);
-      }
-    }
+    // Size of messages in the sort buffer.
+    uint64 bytes = 0;
 
-    // Close merge file readers.
-    VLOG(3) << "Close merge files";
-    for (auto &item : items) {
-      CHECK(item.reader->Close());
-      delete item.reader;
-    }
-  }
+    // Mutex for serializing access to buffer.
+    Mutex mu;
+  };
 
- private:
   // Temporary local directory for sort-merge files.
   string tmpdir_;
 
-  // Buffer of messages that have not yet been sorted and written to merge file.
-  std::vector<Message *> messages_;
+  // Sort buffers for input channels.
+  std::vector<Buffer *> buffers_;
 
-  // Maximum size of messages in the sort buffer.
+  // Mapping from input channel to sort buffer.
+  std::unordered_map<Channel *, int> channels_;
+
+  // Maximum size of messages in the sort buffers.
   int64 max_buffer_size_ = 64 * 1024 * 1024;
 
-  // Size of messages in the sort buffer.
-  uint64 buffer_bytes_ = 0;
+  // Maximum size of messages in each sort buffer before it is spilled.
+  int64 run_size_ = 0;
+
+  // Minimum size of messages in sort buffer for spilling it when the total
+  // size of the sort buffers exceeds the sort buffer size.
+  int64 min_run_size_ = 64 * 1024;
+
+  // Total size of messages in the sort buffers.
+  std::atomic<int64> buffered_{0};
+
+  // Peak total size of messages in the sort buffers.
+  std::atomic<int64> peak_{0};
+
+  // Number of background threads for sorting and merging.
+  int sort_threads_ = 4;
+
+  // Maximum number of merge files merged at a time.
+  int merge_fanin_ = 64;
+
+  // Thread pool for sorting and spilling sort buffers.
+  ThreadPool *pool_ = nullptr;
+
+  // Merge files.
+  std::vector<string> files_;
 
   // Next merge file number.
   int next_merge_file_ = 0;
@@ -246,8 +487,10 @@ class Sorter : public Processor {
 
   // Statistics.
   Counter *num_merge_files_ = nullptr;
+  Counter *num_merge_passes_ = nullptr;
+  Counter *sort_buffer_peak_ = nullptr;
 
-  // Mutex for serializing access.
+  // Mutex for serializing access to merge files.
   Mutex mu_;
 };
 
@@ -255,4 +498,3 @@ REGISTER_TASK_PROCESSOR("sorter", Sorter);
 
 }  // namespace task
 }  // namespace sling
-
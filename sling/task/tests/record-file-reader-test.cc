@@ -0,0 +1,170 @@
+// Copyright 2025 Ringgaard Research ApS
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include "sling/base/flags.h"
+#include "sling/base/init.h"
+#include "sling/base/logging.h"
+#include "sling/file/file.h"
+#include "sling/file/recordio.h"
+#include "sling/string/printf.h"
+#include "sling/task/job.h"
+
+DEFINE_int32(records, 20000, "Number of records in test file");
+DEFINE_int32(prefetch, 4, "Read-ahead queue depth");
+
+using namespace sling;
+using namespace sling::task;
+
+// Return key for record.
+static string Key(int i) {
+  return StringPrintf("key%06d", i);
+}
+
+// Return value for record. Values vary in size from empty to several times
+// the reader buffer size, so records straddle block boundaries.
+static string Value(int i) {
+  int size = (i * 7919) % 3000;
+  if (i % 1000 == 0) size = 100000;
+  string value(size, 'a' + i % 26);
+  return value;
+}
+
+// Write test record file.
+static void WriteRecords(const string &filename) {
+  RecordFileOptions options;
+  options.buffer_size = 4096;
+  RecordWriter writer(filename, options);
+  for (int i = 0; i < FLAGS_records; ++i) {
+    CHECK(writer.Write(Key(i), i + 1, Value(i)));
+  }
+  CHECK(writer.Close());
+}
+
+// Read all records with prefetching and check them.
+static void TestPrefetchingReader(const string &filename, int buffer_size) {
+  RecordFileOptions options;
+  options.buffer_size = buffer_size;
+  options.prefetch = FLAGS_prefetch;
+  RecordReader reader(filename, options);
+  Record record;
+  uint64 middle = 0;
+  for (int i = 0; i < FLAGS_records; ++i) {
+    if (i == FLAGS_records / 2) middle = reader.Tell();
+    CHECK(!reader.Done());
+    CHECK(reader.Read(&record));
+    CHECK_EQ(record.key, Key(i));
+    CHECK_EQ(record.version, i + 1);
+    CHECK(record.value == Value(i)) << "record " << i;
+  }
+  CHECK(reader.Done());
+
+  // Check prefetch statistics.
+  const RecordReader::PrefetchStats &stats = reader.prefetch_stats();
+  CHECK_GT(stats.blocks, 0);
+  CHECK_LE(stats.max_queued, FLAGS_prefetch);
+  CHECK_LE(stats.queued, stats.blocks * stats.max_queued);
+
+  // Seeking restarts the prefetcher at the new position.
+  CHECK(reader.Seek(middle));
+  for (int i = FLAGS_records / 2; i < FLAGS_records; ++i) {
+    CHECK(reader.Read(&record));
+    CHECK_EQ(record.key, Key(i));
+    CHECK(record.value == Value(i)) << "record " << i;
+  }
+  CHECK(reader.Done());
+  CHECK(reader.Close());
+}
+
+// Read records through the record file reader task with prefetching and
+// write them to an output file.
+static Job *CopyRecords(const string &input, const string &output,
+                        int64 limit) {
+  Job *job = new Job();
+  Task *reader = job->CreateTask("record-file-reader", "reader");
+  reader->AddParameter("prefetch", FLAGS_prefetch);
+  reader->AddParameter("buffer_size", 8192);
+  if (limit != -1) reader->AddParameter("limit", limit);
+  job->BindInput(reader,
+                 job->CreateResource(input, Format("records/string")),
+                 "input");
+
+  Task *writer = job->CreateTask("record-file-writer", "writer");
+  job->BindOutput(writer,
+                  job->CreateResource(output, Format("records/string")),
+                  "output");
+  job->Connect(reader, writer, "string");
+
+  job->Start();
+  job->Wait();
+  return job;
+}
+
+// Check that the record file reader task outputs all records in order and
+// reports prefetch statistics.
+static void TestReaderTask(const string &input, const string &output,
+                           int64 limit) {
+  Job *job = CopyRecords(input, output, limit);
+  int64 expected = limit == -1 ? FLAGS_records : limit;
+  CHECK_EQ(job->GetCounter("records_read")->value(), expected);
+  int64 blocks = job->GetCounter("prefetch_blocks")->value();
+  int64 queued = job->GetCounter("prefetch_queued_blocks")->value();
+  int64 depth = job->GetCounter("prefetch_max_queue_depth")->value();
+  CHECK_GT(blocks, 0);
+  CHECK_LE(depth, FLAGS_prefetch);
+  CHECK_LE(queued, blocks * depth);
+  LOG(INFO) << "Prefetched " << blocks << " blocks, average queue depth "
+            << (queued / static_cast<double>(blocks))
+            << ", max queue depth " << depth;
+  delete job;
+
+  RecordReader reader(output);
+  Record record;
+  for (int i = 0; i < expected; ++i) {
+    CHECK(reader.Read(&record));
+    CHECK_EQ(record.key, Key(i));
+    CHECK(record.value == Value(i)) << "record " << i;
+  }
+  CHECK(reader.Done());
+  CHECK(reader.Close());
+  File::Delete(output);
+}
+
+int main(int argc, char *argv[]) {
+  InitProgram(&argc, &argv);
+
+  string dir;
+  CHECK(File::CreateTempDir(&dir));
+  string input = dir + "/input";
+  string output = dir + "/output";
+  WriteRecords(input);
+
+  for (int buffer_size : {1024, 4096, 65536}) {
+    TestPrefetchingReader(input, buffer_size);
+  }
+  LOG(INFO) << "Prefetching reader test passed";
+
+  TestReaderTask(input, output, -1);
+  TestReaderTask(input, output, FLAGS_records / 3);
+  LOG(INFO) << "Reader task test passed";
+
+  File::Delete(input);
+  File::Rmdir(dir);
+
+  LOG(INFO) << "Record file reader test passed";
+  return 0;
+}
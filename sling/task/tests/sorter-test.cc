@@ -0,0 +1,190 @@
+// Copyright 2025 Ringgaard Research ApS
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include "sling/base/flags.h"
+#include "sling/base/init.h"
+#include "sling/base/logging.h"
+#include "sling/file/file.h"
+#include "sling/file/recordio.h"
+#include "sling/string/printf.h"
+#include "sling/task/job.h"
+
+DEFINE_int32(shards, 8, "Number of input shards");
+DEFINE_int32(records, 5000, "Number of records per input shard");
+DEFINE_int32(value_size, 200, "Size of record values");
+
+using namespace sling;
+using namespace sling::task;
+
+// Default minimum size of spilled sort buffers.
+static const int64 kMinRunSize = 64 * 1024;
+
+// Sorter configuration and statistics for test run.
+struct Run {
+  int64 sort_buffer_size;   // sort buffer size
+  int merge_fanin;          // merge fan-in
+  int64 merge_files = 0;    // number of merge files written
+  int64 merge_passes = 0;   // number of intermediate merge passes
+  int64 peak = 0;           // peak size of sort buffers
+};
+
+// Write input shards with random keys. Keys are drawn from a small key space,
+// so there are many duplicate keys, and the serial number is the position in
+// the input shard.
+static std::vector<string> WriteInput(const string &dir, int64 *max_size) {
+  std::mt19937 prng(314159);
+  std::uniform_int_distribution<int> keys(0, FLAGS_records);
+  std::vector<string> files;
+  *max_size = 0;
+  for (int shard = 0; shard < FLAGS_shards; ++shard) {
+    string filename = StringPrintf("%s/input-%d", dir.c_str(), shard);
+    RecordWriter writer(filename);
+    for (int i = 0; i < FLAGS_records; ++i) {
+      string key = StringPrintf("%08d", keys(prng));
+      string value(FLAGS_value_size, 'a' + shard);
+      CHECK(writer.Write(key, i + 1, value));
+      *max_size = std::max<int64>(*max_size, key.size() + value.size());
+    }
+    CHECK(writer.Close());
+    files.push_back(filename);
+  }
+  return files;
+}
+
+// Sort input shards into output file.
+static void Sort(const std::vector<string> &inputs, const string &output,
+                 Run *run) {
+  Job job;
+  Task *sorter = job.CreateTask("sorter", "sorter");
+  sorter->AddParameter("sort_buffer_size", run->sort_buffer_size);
+  sorter->AddParameter("merge_fanin", run->merge_fanin);
+  sorter->AddParameter("sort_threads", 2);
+
+  int shards = inputs.size();
+  for (int i = 0; i < shards; ++i) {
+    Shard shard(i, shards);
+    Task *reader = job.CreateTask("record-file-reader", "reader", shard);
+    job.BindInput(reader,
+                  job.CreateResource(inputs[i], Format("records/string")),
+                  "input");
+    job.Connect(Port(reader, "output"), Port(sorter, "input", shard),
+                Format("message/string"));
+  }
+
+  Task *writer = job.CreateTask("record-file-writer", "writer");
+  job.BindOutput(writer,
+                 job.CreateResource(output, Format("records/string")),
+                 "output");
+  job.Connect(sorter, writer, "string");
+
+  job.Start();
+  job.Wait();
+  run->merge_files = job.GetCounter("merge_files")->value();
+  run->merge_passes = job.GetCounter("merge_passes")->value();
+  run->peak = job.GetCounter("sort_buffer_peak")->value();
+}
+
+// Check that output is sorted by key and serial and has all the records.
+static void CheckOutput(const string &output, int64 expected) {
+  RecordReader reader(output);
+  Record record;
+  string prev_key;
+  uint64 prev_serial = 0;
+  int64 count = 0;
+  while (!reader.Done()) {
+    CHECK(reader.Read(&record));
+    string key = record.key.str();
+    CHECK_EQ(record.value.size(), FLAGS_value_size);
+    if (count > 0) {
+      CHECK_LE(prev_key, key) << "Output not sorted at record " << count;
+      if (prev_key == key) {
+        CHECK_LE(prev_serial, record.version)
+            << "Serial not sorted at record " << count;
+      }
+    }
+    prev_key = key;
+    prev_serial = record.version;
+    count++;
+  }
+  CHECK(reader.Close());
+  CHECK_EQ(count, expected);
+}
+
+int main(int argc, char *argv[]) {
+  InitProgram(&argc, &argv);
+
+  string dir;
+  CHECK(File::CreateTempDir(&dir));
+  int64 max_size;
+  std::vector<string> inputs = WriteInput(dir, &max_size);
+  int64 total = FLAGS_shards * FLAGS_records;
+  int64 bytes = total * (8 + FLAGS_value_size);
+
+  std::vector<Run> runs = {
+    // Everything fits in the sort buffers.
+    {1 << 30, 64},
+
+    // Sort buffer size smaller than the input, but larger than the minimum
+    // run size for each channel.
+    {bytes / 4, 64},
+
+    // Small sort buffer with several merge passes.
+    {bytes / 16, 2},
+
+    // Sort buffer smaller than the minimum run size for all channels.
+    {256 * 1024, 64},
+  };
+
+  for (Run &run : runs) {
+    string output = dir + "/output";
+    Sort(inputs, output, &run);
+    CheckOutput(output, total);
+    File::Delete(output);
+
+    LOG(INFO) << "Sort buffer " << run.sort_buffer_size
+              << " fan-in " << run.merge_fanin
+              << ": " << run.merge_files << " merge files, "
+              << run.merge_passes << " merge passes, peak "
+              << run.peak << " bytes";
+
+    // Check that the sort buffers stay within the sort buffer size plus the
+    // minimum run size for each channel.
+    CHECK_LE(run.peak, run.sort_buffer_size + FLAGS_shards * kMinRunSize +
+                       max_size);
+
+    // Check that spilled merge files are not smaller than the minimum run
+    // size.
+    if (run.merge_passes == 0) {
+      CHECK_LE(run.merge_files, bytes / kMinRunSize);
+    }
+
+    // Check that sort buffers are spilled when the input does not fit.
+    if (run.sort_buffer_size < bytes) {
+      CHECK_GT(run.merge_files, 0);
+    } else {
+      CHECK_EQ(run.merge_files, 0);
+    }
+    if (run.merge_fanin == 2) CHECK_GT(run.merge_passes, 0);
+  }
+
+  for (const string &filename : inputs) File::Delete(filename);
+  File::Rmdir(dir);
+
+  LOG(INFO) << "Sorter test passed";
+  return 0;
+}
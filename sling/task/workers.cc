@@ -35,6 +35,7 @@ class Workers : public Processor {
 
     // Start worker pool.
     pool_ = new ThreadPool(num_workers, queue_size);
+    pool_->set_pin_workers(task->Get("pin_workers", false));
     pool_->StartWorkers();
 
     queue_length_ = task->GetCounter("worker_queue_length");
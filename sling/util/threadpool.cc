@@ -12,13 +12,26 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
-#include "sling/base/logging.h"
 #include "sling/util/threadpool.h"
 
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <algorithm>
+#include <thread>
+
+#include "sling/base/logging.h"
+
 namespace sling {
 
+// Pool and worker index for the current thread if it is a worker thread.
+static thread_local const ThreadPool *current_pool = nullptr;
+static thread_local int current_worker = -1;
+
 ThreadPool::ThreadPool(int num_workers, int queue_size)
     : num_workers_(num_workers), queue_size_(queue_size) {
+  if (num_workers_ < 1) num_workers_ = 1;
+  for (int i = 0; i < num_workers_; ++i) workers_.push_back(new Worker());
 }
 
 ThreadPool::~ThreadPool() {
@@ -26,47 +39,148 @@ ThreadPool::~ThreadPool() {
   Shutdown();
 
   // Wait until all workers have terminated.
-  for (auto *t : workers_) t->Join();
+  for (Worker *worker : workers_) {
+    if (worker->thread != nullptr) {
+      worker->thread->Join();
+      delete worker->thread;
+    }
+    delete worker;
+  }
 }
 
 void ThreadPool::StartWorkers() {
   // Create worker threads.
-  CHECK(workers_.empty());
   for (int i = 0; i < num_workers_; ++i) {
-    ClosureThread *t = new ClosureThread([this]() {
-      // Keep processing tasks until done.
-      Task task;
-      while (FetchTask(&task)) task();
-    });
-    workers_.push_back(t);
+    CHECK(workers_[i]->thread == nullptr);
+    workers_[i]->thread = new ClosureThread([this, i]() { Work(i); });
   }
 
   // Start worker threads.
-  for (auto *t : workers_) {
-    t->SetJoinable(true);
-    t->Start();
+  for (Worker *worker : workers_) {
+    worker->thread->SetJoinable(true);
+    worker->thread->Start();
   }
 }
 
-void ThreadPool::Schedule(Task &&task) {
-  std::unique_lock<std::mutex> lock(mu_);
-  while (tasks_.size() >= queue_size_) {
-    nonfull_.wait(lock);
+void ThreadPool::Work(int index) {
+  current_pool = this;
+  current_worker = index;
+
+  // Pin worker thread to CPU core.
+  if (pin_workers_) {
+    int num_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if (num_cpus > 0) {
+      cpu_set_t cpus;
+      CPU_ZERO(&cpus);
+      CPU_SET(index % num_cpus, &cpus);
+      if (pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus) != 0) {
+        LOG(WARNING) << "Cannot pin worker " << index << " to CPU";
+      }
+    }
+  }
+
+  // Keep processing tasks until done.
+  Task task;
+  for (;;) {
+    if (FetchTask(index, &task)) {
+      task();
+      task = Task();
+      continue;
+    }
+
+    // Wait for more tasks. The idle count is incremented before checking for
+    // pending tasks, so a scheduler either sees the idle worker or the worker
+    // sees the new task.
+    std::unique_lock<std::mutex> lock(mu_);
+    idle_++;
+    while (pending_ == 0 && !done_) nonempty_.wait(lock);
+    idle_--;
+    if (pending_ == 0 && done_) break;
+    lock.unlock();
+
+    // Another worker may grab the task before this worker gets to it.
+    std::this_thread::yield();
+  }
+
+  current_pool = nullptr;
+  current_worker = -1;
+}
+
+bool ThreadPool::FetchTask(int index, Task *task) {
+  if (pending_ == 0) return false;
+
+  // Get task from own queue first, and then try to steal tasks from the
+  // other workers.
+  for (int i = 0; i < num_workers_; ++i) {
+    Worker *worker = workers_[(index + i) % num_workers_];
+    std::lock_guard<std::mutex> lock(worker->mu);
+    if (!worker->tasks.empty()) {
+      *task = std::move(worker->tasks.front());
+      worker->tasks.pop_front();
+      pending_--;
+      if (blocked_ > 0) {
+        std::lock_guard<std::mutex> wakeup(mu_);
+        nonfull_.notify_all();
+      }
+      return true;
+    }
   }
-  tasks_.push(std::move(task));
-  nonempty_.notify_one();
+  return false;
 }
 
-bool ThreadPool::FetchTask(Task *task) {
+void ThreadPool::Push(int index, Task *begin, Task *end) {
+  // Add tasks to worker queue.
+  Worker *worker = workers_[index];
+  {
+    std::lock_guard<std::mutex> lock(worker->mu);
+    for (Task *t = begin; t < end; ++t) worker->tasks.push_back(std::move(*t));
+  }
+  pending_ += end - begin;
+
+  // Wake up idle workers.
+  if (idle_ > 0) {
+    std::lock_guard<std::mutex> lock(mu_);
+    if (end - begin == 1) {
+      nonempty_.notify_one();
+    } else {
+      nonempty_.notify_all();
+    }
+  }
+}
+
+void ThreadPool::WaitForSpace(int count) {
+  // Tasks scheduled from worker threads never block, since this could
+  // deadlock the pool.
+  if (current_pool == this) return;
+  if (pending_ + count <= queue_size_) return;
   std::unique_lock<std::mutex> lock(mu_);
-  while (tasks_.empty()) {
-    if (done_) return false;
-    nonempty_.wait(lock);
+  blocked_++;
+  while (pending_ + count > queue_size_) nonfull_.wait(lock);
+  blocked_--;
+}
+
+void ThreadPool::Schedule(Task &&task) {
+  WaitForSpace(1);
+  int index = current_pool == this ? current_worker : next_++ % num_workers_;
+  Push(index, &task, &task + 1);
+}
+
+void ThreadPool::ScheduleBatch(std::vector<Task> *tasks) {
+  // Divide the tasks into one chunk per worker, starting with the current
+  // worker. Chunks are no larger than the queue size, and each chunk waits
+  // for room in the queues, so large batches do not overfill the pool.
+  int size = tasks->size();
+  int first = current_pool == this ? current_worker : next_++ % num_workers_;
+  int chunk = (size + num_workers_ - 1) / num_workers_;
+  chunk = std::max(std::min(chunk, queue_size_), 1);
+  Task *data = tasks->data();
+  for (int i = 0; i * chunk < size; ++i) {
+    int begin = i * chunk;
+    int end = std::min(begin + chunk, size);
+    WaitForSpace(end - begin);
+    Push((first + i) % num_workers_, data + begin, data + end);
   }
-  *task = tasks_.front();
-  tasks_.pop();
-  nonfull_.notify_one();
-  return true;
+  tasks->clear();
 }
 
 void ThreadPool::Shutdown() {
@@ -77,4 +191,3 @@ void ThreadPool::Shutdown() {
 }
 
 }  // namespace sling
-
@@ -15,23 +15,133 @@
 #ifndef SLING_UTIL_THREADPOOL_H_
 #define SLING_UTIL_THREADPOOL_H_
 
+#include <atomic>
 #include <condition_variable>
-#include <functional>
+#include <deque>
 #include <mutex>
-#include <queue>
+#include <new>
+#include <type_traits>
+#include <utility>
 #include <vector>
 
 #include "sling/util/thread.h"
 
 namespace sling {
 
-// Thread pool for executing tasks using a pool of worker threads.
+// Thread pool for executing tasks using a pool of worker threads. Each worker
+// has its own task queue, and idle workers steal tasks from the queues of the
+// other workers. Tasks scheduled from a worker thread are added to the queue
+// of that worker, whereas tasks scheduled from other threads are distributed
+// round-robin over the worker queues.
 class ThreadPool {
  public:
-  // Task that can be scheduled for execution.
-  typedef std::function<void()> Task;
-
-  // Initialize thread pool.
+  // Task that can be scheduled for execution. Small closures are stored inline
+  // in the task to avoid heap allocation.
+  class Task {
+   public:
+    Task() {}
+
+    // Initialize task from closure.
+    template <typename F, typename = typename std::enable_if<
+        !std::is_same<typename std::decay<F>::type, Task>::value>::type>
+    Task(F &&closure) {
+      typedef typename std::decay<F>::type Closure;
+      Init<Closure>(std::forward<F>(closure),
+                    std::integral_constant<bool,
+                        sizeof(Closure) <= kInlineSize &&
+                        alignof(Closure) <= alignof(Storage) &&
+                        std::is_nothrow_move_constructible<Closure>::value>());
+    }
+
+    Task(Task &&other) : ops_(other.ops_) {
+      if (ops_ != nullptr) ops_->move(&other.storage_, &storage_);
+      other.ops_ = nullptr;
+    }
+
+    Task &operator=(Task &&other) {
+      if (this != &other) {
+        if (ops_ != nullptr) ops_->destroy(&storage_);
+        ops_ = other.ops_;
+        if (ops_ != nullptr) ops_->move(&other.storage_, &storage_);
+        other.ops_ = nullptr;
+      }
+      return *this;
+    }
+
+    ~Task() { if (ops_ != nullptr) ops_->destroy(&storage_); }
+
+    // Run task.
+    void operator()() { ops_->invoke(&storage_); }
+
+    // Check if task is empty.
+    explicit operator bool() const { return ops_ != nullptr; }
+
+   private:
+    // Maximum size of closures stored inline.
+    static const int kInlineSize = 48;
+    typedef typename std::aligned_storage<kInlineSize>::type Storage;
+
+    // Store closure inline in task.
+    template <typename Closure, typename F>
+    void Init(F &&closure, std::true_type inlined) {
+      new (&storage_) Closure(std::forward<F>(closure));
+      ops_ = &InlineOps<Closure>::ops;
+    }
+
+    // Store closure on the heap.
+    template <typename Closure, typename F>
+    void Init(F &&closure, std::false_type inlined) {
+      *reinterpret_cast<Closure **>(&storage_) =
+          new Closure(std::forward<F>(closure));
+      ops_ = &HeapOps<Closure>::ops;
+    }
+
+    // Operations for closure type.
+    struct Ops {
+      void (*invoke)(void *storage);
+      void (*move)(void *from, void *to);
+      void (*destroy)(void *storage);
+    };
+
+    // Operations for closures stored inline.
+    template <typename Closure> struct InlineOps {
+      static void Invoke(void *storage) {
+        (*static_cast<Closure *>(storage))();
+      }
+      static void Move(void *from, void *to) {
+        new (to) Closure(std::move(*static_cast<Closure *>(from)));
+        static_cast<Closure *>(from)->~Closure();
+      }
+      static void Destroy(void *storage) {
+        static_cast<Closure *>(storage)->~Closure();
+      }
+      static constexpr Ops ops = {Invoke, Move, Destroy};
+    };
+
+    // Operations for closures stored on the heap.
+    template <typename Closure> struct HeapOps {
+      static void Invoke(void *storage) {
+        (**static_cast<Closure **>(storage))();
+      }
+      static void Move(void *from, void *to) {
+        *static_cast<Closure **>(to) = *static_cast<Closure **>(from);
+      }
+      static void Destroy(void *storage) {
+        delete *static_cast<Closure **>(storage);
+      }
+      static constexpr Ops ops = {Invoke, Move, Destroy};
+    };
+
+    // Closure operations and storage.
+    const Ops *ops_ = nullptr;
+    Storage storage_;
+
+    Task(const Task &) = delete;
+    void operator=(const Task &) = delete;
+  };
+
+  // Initialize thread pool. The queue size is the maximum number of pending
+  // tasks before scheduling from outside the pool blocks.
   ThreadPool(int num_workers, int queue_size);
 
   // Wait for all workers to complete.
@@ -43,25 +153,65 @@ class ThreadPool {
   // Schedule task to be executed by worker.
   void Schedule(Task &&task);
 
+  // Schedule a batch of tasks. The tasks are divided between the workers in
+  // chunks, so each worker queue is only locked once per chunk. Scheduling
+  // from outside the pool blocks until there is room for each chunk.
+  void ScheduleBatch(std::vector<Task> *tasks);
+
+  // Pin worker threads to CPU cores. This must be called before starting the
+  // workers.
+  void set_pin_workers(bool pin) { pin_workers_ = pin; }
+
+  // Number of worker threads.
+  int num_workers() const { return num_workers_; }
+
  private:
-  // Fetch next task. Returns false when all tasks have been completed.
-  bool FetchTask(Task *task);
+  // Worker with task queue.
+  struct Worker {
+    std::mutex mu;
+    std::deque<Task> tasks;
+    ClosureThread *thread = nullptr;
+  };
+
+  // Main loop for worker thread.
+  void Work(int index);
+
+  // Get next task from own queue or steal task from another worker.
+  bool FetchTask(int index, Task *task);
+
+  // Add tasks to worker queue and wake up idle workers.
+  void Push(int index, Task *begin, Task *end);
+
+  // Wait until there is room for a number of tasks in the pool.
+  void WaitForSpace(int count);
 
   // Shut down workers. This waits until all tasks have been completed.
   void Shutdown();
 
   // Worker threads.
   int num_workers_;
-  std::vector<ClosureThread *> workers_;
+  std::vector<Worker *> workers_;
 
-  // Task queue.
+  // Maximum number of pending tasks.
   int queue_size_;
-  std::queue<Task> tasks_;
+
+  // Number of tasks in the worker queues.
+  std::atomic<int> pending_{0};
+
+  // Number of idle workers and blocked schedulers.
+  std::atomic<int> idle_{0};
+  std::atomic<int> blocked_{0};
+
+  // Next worker for round-robin scheduling.
+  std::atomic<unsigned> next_{0};
+
+  // Pin worker threads to CPU cores.
+  bool pin_workers_ = false;
 
   // Are we done with adding new tasks.
   bool done_ = false;
 
-  // Mutex for serializing access to task queue.
+  // Mutex for idle workers and blocked schedulers.
   std::mutex mu_;
 
   // Signal to notify about new tasks in queue.
@@ -71,7 +221,12 @@ class ThreadPool {
   std::condition_variable nonfull_;
 };
 
+template <typename Closure>
+constexpr ThreadPool::Task::Ops ThreadPool::Task::InlineOps<Closure>::ops;
+
+template <typename Closure>
+constexpr ThreadPool::Task::Ops ThreadPool::Task::HeapOps<Closure>::ops;
+
 }  // namespace sling
 
 #endif  // SLING_UTIL_THREADPOOL_H_
-
@@ -0,0 +1,107 @@
+// Copyright 2025 Ringgaard Research ApS
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "sling/web/char-scanner.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "sling/base/logging.h"
+#include "sling/base/types.h"
+
+namespace sling {
+
+CharScanner::CharScanner(const char *stops) {
+  int n = 0;
+  while (stops[n] != 0) {
+    CHECK_LT(n, 4) << "Too many stop characters";
+    stops_[n] = stops[n];
+    n++;
+  }
+  CHECK_GT(n, 0) << "No stop characters";
+  for (int i = n; i < 4; ++i) stops_[i] = stops_[0];
+}
+
+const char *CharScanner::Find(const char *begin,
+                              const char *end,
+                              int *newlines) const {
+  const char *p = begin;
+  int lines = 0;
+
+#if defined(__AVX2__)
+  // Compare 32 bytes at a time.
+  const __m256i s0 = _mm256_set1_epi8(stops_[0]);
+  const __m256i s1 = _mm256_set1_epi8(stops_[1]);
+  const __m256i s2 = _mm256_set1_epi8(stops_[2]);
+  const __m256i s3 = _mm256_set1_epi8(stops_[3]);
+  const __m256i nl = _mm256_set1_epi8('\n');
+  while (end - p >= 32) {
+    __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p));
+    __m256i match = _mm256_or_si256(
+        _mm256_or_si256(_mm256_cmpeq_epi8(v, s0), _mm256_cmpeq_epi8(v, s1)),
+        _mm256_or_si256(_mm256_cmpeq_epi8(v, s2), _mm256_cmpeq_epi8(v, s3)));
+    uint32 mask = _mm256_movemask_epi8(match);
+    uint32 nlmask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(v, nl));
+    if (mask != 0) {
+      int i = __builtin_ctz(mask);
+      *newlines += lines + __builtin_popcount(nlmask & ((1u << i) - 1));
+      return p + i;
+    }
+    lines += __builtin_popcount(nlmask);
+    p += 32;
+  }
+#endif
+
+#if defined(__SSE2__)
+  // Compare 16 bytes at a time.
+  const __m128i t0 = _mm_set1_epi8(stops_[0]);
+  const __m128i t1 = _mm_set1_epi8(stops_[1]);
+  const __m128i t2 = _mm_set1_epi8(stops_[2]);
+  const __m128i t3 = _mm_set1_epi8(stops_[3]);
+  const __m128i tnl = _mm_set1_epi8('\n');
+  while (end - p >= 16) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+    __m128i match = _mm_or_si128(
+        _mm_or_si128(_mm_cmpeq_epi8(v, t0), _mm_cmpeq_epi8(v, t1)),
+        _mm_or_si128(_mm_cmpeq_epi8(v, t2), _mm_cmpeq_epi8(v, t3)));
+    uint32 mask = _mm_movemask_epi8(match);
+    uint32 nlmask = _mm_movemask_epi8(_mm_cmpeq_epi8(v, tnl));
+    if (mask != 0) {
+      int i = __builtin_ctz(mask);
+      *newlines += lines + __builtin_popcount(nlmask & ((1u << i) - 1));
+      return p + i;
+    }
+    lines += __builtin_popcount(nlmask);
+    p += 16;
+  }
+#endif
+
+  // Check remaining characters one at a time.
+  while (p < end) {
+    char ch = *p;
+    if (ch == stops_[0] || ch == stops_[1] ||
+        ch == stops_[2] || ch == stops_[3]) {
+      break;
+    }
+    if (ch == '\n') lines++;
+    p++;
+  }
+  *newlines += lines;
+  return p;
+}
+
+}  // namespace sling
@@ -0,0 +1,41 @@
+// Copyright 2025 Ringgaard Research ApS
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef SLING_WEB_CHAR_SCANNER_H_
+#define SLING_WEB_CHAR_SCANNER_H_
+
+namespace sling {
+
+// Scanner for finding the first occurrence of one of a small set of stop
+// characters in a buffer. The input is compared in blocks of 32 or 16 bytes
+// with AVX2 or SSE2 when available, so long runs of ordinary characters can be
+// skipped in bulk.
+class CharScanner {
+ public:
+  // Initialize scanner with one to four stop characters.
+  explicit CharScanner(const char *stops);
+
+  // Return pointer to the first stop character in [begin, end), or end if
+  // there are no stop characters. The number of newlines before the returned
+  // position is added to *newlines.
+  const char *Find(const char *begin, const char *end, int *newlines) const;
+
+ private:
+  // Stop characters. Unused entries repeat the first stop character.
+  char stops_[4];
+};
+
+}  // namespace sling
+
+#endif  // SLING_WEB_CHAR_SCANNER_H_
@@ -0,0 +1,176 @@
+// Copyright 2025 Ringgaard Research ApS
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// Benchmark for HTML and XML parsing with and without bulk text scanning.
+// Documents are read from the files on the command line, or from WARC files
+// with --warc. A synthetic page is used if no files are specified.
+
+#include <string.h>
+#include <string>
+#include <vector>
+
+#include "sling/base/clock.h"
+#include "sling/base/flags.h"
+#include "sling/base/init.h"
+#include "sling/base/logging.h"
+#include "sling/base/types.h"
+#include "sling/file/file.h"
+#include "sling/stream/input.h"
+#include "sling/stream/memory.h"
+#include "sling/util/fingerprint.h"
+#include "sling/web/html-parser.h"
+#include "sling/web/web-archive.h"
+#include "sling/web/xml-parser.h"
+
+DEFINE_bool(warc, false, "Read documents from WARC files");
+DEFINE_bool(xml, false, "Use XML parser instead of HTML parser");
+DEFINE_int32(max_docs, 10000, "Maximum number of documents");
+DEFINE_int32(repeat, 10, "Number of passes over the documents");
+
+using namespace sling;
+
+// Compute digest of parser events for comparing parser output.
+template <class Parser> class DigestParser : public Parser {
+ public:
+  bool StartElement(const XMLElement &element) override {
+    Add('S', element.name);
+    for (const XMLAttribute &attr : element.attrs) {
+      Add('A', attr.name);
+      Add('V', attr.value);
+    }
+    return true;
+  }
+
+  bool EndElement(const char *name) override {
+    Add('E', name);
+    return true;
+  }
+
+  bool Text(const char *str) override {
+    Add('T', str);
+    return true;
+  }
+
+  bool Comment(const char *str) override {
+    Add('C', str);
+    return true;
+  }
+
+  uint64 digest() const { return digest_; }
+
+ private:
+  void Add(char type, const char *str) {
+    uint64 fp = str != nullptr ? Fingerprint(str, strlen(str)) : 0;
+    digest_ = FingerprintCat(digest_, FingerprintCat(type, fp));
+  }
+
+  uint64 digest_ = 0;
+};
+
+// Parse all documents and return digest of the parser events.
+template <class Parser> uint64 ParseAll(const std::vector<string> &docs,
+                                        bool bulk_scan) {
+  uint64 digest = 0;
+  for (const string &doc : docs) {
+    DigestParser<Parser> parser;
+    parser.set_bulk_scan(bulk_scan);
+    StringInputStream stream(doc);
+    Input input(&stream);
+    parser.Parse(&input);
+    digest = FingerprintCat(digest, parser.digest());
+  }
+  return digest;
+}
+
+// Measure parsing speed in MB/s and return digest of the parser events.
+template <class Parser> uint64 Benchmark(const std::vector<string> &docs,
+                                         int64 bytes,
+                                         bool bulk_scan) {
+  uint64 digest = ParseAll<Parser>(docs, bulk_scan);
+  Clock clock;
+  clock.start();
+  for (int i = 0; i < FLAGS_repeat; ++i) ParseAll<Parser>(docs, bulk_scan);
+  clock.stop();
+  double mbs = bytes * FLAGS_repeat / clock.secs() / 1e6;
+  LOG(INFO) << (bulk_scan ? "bulk scan:" : "per char: ") << " "
+            << mbs << " MB/s";
+  return digest;
+}
+
+// Generate synthetic web page.
+static string SyntheticPage() {
+  string page = "<!DOCTYPE html>\n<html>\n<head>\n<title>Test page</title>\n";
+  page += "<script>\nfunction f(a, b) { return a < b ? a : b; }\n";
+  for (int i = 0; i < 20; ++i) page += "var x = f(1, 2) + f(3, 4);\n";
+  page += "</script>\n</head>\n<body>\n<!-- page content -->\n";
+  for (int i = 0; i < 200; ++i) {
+    page += "<p class=\"text\" id=\"p" + std::to_string(i) + "\">";
+    page += "Lorem ipsum dolor sit amet, consectetur adipiscing elit, sed do "
+            "eiusmod tempor incididunt ut labore et dolore magna aliqua. Ut "
+            "enim ad minim veniam, quis nostrud exercitation &amp; ullamco "
+            "laboris nisi ut aliquip ex ea commodo consequat.</p>\n";
+    page += "<a href=\"https://example.com/page?id=" + std::to_string(i) +
+            "&amp;lang=en\">link</a><br>\n";
+  }
+  page += "</body>\n</html>\n";
+  return page;
+}
+
+int main(int argc, char *argv[]) {
+  InitProgram(&argc, &argv);
+
+  // Read documents.
+  std::vector<string> docs;
+  for (int i = 1; i < argc; ++i) {
+    if (FLAGS_warc) {
+      WARCFile warc(argv[i]);
+      while (warc.Next() && docs.size() < FLAGS_max_docs) {
+        string content;
+        const void *data;
+        int size;
+        while (warc.content()->Next(&data, &size)) {
+          content.append(static_cast<const char *>(data), size);
+        }
+        docs.push_back(content);
+      }
+    } else {
+      string content;
+      CHECK(File::ReadContents(argv[i], &content));
+      docs.push_back(content);
+    }
+  }
+  if (docs.empty()) docs.push_back(SyntheticPage());
+
+  int64 bytes = 0;
+  for (const string &doc : docs) bytes += doc.size();
+  LOG(INFO) << docs.size() << " documents, " << bytes << " bytes";
+
+  // Compare parsing speed with and without bulk scanning.
+  uint64 before, after;
+  if (FLAGS_xml) {
+    before = Benchmark<XMLParser>(docs, bytes, false);
+    after = Benchmark<XMLParser>(docs, bytes, true);
+  } else {
+    before = Benchmark<HTMLParser>(docs, bytes, false);
+    after = Benchmark<HTMLParser>(docs, bytes, true);
+  }
+
+  // Check that the parser output is the same.
+  if (before != after) {
+    LOG(ERROR) << "Parser output differs with bulk scanning";
+    return 1;
+  }
+
+  return 0;
+}
@@ -22,6 +22,14 @@
 
 namespace sling {
 
+// Stop characters for text, attribute values, special tags, and unparsed
+// element content.
+static const CharScanner text_stops("<&");
+static const CharScanner quote_stops("\"&");
+static const CharScanner apos_stops("'&");
+static const CharScanner gt_stops(">");
+static const CharScanner lt_stops("<");
+
 bool HTMLParser::IsNameChar(int ch) {
   if (ch < 0) return false;
   if (ch == ' ') return false;
@@ -163,8 +171,8 @@ bool HTMLParser::Parse(Input *input) {
         // Add text to heap buffer.
         AddText(ch);
 
-        // Read next char.
-        ch = ReadChar();
+        // Read until next markup or entity reference.
+        ch = ScanUntil(text_stops);
       }
     } else {
       bool endtag = false;
@@ -284,7 +292,12 @@ bool HTMLParser::Parse(Input *input) {
             }
           }
 
-          ch = ReadChar();
+          // Skip to next '>' when the tag type has been determined.
+          if (comment || doctype || cdata) {
+            ch = ReadChar();
+          } else {
+            ch = ScanUntil(gt_stops);
+          }
         }
       } else {
         if (ch == '/') {
@@ -337,9 +350,9 @@ bool HTMLParser::Parse(Input *input) {
                 if (ch < 0) break;
 
                 if (ch != '&') {
-                  // Add character to attribute value.
+                  // Add characters to attribute value.
                   Add(ch);
-                  ch = ReadChar();
+                  ch = ScanUntil(delim == '"' ? quote_stops : apos_stops);
                 } else {
                   // Process entity reference.
                   string &entref = scratch;
@@ -488,7 +501,9 @@ bool HTMLParser::Parse(Input *input) {
                   }
                   break;
               }
-              ch = ReadChar();
+
+              // Skip to next '<' while scanning.
+              ch = state == 1 ? ScanUntil(lt_stops) : ReadChar();
             }
             AddText(0);
 
@@ -0,0 +1,121 @@
+// Copyright 2025 Ringgaard Research ApS
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <string.h>
+#include <random>
+#include <string>
+
+#include "sling/base/flags.h"
+#include "sling/base/init.h"
+#include "sling/base/logging.h"
+#include "sling/web/char-scanner.h"
+
+DEFINE_int32(max_length, 130, "Maximum buffer length in tests");
+DEFINE_int32(iterations, 2000, "Number of random buffers in tests");
+
+using namespace sling;
+
+// Scalar reference for CharScanner::Find.
+static const char *Reference(const char *stops, const char *begin,
+                             const char *end, int *newlines) {
+  const char *p = begin;
+  while (p < end && strchr(stops, *p) == nullptr) {
+    if (*p == '\n') (*newlines)++;
+    p++;
+  }
+  return p;
+}
+
+// Check scanner against reference for all start positions in the buffer.
+static void Check(const char *stops, const string &buffer) {
+  CharScanner scanner(stops);
+
+  // Copy the buffer to exactly sized memory, so reads past the end are not
+  // hidden by the string padding.
+  int size = buffer.size();
+  char *data = new char[size];
+  memcpy(data, buffer.data(), size);
+  const char *end = data + size;
+  for (int start = 0; start <= size; ++start) {
+    int expected_lines = 5;
+    int actual_lines = 5;
+    const char *expected = Reference(stops, data + start, end, &expected_lines);
+    const char *actual = scanner.Find(data + start, end, &actual_lines);
+    CHECK_EQ(actual - data, expected - data)
+        << "stops '" << stops << "' size " << size << " start " << start;
+    CHECK_EQ(actual_lines, expected_lines)
+        << "stops '" << stops << "' size " << size << " start " << start;
+  }
+  delete [] data;
+}
+
+// A single stop character at every position in buffers of every length. The
+// lengths cover full 32 and 16 byte blocks and all scalar tail lengths.
+static void TestSingleStop() {
+  for (int length = 0; length <= FLAGS_max_length; ++length) {
+    for (int pos = -1; pos < length; ++pos) {
+      string buffer(length, 'a');
+      for (int i = 0; i < length; i += 3) buffer[i] = '\n';
+      if (pos >= 0) buffer[pos] = '<';
+      Check("<", buffer);
+      Check("<&", buffer);
+      Check("\"&'>", buffer);
+    }
+  }
+}
+
+// Newlines as stop characters are both found and counted before the stop.
+static void TestNewlineStop() {
+  for (int length = 0; length <= FLAGS_max_length; ++length) {
+    string buffer(length, 'x');
+    for (int i = 7; i < length; i += 11) buffer[i] = '\n';
+    Check("\n", buffer);
+    Check("-\n", buffer);
+  }
+}
+
+// Random buffers with stop characters, newlines, and characters with the high
+// bit set, which compare as negative bytes.
+static void TestRandom() {
+  static const char *stop_sets[] = {
+    "<", "<&", "\"&", "'&", "->", ">", "<&>\"", "\xe2", "\n<",
+  };
+  static const char alphabet[] = "abc <&\"'->\n\t\xe2\x80\x9c\xff";
+  std::mt19937 prng(42);
+  std::uniform_int_distribution<int> length(0, FLAGS_max_length);
+  std::uniform_int_distribution<int> text(0, 99);
+  std::uniform_int_distribution<int> special(0, sizeof(alphabet) - 2);
+  for (int i = 0; i < FLAGS_iterations; ++i) {
+    // Most characters are ordinary, so the stops are spread out.
+    string buffer(length(prng), 0);
+    for (char &c : buffer) {
+      c = text(prng) < 90 ? 'a' + text(prng) % 26 : alphabet[special(prng)];
+    }
+    for (const char *stops : stop_sets) Check(stops, buffer);
+  }
+}
+
+int main(int argc, char *argv[]) {
+  InitProgram(&argc, &argv);
+
+  TestSingleStop();
+  LOG(INFO) << "Single stop passed";
+  TestNewlineStop();
+  LOG(INFO) << "Newline stop passed";
+  TestRandom();
+  LOG(INFO) << "Random buffers passed";
+
+  LOG(INFO) << "Char scanner test passed";
+  return 0;
+}
@@ -0,0 +1,275 @@
+// Copyright 2025 Ringgaard Research ApS
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <random>
+#include <string>
+#include <vector>
+
+#include "sling/base/flags.h"
+#include "sling/base/init.h"
+#include "sling/base/logging.h"
+#include "sling/stream/input.h"
+#include "sling/stream/memory.h"
+#include "sling/string/strcat.h"
+#include "sling/web/html-parser.h"
+#include "sling/web/xml-parser.h"
+
+DEFINE_int32(documents, 200, "Number of random documents in tests");
+
+using namespace sling;
+
+// Parser that records all callbacks together with the current line number.
+template <class Parser> class Recorder : public Parser {
+ public:
+  bool StartDocument() override { return Event("start"); }
+  bool EndDocument() override { return Event("end"); }
+
+  bool StartElement(const XMLElement &element) override {
+    return Event(StrCat("<", element.name, Attributes(element), ">"));
+  }
+
+  bool EndElement(const char *name) override {
+    return Event(StrCat("</", name, ">"));
+  }
+
+  bool Text(const char *str) override { return Event(StrCat("text:", str)); }
+
+  bool Comment(const char *str) override {
+    return Event(StrCat("comment:", str));
+  }
+
+  bool ProcessingInstruction(const XMLElement &element) override {
+    return Event(StrCat("<?", element.name, Attributes(element), "?>"));
+  }
+
+  // Record event.
+  bool Event(const string &event) {
+    StrAppend(&log_, this->line_, " ", event, "\n");
+    return true;
+  }
+
+  // Parse text and return the log of callbacks.
+  string Run(const string &text, bool bulk_scan, int block_size) {
+    log_.clear();
+    this->set_bulk_scan(bulk_scan);
+    ArrayInputStream stream(text.data(), text.size(), block_size);
+    Input input(&stream);
+    bool ok = this->Parse(&input);
+    StrAppend(&log_, this->line_, ok ? " ok" : " failed");
+    return log_;
+  }
+
+ private:
+  // Return attributes for element.
+  static string Attributes(const XMLElement &element) {
+    string attrs;
+    for (const XMLAttribute &attr : element.attrs) {
+      StrAppend(&attrs, " ", attr.name, "=[",
+                attr.value ? attr.value : "null", "]");
+    }
+    return attrs;
+  }
+
+  string log_;
+};
+
+typedef Recorder<XMLParser> XMLRecorder;
+
+class HTMLRecorder : public Recorder<HTMLParser> {
+ public:
+  bool DocType(const char *str) override {
+    return Event(StrCat("doctype:", str));
+  }
+
+  bool CData(const char *str) override { return Event(StrCat("cdata:", str)); }
+};
+
+// Generator for random documents. The text runs are long enough to span
+// several scanner blocks and input buffers.
+class Generator {
+ public:
+  explicit Generator(bool html) : html_(html), prng_(html ? 17 : 42) {}
+
+  // Generate document.
+  string Document() {
+    string doc;
+    if (html_) {
+      if (Random(2) == 0) doc.append("<!DOCTYPE html>\n");
+    } else {
+      doc.append("<?xml version=\"1.0\" encoding='utf-8'?>\n");
+    }
+    Element(&doc, 0);
+    doc.append("\n");
+    return doc;
+  }
+
+ private:
+  // Generate element with random content.
+  void Element(string *doc, int depth) {
+    static const char *names[] = {"a", "div", "p", "x:item", "span-1"};
+    string name = names[Random(5)];
+    StrAppend(doc, "<", name);
+    int attrs = Random(4);
+    for (int i = 0; i < attrs; ++i) {
+      string value = Text(20);
+      if (Random(2) == 0) {
+        StrAppend(doc, " at", i, "=\"", value, "'\"");
+      } else {
+        StrAppend(doc, "\n  at", i, " = '", value, "\"'");
+      }
+    }
+    doc->append(">");
+
+    int parts = Random(8);
+    for (int i = 0; i < parts; ++i) {
+      switch (Random(html_ ? 8 : 5)) {
+        case 0:
+          doc->append(Text(200));
+          break;
+        case 1:
+          if (depth < 4) {
+            Element(doc, depth + 1);
+          } else {
+            doc->append(Text(50));
+          }
+          break;
+        case 2:
+          StrAppend(doc, "<!-- ", Text(100), " - -> --->");
+          break;
+        case 3:
+          doc->append("<empty a=\"1\"/>");
+          break;
+        case 4:
+          doc->append(" &amp;&lt;&#65;&#x42;&gt;\n");
+          break;
+        case 5:
+          StrAppend(doc, "<![CDATA[", Text(100), " ] ]> ]]>");
+          break;
+        case 6:
+          StrAppend(doc, "<script>if (a < b && c > d) {", Text(100),
+                    "}</script>");
+          break;
+        case 7:
+          StrAppend(doc, "<br><img src=", Random(1000), " alt='", Text(30),
+                    "'>");
+          break;
+      }
+    }
+    StrAppend(doc, "</", name, ">");
+  }
+
+  // Generate text run with up to n characters. The text has newlines, UTF-8
+  // sequences, and entity references, but no markup.
+  string Text(int n) {
+    static const char *specials[] = {
+      "\n", "\n\n", "\t", "\xc3\xa6", "\xe2\x80\x9c", "&amp;", "&#1234;",
+      "&quot;", "-", "--", ">", "?", "/",
+    };
+    string text;
+    int length = Random(n + 1);
+    while (text.size() < length) {
+      if (Random(10) == 0) {
+        text.append(specials[Random(13)]);
+      } else {
+        text.push_back('a' + Random(26));
+      }
+    }
+    return text;
+  }
+
+  // Return random number in [0, n).
+  int Random(int n) {
+    return std::uniform_int_distribution<int>(0, n - 1)(prng_);
+  }
+
+  bool html_;
+  std::mt19937 prng_;
+};
+
+// Parse document with and without bulk scanning and different input buffer
+// sizes, and check that the parser callbacks are the same.
+template <class Parser> static void CheckDocument(const string &text) {
+  static const int block_sizes[] = {1, 7, 31, 64, 4096};
+  Parser reference;
+  string expected = reference.Run(text, false, -1);
+  for (int block_size : block_sizes) {
+    for (bool bulk_scan : {false, true}) {
+      Parser parser;
+      string actual = parser.Run(text, bulk_scan, block_size);
+      CHECK_EQ(actual, expected)
+          << "bulk scan " << bulk_scan << " block size " << block_size
+          << "\ndocument:\n" << text;
+    }
+  }
+}
+
+// Fixed XML documents, including malformed ones where the parsers must fail
+// on the same line.
+static void TestXMLDocuments() {
+  std::vector<string> docs = {
+    "",
+    "<a/>",
+    "<a>text</a>",
+    "<a x=\"1\" y='2'>&lt;b&gt; &unknown; &#169;</a>",
+    "<?pi a=\"b\"?>\n<r>\n<!--\ncomment - with -- dashes\n-->\n</r>",
+    "<r>" + string(1000, 'x') + "\n" + string(100, 'y') + "</r>",
+    "<r>\n\n<!-- unterminated",
+    "<r a=\"unterminated\n\n",
+    "<r>\n</s>",
+    "<r>\n\n",
+  };
+  for (const string &doc : docs) CheckDocument<XMLRecorder>(doc);
+}
+
+// Fixed HTML documents.
+static void TestHTMLDocuments() {
+  std::vector<string> docs = {
+    "",
+    "<!DOCTYPE html><html><body>text</body></html>",
+    "<p>unclosed<br>line\n<img src=x.png alt='a > b'>",
+    "<script>\nif (a < b) x = '</p>';\n</script>\n<style>p > a {}</style>",
+    "<![CDATA[\n<not markup> & ]]>",
+    "<!-- comment\nwith > and -- -->",
+    "<p>" + string(1000, 'x') + "&nbsp;&mdash;" + string(100, '\n') + "</p>",
+    "<a href=\"x&amp;y\n\">&",
+    "<p>\n<!DOCTYPE",
+  };
+  for (const string &doc : docs) CheckDocument<HTMLRecorder>(doc);
+}
+
+// Random documents.
+static void TestRandomDocuments() {
+  Generator xml(false);
+  for (int i = 0; i < FLAGS_documents; ++i) {
+    CheckDocument<XMLRecorder>(xml.Document());
+  }
+  Generator html(true);
+  for (int i = 0; i < FLAGS_documents; ++i) {
+    CheckDocument<HTMLRecorder>(html.Document());
+  }
+}
+
+int main(int argc, char *argv[]) {
+  InitProgram(&argc, &argv);
+
+  TestXMLDocuments();
+  LOG(INFO) << "XML documents passed";
+  TestHTMLDocuments();
+  LOG(INFO) << "HTML documents passed";
+  TestRandomDocuments();
+  LOG(INFO) << "Random documents passed";
+
+  LOG(INFO) << "Parser test passed";
+  return 0;
+}
@@ -0,0 +1,154 @@
+// Copyright 2025 Ringgaard Research ApS
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <string.h>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "sling/base/flags.h"
+#include "sling/base/init.h"
+#include "sling/base/logging.h"
+#include "sling/file/file.h"
+#include "sling/string/strcat.h"
+#include "sling/util/fingerprint.h"
+#include "sling/web/web-archive.h"
+#include "third_party/zlib/zlib.h"
+
+DEFINE_int32(records, 200, "Number of records in test archive");
+DEFINE_int32(workers, 4, "Number of decompression workers");
+
+using namespace sling;
+
+// Compress data into a GZIP member.
+static string Compress(const string &data) {
+  z_stream stream;
+  memset(&stream, 0, sizeof(stream));
+  CHECK(deflateInit2(&stream, Z_BEST_SPEED, Z_DEFLATED, 15 + 16, 8,
+                     Z_DEFAULT_STRATEGY) == Z_OK);
+  string output(deflateBound(&stream, data.size()), 0);
+  stream.next_in = reinterpret_cast<Bytef *>(const_cast<char *>(data.data()));
+  stream.avail_in = data.size();
+  stream.next_out = reinterpret_cast<Bytef *>(&output[0]);
+  stream.avail_out = output.size();
+  CHECK(deflate(&stream, Z_FINISH) == Z_STREAM_END);
+  output.resize(stream.total_out);
+  CHECK(deflateEnd(&stream) == Z_OK);
+  return output;
+}
+
+// Return record id.
+static string RecordID(int i) { return StrCat("<urn:test:", i, ">"); }
+
+// Write WARC file where each record is a separate GZIP member. The contents
+// are random bytes, so they hardly compress and the file is split into many
+// segments by the decompressor. Returns the fingerprints of the contents.
+static std::vector<uint64> WriteArchive(const string &filename) {
+  std::mt19937 prng(42);
+  std::uniform_int_distribution<int> size(1000, 200000);
+  std::vector<uint64> fingerprints;
+  string archive;
+  for (int i = 0; i < FLAGS_records; ++i) {
+    string content(size(prng), 0);
+    for (char &c : content) c = prng();
+    fingerprints.push_back(Fingerprint(content.data(), content.size()));
+    string record = StrCat("WARC/1.0\r\n",
+                           "WARC-Type: response\r\n",
+                           "WARC-Target-URI: http://example.com/", i, "\r\n",
+                           "WARC-Record-ID: ", RecordID(i), "\r\n",
+                           "Content-Length: ", content.size(), "\r\n",
+                           "\r\n");
+    record.append(content);
+    record.append("\r\n\r\n");
+    archive.append(Compress(record));
+  }
+  CHECK(File::WriteContents(filename, archive));
+  LOG(INFO) << "Archive with " << FLAGS_records << " records, "
+            << archive.size() << " bytes";
+  return fingerprints;
+}
+
+// Read content of current record.
+static string ReadContent(WARCInput *warc) {
+  string content;
+  const void *data;
+  int size;
+  while (warc->content()->Next(&data, &size)) {
+    content.append(static_cast<const char *>(data), size);
+  }
+  CHECK_EQ(content.size(), warc->content_length());
+  return content;
+}
+
+// Read archive and check that all records are returned once with the right
+// content. In ordered mode, the records must be in file order.
+static void ReadArchive(WARCInput *warc,
+                        const std::vector<uint64> &fingerprints,
+                        bool ordered) {
+  std::vector<bool> seen(FLAGS_records);
+  int count = 0;
+  int out_of_order = 0;
+  while (warc->Next()) {
+    int index = -1;
+    for (int i = 0; i < FLAGS_records; ++i) {
+      if (warc->id() == RecordID(i)) index = i;
+    }
+    CHECK_GE(index, 0) << warc->id();
+    CHECK(!seen[index]) << "duplicate record " << warc->id();
+    seen[index] = true;
+    if (index != count) out_of_order++;
+    CHECK(warc->uri() == StrCat("http://example.com/", index));
+    string content = ReadContent(warc);
+    CHECK_EQ(Fingerprint(content.data(), content.size()), fingerprints[index])
+        << warc->id();
+    count++;
+  }
+  CHECK_EQ(count, FLAGS_records);
+  if (ordered) CHECK_EQ(out_of_order, 0);
+  LOG(INFO) << (ordered ? "Ordered" : "Unordered") << " read, "
+            << out_of_order << " records out of order";
+}
+
+int main(int argc, char *argv[]) {
+  InitProgram(&argc, &argv);
+
+  string dir;
+  CHECK(File::CreateTempDir(&dir));
+  string filename = dir + "/test.warc.gz";
+  std::vector<uint64> fingerprints = WriteArchive(filename);
+
+  // Read archive sequentially.
+  {
+    WARCFile warc(filename);
+    ReadArchive(&warc, fingerprints, true);
+  }
+
+  // Read archive with parallel decompression in file order.
+  {
+    ParallelWARCFile warc(filename, FLAGS_workers, true);
+    ReadArchive(&warc, fingerprints, true);
+  }
+
+  // Read archive with parallel decompression in completion order.
+  {
+    ParallelWARCFile warc(filename, FLAGS_workers, false);
+    ReadArchive(&warc, fingerprints, false);
+  }
+
+  CHECK(File::Delete(filename));
+  CHECK(File::Rmdir(dir));
+
+  LOG(INFO) << "Web archive test passed";
+  return 0;
+}
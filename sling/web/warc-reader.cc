@@ -50,6 +50,8 @@ class WARCReader : public Process {
     int buffer_size = task->Get("buffer_size", 1 << 16);
     int max_warc_files = task->Get("max_warc_files", -1);
     string warc_type = task->Get("warc_type", "");
+    int decompression_threads = task->Get("decompression_threads", 0);
+    bool ordered = task->Get("ordered", true);
 
     // Statistics counters.
     Counter *files_read = task->GetCounter("warc_files_read");
@@ -59,33 +61,41 @@ class WARCReader : public Process {
     // Process all input files.
     int num_warc_files = 0;
     for (Binding *input : inputs) {
-      // Open WARC file.
-      VLOG(1) << "Read WARC file: " << input->resource()->name();
-      WARCFile warc(input->resource()->name(), buffer_size);
+      // Open WARC file. Gzipped WARC files can optionally be decompressed
+      // in parallel by a pool of worker threads.
+      const string &filename = input->resource()->name();
+      VLOG(1) << "Read WARC file: " << filename;
+      WARCInput *warc;
+      if (decompression_threads > 0) {
+        warc = new ParallelWARCFile(filename, decompression_threads, ordered,
+                                    buffer_size);
+      } else {
+        warc = new WARCFile(filename, buffer_size);
+      }
 
       // Process all blocks in web archive.
-      while (warc.Next()) {
+      while (warc->Next()) {
         // Check WARC record type.
-        if (!warc_type.empty() && warc.type() != warc_type) {
+        if (!warc_type.empty() && warc->type() != warc_type) {
           continue;
         }
 
         // Create message where the key is the WARC header and the value is the
         // record content.
-        int key_size = warc.headers().buffer().size();
-        int value_size = warc.content_length();
+        int key_size = warc->headers().buffer().size();
+        int value_size = warc->content_length();
         Message *message = new Message(key_size, value_size);
 
         // Copy WARC header to message key.
         memcpy(message->key_buffer()->data(),
-               warc.headers().buffer().data(),
+               warc->headers().buffer().data(),
                key_size);
 
         // Copy WARC record content to message value.
         char *value = message->value_buffer()->data();
         const void *data;
         int size;
-        while (warc.content()->Next(&data, &size)) {
+        while (warc->content()->Next(&data, &size)) {
           memcpy(value, data, size);
           value += size;
         }
@@ -97,6 +107,8 @@ class WARCReader : public Process {
         bytes_read->Increment(value_size);
       }
 
+      delete warc;
+
       // Stop if we have reached the maximum number of files.
       files_read->Increment();
       if (++num_warc_files >= max_warc_files && max_warc_files > 0) break;
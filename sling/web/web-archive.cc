@@ -16,6 +16,8 @@
 
 #include "sling/base/logging.h"
 #include "sling/stream/bounded.h"
+#include "sling/stream/file.h"
+#include "sling/stream/parallel-gzip.h"
 #include "sling/string/numbers.h"
 
 namespace sling {
@@ -57,5 +59,20 @@ bool WARCInput::ParseHeader() {
   return true;
 }
 
+InputStream *ParallelWARCFile::Open(const string &filename, int num_workers,
+                                    bool ordered, int block_size) {
+  // Use standard file input for uncompressed files.
+  if (filename.size() < 3 || filename.substr(filename.size() - 3) != ".gz") {
+    return FileInput::Open(filename, block_size);
+  }
+
+  // Decompress gzip members in parallel.
+  InputPipeline *pipeline = new InputPipeline();
+  InputStream *file = new FileInputStream(filename, block_size);
+  pipeline->Add(file);
+  pipeline->Add(new ParallelGZipDecompressor(file, num_workers, ordered));
+  return pipeline;
+}
+
 }  // namespace sling
 
@@ -31,7 +31,7 @@ class WARCInput {
  public:
   // Initialize WARC file input stream.
   WARCInput(InputStream *stream) : stream_(stream) {}
-  ~WARCInput() { delete content_; }
+  virtual ~WARCInput() { delete content_; }
 
   // Fetch next WARC data block. Return false if there are no more data blocks.
   bool Next();
@@ -90,7 +90,25 @@ class WARCFile : public WARCInput {
   WARCFile(const string &filename, int block_size = 1 << 20)
       : WARCInput(FileInput::Open(filename, block_size)) {}
 
-  ~WARCFile() { delete stream(); }
+  ~WARCFile() override { delete stream(); }
+};
+
+// WARC file reader that decompresses gzip members in parallel. Records are
+// returned in file order unless ordered is false, in which case records are
+// returned as soon as their member has been decompressed. Unordered reading
+// requires that records do not span gzip members.
+class ParallelWARCFile : public WARCInput {
+ public:
+  ParallelWARCFile(const string &filename, int num_workers,
+                   bool ordered = true, int block_size = 1 << 20)
+      : WARCInput(Open(filename, num_workers, ordered, block_size)) {}
+
+  ~ParallelWARCFile() override { delete stream(); }
+
+ private:
+  // Open WARC file and add parallel decompression for gzipped files.
+  static InputStream *Open(const string &filename, int num_workers,
+                           bool ordered, int block_size);
 };
 
 }  // namespace sling
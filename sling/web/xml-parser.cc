@@ -25,6 +25,12 @@
 
 namespace sling {
 
+// Stop characters for text, attribute values, and comments.
+static const CharScanner text_stops("<&");
+static const CharScanner quote_stops("\"&");
+static const CharScanner apos_stops("'&");
+static const CharScanner comment_stops("->");
+
 const char *XMLElement::Get(const char *name, const char *defval) const {
   for (const XMLAttribute &attr : attrs) {
     if (strcmp(attr.name, name) == 0) return attr.value;
@@ -49,15 +55,25 @@ XMLParser:: ~XMLParser() {
 }
 
 void XMLParser::Add(char ch) {
+  // Expand buffer if there is no more room.
+  if (bufptr_ == bufend_) Expand(1);
+
   // Add character to buffer.
-  if (bufptr_ < bufend_) {
-    *bufptr_++ = ch;
-    return;
-  }
+  *bufptr_++ = ch;
+}
+
+void XMLParser::AddRun(const char *data, int size) {
+  if (bufend_ - bufptr_ < size) Expand(size);
+  memcpy(bufptr_, data, size);
+  bufptr_ += size;
+}
 
-  // No more room in buffer, expand it.
+void XMLParser::Expand(int size) {
+  // Double buffer size until there is room for the data.
+  int used = bufptr_ - buffer_;
   int buflen = bufend_ - buffer_;
-  int newlen = buflen * 2;
+  int newlen = buflen;
+  while (newlen - used < size) newlen *= 2;
   char *newbuf = static_cast<char *>(realloc(buffer_, newlen));
 
   // If the buffer has been moved to a new location, adjust pointers.
@@ -78,9 +94,6 @@ void XMLParser::Add(char ch) {
   }
 
   bufend_ = buffer_ + newlen;
-
-  // Add character to new buffer.
-  *bufptr_++ = ch;
 }
 
 void XMLParser::AddText(char ch) {
@@ -109,6 +122,22 @@ int XMLParser::SkipWhitespace(int ch) {
   return ch;
 }
 
+int XMLParser::ScanUntil(const CharScanner &stops) {
+  if (!bulk_scan_) return ReadChar();
+
+  // Add characters from the input buffer up to the first stop character.
+  const char *data;
+  int size;
+  while (input_->PeekBuffer(&data, &size)) {
+    const char *end = stops.Find(data, data + size, &line_);
+    int n = end - data;
+    AddRun(data, n);
+    input_->Skip(n);
+    if (n < size) return ReadChar();
+  }
+  return -1;
+}
+
 bool XMLParser::Error(const char *message) {
   LOG(ERROR) << "XML parse error line " << line_ << ": " << message;
   return false;
@@ -160,8 +189,8 @@ bool XMLParser::Parse(Input *input) {
         // Add text to heap buffer.
         AddText(ch);
 
-        // Read next char.
-        ch = ReadChar();
+        // Read until next markup or entity reference.
+        ch = ScanUntil(text_stops);
       }
     } else {
       bool pi = false;
@@ -210,7 +239,7 @@ bool XMLParser::Parse(Input *input) {
               } else {
                 dashes = 0;
               }
-              ch = ReadChar();
+              ch = dashes > 0 ? ReadChar() : ScanUntil(comment_stops);
             }
           } else {
             AddText('<');
@@ -304,7 +333,7 @@ bool XMLParser::Parse(Input *input) {
               }
             } else {
               Add(ch);
-              ch = ReadChar();
+              ch = ScanUntil(delim == '"' ? quote_stops : apos_stops);
             }
           }
           Add(0);
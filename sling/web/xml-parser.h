@@ -18,6 +18,7 @@
 #include <vector>
 
 #include "sling/stream/input.h"
+#include "sling/web/char-scanner.h"
 
 namespace sling {
 
@@ -64,6 +65,10 @@ class XMLParser {
   // Input stream.
   Input *input() const { return input_; }
 
+  // Enable or disable bulk scanning of text runs. When disabled, the input is
+  // processed one character at a time.
+  void set_bulk_scan(bool bulk_scan) { bulk_scan_ = bulk_scan; }
+
  protected:
   // Initialize document state.
   void Init(Input *input);
@@ -72,6 +77,10 @@ class XMLParser {
   void Add(char ch);
   void AddText(char ch);
   void AddString(const char *text);
+  void AddRun(const char *data, int size);
+
+  // Expand buffer to make room for more data.
+  void Expand(int size);
 
   // Read next character from input. Return -1 on end of input.
   int ReadChar();
@@ -79,6 +88,10 @@ class XMLParser {
   // Skip whitespace.
   int SkipWhitespace(int ch);
 
+  // Add characters from the input to the buffer until one of the stop
+  // characters is found. Returns the stop character or -1 on end of input.
+  int ScanUntil(const CharScanner &stops);
+
   // Log error.
   bool Error(const char *message);
 
@@ -104,6 +117,9 @@ class XMLParser {
 
   // Element name stack.
   std::vector<char *> stack_;
+
+  // Scan runs of text in bulk.
+  bool bulk_scan_ = true;
 };
 
 }  // namespace sling
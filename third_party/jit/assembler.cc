@@ -4534,7 +4534,9 @@ void Assembler::emit_evex_prefix(ZMMRegister reg, ZMMRegister vreg,
   // Masking (z and aaa).
   p2 |= (mask.op() << 7) | mask.reg().code();
 
-  // Broadcasting, rounding and exception supression (b).
+  // Broadcasting, rounding and exception supression (b). Exception
+  // suppression only applies to register operands, and the b bit must not be
+  // set for memory operands of instructions without broadcast.
   if (flags & EVEX_BCST) {
     // Broadcast memory source operand.
     if (rm.load() == broadcast) p2 |= 0x10;
@@ -4543,9 +4545,6 @@ void Assembler::emit_evex_prefix(ZMMRegister reg, ZMMRegister vreg,
     p2 |= 0x10;
     if (flags & EVEX_R0) p2 |= 0x20;
     if (flags & EVEX_R1) p2 |= 0x40;
-  } else if (flags & EVEX_SAE) {
-    // Suppress all exceptions.
-    p2 |= 0x10;
   }
 
   // Emit four-byte EVEX prefix.
@@ -4968,6 +4967,10 @@ void Assembler::emit_sse_operand(ZMMRegister reg, const Operand &adr,
     } else if (flags & EVEX_DT64) {
       ts = 64;
     }
+
+    // The data type size is for 128-bit vectors if the memory operand is a
+    // fraction of the vector length.
+    if (flags & EVEX_DTVL) ts = ts * regsize / 16;
   }
 
   // Suffix length is one if there is an immediate byte.
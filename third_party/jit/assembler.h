@@ -261,6 +261,8 @@ class Assembler : public CodeGenerator {
 
     EVEX_BT4    = (1 << 29),   // 4-byte broadcast data type
     EVEX_BT8    = (1 << 30),   // 8-byte broadcast data type
+
+    EVEX_DTVL   = (1u << 31),  // data type size scales with vector length
   };
 
   // Code generation
@@ -1736,6 +1738,12 @@ class Assembler : public CodeGenerator {
     YMMRegister isrc = {src.code()};
     vinstr(0x25, dst, ymm0, isrc, k66, k0F38, kWIG);
   }
+  void vpmovzxwd(XMMRegister dst, const Operand &src) {
+    vinstr(0x33, dst, xmm0, src, k66, k0F38, kWIG);
+  }
+  void vpmovzxwd(YMMRegister dst, const Operand &src) {
+    vinstr(0x33, dst, ymm0, src, k66, k0F38, kWIG);
+  }
 
   void vcmpss(XMMRegister dst, XMMRegister src1, XMMRegister src2, int8_t cmp) {
     vss(0xC2, dst, src1, src2);
@@ -2380,6 +2388,19 @@ class Assembler : public CodeGenerator {
     vinstr(0x5b, dst, ymm0, src, kF3, k0F, kWIG);
   }
 
+  void vcvtps2dq(XMMRegister dst, XMMRegister src) {
+    vinstr(0x5b, dst, xmm0, src, k66, k0F, kWIG);
+  }
+  void vcvtps2dq(XMMRegister dst, const Operand &src) {
+    vinstr(0x5b, dst, xmm0, src, k66, k0F, kWIG);
+  }
+  void vcvtps2dq(YMMRegister dst, YMMRegister src) {
+    vinstr(0x5b, dst, ymm0, src, k66, k0F, kWIG);
+  }
+  void vcvtps2dq(YMMRegister dst, const Operand &src) {
+    vinstr(0x5b, dst, ymm0, src, k66, k0F, kWIG);
+  }
+
   void vcvtdq2pd(XMMRegister dst, XMMRegister src) {
     vinstr(0xe6, dst, xmm0, src, kF3, k0F, kWIG);
   }
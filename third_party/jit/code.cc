@@ -201,5 +201,16 @@ void Code::Allocate(void *code, int size) {
   CHECK_EQ(rc, 0);
 }
 
+void Code::Map(void *memory, int size) {
+  // Take ownership of mapped memory.
+  CHECK(memory_ == nullptr);
+  memory_ = static_cast<byte *>(memory);
+  size_ = size;
+
+  // Make code executable and remove write permissions.
+  int rc = mprotect(memory_, size_, PROT_READ | PROT_EXEC);
+  CHECK_EQ(rc, 0);
+}
+
 }  // namespace jit
 }  // namespace sling
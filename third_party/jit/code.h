@@ -259,6 +259,10 @@ class Code {
     Allocate(generator->begin(), generator->size());
   }
 
+  // Take ownership of page-aligned code block that has been mapped into memory
+  // with mmap() and make it executable.
+  void Map(void *memory, int size);
+
   // Memory range for code block.
   byte *begin() const { return memory_; }
   byte *end() const { return memory_ + size_; }
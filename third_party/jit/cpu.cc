@@ -48,11 +48,11 @@ uint32_t CPU::page_size = 0;
 uint64_t CPU::memory_size = 0;
 bool CPU::vzero_needed = false;
 
-static void __cpuid(int cpu_info[4], int info_type) {
+static void __cpuid(int cpu_info[4], int info_type, int sub_type = 0) {
   __asm__ volatile ("cpuid \n\t"
                     : "=a"(cpu_info[0]), "=b"(cpu_info[1]), "=c"(cpu_info[2]),
                       "=d"(cpu_info[3])
-                    : "a"(info_type), "c"(0));
+                    : "a"(info_type), "c"(sub_type));
 }
 
 static uint64_t xgetbv(unsigned int xcr) {
@@ -142,6 +142,12 @@ ProcessorInformation::ProcessorInformation() {
     avx512[AVX512VPOPCNTDQ] = has(2, 14);
     avx512[AVX512_4VNNIW] = has(3, 2);
     avx512[AVX512_4FMAPS] = has(3, 3);
+
+    // Newer AVX-512 extensions are reported in sub-leaf 1.
+    if (cpu_info[0] >= 1) {
+      __cpuid(cpu_info, 7, 1);
+      avx512[AVX512_BF16] = has(0, 5);
+    }
   }
 
   // Query extended IDs.
@@ -281,6 +287,12 @@ void CPU::Initialize() {
     if (cpu.has_avx2()) features |= 1u << AVX2;
     if (cpu.has_avx512(ProcessorInformation::AVX512F)) {
       features |= 1u << AVX512F;
+      if (cpu.has_avx512(ProcessorInformation::AVX512VNNI)) {
+        features |= 1u << AVX512VNNI;
+      }
+      if (cpu.has_avx512(ProcessorInformation::AVX512_BF16)) {
+        features |= 1u << AVX512BF16;
+      }
     }
   }
 
@@ -57,6 +57,7 @@ class ProcessorInformation {
     AVX512VPOPCNTDQ,  // AVX-512 Vector Population Count Double and Quad-word
     AVX512_4VNNIW,    // AVX-512 4-reg Neural Network Instructions
     AVX512_4FMAPS,    // AVX-512 4-reg Multiply Accumulation Single precision
+    AVX512_BF16,      // AVX-512 BFLOAT16 Instructions
     NUMBER_OF_AVX512_FEATURES
   };
 
@@ -101,7 +102,7 @@ class ProcessorInformation {
   bool has_popcnt() const { return has_popcnt_; }
   bool has_zero_idiom() const { return has_zero_idiom_; }
   bool has_one_idiom() const { return has_one_idiom_; }
-  bool has_avx512(AVX512Feature f) const { return avx512[1 << f]; }
+  bool has_avx512(AVX512Feature f) const { return avx512[f]; }
 
  private:
   char vendor_[13];
@@ -158,6 +159,8 @@ enum CpuFeature {
   POPCNT,
   ZEROIDIOM,
   ONEIDIOM,
+  AVX512VNNI,
+  AVX512BF16,
 
   NUMBER_OF_CPU_FEATURES,
 };
@@ -39,6 +39,7 @@ class Method:
     self.er = False
     self.sae = False
     self.ireg = -1
+    self.memsizes = {}
 
   def add_flag(self, flag):
     if flag not in self.flags: self.flags.append(flag)
@@ -53,6 +54,7 @@ class Method:
     m.er = self.er
     m.sae = self.sae
     m.ireg = self.ireg
+    m.memsizes = dict(self.memsizes)
     return m
 
 methods = []
@@ -138,6 +140,7 @@ for line in fin.readlines():
   numargs = 0
   dt = 0
   bt = 0
+  memsize = 0
   for a in arguments:
     arg = a
     arg = re.sub("xmm\d", "xmm0", arg)
@@ -145,6 +148,9 @@ for line in fin.readlines():
     arg = re.sub("zmm\d", "zmm0", arg)
     arg = re.sub("k\d", "k0", arg)
 
+    m = re.search(r"(?:^|/)m(\d+)(?:/|$)", arg)
+    if m and memsize == 0: memsize = int(m.group(1))
+
     if arg.endswith("{er}"):
       er = True
       arg = arg[:-4]
@@ -291,6 +297,9 @@ for line in fin.readlines():
   if dt != 0: method.add_flag("EVEX_DT" + str(int(dt / 8)))
   if bt != 0: method.add_flag("EVEX_BT" + str(int(bt / 8)))
   if ireg != -1: method.ireg = ireg
+  for flag in flags:
+    if flag in ["EVEX_L128", "EVEX_L256", "EVEX_L512"]:
+      method.memsizes[int(flag[6:])] = memsize
   if mask: method.mask = True
   if bcst: method.bcst = True
   if er: method.er = True
@@ -319,6 +328,19 @@ for method in methods:
     if not find_method(mem_method.name, mem_method.args):
       methods.append(mem_method)
 
+# Memory operands that are a fixed fraction of the vector length, e.g. for
+# vpmovzxwd, use the vector length for computing the disp8*N scaling.
+for method in methods:
+  sizes = method.memsizes
+  if len(sizes) < 2 or 0 in sizes.values(): continue
+  ratios = set(float(l) / m for l, m in sizes.items())
+  if len(ratios) != 1: continue
+  ratio = int(ratios.pop())
+  if ratio < 2: continue
+  method.flags = [f for f in method.flags if not f.startswith("EVEX_DT")]
+  method.add_flag("EVEX_DT" + str(16 // ratio))
+  method.add_flag("EVEX_DTVL")
+
 # Generate instruction methods.
 signatures = []
 for method in sorted(methods, key=lambda x: x.name):